@@ -0,0 +1,193 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/BeatClickGenerator.h"
+
+namespace BeatClick
+{
+	// Accented clicks sit higher, like a metronome's bell
+	constexpr float DownbeatPitch = 1.5f;
+	constexpr float GroupPitch    = 1.25f;
+
+	// A hit is cut once its decay is 60 dB down
+	constexpr float DecaysTo60dB = 6.9f;
+}
+
+uint32 FBeatClickBeat::MakeGroupMask(int32 BeatsPerBar)
+{
+	uint32 Mask = 1;
+	if (BeatsPerBar <= 3) return Mask;
+
+	const bool bThrees = BeatsPerBar % 3 == 0;
+	for (int32 Beat = 0; ; )
+	{
+		Beat += bThrees || BeatsPerBar - Beat == 3 ? 3 : 2;
+		if (Beat >= FMath::Min(BeatsPerBar, 32)) break;
+		Mask |= 1u << Beat;
+	}
+	return Mask;
+}
+
+void FBeatClickGenerator::Init(float InSampleRate)
+{
+	SampleRate = FMath::Max(1.f, InSampleRate);
+	Disarm();
+}
+
+void FBeatClickGenerator::SetAccents(const FBeatClickAccents& InAccents)
+{
+	Accents = InAccents;
+	Accents.Subdivisions = FMath::Clamp(Accents.Subdivisions, 1, 8);
+}
+
+void FBeatClickGenerator::Arm(const FBeatClickBeat& First)
+{
+	Disarm();
+
+	CurrentBeat    = First.Beat;
+	FramesRendered = 0;
+	BeatStart      = 0;
+	NextTick       = 0;
+	TickInBeat     = 0;
+	Apply(First);
+	bArmed = true;
+}
+
+void FBeatClickGenerator::Disarm()
+{
+	bArmed      = false;
+	PendingHead = 0;
+	PendingNum  = 0;
+	NextHit     = 0;
+	for (FHit& Hit : Hits)
+	{
+		Hit.FramesLeft = 0;
+	}
+}
+
+void FBeatClickGenerator::Schedule(const FBeatClickBeat& Beat)
+{
+	if (PendingNum == MaxSchedule)
+	{
+		// Nobody is rendering: the oldest entry is stale anyway
+		PendingHead = (PendingHead + 1) % MaxSchedule;
+		--PendingNum;
+	}
+	Pending[(PendingHead + PendingNum) % MaxSchedule] = Beat;
+	++PendingNum;
+}
+
+void FBeatClickGenerator::Render(float* Out, int32 NumFrames)
+{
+	FMemory::Memzero(Out, NumFrames * sizeof(float));
+	if (!bArmed) return;
+
+	for (int32 Frame = 0; ; )
+	{
+		while (FramesRendered >= NextTick)
+		{
+			if (TickInBeat >= Accents.Subdivisions)
+			{
+				// The last beat's ticks are done: this one starts here
+				TickInBeat = 0;
+				BeatStart += FramesPerBeat;
+				BeatInBar  = (BeatInBar + 1) % BeatsPerBar;
+				++CurrentBeat;
+				BeginBeat();
+			}
+
+			if (TickInBeat > 0)
+			{
+				Trigger(Accents.Subdivision, 1.f);
+			}
+			else if (BeatInBar == 0)
+			{
+				Trigger(Accents.Downbeat, BeatClick::DownbeatPitch);
+			}
+			else if (BeatInBar < 32 && (GroupMask & (1u << BeatInBar)))
+			{
+				Trigger(Accents.Group, BeatClick::GroupPitch);
+			}
+			else
+			{
+				Trigger(Accents.Beat, 1.f);
+			}
+
+			++TickInBeat;
+			NextTick = BeatStart + static_cast<int64>(FramesPerBeat) * FMath::Min(TickInBeat, Accents.Subdivisions) / Accents.Subdivisions;
+		}
+
+		if (Frame >= NumFrames) break;
+
+		const int32 Run = static_cast<int32>(FMath::Min<int64>(NumFrames - Frame, NextTick - FramesRendered));
+		RenderHits(Out + Frame, Run);
+		Frame          += Run;
+		FramesRendered += Run;
+	}
+}
+
+void FBeatClickGenerator::BeginBeat()
+{
+	// Entries for this beat, or late ones for beats already played (their tempo applies from here)
+	while (PendingNum > 0 && Pending[PendingHead].Beat <= CurrentBeat)
+	{
+		Apply(Pending[PendingHead]);
+		PendingHead = (PendingHead + 1) % MaxSchedule;
+		--PendingNum;
+	}
+}
+
+void FBeatClickGenerator::Apply(const FBeatClickBeat& Beat)
+{
+	// Whole frames, as Quartz counts a beat
+	FramesPerBeat = FMath::Max(1, FMath::RoundToInt(60.f * SampleRate / FMath::Max(Beat.BPM, 1.f)));
+	BeatsPerBar   = FMath::Max(1, Beat.BeatsPerBar);
+	GroupMask     = Beat.GroupMask | 1u;
+	BeatInBar     = (Beat.BeatInBar + FMath::Max(0, CurrentBeat - Beat.Beat)) % BeatsPerBar;
+}
+
+void FBeatClickGenerator::Trigger(float Gain, float PitchScale)
+{
+	if (Gain <= 0.f) return;
+
+	// The oldest hit makes way
+	FHit& Hit = Hits[NextHit];
+	NextHit = (NextHit + 1) % MaxHits;
+
+	const float Nyquist   = 0.45f * SampleRate;
+	const float Frequency = FMath::Clamp(Shape.Frequency * PitchScale, 10.f, Nyquist);
+	const float End       = FMath::Clamp(Shape.EndFrequency * PitchScale, 10.f, Nyquist);
+	const float Decay     = FMath::Max(Shape.Decay, 0.001f);
+
+	Hit.FramesLeft   = FMath::Max(1, FMath::CeilToInt(BeatClick::DecaysTo60dB * Decay * SampleRate));
+	Hit.Phase        = 0.f;
+	Hit.PhaseStep    = UE_TWO_PI * Frequency / SampleRate;
+	Hit.StepScale    = FMath::Pow(End / Frequency, 1.f / Hit.FramesLeft);
+	Hit.Level        = 1.f;
+	Hit.LevelScale   = FMath::Exp(-1.f / (Decay * SampleRate));
+	Hit.Gain         = Gain;
+	Hit.Age          = 0;
+	Hit.AttackFrames = FMath::Max(1, FMath::RoundToInt(Shape.Attack * SampleRate));
+}
+
+void FBeatClickGenerator::RenderHits(float* Out, int32 NumFrames)
+{
+	for (FHit& Hit : Hits)
+	{
+		const int32 Count = FMath::Min(NumFrames, Hit.FramesLeft);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const float Ramp = Hit.Age < Hit.AttackFrames ? static_cast<float>(Hit.Age) / Hit.AttackFrames : 1.f;
+			Out[i] += Hit.Gain * Hit.Level * Ramp * FMath::Sin(Hit.Phase);
+
+			Hit.Phase += Hit.PhaseStep;
+			if (Hit.Phase >= UE_TWO_PI)
+			{
+				Hit.Phase -= UE_TWO_PI;
+			}
+			Hit.PhaseStep *= Hit.StepScale;
+			Hit.Level     *= Hit.LevelScale;
+			++Hit.Age;
+		}
+		Hit.FramesLeft -= Count;
+	}
+}
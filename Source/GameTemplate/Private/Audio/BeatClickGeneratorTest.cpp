@@ -0,0 +1,134 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Audio/BeatClickGenerator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace BeatClickGeneratorTest
+{
+	constexpr float SampleRate = 48000.f;
+
+	// A show's worth of tempo and meter changes, on bar lines, as the tempo map hands them out
+	struct FSegment
+	{
+		int32 StartBeat;
+		float BPM;
+		int32 BeatsPerBar;
+	};
+	const FSegment Segments[] = { { 0, 150.f, 4 }, { 16, 141.3f, 7 }, { 30, 97.f, 6 }, { 48, 173.5f, 5 } };
+	constexpr int32 NumBeats = 68;
+
+	FBeatClickBeat MakeBeat(int32 Beat)
+	{
+		const FSegment* Segment = &Segments[0];
+		for (const FSegment& Candidate : Segments)
+		{
+			if (Candidate.StartBeat <= Beat) Segment = &Candidate;
+		}
+
+		FBeatClickBeat Result;
+		Result.Beat        = Beat;
+		Result.BPM         = Segment->BPM;
+		Result.BeatsPerBar = Segment->BeatsPerBar;
+		Result.BeatInBar   = (Beat - Segment->StartBeat) % Segment->BeatsPerBar;
+		Result.GroupMask   = FBeatClickBeat::MakeGroupMask(Segment->BeatsPerBar);
+		return Result;
+	}
+
+	// Renders from FirstBeat in uneven callbacks, scheduling each beat once the one before it has
+	// started (as OnBeat does), and checks every click starts on its frame with its accent's gain
+	void RunPass(FAutomationTestBase& Test, int32 FirstBeat, int32 Subdivisions)
+	{
+		FBeatClickShape Shape;
+		// Gone before the next tick, and peaking within a quarter period (12 frames, less when accented)
+		Shape.Frequency = Shape.EndFrequency = 1000.f;
+		Shape.Decay  = 0.01f;
+		Shape.Attack = 0.f;
+
+		FBeatClickAccents Accents;
+		Accents.Subdivisions = Subdivisions;
+
+		FBeatClickGenerator Generator;
+		Generator.Init(SampleRate);
+		Generator.SetShape(Shape);
+		Generator.SetAccents(Accents);
+		Generator.Arm(MakeBeat(FirstBeat));
+
+		// Expected onsets, frames counted the way Quartz counts them
+		TArray<int64> Onsets;
+		TArray<float> Gains;
+		int64 BeatStart = 0;
+		for (int32 Beat = FirstBeat; Beat < NumBeats; ++Beat)
+		{
+			const FBeatClickBeat Info = MakeBeat(Beat);
+			const int32 FramesPerBeat = FMath::RoundToInt(60.f * SampleRate / Info.BPM);
+			for (int32 Tick = 0; Tick < Subdivisions; ++Tick)
+			{
+				Onsets.Add(BeatStart + static_cast<int64>(FramesPerBeat) * Tick / Subdivisions);
+				Gains.Add(Tick > 0 ? Accents.Subdivision
+					: Info.BeatInBar == 0 ? Accents.Downbeat
+					: (Info.GroupMask & (1u << Info.BeatInBar)) ? Accents.Group
+					: Accents.Beat);
+			}
+			BeatStart += FramesPerBeat;
+		}
+
+		TArray<float> Out;
+		Out.SetNumZeroed(BeatStart);
+		const int32 Callbacks[] = { 1024, 441, 17, 2048, 256, 999 };
+		int32 NextScheduled = FirstBeat + 1;
+		for (int64 Frame = 0, Call = 0; Frame < Out.Num(); ++Call)
+		{
+			while (NextScheduled <= Generator.GetCurrentBeat() + 1 && NextScheduled < NumBeats)
+			{
+				Generator.Schedule(MakeBeat(NextScheduled++));
+			}
+			const int32 Count = static_cast<int32>(FMath::Min<int64>(Callbacks[Call % UE_ARRAY_COUNT(Callbacks)], Out.Num() - Frame));
+			Generator.Render(Out.GetData() + Frame, Count);
+			Frame += Count;
+		}
+
+		int32 NumFailed = 0;
+		for (int32 i = 0; i < Onsets.Num(); ++i)
+		{
+			const int64 Onset = Onsets[i];
+			const bool bSilentBefore = Onset == 0 || FMath::Abs(Out[Onset - 1]) < 1e-6f;
+			float Peak = 0.f;
+			for (int64 Frame = Onset; Frame < FMath::Min<int64>(Onset + 16, Out.Num()); ++Frame)
+			{
+				Peak = FMath::Max(Peak, Out[Frame]);
+			}
+			if ((!bSilentBefore || !FMath::IsNearlyEqual(Peak, Gains[i], 0.03f)) && NumFailed++ < 8)
+			{
+				Test.AddError(FString::Printf(TEXT("From beat %d, %d per beat: click %d expected at frame %lld with gain %.2f, got %.3f (%s before)."),
+					FirstBeat, Subdivisions, i, Onset, Gains[i], Peak, bSilentBefore ? TEXT("silent") : TEXT("sound")));
+			}
+		}
+
+		Test.TestEqual(FString::Printf(TEXT("From beat %d, %d per beat: clicks off their frame or accent, of %d"), FirstBeat, Subdivisions, Onsets.Num()), NumFailed, 0);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBeatClickGeneratorTest, "GameTemplate.Audio.BeatClick",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBeatClickGeneratorTest::RunTest(const FString& Parameters)
+{
+	using namespace BeatClickGeneratorTest;
+
+	TestEqual(TEXT("Groups in 3/4"), static_cast<int32>(FBeatClickBeat::MakeGroupMask(3)), 0b1);
+	TestEqual(TEXT("Groups in 4/4"), static_cast<int32>(FBeatClickBeat::MakeGroupMask(4)), 0b101);
+	TestEqual(TEXT("Groups in 5/4 (2+3)"), static_cast<int32>(FBeatClickBeat::MakeGroupMask(5)), 0b101);
+	TestEqual(TEXT("Groups in 6/4 (3+3)"), static_cast<int32>(FBeatClickBeat::MakeGroupMask(6)), 0b1001);
+	TestEqual(TEXT("Groups in 7/4 (2+2+3)"), static_cast<int32>(FBeatClickBeat::MakeGroupMask(7)), 0b10101);
+
+	// Render through tempo and meter changes, checking every click starts on its Quartz frame with its accent
+	RunPass(*this, 0, 1);
+	RunPass(*this, 16, 2);
+	RunPass(*this, 48, 4);
+	return true;
+}
+
+#endif
@@ -0,0 +1,228 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/BeatClickSynthComponent.h"
+#include "Audio/TempoMap.h"
+#include "Components/AudioComponent.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "World/Subsystems/BeatClockSubsystem.h"
+
+UBeatClickSynthComponent::UBeatClickSynthComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Only ever started on the grid, never free-running
+	bAutoActivate = false;
+}
+
+void UBeatClickSynthComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bStartWithBeatClock)
+	{
+		// Whoever starts the clock may begin play after us
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UBeatClickSynthComponent::StartOnBeatClock);
+	}
+}
+
+void UBeatClickSynthComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopClick();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool UBeatClickSynthComponent::Init(int32& SampleRate)
+{
+	NumChannels = 1;
+
+	Generator.Init(static_cast<float>(SampleRate));
+	Generator.SetShape(MakeShape());
+	Generator.SetAccents(MakeAccents());
+	return true;
+}
+
+int32 UBeatClickSynthComponent::OnGenerateAudio(float* OutAudio, int32 NumSamples)
+{
+	Generator.Render(OutAudio, NumSamples);
+	return NumSamples;
+}
+
+void UBeatClickSynthComponent::StartOnBeatClock()
+{
+	if (bClicking)
+	{
+		if (IsActive()) return;
+
+		// Stopped through USynthComponent::Stop(): drop the beat subscription and start over
+		StopClick();
+	}
+
+	UBeatClockSubsystem* Clock = UBeatClockSubsystem::Get(this);
+	if (!Clock || !Clock->IsClockRunning() || !Clock->GetTempoMap() || !Clock->GetClockHandle())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BeatClickSynthComponent: The beat clock isn't running, click not started."));
+		return;
+	}
+
+	// Creates the audio component the synth plays through and sets the synth sound up on it (Init
+	// runs here, on the game thread), without playing: the quantized play below is the only start
+	Initialize();
+
+	// USynthComponent's own output component, created by Initialize
+	UAudioComponent* Output = AudioComponent;
+	if (!Output)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BeatClickSynthComponent: No audio output (no audio device?), click not started."));
+		return;
+	}
+
+	// The first frame the quantized play renders is the bar line
+	const int32 FirstBeat = Clock->GetNextBoundaryBeat(true);
+	const float FirstBPM  = Clock->IsFollowingMusic() ? Clock->GetScheduledBPM() : Clock->GetTempoMap()->GetBPMAtBeat(FirstBeat);
+	const FBeatClickBeat First = MakeBeat(*Clock, FirstBeat, FirstBPM);
+	SynthCommand([this, First]()
+	{
+		Generator.Arm(First);
+	});
+	LastScheduledBeat = FirstBeat;
+
+	BeatHandle = Clock->OnBeat.AddUObject(this, &UBeatClickSynthComponent::HandleBeat);
+
+	FQuartzQuantizationBoundary Boundary = Clock->MakeBoundaryForBeat(FirstBeat);
+	UQuartzClockHandle* Handle = Clock->GetClockHandle();
+	Output->PlayQuantized(this, Handle, Boundary, FOnQuartzCommandEventBP());
+
+	// USynthComponent only marks itself active when its own Start() plays the sound; this is the
+	// same sound on the same component, so Start() mustn't play it again off the grid and Stop()
+	// has to reach it
+	SetActiveFlag(true);
+	bClicking = true;
+}
+
+void UBeatClickSynthComponent::StopClick()
+{
+	if (UBeatClockSubsystem* Clock = UBeatClockSubsystem::Get(this))
+	{
+		Clock->OnBeat.Remove(BeatHandle);
+	}
+	BeatHandle.Reset();
+
+	if (!bClicking) return;
+
+	// Stops the output and clears the active flag
+	Stop();
+	SynthCommand([this]()
+	{
+		Generator.Disarm();
+	});
+
+	LastScheduledBeat = INDEX_NONE;
+	LastClockBeat     = INDEX_NONE;
+	bClicking = false;
+}
+
+void UBeatClickSynthComponent::SetVoice(EBeatClickVoice InVoice)
+{
+	Voice = InVoice;
+	PushSettings();
+}
+
+void UBeatClickSynthComponent::SetSubdivisions(int32 InSubdivisions)
+{
+	Subdivisions = FMath::Clamp(InSubdivisions, 1, 8);
+	PushSettings();
+}
+
+/* ---------------- Internals ---------------- */
+
+void UBeatClickSynthComponent::HandleBeat(const FBeatClockTime& Time)
+{
+	if (Time.BeatIndex < LastClockBeat)
+	{
+		// The clock was restarted under us: lock on to its new grid
+		StopClick();
+		StartOnBeatClock();
+		return;
+	}
+	LastClockBeat = Time.BeatIndex;
+
+	// Still counting in to the first bar line
+	const int32 NextBeat = Time.BeatIndex + 1;
+	if (NextBeat <= LastScheduledBeat) return;
+
+	// The clock has just retimed itself for the coming beat
+	if (const UBeatClockSubsystem* Clock = UBeatClockSubsystem::Get(this))
+	{
+		const FBeatClickBeat Next = MakeBeat(*Clock, NextBeat, Clock->GetScheduledBPM());
+		SynthCommand([this, Next]()
+		{
+			Generator.Schedule(Next);
+		});
+		LastScheduledBeat = NextBeat;
+	}
+}
+
+void UBeatClickSynthComponent::PushSettings()
+{
+	const FBeatClickShape Shape = MakeShape();
+	const FBeatClickAccents Accents = MakeAccents();
+	SynthCommand([this, Shape, Accents]()
+	{
+		Generator.SetShape(Shape);
+		Generator.SetAccents(Accents);
+	});
+}
+
+FBeatClickBeat UBeatClickSynthComponent::MakeBeat(const UBeatClockSubsystem& Clock, int32 Beat, float BPM) const
+{
+	// Bars and meter come from the tempo map even while the tempo follows the music
+	const UTempoMap* TempoMap = Clock.GetTempoMap();
+
+	FBeatClickBeat Result;
+	Result.Beat        = Beat;
+	Result.BPM         = BPM;
+	Result.BeatsPerBar = TempoMap ? TempoMap->GetBeatsPerBarAtBeat(Beat) : Clock.GetBeatsPerBar();
+	Result.BeatInBar   = TempoMap ? TempoMap->BeatToPosition(Beat).BeatInBar : 0;
+	Result.GroupMask   = FBeatClickBeat::MakeGroupMask(Result.BeatsPerBar);
+	return Result;
+}
+
+FBeatClickShape UBeatClickSynthComponent::MakeShape() const
+{
+	FBeatClickShape Shape;
+	switch (Voice)
+	{
+	case EBeatClickVoice::Pulse:
+		Shape.Frequency    = 220.f;
+		Shape.EndFrequency = 180.f;
+		Shape.Decay        = 0.06f;
+		Shape.Attack       = 0.002f;
+		break;
+
+	case EBeatClickVoice::SubDrop:
+		Shape.Frequency    = 160.f;
+		Shape.EndFrequency = 40.f;
+		Shape.Decay        = 0.15f;
+		Shape.Attack       = 0.004f;
+		break;
+
+	default:
+		break;
+	}
+
+	Shape.Frequency    *= Pitch;
+	Shape.EndFrequency *= Pitch;
+	return Shape;
+}
+
+FBeatClickAccents UBeatClickSynthComponent::MakeAccents() const
+{
+	FBeatClickAccents Accents;
+	Accents.Downbeat     = DownbeatGain;
+	Accents.Group        = GroupGain;
+	Accents.Beat         = BeatGain;
+	Accents.Subdivision  = SubdivisionGain;
+	Accents.Subdivisions = Subdivisions;
+	return Accents;
+}
@@ -0,0 +1,137 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/MusicAnalysisTap.h"
+
+namespace MusicAnalysisTap
+{
+	// Crossover between the four bands
+	constexpr float CrossoverHz[FMusicAnalysisFrame::NumBands - 1] = { 150.f, 800.f, 4000.f };
+}
+
+FMusicAnalysisTap::FMusicAnalysisTap(float InHopSeconds, uint32 QueueCapacity)
+	: Frames(FMath::RoundUpToPowerOfTwo(FMath::Max(QueueCapacity, 2u)))
+	, HopSeconds(FMath::Max(InHopSeconds, 0.001f))
+{
+}
+
+const FString& FMusicAnalysisTap::GetListenerName() const
+{
+	static const FString Name(TEXT("MusicAnalysisTap"));
+	return Name;
+}
+
+void FMusicAnalysisTap::OnNewSubmixBuffer(const USoundSubmix* OwningSubmix, float* AudioData, int32 NumSamples, int32 NumChannels, const int32 SampleRate, double AudioClock)
+{
+	if (NumChannels <= 0 || SampleRate <= 0) return;
+
+	if (SampleRate != CoefficientsRate)
+	{
+		UpdateCoefficients(SampleRate);
+	}
+
+	const float InvChannels = 1.f / NumChannels;
+	const int32 NumFrames   = NumSamples / NumChannels;
+
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const float* Samples = AudioData + Frame * NumChannels;
+
+		float Mix = 0.f;
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Mix += Samples[Channel];
+			HopPeak = FMath::Max(HopPeak, FMath::Abs(Samples[Channel]));
+		}
+		Mix *= InvChannels;
+
+		// Three one-pole low-passes; the bands are the differences, so they add back up to Mix
+		CrossoverZ[0] += CrossoverCoef[0] * (Mix - CrossoverZ[0]);
+		CrossoverZ[1] += CrossoverCoef[1] * (Mix - CrossoverZ[1]);
+		CrossoverZ[2] += CrossoverCoef[2] * (Mix - CrossoverZ[2]);
+
+		const float Low     = CrossoverZ[0];
+		const float LowMid  = CrossoverZ[1] - CrossoverZ[0];
+		const float HighMid = CrossoverZ[2] - CrossoverZ[1];
+		const float High    = Mix - CrossoverZ[2];
+
+		SumSquares     += Mix * Mix;
+		BandSquares[0] += Low * Low;
+		BandSquares[1] += LowMid * LowMid;
+		BandSquares[2] += HighMid * HighMid;
+		BandSquares[3] += High * High;
+
+		if (++FramesInHop >= HopFrames)
+		{
+			// Clock of the frame that closed the hop
+			FinishHop(AudioClock + static_cast<double>(Frame + 1) / SampleRate);
+		}
+	}
+}
+
+int32 FMusicAnalysisTap::Drain(FMusicAnalysisFrame& OutLatest, FMusicAnalysisFrame& OutPeak)
+{
+	int32 NumPopped = 0;
+	FMusicAnalysisFrame Frame;
+	while (Pop(Frame))
+	{
+		if (NumPopped == 0)
+		{
+			OutPeak = Frame;
+		}
+		else
+		{
+			OutPeak.Rms  = FMath::Max(OutPeak.Rms, Frame.Rms);
+			OutPeak.Peak = FMath::Max(OutPeak.Peak, Frame.Peak);
+			for (int32 Band = 0; Band < FMusicAnalysisFrame::NumBands; ++Band)
+			{
+				OutPeak.Bands[Band] = FMath::Max(OutPeak.Bands[Band], Frame.Bands[Band]);
+			}
+		}
+		OutLatest = Frame;
+		++NumPopped;
+	}
+	return NumPopped;
+}
+
+/* ---------------- Internals ---------------- */
+
+void FMusicAnalysisTap::UpdateCoefficients(int32 SampleRate)
+{
+	CoefficientsRate = SampleRate;
+	HopFrames = GetHopFrames(SampleRate);
+
+	for (int32 i = 0; i < FMusicAnalysisFrame::NumBands - 1; ++i)
+	{
+		CrossoverCoef[i] = 1.f - FMath::Exp(-UE_TWO_PI * MusicAnalysisTap::CrossoverHz[i] / SampleRate);
+	}
+}
+
+void FMusicAnalysisTap::FinishHop(double AudioClock)
+{
+	const double InvFrames = 1.0 / FramesInHop;
+
+	FMusicAnalysisFrame Frame;
+	Frame.Sequence   = Sequence++;
+	Frame.AudioClock = AudioClock;
+	Frame.Rms        = static_cast<float>(FMath::Sqrt(SumSquares * InvFrames));
+	Frame.Peak       = HopPeak;
+	for (int32 Band = 0; Band < FMusicAnalysisFrame::NumBands; ++Band)
+	{
+		Frame.Bands[Band] = static_cast<float>(FMath::Sqrt(BandSquares[Band] * InvFrames));
+		BandSquares[Band] = 0.0;
+	}
+
+	FramesInHop = 0;
+	SumSquares  = 0.0;
+	HopPeak     = 0.f;
+
+	// Lock-free and allocation-free; a full queue means the game thread fell behind
+	if (Frames.Enqueue(Frame))
+	{
+		NumProduced.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		NumDropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
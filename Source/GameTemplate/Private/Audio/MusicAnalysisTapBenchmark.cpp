@@ -0,0 +1,155 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/Thread.h"
+#include "Audio/MusicAnalysisTap.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace MusicAnalysisTapBenchmark
+{
+	constexpr int32 SampleRate  = 48000;
+	constexpr int32 NumChannels = 2;
+
+	// One second of a 60 Hz kick every half beat at 120 BPM over noise and a 1 kHz tone
+	void FillSignal(TArray<float>& Signal)
+	{
+		FRandomStream Rng(2024);
+		Signal.SetNumUninitialized(SampleRate * NumChannels);
+		for (int32 Frame = 0; Frame < SampleRate; ++Frame)
+		{
+			const float Time    = static_cast<float>(Frame) / SampleRate;
+			const float KickEnv = FMath::Exp(-FMath::Fmod(Time, 0.25f) * 30.f);
+			const float Sample  = 0.6f * KickEnv * FMath::Sin(UE_TWO_PI * 60.f * Time)
+				+ 0.1f * FMath::Sin(UE_TWO_PI * 1000.f * Time)
+				+ 0.05f * Rng.FRandRange(-1.f, 1.f);
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				Signal[Frame * NumChannels + Channel] = Sample;
+			}
+		}
+	}
+
+	// Audio thread pushes Seconds of audio in BufferFrames callbacks, each due when a device would
+	// ask for it, while this thread drains with the occasional hitch; every hop must arrive in
+	// order or be counted dropped
+	void RunBufferSize(const TArray<float>& Signal, int32 BufferFrames, float Seconds)
+	{
+		FMusicAnalysisTap Tap;
+		const int32 NumCallbacks = FMath::CeilToInt(Seconds * SampleRate / BufferFrames);
+
+		TArray<float> Buffer;
+		Buffer.SetNumUninitialized(BufferFrames * NumChannels);
+
+		std::atomic<bool> bDone { false };
+		uint64 ProducerCycles = 0;
+
+		FThread Producer(TEXT("MusicAnalysisStress"), [&]()
+		{
+			const int32 SignalFrames = Signal.Num() / NumChannels;
+			int32 Cursor = 0;
+
+			const double StartSeconds = FPlatformTime::Seconds();
+			for (int32 Callback = 0; Callback < NumCallbacks; ++Callback)
+			{
+				// Paced to the buffer period, as the device's render thread is
+				const double Due = StartSeconds + static_cast<double>(Callback) * BufferFrames / SampleRate;
+				while (FPlatformTime::Seconds() < Due)
+				{
+					FPlatformProcess::YieldThread();
+				}
+
+				const uint64 CallbackCycles = FPlatformTime::Cycles64();
+				for (int32 Frame = 0; Frame < BufferFrames; ++Frame)
+				{
+					const int32 From = ((Cursor + Frame) % SignalFrames) * NumChannels;
+					Buffer[Frame * NumChannels]     = Signal[From];
+					Buffer[Frame * NumChannels + 1] = Signal[From + 1];
+				}
+				Cursor = (Cursor + BufferFrames) % SignalFrames;
+
+				Tap.OnNewSubmixBuffer(nullptr, Buffer.GetData(), Buffer.Num(), NumChannels, SampleRate,
+					static_cast<double>(Callback) * BufferFrames / SampleRate);
+				ProducerCycles += FPlatformTime::Cycles64() - CallbackCycles;
+			}
+			bDone = true;
+		});
+
+		uint32 NumReceived  = 0;
+		uint32 NumGaps      = 0;
+		uint32 NumBadFrames = 0;
+		int64  LastSequence = -1;
+		double LastClock    = -1.0;
+		int32  NumDrains    = 0;
+
+		auto Check = [&](const FMusicAnalysisFrame& Frame)
+		{
+			if (static_cast<int64>(Frame.Sequence) <= LastSequence || Frame.AudioClock < LastClock
+				|| !FMath::IsFinite(Frame.Rms) || Frame.Rms < 0.f || Frame.Peak > 1.f)
+			{
+				++NumBadFrames;
+			}
+			NumGaps     += static_cast<uint32>(Frame.Sequence - (LastSequence + 1));
+			LastSequence = Frame.Sequence;
+			LastClock    = Frame.AudioClock;
+		};
+
+		// Frame by frame, so every sequence number is seen (the lights use Drain)
+		bool bFinished = false;
+		while (!bFinished)
+		{
+			bFinished = bDone.load();
+
+			FMusicAnalysisFrame Frame;
+			while (Tap.Pop(Frame))
+			{
+				Check(Frame);
+				++NumReceived;
+			}
+
+			// About a tick between drains, with a game thread hitch now and then to fill the queue
+			FPlatformProcess::Sleep(++NumDrains % 64 == 0 ? 0.05f : 0.001f);
+		}
+		Producer.Join();
+
+		// Every hop is either received or dropped; gaps in between can only come from drops
+		const uint32 NumHops    = static_cast<uint32>(static_cast<int64>(NumCallbacks) * BufferFrames / Tap.GetHopFrames(SampleRate));
+		const double BudgetUs   = 1e6 * BufferFrames / SampleRate;
+		const double CostUs     = 1000.0 * FPlatformTime::ToMilliseconds64(ProducerCycles) / NumCallbacks;
+		const bool   bAccounted = NumReceived == Tap.GetNumProduced() && NumGaps <= Tap.GetNumDropped()
+			&& NumReceived + Tap.GetNumDropped() == NumHops;
+
+		UE_LOG(LogTemp, Display, TEXT("MusicAnalysis %4d frames @ %d Hz: %.3f us/callback (budget %.1f us, %.2f%%), %u hops received, %u dropped, %u gaps, %u bad -> %s"),
+			BufferFrames, SampleRate, CostUs, BudgetUs, 100.0 * CostUs / BudgetUs,
+			NumReceived, Tap.GetNumDropped(), NumGaps, NumBadFrames,
+			bAccounted && NumBadFrames == 0 ? TEXT("OK") : TEXT("FAILED"));
+	}
+
+	void Run(const TArray<FString>& Args)
+	{
+		const float Seconds = Args.Num() > 0 ? FMath::Max(0.1f, FCString::Atof(*Args[0])) : 2.f;
+
+		// Real time per buffer size: off the game thread, which would otherwise stall for all of it
+		Async(EAsyncExecution::Thread, [Seconds]()
+		{
+			TArray<float> Signal;
+			FillSignal(Signal);
+
+			for (const int32 BufferFrames : { 16, 32, 64, 128, 256, 1024 })
+			{
+				RunBufferSize(Signal, BufferFrames, Seconds);
+			}
+		});
+	}
+
+	FAutoConsoleCommand StressCommand(
+		TEXT("au.MusicAnalysis.Stress"),
+		TEXT("Feeds [Seconds=2] of 48 kHz stereo through the music analysis tap from a producer thread paced like a device at 16-1024 frame buffers, in the background, while draining with hitches; logs the cost per callback and whether every hop arrived in order or was counted dropped. GameTemplate.Audio.MusicAnalysisTap asserts a short run."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
+
+#endif
@@ -0,0 +1,190 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/Thread.h"
+#include "Audio/MusicAnalysisTap.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MusicAnalysisTapTest
+{
+	constexpr int32 SampleRate  = 48000;
+	constexpr int32 NumChannels = 2;
+
+	// Seconds of a stereo sine, handed to the tap in BufferFrames callbacks as the audio thread would
+	void Feed(FMusicAnalysisTap& Tap, float Hz, float Amplitude, float Seconds, int32 BufferFrames)
+	{
+		TArray<float> Buffer;
+		Buffer.SetNumUninitialized(BufferFrames * NumChannels);
+
+		const int32 NumFrames = FMath::RoundToInt(Seconds * SampleRate);
+		for (int32 Start = 0; Start < NumFrames; Start += BufferFrames)
+		{
+			for (int32 Frame = 0; Frame < BufferFrames; ++Frame)
+			{
+				const float Sample = Amplitude * FMath::Sin(UE_TWO_PI * Hz * (Start + Frame) / SampleRate);
+				Buffer[Frame * NumChannels]     = Sample;
+				Buffer[Frame * NumChannels + 1] = Sample;
+			}
+			Tap.OnNewSubmixBuffer(nullptr, Buffer.GetData(), Buffer.Num(), NumChannels, SampleRate, static_cast<double>(Start) / SampleRate);
+		}
+	}
+
+	// A producer thread paced like a device at BufferFrames, this thread draining with a hitch now and
+	// then: every hop must arrive in order, or be counted dropped
+	void StressRun(FAutomationTestBase& Test, int32 BufferFrames, float Seconds)
+	{
+		FMusicAnalysisTap Tap;
+		const int32 NumCallbacks = FMath::CeilToInt(Seconds * SampleRate / BufferFrames);
+
+		std::atomic<bool> bDone { false };
+		FThread Producer(TEXT("MusicAnalysisTapTest"), [&]()
+		{
+			TArray<float> Buffer;
+			Buffer.SetNumUninitialized(BufferFrames * NumChannels);
+
+			const double StartSeconds = FPlatformTime::Seconds();
+			for (int32 Callback = 0; Callback < NumCallbacks; ++Callback)
+			{
+				const double Due = StartSeconds + static_cast<double>(Callback) * BufferFrames / SampleRate;
+				while (FPlatformTime::Seconds() < Due)
+				{
+					FPlatformProcess::YieldThread();
+				}
+
+				for (int32 Frame = 0; Frame < BufferFrames; ++Frame)
+				{
+					const float Sample = 0.5f * FMath::Sin(UE_TWO_PI * 1000.f * (Callback * BufferFrames + Frame) / SampleRate);
+					Buffer[Frame * NumChannels]     = Sample;
+					Buffer[Frame * NumChannels + 1] = Sample;
+				}
+				Tap.OnNewSubmixBuffer(nullptr, Buffer.GetData(), Buffer.Num(), NumChannels, SampleRate,
+					static_cast<double>(Callback) * BufferFrames / SampleRate);
+			}
+			bDone = true;
+		});
+
+		uint32 NumReceived   = 0;
+		uint32 NumGaps       = 0;
+		uint32 NumOutOfOrder = 0;
+		int64  LastSequence  = -1;
+		double LastClock     = -1.0;
+		int32  NumDrains     = 0;
+
+		bool bFinished = false;
+		while (!bFinished)
+		{
+			bFinished = bDone.load();
+
+			FMusicAnalysisFrame Frame;
+			while (Tap.Pop(Frame))
+			{
+				NumOutOfOrder += (static_cast<int64>(Frame.Sequence) <= LastSequence || Frame.AudioClock <= LastClock) ? 1 : 0;
+				NumGaps       += static_cast<uint32>(Frame.Sequence - (LastSequence + 1));
+				LastSequence   = Frame.Sequence;
+				LastClock      = Frame.AudioClock;
+				++NumReceived;
+			}
+
+			FPlatformProcess::Sleep(++NumDrains % 32 == 0 ? 0.05f : 0.001f);
+		}
+		Producer.Join();
+
+		const uint32 NumHops = static_cast<uint32>(static_cast<int64>(NumCallbacks) * BufferFrames / Tap.GetHopFrames(SampleRate));
+		const FString What = FString::Printf(TEXT("%d-frame buffers"), BufferFrames);
+		Test.TestEqual(What + TEXT(": hops out of order"), static_cast<int32>(NumOutOfOrder), 0);
+		Test.TestEqual(What + TEXT(": every produced hop received"), static_cast<int32>(NumReceived), static_cast<int32>(Tap.GetNumProduced()));
+		Test.TestEqual(What + TEXT(": every hop received or dropped"), static_cast<int32>(NumReceived + Tap.GetNumDropped()), static_cast<int32>(NumHops));
+		Test.TestTrue(What + TEXT(": gaps only where hops were dropped"), NumGaps <= Tap.GetNumDropped());
+	}
+
+	// The band with the most energy in the last frame produced
+	int32 LoudestBand(FMusicAnalysisTap& Tap)
+	{
+		FMusicAnalysisFrame Latest;
+		FMusicAnalysisFrame Peak;
+		Tap.Drain(Latest, Peak);
+
+		int32 Loudest = 0;
+		for (int32 Band = 1; Band < FMusicAnalysisFrame::NumBands; ++Band)
+		{
+			if (Latest.Bands[Band] > Latest.Bands[Loudest]) Loudest = Band;
+		}
+		return Loudest;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMusicAnalysisTapTest, "GameTemplate.Audio.MusicAnalysisTap",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FMusicAnalysisTapTest::RunTest(const FString& Parameters)
+{
+	using namespace MusicAnalysisTapTest;
+
+	// Hops are counted in frames, whatever the buffer size: in order, on the audio clock, levels exact
+	{
+		FMusicAnalysisTap Tap;
+		const int32 HopFrames = Tap.GetHopFrames(SampleRate);
+		Feed(Tap, 1000.f, 0.5f, 1.f, 441);
+
+		const uint32 NumHops = SampleRate / HopFrames;
+		TestEqual(TEXT("Hops produced"), Tap.GetNumProduced(), NumHops);
+		TestEqual(TEXT("Hops dropped"), Tap.GetNumDropped(), 0u);
+
+		uint32 NumPopped = 0;
+		FMusicAnalysisFrame Frame;
+		while (Tap.Pop(Frame))
+		{
+			TestEqual(TEXT("Sequence"), Frame.Sequence, NumPopped);
+			TestEqual(TEXT("Audio clock at the end of the hop"), Frame.AudioClock, static_cast<double>(NumPopped + 1) * HopFrames / SampleRate, 1e-9);
+			// A whole number of periods per hop
+			TestEqual(TEXT("RMS of the sine"), Frame.Rms, 0.5f * UE_INV_SQRT_2, 1e-3f);
+			TestEqual(TEXT("Peak of the sine"), Frame.Peak, 0.5f, 1e-3f);
+			++NumPopped;
+		}
+		TestEqual(TEXT("Hops popped"), NumPopped, NumHops);
+	}
+
+	// Nobody draining: the queue fills, the rest is counted dropped and nothing arrives out of order
+	{
+		FMusicAnalysisTap Tap(0.01f, 64);
+		Feed(Tap, 1000.f, 0.5f, 2.f, 256);
+
+		const uint32 NumHops = SampleRate * 2 / Tap.GetHopFrames(SampleRate);
+		TestTrue(TEXT("Full queue drops"), Tap.GetNumDropped() > 0);
+		TestEqual(TEXT("Every hop produced or dropped"), Tap.GetNumProduced() + Tap.GetNumDropped(), NumHops);
+
+		uint32 NumPopped = 0;
+		FMusicAnalysisFrame Frame;
+		while (Tap.Pop(Frame))
+		{
+			TestEqual(TEXT("Sequence of the queued hops"), Frame.Sequence, NumPopped++);
+		}
+		TestEqual(TEXT("Hops popped"), NumPopped, Tap.GetNumProduced());
+	}
+
+	// The crossover puts a tone in its own band
+	const TPair<float, EMusicAnalysisBand> Tones[] = {
+		{ 60.f,   EMusicAnalysisBand::Low },
+		{ 350.f,  EMusicAnalysisBand::LowMid },
+		{ 1800.f, EMusicAnalysisBand::HighMid },
+		{ 12000.f, EMusicAnalysisBand::High } };
+	for (const TPair<float, EMusicAnalysisBand>& Tone : Tones)
+	{
+		FMusicAnalysisTap Tap;
+		Feed(Tap, Tone.Key, 0.5f, 0.2f, 256);
+		TestEqual(FString::Printf(TEXT("Loudest band for %.0f Hz"), Tone.Key), LoudestBand(Tap) + 1, static_cast<int32>(Tone.Value));
+	}
+
+	// Two threads in real time at the smallest device buffers (au.MusicAnalysis.Stress runs the long version)
+	for (const int32 BufferFrames : { 16, 32, 64 })
+	{
+		StressRun(*this, BufferFrames, 0.3f);
+	}
+	return true;
+}
+
+#endif
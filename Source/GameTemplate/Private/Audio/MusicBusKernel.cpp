@@ -0,0 +1,200 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/MusicBusKernel.h"
+#include "DSP/Dsp.h"
+#include "DSP/FloatArrayMath.h"
+
+namespace MusicBusKernel
+{
+	// Frames per compressor gain step (0.67 ms at 48 kHz, well under the shortest attack)
+	constexpr int32 ControlFrames = 32;
+}
+
+void FMusicBusKernel::Init(float InSampleRate, int32 InNumChannels)
+{
+	SampleRate  = FMath::Max(1.f, InSampleRate);
+	NumChannels = FMath::Clamp(InNumChannels, 1, MaxChannels);
+
+	UpdateLowPass();
+	UpdateHighShelf();
+	UpdateDynamics();
+	Reset();
+}
+
+void FMusicBusKernel::Reset()
+{
+	FMemory::Memzero(LowPassZ1);
+	FMemory::Memzero(LowPassZ2);
+	FMemory::Memzero(HighShelfZ1);
+	FMemory::Memzero(HighShelfZ2);
+	Envelope = 0.f;
+	Gain     = 1.f;
+}
+
+void FMusicBusKernel::SetParams(const FMusicBusKernelParams& InParams)
+{
+	const bool bLowPassChanged   = InParams.CutoffHz != Params.CutoffHz;
+	const bool bHighShelfChanged = InParams.ShelfFrequencyHz != Params.ShelfFrequencyHz
+		|| InParams.ShelfBandwidth != Params.ShelfBandwidth
+		|| InParams.ShelfGainDb != Params.ShelfGainDb;
+	const bool bDynamicsChanged  = InParams.AttackMs != Params.AttackMs
+		|| InParams.ReleaseMs != Params.ReleaseMs
+		|| InParams.ThresholdDb != Params.ThresholdDb
+		|| InParams.Ratio != Params.Ratio;
+
+	Params = InParams;
+
+	if (bLowPassChanged)   UpdateLowPass();
+	if (bHighShelfChanged) UpdateHighShelf();
+	if (bDynamicsChanged)  UpdateDynamics();
+}
+
+void FMusicBusKernel::Process(const float* In, float* Out, int32 NumFrames, const float* Key, int32 KeyNumChannels)
+{
+	const bool bExternalKey = Key && KeyNumChannels > 0;
+
+	for (int32 Start = 0; Start < NumFrames; Start += MusicBusKernel::ControlFrames)
+	{
+		const int32 Frames = FMath::Min(MusicBusKernel::ControlFrames, NumFrames - Start);
+		const TArrayView<float> Block(Out + Start * NumChannels, Frames * NumChannels);
+
+		Filter(In + Start * NumChannels, Block.GetData(), Frames);
+
+		// Peak of the key (or of the filtered block itself) over the control block
+		const float Level = bExternalKey
+			? Audio::ArrayMaxAbsValue(TArrayView<const float>(Key + Start * KeyNumChannels, Frames * KeyNumChannels))
+			: Audio::ArrayMaxAbsValue(Block);
+
+		Envelope += (Level > Envelope ? AttackCoef : ReleaseCoef) * (Level - Envelope);
+
+		// Gain computed once per block in dB, ramped across it from the last block's
+		const float OverDb     = Audio::ConvertToDecibels(Envelope) - Params.ThresholdDb;
+		const float TargetGain = OverDb > 0.f ? Audio::ConvertToLinear(GainSlope * OverDb) : 1.f;
+		Audio::ArrayFade(Block, Gain, TargetGain);
+		Gain = TargetGain;
+	}
+}
+
+/* ---------------- Internals ---------------- */
+
+void FMusicBusKernel::Filter(const float* In, float* Out, int32 NumFrames)
+{
+	const VectorRegister4Float LpB0 = VectorSetFloat1(LowPass.B0);
+	const VectorRegister4Float LpB1 = VectorSetFloat1(LowPass.B1);
+	const VectorRegister4Float LpB2 = VectorSetFloat1(LowPass.B2);
+	const VectorRegister4Float LpA1 = VectorSetFloat1(LowPass.A1);
+	const VectorRegister4Float LpA2 = VectorSetFloat1(LowPass.A2);
+
+	const VectorRegister4Float HsB0 = VectorSetFloat1(HighShelf.B0);
+	const VectorRegister4Float HsB1 = VectorSetFloat1(HighShelf.B1);
+	const VectorRegister4Float HsB2 = VectorSetFloat1(HighShelf.B2);
+	const VectorRegister4Float HsA1 = VectorSetFloat1(HighShelf.A1);
+	const VectorRegister4Float HsA2 = VectorSetFloat1(HighShelf.A2);
+
+	VectorRegister4Float LpZ1 = VectorLoadAligned(LowPassZ1);
+	VectorRegister4Float LpZ2 = VectorLoadAligned(LowPassZ2);
+	VectorRegister4Float HsZ1 = VectorLoadAligned(HighShelfZ1);
+	VectorRegister4Float HsZ2 = VectorLoadAligned(HighShelfZ2);
+
+	// One frame, a channel per lane: low-pass, then the high shelf straight from its register (TDF-II:
+	// y = b0*x + z1; z1 = b1*x - a1*y + z2; z2 = b2*x - a2*y)
+	auto Step = [&](const VectorRegister4Float& X)
+	{
+		const VectorRegister4Float Lp = VectorMultiplyAdd(LpB0, X, LpZ1);
+		LpZ1 = VectorMultiplyAdd(LpB1, X, VectorSubtract(LpZ2, VectorMultiply(LpA1, Lp)));
+		LpZ2 = VectorSubtract(VectorMultiply(LpB2, X), VectorMultiply(LpA2, Lp));
+
+		const VectorRegister4Float Hs = VectorMultiplyAdd(HsB0, Lp, HsZ1);
+		HsZ1 = VectorMultiplyAdd(HsB1, Lp, VectorSubtract(HsZ2, VectorMultiply(HsA1, Hs)));
+		HsZ2 = VectorSubtract(VectorMultiply(HsB2, Lp), VectorMultiply(HsA2, Hs));
+		return Hs;
+	};
+
+	int32 Frame = 0;
+	if (NumChannels == 4)
+	{
+		for (; Frame < NumFrames; ++Frame)
+		{
+			VectorStore(Step(VectorLoad(In + Frame * 4)), Out + Frame * 4);
+		}
+	}
+	else if (NumChannels == 2)
+	{
+		// Two stereo frames per load and store; each runs through the filters with its pair doubled up
+		for (; Frame + 1 < NumFrames; Frame += 2)
+		{
+			const VectorRegister4Float X = VectorLoad(In + Frame * 2);
+			const VectorRegister4Float Y0 = Step(VectorSwizzle(X, 0, 1, 0, 1));
+			const VectorRegister4Float Y1 = Step(VectorSwizzle(X, 2, 3, 2, 3));
+			VectorStore(VectorShuffle(Y0, Y1, 0, 1, 0, 1), Out + Frame * 2);
+		}
+	}
+
+	// Mono, three channels, or the odd stereo frame: through a lane buffer
+	alignas(16) float Lanes[MaxChannels] = {};
+	for (; Frame < NumFrames; ++Frame)
+	{
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Lanes[Channel] = In[Frame * NumChannels + Channel];
+		}
+		VectorStoreAligned(Step(VectorLoadAligned(Lanes)), Lanes);
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Out[Frame * NumChannels + Channel] = Lanes[Channel];
+		}
+	}
+
+	VectorStoreAligned(LpZ1, LowPassZ1);
+	VectorStoreAligned(LpZ2, LowPassZ2);
+	VectorStoreAligned(HsZ1, HighShelfZ1);
+	VectorStoreAligned(HsZ2, HighShelfZ2);
+}
+
+void FMusicBusKernel::UpdateLowPass()
+{
+	// RBJ cookbook low-pass, Q = 0.707 (what PushFilter sets on the preset)
+	const float Cutoff = FMath::Clamp(Params.CutoffHz, 20.f, 0.49f * SampleRate);
+	const float W0     = 2.f * PI * Cutoff / SampleRate;
+	const float CosW0  = FMath::Cos(W0);
+	const float Alpha  = FMath::Sin(W0) / (2.f * 0.707f);
+	const float A0     = 1.f + Alpha;
+
+	LowPass.B0 = ((1.f - CosW0) * 0.5f) / A0;
+	LowPass.B1 = (1.f - CosW0) / A0;
+	LowPass.B2 = LowPass.B0;
+	LowPass.A1 = (-2.f * CosW0) / A0;
+	LowPass.A2 = (1.f - Alpha) / A0;
+}
+
+void FMusicBusKernel::UpdateHighShelf()
+{
+	// RBJ cookbook high shelf with the bandwidth (octaves) the EQ band uses
+	const float Freq   = FMath::Clamp(Params.ShelfFrequencyHz, 20.f, 0.49f * SampleRate);
+	const float W0     = 2.f * PI * Freq / SampleRate;
+	const float CosW0  = FMath::Cos(W0);
+	const float SinW0  = FMath::Sin(W0);
+	const float A      = FMath::Pow(10.f, Params.ShelfGainDb / 40.f);
+	const float SqrtA  = FMath::Sqrt(A);
+	const float Alpha  = SinW0 * FMath::Sinh(0.5f * UE_LN2 * FMath::Max(0.05f, Params.ShelfBandwidth) * W0 / SinW0);
+	const float A0     = (A + 1.f) - (A - 1.f) * CosW0 + 2.f * SqrtA * Alpha;
+
+	HighShelf.B0 = (A * ((A + 1.f) + (A - 1.f) * CosW0 + 2.f * SqrtA * Alpha)) / A0;
+	HighShelf.B1 = (-2.f * A * ((A - 1.f) + (A + 1.f) * CosW0)) / A0;
+	HighShelf.B2 = (A * ((A + 1.f) + (A - 1.f) * CosW0 - 2.f * SqrtA * Alpha)) / A0;
+	HighShelf.A1 = (2.f * ((A - 1.f) - (A + 1.f) * CosW0)) / A0;
+	HighShelf.A2 = ((A + 1.f) - (A - 1.f) * CosW0 - 2.f * SqrtA * Alpha) / A0;
+}
+
+void FMusicBusKernel::UpdateDynamics()
+{
+	// The detector steps once per control block
+	auto OnePole = [this](float Ms)
+	{
+		return 1.f - FMath::Exp(-MusicBusKernel::ControlFrames / (FMath::Max(0.01f, Ms) * 0.001f * SampleRate));
+	};
+
+	AttackCoef  = OnePole(Params.AttackMs);
+	ReleaseCoef = OnePole(Params.ReleaseMs);
+	GainSlope   = -(1.f - 1.f / FMath::Max(1.f, Params.Ratio));
+}
@@ -0,0 +1,155 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Audio/MusicBusKernel.h"
+#include "SubmixEffects/SubmixEffectFilter.h"
+#include "SubmixEffects/AudioMixerSubmixEffectEQ.h"
+#include "SubmixEffects/AudioMixerSubmixEffectDynamicsProcessor.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace MusicBusKernelBenchmark
+{
+	constexpr float SampleRate  = 48000.f;
+	constexpr int32 NumChannels = 2;
+	constexpr int32 NumBlocks   = 2000;
+
+	void FillNoise(Audio::FAlignedFloatBuffer& Buffer, int32 NumSamples)
+	{
+		FRandomStream Rng(1234);
+		Buffer.SetNumUninitialized(NumSamples);
+		for (float& Sample : Buffer)
+		{
+			Sample = Rng.FRandRange(-0.5f, 0.5f);
+		}
+	}
+
+	FSoundEffectSubmixPtr MakeInstance(USoundEffectSubmixPreset& Preset)
+	{
+		FSoundEffectSubmixInitData InitData;
+		InitData.SampleRate           = SampleRate;
+		InitData.ParentPresetUniqueId = Preset.GetUniqueID();
+
+		FSoundEffectSubmixPtr Effect = USoundEffectPreset::CreateInstance<FSoundEffectSubmixInitData, FSoundEffectSubmix>(InitData, Preset);
+		Effect->SetEnabled(true);
+		return Effect;
+	}
+
+	// The stock filter, EQ and compressor submix presets, set up the way AAudioSnapshotManager pushes them,
+	// run as the mixer runs a submix chain: one ProcessAudio per effect, ping-ponging between two buffers
+	double RunPresetChain(const Audio::FAlignedFloatBuffer& In, Audio::FAlignedFloatBuffer& Out, int32 NumFrames)
+	{
+		USubmixEffectFilterPreset* FilterPreset = NewObject<USubmixEffectFilterPreset>();
+		USubmixEffectSubmixEQPreset* EQPreset = NewObject<USubmixEffectSubmixEQPreset>();
+		USubmixEffectDynamicsProcessorPreset* CompressorPreset = NewObject<USubmixEffectDynamicsProcessorPreset>();
+
+		const FSoundEffectSubmixPtr Chain[] = { MakeInstance(*FilterPreset), MakeInstance(*EQPreset), MakeInstance(*CompressorPreset) };
+
+		FilterPreset->SetFilterType(ESubmixFilterType::LowPass);
+		FilterPreset->SetFilterQ(0.7f);
+		FilterPreset->SetFilterCutoffFrequency(6000.f);
+
+		FSubmixEffectEQBand HighShelf;
+		HighShelf.bEnabled  = true;
+		HighShelf.Bandwidth = 0.7f;
+		HighShelf.Frequency = 10000.f;
+		HighShelf.GainDb    = -3.f;
+		FSubmixEffectSubmixEQSettings EQ;
+		EQ.EQBands.Add(HighShelf);
+		EQPreset->SetSettings(EQ);
+
+		FSubmixEffectDynamicsProcessorSettings Compressor = CompressorPreset->GetSettings();
+		Compressor.DynamicsProcessorType = ESubmixEffectDynamicsProcessorType::Compressor;
+		Compressor.ThresholdDb = -18.f;
+		Compressor.Ratio       = 4.f;
+		CompressorPreset->SetSettings(Compressor);
+
+		Audio::FAlignedFloatBuffer Scratch[2];
+		Scratch[0].SetNumZeroed(In.Num());
+		Scratch[1].SetNumZeroed(In.Num());
+
+		auto ProcessBlock = [&]()
+		{
+			int32 Read = 0;
+			for (int32 Index = 0; Index < UE_ARRAY_COUNT(Chain); ++Index)
+			{
+				FSoundEffectSubmixInputData InData;
+				InData.NumFrames         = NumFrames;
+				InData.NumChannels       = NumChannels;
+				InData.NumDeviceChannels = NumChannels;
+				InData.AudioBuffer       = Index == 0 ? const_cast<Audio::FAlignedFloatBuffer*>(&In) : &Scratch[Read];
+
+				FSoundEffectSubmixOutputData OutData;
+				OutData.NumChannels = NumChannels;
+				OutData.AudioBuffer = &Scratch[Read ^ 1];
+
+				Chain[Index]->ProcessAudio(InData, OutData);
+				Read ^= 1;
+			}
+		};
+
+		// One untimed block so the settings pushed above are applied before the clock starts
+		ProcessBlock();
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Block = 0; Block < NumBlocks; ++Block)
+		{
+			ProcessBlock();
+		}
+		const double Ms = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		Out = Scratch[1];
+		return Ms;
+	}
+
+	double RunKernel(const Audio::FAlignedFloatBuffer& In, Audio::FAlignedFloatBuffer& Out, int32 NumFrames)
+	{
+		FMusicBusKernelParams Params;
+		Params.CutoffHz    = 6000.f;
+		Params.ShelfGainDb = -3.f;
+		Params.ThresholdDb = -18.f;
+
+		FMusicBusKernel Kernel;
+		Kernel.Init(SampleRate, NumChannels);
+		Kernel.SetParams(Params);
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Block = 0; Block < NumBlocks; ++Block)
+		{
+			Kernel.Process(In.GetData(), Out.GetData(), NumFrames);
+		}
+		return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	}
+
+	void Run()
+	{
+		for (const int32 NumFrames : { 256, 1024 })
+		{
+			Audio::FAlignedFloatBuffer In;
+			Audio::FAlignedFloatBuffer Out;
+			FillNoise(In, NumFrames * NumChannels);
+			Out.SetNumZeroed(In.Num());
+
+			const double ChainMs     = RunPresetChain(In, Out, NumFrames);
+			const double KernelMs    = RunKernel(In, Out, NumFrames);
+
+			// Real-time budget of one block, to put the numbers in context
+			const double BudgetMs = 1000.0 * NumFrames / SampleRate;
+
+			UE_LOG(LogTemp, Display, TEXT("MusicBus %4d frames @ %.0f Hz: preset chain %.4f ms/block, fused %.4f ms/block (x%.2f), budget %.3f ms"),
+				NumFrames, SampleRate,
+				ChainMs / NumBlocks, KernelMs / NumBlocks,
+				KernelMs > 0.0 ? ChainMs / KernelMs : 0.0,
+				BudgetMs);
+		}
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("au.MusicBus.Benchmark"),
+		TEXT("Times the fused music-bus kernel against the stock filter/EQ/compressor submix preset chain (48 kHz stereo, 256 and 1024 frames)."),
+		FConsoleCommandDelegate::CreateStatic(&Run));
+}
+
+#endif
@@ -0,0 +1,215 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/NarrationCookCommandlet.h"
+#include "Audio/NarrationCueData.h"
+#include "Async/ParallelFor.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Misc/PackageName.h"
+#include "Sound/SoundWave.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+namespace NarrationCook
+{
+	struct FSettings
+	{
+		float EnvelopeRate = 50.f;  // bins per second
+		float SilenceDb    = -40.f; // bins at or below are silence
+		float MinSilence   = 0.25f; // shorter gaps are treated as speech (breaths, consonants)
+		float ClearHold    = 0.75f; // readability hold after the last speech
+		int32 BatchSize    = 32;    // waves decoded at once, bounds peak PCM memory
+	};
+
+	struct FSource
+	{
+		FSoftObjectPath Path;
+		TArray<uint8>   PCM; // 16-bit interleaved
+		uint32          SampleRate  = 0;
+		uint16          NumChannels = 0;
+	};
+
+	void Analyse(const FSource& Source, const FSettings& Settings, FNarrationCue& Out)
+	{
+		const int16* Samples     = reinterpret_cast<const int16*>(Source.PCM.GetData());
+		const int32  NumChannels = FMath::Max<int32>(1, Source.NumChannels);
+		const int32  NumFrames   = Source.PCM.Num() / (sizeof(int16) * NumChannels);
+		const float  SampleRate  = static_cast<float>(FMath::Max<uint32>(1, Source.SampleRate));
+
+		Out.Voice        = Source.Path;
+		Out.Duration     = NumFrames / SampleRate;
+		Out.EnvelopeRate = Settings.EnvelopeRate;
+
+		const int32 FramesPerBin = FMath::Max(1, FMath::RoundToInt32(SampleRate / Settings.EnvelopeRate));
+		const int32 NumBins      = FMath::DivideAndRoundUp(NumFrames, FramesPerBin);
+		const float BinSeconds   = 1.f / Settings.EnvelopeRate;
+
+		Out.Envelope.SetNumUninitialized(NumBins);
+		Out.SpeechRegions.Reset();
+
+		float RegionStart = -1.f;
+		float RegionEnd   = -1.f;
+
+		for (int32 Bin = 0; Bin < NumBins; ++Bin)
+		{
+			const int32 First = Bin * FramesPerBin;
+			const int32 Last  = FMath::Min(First + FramesPerBin, NumFrames);
+
+			// RMS over all channels of the bin
+			double SumSquares = 0.0;
+			for (int32 i = First * NumChannels; i < Last * NumChannels; ++i)
+			{
+				const double Sample = Samples[i] / 32768.0;
+				SumSquares += Sample * Sample;
+			}
+			const double Rms = FMath::Sqrt(SumSquares / FMath::Max(1, (Last - First) * NumChannels));
+			const float  Db  = FMath::Max(FNarrationCue::EnvelopeFloorDb, 20.f * static_cast<float>(FMath::LogX(10.0, FMath::Max(Rms, 1e-6))));
+
+			Out.Envelope[Bin] = static_cast<uint8>(FMath::RoundToInt32((1.f - Db / FNarrationCue::EnvelopeFloorDb) * 255.f));
+
+			if (Db <= Settings.SilenceDb) continue;
+
+			// Speech bin: extend the open region, or close it if the gap was long enough and start a new one
+			const float BinStart = Bin * BinSeconds;
+			if (RegionStart >= 0.f && BinStart - RegionEnd < Settings.MinSilence)
+			{
+				RegionEnd = BinStart + BinSeconds;
+				continue;
+			}
+			if (RegionStart >= 0.f)
+			{
+				Out.SpeechRegions.Add(FVector2f(RegionStart, RegionEnd));
+			}
+			RegionStart = BinStart;
+			RegionEnd   = BinStart + BinSeconds;
+		}
+
+		if (RegionStart >= 0.f)
+		{
+			Out.SpeechRegions.Add(FVector2f(RegionStart, FMath::Min(RegionEnd, Out.Duration)));
+		}
+
+		Out.SuggestedClearTime = Out.SpeechRegions.Num() > 0
+			? Out.SpeechRegions.Last().Y + Settings.ClearHold
+			: Out.Duration;
+	}
+}
+
+UNarrationCookCommandlet::UNarrationCookCommandlet()
+{
+	IsClient        = false;
+	IsServer        = false;
+	IsEditor        = true; // source audio is editor-only data
+	LogToConsole    = true;
+	ShowErrorCount  = true;
+}
+
+int32 UNarrationCookCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString SourcePath = TEXT("/Game");
+	FString OutputPath = TEXT("/Game/Audio/NarrationCues");
+	FParse::Value(*Params, TEXT("Path="), SourcePath);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	NarrationCook::FSettings Settings;
+	FParse::Value(*Params, TEXT("EnvelopeRate="), Settings.EnvelopeRate);
+	FParse::Value(*Params, TEXT("SilenceDb="), Settings.SilenceDb);
+	FParse::Value(*Params, TEXT("MinSilence="), Settings.MinSilence);
+	FParse::Value(*Params, TEXT("ClearHold="), Settings.ClearHold);
+	FParse::Value(*Params, TEXT("Batch="), Settings.BatchSize);
+	Settings.EnvelopeRate = FMath::Clamp(Settings.EnvelopeRate, 1.f, 1000.f);
+	Settings.BatchSize    = FMath::Max(1, Settings.BatchSize);
+
+	if (!FPackageName::IsValidLongPackageName(OutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("NarrationCook: -Output=%s is not a valid package name."), *OutputPath);
+		return 1;
+	}
+
+	IAssetRegistry& Registry = FAssetRegistryModule::GetRegistry();
+	Registry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.PackagePaths.Add(*SourcePath);
+	Filter.ClassPaths.Add(USoundWave::StaticClass()->GetClassPathName());
+	Filter.bRecursivePaths = true;
+
+	TArray<FAssetData> Assets;
+	Registry.GetAssets(Filter, Assets);
+	UE_LOG(LogTemp, Display, TEXT("NarrationCook: %d sound waves under %s"), Assets.Num(), *SourcePath);
+
+	TArray<FNarrationCue> Cues;
+	Cues.Reserve(Assets.Num());
+
+	// Loading and decoding stay on the game thread; the analysis of each batch is parallel
+	TArray<NarrationCook::FSource> Batch;
+	for (int32 First = 0; First < Assets.Num(); First += Settings.BatchSize)
+	{
+		Batch.Reset();
+		for (int32 i = First; i < FMath::Min(First + Settings.BatchSize, Assets.Num()); ++i)
+		{
+			const USoundWave* Wave = Cast<USoundWave>(Assets[i].GetAsset());
+			if (!Wave) continue;
+
+			NarrationCook::FSource& Source = Batch.AddDefaulted_GetRef();
+			Source.Path = Assets[i].GetSoftObjectPath();
+			if (!Wave->GetImportedSoundWaveData(Source.PCM, Source.SampleRate, Source.NumChannels) || Source.PCM.Num() == 0)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("NarrationCook: No source PCM for %s, skipped."), *Source.Path.ToString());
+				Batch.Pop();
+			}
+		}
+
+		const int32 Offset = Cues.Num();
+		Cues.AddDefaulted(Batch.Num());
+		ParallelFor(Batch.Num(), [&Batch, &Settings, &Cues, Offset](int32 i)
+		{
+			NarrationCook::Analyse(Batch[i], Settings, Cues[Offset + i]);
+		});
+
+		// Drop loaded waves between batches
+		CollectGarbage(RF_NoFlags);
+	}
+
+	// Write the sidecar, reusing the asset if it already exists
+	const FString AssetName = FPackageName::GetLongPackageAssetName(OutputPath);
+	UPackage* Package = FPackageName::DoesPackageExist(OutputPath) ? LoadPackage(nullptr, *OutputPath, LOAD_None) : CreatePackage(*OutputPath);
+	if (!Package)
+	{
+		UE_LOG(LogTemp, Error, TEXT("NarrationCook: Could not open %s"), *OutputPath);
+		return 1;
+	}
+
+	UNarrationCueData* Data = FindObject<UNarrationCueData>(Package, *AssetName);
+	const bool bCreated = Data == nullptr;
+	if (bCreated)
+	{
+		Data = NewObject<UNarrationCueData>(Package, *AssetName, RF_Public | RF_Standalone);
+	}
+
+	Data->Cues = MoveTemp(Cues);
+	Data->RebuildLookup();
+	Data->MarkPackageDirty();
+	if (bCreated)
+	{
+		FAssetRegistryModule::AssetCreated(Data);
+	}
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	SaveArgs.Error         = GError;
+
+	const FString Filename = FPackageName::LongPackageNameToFilename(OutputPath, FPackageName::GetAssetPackageExtension());
+	if (!UPackage::SavePackage(Package, Data, *Filename, SaveArgs))
+	{
+		UE_LOG(LogTemp, Error, TEXT("NarrationCook: Could not save %s"), *Filename);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("NarrationCook: Wrote %d cues to %s"), Data->Cues.Num(), *OutputPath);
+	return 0;
+#else
+	UE_LOG(LogTemp, Error, TEXT("NarrationCook: Needs an editor build (source audio is editor-only)."));
+	return 1;
+#endif
+}
@@ -0,0 +1,33 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/NarrationCueData.h"
+
+float FNarrationCue::GetLoudnessDb(float Seconds) const
+{
+	if (Envelope.Num() == 0) return EnvelopeFloorDb;
+
+	const int32 Bin = FMath::Clamp(FMath::FloorToInt32(Seconds * EnvelopeRate), 0, Envelope.Num() - 1);
+	return EnvelopeFloorDb * (1.f - Envelope[Bin] / 255.f);
+}
+
+const FNarrationCue* UNarrationCueData::FindCue(const FSoftObjectPath& Voice) const
+{
+	const int32* Index = Lookup.Find(Voice);
+	return Index ? &Cues[*Index] : nullptr;
+}
+
+void UNarrationCueData::RebuildLookup()
+{
+	Lookup.Reset();
+	Lookup.Reserve(Cues.Num());
+	for (int32 i = 0; i < Cues.Num(); ++i)
+	{
+		Lookup.Add(Cues[i].Voice, i);
+	}
+}
+
+void UNarrationCueData::PostLoad()
+{
+	Super::PostLoad();
+	RebuildLookup();
+}
@@ -0,0 +1,419 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/OnsetTempoTracker.h"
+#include "DSP/FFTAlgorithm.h"
+
+namespace OnsetTempo
+{
+	// log(1 + Compression * |X|): evens out loud and quiet parts before the flux
+	constexpr float Compression = 100.f;
+
+	// Onset threshold: above ThresholdMean x the running mean plus ThresholdPeak x the decaying peak
+	constexpr float ThresholdMean = 1.2f;
+	constexpr float ThresholdPeak = 0.03f;
+	constexpr float MeanSeconds   = 0.25f;
+	constexpr float PeakSeconds   = 2.f;
+	constexpr float MinOnsetGap   = 0.05f;
+
+	// History needed before the first tempo search, and how fast a small tempo change is followed
+	constexpr float WarmupSeconds = 3.f;
+	constexpr float TempoTolerance = 0.04f;
+	constexpr float TempoFollow   = 0.35f;
+
+	// Beats the phase comb looks back over, and the weight lost per beat
+	constexpr int32 CombBeats = 8;
+	constexpr float CombDecay = 0.9f;
+
+	float UnscaleFor(Audio::EFFTScaling Scaling, int32 Size)
+	{
+		switch (Scaling)
+		{
+		case Audio::EFFTScaling::MultipliedByFFTSize:     return 1.f / Size;
+		case Audio::EFFTScaling::MultipliedBySqrtFFTSize: return 1.f / FMath::Sqrt(static_cast<float>(Size));
+		case Audio::EFFTScaling::DividedByFFTSize:        return static_cast<float>(Size);
+		case Audio::EFFTScaling::DividedBySqrtFFTSize:    return FMath::Sqrt(static_cast<float>(Size));
+		default:                                          return 1.f;
+		}
+	}
+}
+
+FOnsetTempoTracker::FOnsetTempoTracker() = default;
+FOnsetTempoTracker::~FOnsetTempoTracker() = default;
+
+void FOnsetTempoTracker::Init(float InSampleRate, const FOnsetTempoSettings& InSettings)
+{
+	Settings   = InSettings;
+	SampleRate = InSampleRate;
+
+	Audio::FFFTSettings FFTSettings;
+	FFTSettings.Log2Size = FMath::FloorLog2(FFTSize);
+	FFTSettings.bArrays128BitAligned = true;
+	FFTSettings.bEnableHardwareAcceleration = true;
+	FFT = Audio::FFFTFactory::NewFFTAlgorithm(FFTSettings);
+
+	// Periodic Hann; a sine of amplitude A peaks at A * FFTSize / 4
+	Window.SetNumUninitialized(FFTSize);
+	for (int32 i = 0; i < FFTSize; ++i)
+	{
+		Window[i] = 0.5f - 0.5f * FMath::Cos(UE_TWO_PI * i / FFTSize);
+	}
+	MagnitudeScale = FFT.IsValid() ? OnsetTempo::UnscaleFor(FFT->ForwardScaling(), FFTSize) * 4.f / FFTSize : 0.f;
+
+	Input.SetNumZeroed(FFTSize);
+	Frame.SetNumZeroed(FFTSize);
+	Spectrum.SetNumZeroed(FFT.IsValid() ? FFT->NumOutputFloats() : FFTSize + 2);
+	LogMagnitude.SetNumZeroed(FFTSize / 2 + 1);
+	PrevLogMagnitude.SetNumZeroed(FFTSize / 2 + 1);
+
+	const float Rate = GetEnvelopeRate();
+	const int32 MaxLag = FMath::CeilToInt(Rate * 60.f / FMath::Max(Settings.MinBPM, 1.f));
+	Envelope.SetNumZeroed(FMath::Max(FMath::CeilToInt(Settings.HistorySeconds * Rate), 4 * MaxLag));
+	Smoothed.SetNumZeroed(Envelope.Num());
+	Autocorr.SetNumZeroed(2 * MaxLag + 2);
+	HopsPerUpdate = FMath::Max(1, FMath::RoundToInt(Settings.UpdateSeconds * Rate));
+
+	NewOnsets.SetNumZeroed(MaxOnsetsPerBlock);
+
+	Reset();
+}
+
+void FOnsetTempoTracker::Reset()
+{
+	FMemory::Memzero(Input.GetData(), Input.Num() * sizeof(float));
+	FMemory::Memzero(PrevLogMagnitude.GetData(), PrevLogMagnitude.Num() * sizeof(float));
+	FMemory::Memzero(Envelope.GetData(), Envelope.Num() * sizeof(float));
+
+	InputWrite = HopFill = 0;
+	NumHops = 0;
+	EnvelopeWrite = EnvelopeCount = HopsSinceUpdate = 0;
+	SearchLag = INDEX_NONE;
+	Odf[0] = Odf[1] = Odf[2] = 0.f;
+	OdfMean = OdfMax = 0.f;
+	LastOnsetSeconds = -1.0;
+	NumNewOnsets = 0;
+	CandidateBPM = 0.f;
+	Estimate = FTempoEstimate();
+}
+
+bool FOnsetTempoTracker::Process(const float* Interleaved, int32 NumFrames, int32 NumChannels, double BlockSeconds)
+{
+	NumNewOnsets = 0;
+	if (!FFT.IsValid() || NumChannels <= 0) return false;
+
+	const uint32 SequenceBefore = Estimate.Sequence;
+	const float InvChannels = 1.f / NumChannels;
+
+	for (int32 Index = 0; Index < NumFrames; ++Index)
+	{
+		float Mix = 0.f;
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Mix += Interleaved[Index * NumChannels + Channel];
+		}
+
+		Input[InputWrite] = Mix * InvChannels;
+		InputWrite = (InputWrite + 1) & (FFTSize - 1);
+
+		if (++HopFill >= HopSize)
+		{
+			HopFill = 0;
+			AnalyzeHop(BlockSeconds + static_cast<double>(Index + 1) / SampleRate);
+		}
+	}
+
+	return Estimate.Sequence != SequenceBefore;
+}
+
+/* ---------------- Internals ---------------- */
+
+void FOnsetTempoTracker::AnalyzeHop(double HopEndSeconds)
+{
+	// Oldest sample is at InputWrite
+	const int32 Head = FFTSize - InputWrite;
+	for (int32 i = 0; i < Head; ++i)
+	{
+		Frame[i] = Input[InputWrite + i] * Window[i];
+	}
+	for (int32 i = Head; i < FFTSize; ++i)
+	{
+		Frame[i] = Input[i - Head] * Window[i];
+	}
+
+	FFT->ForwardRealToComplex(Frame.GetData(), Spectrum.GetData());
+
+	// Spectral flux: rise of the log magnitudes, half-wave rectified
+	const int32 NumBins = LogMagnitude.Num();
+	float Flux = 0.f;
+	for (int32 Bin = 0; Bin < NumBins; ++Bin)
+	{
+		const float Re = Spectrum[2 * Bin];
+		const float Im = Spectrum[2 * Bin + 1];
+		const float Log = FMath::Loge(1.f + OnsetTempo::Compression * MagnitudeScale * FMath::Sqrt(Re * Re + Im * Im));
+		Flux += FMath::Max(0.f, Log - PrevLogMagnitude[Bin]);
+		PrevLogMagnitude[Bin] = Log;
+	}
+	Flux /= NumBins;
+	++NumHops;
+
+	Envelope[EnvelopeWrite] = Flux;
+	EnvelopeWrite = (EnvelopeWrite + 1) % Envelope.Num();
+	EnvelopeCount = FMath::Min(EnvelopeCount + 1, Envelope.Num());
+
+	// The frame is centred half a window before the end of the hop
+	const double CentreSeconds = HopEndSeconds - 0.5 * FFTSize / SampleRate;
+
+	Odf[0] = Odf[1];
+	Odf[1] = Odf[2];
+	Odf[2] = Flux;
+	PickOnset(CentreSeconds - HopSize / SampleRate);
+
+	if (SearchLag != INDEX_NONE)
+	{
+		ContinueSearch();
+	}
+	if (++HopsSinceUpdate >= HopsPerUpdate && SearchLag == INDEX_NONE && EnvelopeCount >= OnsetTempo::WarmupSeconds * GetEnvelopeRate())
+	{
+		HopsSinceUpdate = 0;
+		BeginSearch(CentreSeconds, HopEndSeconds);
+	}
+}
+
+void FOnsetTempoTracker::PickOnset(double FrameSeconds)
+{
+	// Odf[1] is a peak of the envelope above the adaptive threshold
+	const float Threshold = OnsetTempo::ThresholdMean * OdfMean + OnsetTempo::ThresholdPeak * OdfMax;
+	if (Odf[1] > Odf[0] && Odf[1] >= Odf[2] && Odf[1] > Threshold
+		&& (LastOnsetSeconds < 0.0 || FrameSeconds - LastOnsetSeconds >= OnsetTempo::MinOnsetGap))
+	{
+		LastOnsetSeconds = FrameSeconds;
+		if (NumNewOnsets < NewOnsets.Num())
+		{
+			NewOnsets[NumNewOnsets++] = { FrameSeconds, Odf[1] };
+		}
+	}
+
+	const float Rate = GetEnvelopeRate();
+	OdfMean += (1.f - FMath::Exp(-1.f / (OnsetTempo::MeanSeconds * Rate))) * (Odf[2] - OdfMean);
+	OdfMax   = FMath::Max(Odf[2], OdfMax * FMath::Exp(-1.f / (OnsetTempo::PeakSeconds * Rate)));
+}
+
+void FOnsetTempoTracker::BeginSearch(double NewestSeconds, double HopEndSeconds)
+{
+	const float Rate = GetEnvelopeRate();
+	const int32 Count = EnvelopeCount;
+	const int32 Oldest = (EnvelopeWrite - Count + Envelope.Num()) % Envelope.Num();
+
+	// Time-ordered history, smoothed ([1 4 6 4 1] / 16) so a beat period that falls between two
+	// envelope frames still shows as one autocorrelation peak, then made zero-mean
+	auto At = [this, Oldest, Count](int32 i)
+	{
+		return i >= 0 && i < Count ? Envelope[(Oldest + i) % Envelope.Num()] : 0.f;
+	};
+	float Mean = 0.f;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Smoothed[i] = (At(i - 2) + 4.f * At(i - 1) + 6.f * At(i) + 4.f * At(i + 1) + At(i + 2)) * (1.f / 16.f);
+		Mean += Smoothed[i];
+	}
+	Mean /= Count;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Smoothed[i] -= Mean;
+	}
+
+	const int32 MinLag = FMath::Max(1, FMath::FloorToInt(Rate * 60.f / Settings.MaxBPM));
+	const int32 MaxLag = FMath::CeilToInt(Rate * 60.f / Settings.MinBPM);
+	const int32 TopLag = FMath::Min(FMath::Min(2 * MaxLag + 1, Count / 2), Autocorr.Num() - 1);
+	if (TopLag <= MinLag) return;
+
+	// The lags are shared out over the first half of the update interval, so the search is done
+	// long before the next one is due and no one hop carries all of it
+	SearchCount         = Count;
+	SearchTopLag        = TopLag;
+	SearchNewestSeconds = NewestSeconds;
+	SearchEndSeconds    = HopEndSeconds;
+	LagsPerHop          = FMath::DivideAndRoundUp(TopLag + 1, FMath::Max(1, HopsPerUpdate / 2));
+	SearchLag           = 0;
+	ContinueSearch();
+}
+
+void FOnsetTempoTracker::ContinueSearch()
+{
+	// Smoothed is left alone until the search is done, so every slice sees the same history
+	const int32 Count = SearchCount;
+	const int32 EndLag = FMath::Min(SearchLag + LagsPerHop, SearchTopLag + 1);
+	for (int32 Lag = SearchLag; Lag < EndLag; ++Lag)
+	{
+		float Sum = 0.f;
+		for (int32 i = Lag; i < Count; ++i)
+		{
+			Sum += Smoothed[i] * Smoothed[i - Lag];
+		}
+		Autocorr[Lag] = Sum / (Count - Lag);
+	}
+
+	SearchLag = EndLag;
+	if (SearchLag > SearchTopLag)
+	{
+		SearchLag = INDEX_NONE;
+		FinishSearch();
+	}
+}
+
+void FOnsetTempoTracker::FinishSearch()
+{
+	if (Autocorr[0] <= 0.f) return;
+
+	const float Rate = GetEnvelopeRate();
+	const int32 Count  = SearchCount;
+	const int32 TopLag = SearchTopLag;
+	const int32 MinLag = FMath::Max(1, FMath::FloorToInt(Rate * 60.f / Settings.MaxBPM));
+	const int32 MaxLag = FMath::CeilToInt(Rate * 60.f / Settings.MinBPM);
+
+	// Periodicity at the lag, reinforced by the double lag, weighted by the tempo prior
+	auto Score = [this, Rate, TopLag](int32 Lag)
+	{
+		const float LagBPM = Rate * 60.f / Lag;
+		const float Octaves = FMath::Log2(LagBPM / Settings.PriorBPM) / Settings.PriorWidth;
+		const float Periodicity = Autocorr[Lag] + (2 * Lag <= TopLag ? 0.5f * Autocorr[2 * Lag] : 0.f);
+		return FMath::Exp(-0.5f * Octaves * Octaves) * Periodicity;
+	};
+
+	const int32 LastLag = FMath::Min(MaxLag, TopLag);
+	int32 BestLag = MinLag;
+	float BestScore = -UE_MAX_FLT;
+	for (int32 Lag = MinLag; Lag <= LastLag; ++Lag)
+	{
+		const float LagScore = Score(Lag);
+		if (LagScore > BestScore)
+		{
+			BestScore = LagScore;
+			BestLag   = Lag;
+		}
+	}
+
+	// Parabola through the peak for a fractional lag
+	float Lag = static_cast<float>(BestLag);
+	if (BestLag > MinLag && BestLag < LastLag)
+	{
+		const float Y0 = Score(BestLag - 1);
+		const float Y2 = Score(BestLag + 1);
+		const float Curve = Y0 - 2.f * BestScore + Y2;
+		if (Curve < 0.f)
+		{
+			Lag += 0.5f * (Y0 - Y2) / Curve;
+		}
+	}
+	const float FoundBPM = Rate * 60.f / Lag;
+
+	// Confidence is the periodicity the tempo was picked by, against a perfectly periodic envelope:
+	// music with a backbeat repeats more strongly over two beats than over one
+	const bool bDoubleLag = 2 * BestLag <= TopLag;
+	const float Periodicity = Autocorr[BestLag] + (bDoubleLag ? 0.5f * Autocorr[2 * BestLag] : 0.f);
+	const float PerfectPeriodicity = Autocorr[0] * (bDoubleLag ? 1.5f : 1.f);
+
+	// Small changes are followed; a jump has to be found twice in a row
+	if (!Estimate.IsValid())
+	{
+		Estimate.BPM = FoundBPM;
+	}
+	else if (FMath::Abs(FoundBPM / Estimate.BPM - 1.f) < OnsetTempo::TempoTolerance)
+	{
+		Estimate.BPM += OnsetTempo::TempoFollow * (FoundBPM - Estimate.BPM);
+		CandidateBPM = 0.f;
+	}
+	else if (CandidateBPM > 0.f && FMath::Abs(FoundBPM / CandidateBPM - 1.f) < OnsetTempo::TempoTolerance)
+	{
+		Estimate.BPM = FoundBPM;
+		CandidateBPM = 0.f;
+	}
+	else
+	{
+		CandidateBPM = FoundBPM;
+	}
+
+	// Phase: the offset back from the newest frame where a comb at the beat period collects the most onset energy
+	const float Period = Rate * 60.f / Estimate.BPM;
+	int32 BestOffset = 0;
+	float BestComb = -UE_MAX_FLT;
+	for (int32 Offset = 0; Offset < FMath::CeilToInt(Period); ++Offset)
+	{
+		const int32 NumTeeth = FMath::Min(OnsetTempo::CombBeats, FMath::FloorToInt((Count - 2 - Offset) / Period) + 1);
+		float Comb = 0.f;
+		float Weight = 1.f;
+		for (int32 Tooth = 0; Tooth < NumTeeth; ++Tooth)
+		{
+			Comb   += Weight * SmoothedAt(Offset + Tooth * Period);
+			Weight *= OnsetTempo::CombDecay;
+		}
+		if (Comb > BestComb)
+		{
+			BestComb   = Comb;
+			BestOffset = Offset;
+		}
+	}
+
+	// As of the hop the history was taken at; the phase is absolute, so it holds a few hops on
+	Estimate.StreamSeconds   = SearchEndSeconds;
+	Estimate.LastBeatSeconds = SearchNewestSeconds - BestOffset / Rate;
+	Estimate.Confidence      = FMath::Clamp(Periodicity / PerfectPeriodicity, 0.f, 1.f);
+	++Estimate.Sequence;
+}
+
+float FOnsetTempoTracker::SmoothedAt(float FramesBack) const
+{
+	const int32 Newest = SearchCount - 1;
+	const int32 Back   = FMath::FloorToInt(FramesBack);
+	const float Frac   = FramesBack - Back;
+
+	const float A = Smoothed[FMath::Clamp(Newest - Back, 0, Newest)];
+	const float B = Smoothed[FMath::Clamp(Newest - Back - 1, 0, Newest)];
+	return A + (B - A) * Frac;
+}
+
+/* ---------------- Submix tap ---------------- */
+
+FTempoTrackerTap::FTempoTrackerTap(const FOnsetTempoSettings& InSettings, int32 DeviceSampleRate)
+	: Settings(InSettings)
+	, TrackerRate(DeviceSampleRate)
+{
+	Tracker.Init(static_cast<float>(DeviceSampleRate), Settings);
+}
+
+const FString& FTempoTrackerTap::GetListenerName() const
+{
+	static const FString Name(TEXT("TempoTrackerTap"));
+	return Name;
+}
+
+void FTempoTrackerTap::OnNewSubmixBuffer(const USoundSubmix* OwningSubmix, float* AudioData, int32 NumSamples, int32 NumChannels, const int32 SampleRate, double AudioClock)
+{
+	if (NumChannels <= 0) return;
+
+	// Sized for the device rate up front. Re-sizing here would allocate on the render thread, so a
+	// device switch only flags the new rate; the owner replaces the tap from the game thread
+	if (SampleRate != TrackerRate)
+	{
+		MismatchedRate.store(SampleRate, std::memory_order_relaxed);
+		return;
+	}
+
+	if (Tracker.Process(AudioData, NumSamples / NumChannels, NumChannels, AudioClock))
+	{
+		// Overwrites an estimate the game thread hasn't read yet; it only ever needs the newest
+		Slots[WriteSlot] = Tracker.GetEstimate();
+		WriteSlot = static_cast<int32>(SharedSlot.exchange(static_cast<uint32>(WriteSlot) | FreshBit, std::memory_order_acq_rel) & ~FreshBit);
+	}
+}
+
+bool FTempoTrackerTap::PopLatest(FTempoEstimate& OutEstimate)
+{
+	if (!(SharedSlot.load(std::memory_order_relaxed) & FreshBit))
+	{
+		return false;
+	}
+
+	ReadSlot    = static_cast<int32>(SharedSlot.exchange(static_cast<uint32>(ReadSlot), std::memory_order_acq_rel) & ~FreshBit);
+	OutEstimate = Slots[ReadSlot];
+	return true;
+}
@@ -0,0 +1,108 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Audio.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Audio/OnsetTempoTracker.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace OnsetTempoTrackerBenchmark
+{
+	constexpr float SampleRate  = 48000.f;
+	constexpr int32 BlockFrames = 512;
+
+	// 16-bit PCM WAV at SampleRate, interleaved
+	bool LoadWav(const FString& WavPath, TArray<float>& OutAudio, int32& OutNumChannels)
+	{
+		TArray<uint8> Bytes;
+		FWaveModInfo Info;
+		if (!FFileHelper::LoadFileToArray(Bytes, *WavPath) || !Info.ReadWaveInfo(Bytes.GetData(), Bytes.Num())
+			|| *Info.pBitsPerSample != 16 || *Info.pSamplesPerSec != static_cast<uint32>(SampleRate))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("TempoTracker: %s is not a 16-bit %.0f Hz WAV."), *WavPath, SampleRate);
+			return false;
+		}
+
+		OutNumChannels = *Info.pChannels;
+		const int16* Samples = reinterpret_cast<const int16*>(Info.SampleDataStart);
+		OutAudio.SetNumUninitialized(Info.SampleDataSize / sizeof(int16));
+		for (int32 i = 0; i < OutAudio.Num(); ++i)
+		{
+			OutAudio[i] = Samples[i] / 32768.f;
+		}
+		return true;
+	}
+
+	// 40 s of noise hits on the beat and off-beat at 128 BPM over a quiet floor, mono
+	void MakeClickTrack(TArray<float>& OutAudio)
+	{
+		const int32 NumFrames = static_cast<int32>(40.f * SampleRate);
+		OutAudio.SetNumUninitialized(NumFrames);
+
+		FRandomStream Rng(128);
+		const float HalfBeat = 0.5f * 60.f / 128.f;
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			const float T = i / SampleRate;
+			const float Since = FMath::Fmod(T, HalfBeat);
+			const float Gain = FMath::Fmod(T, 2.f * HalfBeat) < HalfBeat ? 0.8f : 0.2f;
+			OutAudio[i] = (Gain * FMath::Exp(-Since * 30.f) + 0.01f) * Rng.FRandRange(-1.f, 1.f);
+		}
+	}
+
+	void Run(const TArray<FString>& Args)
+	{
+		TArray<float> Audio;
+		int32 NumChannels = 1;
+		FString Name = TEXT("click 128");
+		if (Args.Num() > 0)
+		{
+			if (!LoadWav(Args[0], Audio, NumChannels)) return;
+			Name = FPaths::GetCleanFilename(Args[0]);
+		}
+		else
+		{
+			MakeClickTrack(Audio);
+		}
+
+		FOnsetTempoSettings Settings;
+		Settings.PriorBPM = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 120.f;
+
+		FOnsetTempoTracker Tracker;
+		Tracker.Init(SampleRate, Settings);
+
+		int32 NumBlocks = 0;
+		double TotalMs  = 0.0;
+		double MaxMs    = 0.0;
+		const int32 NumFrames = Audio.Num() / NumChannels;
+		for (int32 Frame = 0; Frame < NumFrames; Frame += BlockFrames)
+		{
+			const int32 Frames = FMath::Min(BlockFrames, NumFrames - Frame);
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Tracker.Process(&Audio[Frame * NumChannels], Frames, NumChannels, Frame / SampleRate);
+			const double BlockMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+			TotalMs += BlockMs;
+			MaxMs    = FMath::Max(MaxMs, BlockMs);
+			++NumBlocks;
+		}
+
+		const double BudgetMs = 1000.0 * BlockFrames / SampleRate;
+		const double MeanMs   = TotalMs / FMath::Max(1, NumBlocks);
+		const FTempoEstimate& Estimate = Tracker.GetEstimate();
+		UE_LOG(LogTemp, Display, TEXT("TempoTracker %s: %.4f ms/block (%.2f%% of %.2f ms), max %.4f ms | ends at %.1f BPM, confidence %.2f"),
+			*Name, MeanMs, 100.0 * MeanMs / BudgetMs, BudgetMs, MaxMs, Estimate.BPM, Estimate.Confidence);
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("au.TempoTracker.Benchmark"),
+		TEXT("au.TempoTracker.Benchmark [Path.wav [HintBPM]]: CPU per 512-frame block of the onset/tempo tracker over a built-in click track or a 16-bit 48 kHz WAV, mean and worst block (accuracy is the GameTemplate.Audio.TempoTracker automation tests)."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
+
+#endif
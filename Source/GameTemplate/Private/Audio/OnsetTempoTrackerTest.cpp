@@ -0,0 +1,293 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/AutomationTest.h"
+#include "Audio/OnsetTempoTracker.h"
+#include "Audio/TempoMap.h"
+#include "World/Subsystems/BeatClockSubsystem.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace OnsetTempoTrackerTest
+{
+	constexpr float SampleRate   = 48000.f;
+	constexpr int32 BlockFrames  = 512;
+	constexpr double OnsetWindow = 0.05;  // onset counts as found within +-50 ms
+	constexpr double BeatWindow  = 0.07;  // beat phase counts as right within +-70 ms
+	constexpr double ScoreAfter  = 8.0;   // tempo and phase are scored once the tracker has settled
+	constexpr double FollowAfter = 12.0;  // and the followed clock once it has had a few seconds to pull in
+
+	struct FTrack
+	{
+		FString Name;
+		float HintBPM = 120.f;
+		int32 NumChannels = 2;
+		TArray<float> Audio;
+		TArray<double> Beats;
+		TArray<double> Onsets;
+	};
+
+	// Kick on odd beats, snare on even ones, a hat on each off-beat (pushed late by Swing), over a
+	// pad and noise; tempo from BPMAt, so beats and onsets are known exactly
+	FTrack MakeTrack(const FString& Name, float HintBPM, double Seconds, TFunctionRef<double(double)> BPMAt, double Swing = 0.0)
+	{
+		FTrack Track;
+		Track.Name        = Name;
+		Track.HintBPM     = HintBPM;
+		Track.NumChannels = 2;
+
+		const int32 NumFrames = static_cast<int32>(Seconds * SampleRate);
+		TArray<float> Mono;
+		Mono.SetNumZeroed(NumFrames);
+
+		FRandomStream Rng(Name.Len() * 7919);
+		auto AddHit = [&](double Time, float Gain, float Decay, float Pitch, float Noise)
+		{
+			const int32 Start = static_cast<int32>(Time * SampleRate);
+			const int32 Length = FMath::Min(static_cast<int32>(0.4f * SampleRate), NumFrames - Start);
+			for (int32 i = 0; i < Length; ++i)
+			{
+				const float T = i / SampleRate;
+				const float Tone = Pitch > 0.f ? FMath::Sin(UE_TWO_PI * (Pitch + 80.f * FMath::Exp(-T * 40.f)) * T) : 0.f;
+				Mono[Start + i] += Gain * FMath::Exp(-T * Decay) * ((1.f - Noise) * Tone + Noise * Rng.FRandRange(-1.f, 1.f));
+			}
+		};
+
+		for (double Time = 0.0; Time < Seconds; )
+		{
+			const double Next = Time + 60.0 / BPMAt(Time);
+			const bool bKick = Track.Beats.Num() % 2 == 0;
+			Track.Beats.Add(Time);
+			Track.Onsets.Add(Time);
+			AddHit(Time, 0.8f, 25.f, 50.f, bKick ? 0.f : 0.6f);
+
+			const double Hat = Time + (Next - Time) * (0.5 + Swing);
+			if (Hat < Seconds)
+			{
+				Track.Onsets.Add(Hat);
+				AddHit(Hat, 0.15f, 80.f, 0.f, 1.f);
+			}
+			Time = Next;
+		}
+		Track.Onsets.Sort();
+
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			const float T = i / SampleRate;
+			Mono[i] += 0.05f * FMath::Sin(UE_TWO_PI * 220.f * T) * (1.f + 0.3f * FMath::Sin(UE_TWO_PI * 0.2f * T)) + 0.01f * Rng.FRandRange(-1.f, 1.f);
+		}
+
+		Track.Audio.SetNumUninitialized(NumFrames * 2);
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			Track.Audio[2 * i] = Track.Audio[2 * i + 1] = Mono[i];
+		}
+		return Track;
+	}
+
+	// The built-in set: the hint is the hand-typed BPM a show would have had
+	TArray<FTrack> MakeTracks()
+	{
+		TArray<FTrack> Tracks;
+		Tracks.Add(MakeTrack(TEXT("92"),              90.f,  40.0, [](double) { return 92.0; }));
+		Tracks.Add(MakeTrack(TEXT("128"),             120.f, 40.0, [](double) { return 128.0; }));
+		Tracks.Add(MakeTrack(TEXT("150"),             150.f, 40.0, [](double) { return 150.0; }));
+		Tracks.Add(MakeTrack(TEXT("142 (typed 150)"), 150.f, 40.0, [](double) { return 142.0; }));
+		Tracks.Add(MakeTrack(TEXT("drift 118-126"),   120.f, 40.0, [](double Time) { return 118.0 + 8.0 * Time / 40.0; }));
+		Tracks.Add(MakeTrack(TEXT("swing 140"),       150.f, 40.0, [](double) { return 140.0; }, 0.16));
+		return Tracks;
+	}
+
+	double Nearest(const TArray<double>& Sorted, double Time)
+	{
+		const int32 Upper = Algo::LowerBound(Sorted, Time);
+		double Best = UE_BIG_NUMBER;
+		for (const int32 i : { Upper - 1, Upper })
+		{
+			if (Sorted.IsValidIndex(i))
+			{
+				Best = FMath::Abs(Sorted[i] - Time) < FMath::Abs(Best - Time) ? Sorted[i] : Best;
+			}
+		}
+		return Best;
+	}
+
+	// Reference tempo at Time: the beat interval around it
+	double ReferenceBPM(const TArray<double>& Beats, double Time)
+	{
+		const int32 Upper = FMath::Clamp(Algo::LowerBound(Beats, Time), 1, Beats.Num() - 1);
+		return 60.0 / (Beats[Upper] - Beats[Upper - 1]);
+	}
+
+	void ProcessBlock(FOnsetTempoTracker& Tracker, const FTrack& Track, int32 Frame, TArray<double>& OutOnsets)
+	{
+		const int32 Frames = FMath::Min(BlockFrames, Track.Audio.Num() / Track.NumChannels - Frame);
+		Tracker.Process(&Track.Audio[Frame * Track.NumChannels], Frames, Track.NumChannels, Frame / SampleRate);
+		for (const FDetectedOnset& Onset : Tracker.GetNewOnsets())
+		{
+			OutOnsets.Add(Onset.Seconds);
+		}
+	}
+
+	// Onset F-measure, and the share of settled estimates with the tempo within 4% and the beat
+	// phase within BeatWindow
+	void Score(FAutomationTestBase& Test, const FTrack& Track)
+	{
+		FOnsetTempoSettings Settings;
+		Settings.PriorBPM = Track.HintBPM;
+
+		FOnsetTempoTracker Tracker;
+		Tracker.Init(SampleRate, Settings);
+
+		TArray<double> Found;
+		int32 NumEstimates  = 0;
+		int32 NumTempoRight = 0;
+		int32 NumPhaseRight = 0;
+
+		const int32 NumFrames = Track.Audio.Num() / Track.NumChannels;
+		for (int32 Frame = 0; Frame < NumFrames; Frame += BlockFrames)
+		{
+			const uint32 Sequence = Tracker.GetEstimate().Sequence;
+			ProcessBlock(Tracker, Track, Frame, Found);
+
+			const FTempoEstimate& Estimate = Tracker.GetEstimate();
+			if (Estimate.Sequence != Sequence && Estimate.StreamSeconds >= ScoreAfter)
+			{
+				++NumEstimates;
+				NumTempoRight += FMath::Abs(Estimate.BPM / ReferenceBPM(Track.Beats, Estimate.StreamSeconds) - 1.0) < 0.04 ? 1 : 0;
+				NumPhaseRight += FMath::Abs(Nearest(Track.Beats, Estimate.LastBeatSeconds) - Estimate.LastBeatSeconds) < BeatWindow ? 1 : 0;
+			}
+		}
+
+		// Each reference onset matched to at most one found onset (both sorted)
+		int32 NumHits = 0;
+		int32 Next = 0;
+		for (const double Time : Track.Onsets)
+		{
+			while (Next < Found.Num() && Found[Next] < Time - OnsetWindow) ++Next;
+			if (Next < Found.Num() && Found[Next] <= Time + OnsetWindow)
+			{
+				++NumHits;
+				++Next;
+			}
+		}
+		const double Precision = Found.Num() > 0 ? static_cast<double>(NumHits) / Found.Num() : 0.0;
+		const double Recall    = static_cast<double>(NumHits) / Track.Onsets.Num();
+		const double F         = Precision + Recall > 0.0 ? 2.0 * Precision * Recall / (Precision + Recall) : 0.0;
+
+		const double TempoRight = NumEstimates > 0 ? static_cast<double>(NumTempoRight) / NumEstimates : 0.0;
+		const double PhaseRight = NumEstimates > 0 ? static_cast<double>(NumPhaseRight) / NumEstimates : 0.0;
+		Test.TestTrue(FString::Printf(TEXT("%s: onset F-measure %.3f (P %.3f, R %.3f)"), *Track.Name, F, Precision, Recall), F >= 0.85);
+		Test.TestTrue(FString::Printf(TEXT("%s: %.0f%% of %d estimates within 4%% of the tempo"), *Track.Name, 100.0 * TempoRight, NumEstimates), NumEstimates > 0 && TempoRight >= 0.9);
+		Test.TestTrue(FString::Printf(TEXT("%s: %.0f%% of %d estimates within %.0f ms of a beat"), *Track.Name, 100.0 * PhaseRight, NumEstimates, BeatWindow * 1000.0), NumEstimates > 0 && PhaseRight >= 0.9);
+	}
+
+	/**
+	 * The beat clock following the track, as UBeatClockSubsystem does it: the clock starts
+	 * ClockStart seconds into the music at the hinted tempo, and as each of its beats fires the
+	 * newest estimate (from the audio heard up to then) sets the next beat's tempo and the phase
+	 * correction. Returns the worst distance, in seconds, from a settled clock beat to a music beat.
+	 */
+	double Follow(FAutomationTestBase& Test, const FTrack& Track, double ClockStart)
+	{
+		UTempoMap* TempoMap = NewObject<UTempoMap>();
+		FTempoChange& Change = TempoMap->Changes.AddDefaulted_GetRef();
+		Change.StartBar    = 0;
+		Change.BPM         = Track.HintBPM;
+		Change.BeatsPerBar = 4;
+		TempoMap->Compile();
+
+		FBeatClockSchedule Schedule;
+		Schedule.Start(TempoMap);
+
+		FOnsetTempoSettings Settings;
+		Settings.PriorBPM = Schedule.GetBPM();
+
+		FOnsetTempoTracker Tracker;
+		Tracker.Init(SampleRate, Settings);
+
+		TArray<double> Found;
+		float FollowBPM = 0.f;
+		float PendingCorrection = 0.f;
+		int32 NumScored = 0;
+		double WorstSeconds = 0.0;
+
+		const int32 NumFrames = Track.Audio.Num() / Track.NumChannels;
+		int32 Frame = 0;
+		for (int32 Beat = 0; ; ++Beat)
+		{
+			const double BeatSeconds = ClockStart + Schedule.GetBeatTime(Beat);
+			if (BeatSeconds >= static_cast<double>(NumFrames - BlockFrames) / SampleRate) break;
+
+			// The tap has heard the music up to the end of the block the beat fires in
+			while (Frame / SampleRate < BeatSeconds)
+			{
+				ProcessBlock(Tracker, Track, Frame, Found);
+				Frame += BlockFrames;
+			}
+			const double Now = Frame / SampleRate;
+
+			// HandleMetronome's beat, with UpdateFollow in the middle
+			Schedule.BeginBeat(Beat);
+			const FTempoEstimate& Detected = Tracker.GetEstimate();
+			if (Detected.IsValid() && Detected.Confidence >= FBeatClockSchedule::MinFollowConfidence)
+			{
+				FollowBPM = Detected.BPM;
+				const float ClockPhase = static_cast<float>(FMath::Frac(Schedule.GetBeatAtTime(Now - ClockStart)));
+				PendingCorrection = FBeatClockSchedule::CorrectPhase(Detected.GetPhaseAt(Now), ClockPhase, PendingCorrection);
+			}
+			else
+			{
+				PendingCorrection = 0.f;
+			}
+			Schedule.Schedule(Beat + 1, FollowBPM, PendingCorrection);
+
+			if (BeatSeconds >= FollowAfter)
+			{
+				WorstSeconds = FMath::Max(WorstSeconds, FMath::Abs(Nearest(Track.Beats, BeatSeconds) - BeatSeconds));
+				++NumScored;
+			}
+		}
+
+		Test.TestTrue(FString::Printf(TEXT("%s: the clock followed the music (last confidence %.2f)"), *Track.Name, Tracker.GetEstimate().Confidence), FollowBPM > 0.f);
+		Test.TestTrue(FString::Printf(TEXT("%s: clock beats scored after %.0f s"), *Track.Name, FollowAfter), NumScored > 0);
+		return WorstSeconds;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOnsetTempoTrackerTest, "GameTemplate.Audio.TempoTracker",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FOnsetTempoTrackerTest::RunTest(const FString& Parameters)
+{
+	using namespace OnsetTempoTrackerTest;
+
+	for (const FTrack& Track : MakeTracks())
+	{
+		Score(*this, Track);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTempoFollowTest, "GameTemplate.Audio.TempoTracker.Follow",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTempoFollowTest::RunTest(const FString& Parameters)
+{
+	using namespace OnsetTempoTrackerTest;
+
+	// Clocks started off the music's beat, at the hinted tempo rather than the played one
+	for (const FTrack& Track : MakeTracks())
+	{
+		for (const double ClockStart : { 0.23, 0.41 })
+		{
+			const double WorstSeconds = Follow(*this, Track, ClockStart);
+			TestTrue(FString::Printf(TEXT("%s, clock %.2f s late: every settled beat within %.0f ms of the music's (worst %.1f ms)"),
+				*Track.Name, ClockStart, BeatWindow * 1000.0, WorstSeconds * 1000.0), WorstSeconds < BeatWindow);
+		}
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,344 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/PartitionedConvolver.h"
+#include "DSP/FFTAlgorithm.h"
+
+namespace PartitionedConvolution
+{
+	constexpr int32 MinBlockFrames = 64;
+	constexpr int32 MaxBlockFrames = 4096;
+
+	int32 ClampBlockFrames(int32 BlockFrames)
+	{
+		return FMath::RoundUpToPowerOfTwo(FMath::Clamp(BlockFrames, MinBlockFrames, MaxBlockFrames));
+	}
+
+	TUniquePtr<Audio::IFFTAlgorithm> MakeFFT(int32 FFTSize)
+	{
+		Audio::FFFTSettings FFTSettings;
+		FFTSettings.Log2Size = FMath::FloorLog2(FFTSize);
+		FFTSettings.bArrays128BitAligned = true;
+		FFTSettings.bEnableHardwareAcceleration = true;
+		return Audio::FFFTFactory::NewFFTAlgorithm(FFTSettings);
+	}
+
+	void Split(const float* Interleaved, float* Real, float* Imag, int32 NumBins)
+	{
+		for (int32 k = 0; k < NumBins; ++k)
+		{
+			Real[k] = Interleaved[2 * k];
+			Imag[k] = Interleaved[2 * k + 1];
+		}
+	}
+
+	void Interleave(const float* Real, const float* Imag, float* Interleaved, int32 NumBins)
+	{
+		for (int32 k = 0; k < NumBins; ++k)
+		{
+			Interleaved[2 * k]     = Real[k];
+			Interleaved[2 * k + 1] = Imag[k];
+		}
+	}
+
+	// Gain of forward -> multiply -> inverse for two unit impulses. Whatever scaling the platform's
+	// FFT uses, the impulse spectra are divided by this so the convolver needs no scaling at all.
+	float RoundTripGain(Audio::IFFTAlgorithm& FFT, int32 FFTSize)
+	{
+		Audio::FAlignedFloatBuffer Frame;
+		Audio::FAlignedFloatBuffer Spectrum;
+		Frame.SetNumZeroed(FFTSize);
+		Spectrum.SetNumZeroed(FFT.NumOutputFloats());
+
+		Frame[0] = 1.f;
+		FFT.ForwardRealToComplex(Frame.GetData(), Spectrum.GetData());
+		for (int32 k = 0; k + 1 < Spectrum.Num(); k += 2)
+		{
+			const float Re = Spectrum[k];
+			const float Im = Spectrum[k + 1];
+			Spectrum[k]     = Re * Re - Im * Im;
+			Spectrum[k + 1] = 2.f * Re * Im;
+		}
+		FFT.InverseComplexToReal(Spectrum.GetData(), Frame.GetData());
+		return Frame[0];
+	}
+}
+
+/* ---------------- Impulse ---------------- */
+
+FConvolutionImpulsePtr FConvolutionImpulse::Build(TArrayView<const float> Samples, int32 InNumChannels, float SourceSampleRate,
+	float SampleRate, int32 InBlockFrames, float Gain)
+{
+	using namespace PartitionedConvolution;
+
+	if (InNumChannels <= 0 || Samples.Num() < InNumChannels || SourceSampleRate <= 0.f || SampleRate <= 0.f)
+		return nullptr;
+
+	const int32 BlockFrames = ClampBlockFrames(InBlockFrames);
+	const int32 FFTSize     = 2 * BlockFrames;
+	TUniquePtr<Audio::IFFTAlgorithm> FFT = MakeFFT(FFTSize);
+	if (!FFT.IsValid())
+		return nullptr;
+
+	const float RoundTrip = RoundTripGain(*FFT, FFTSize);
+	if (FMath::Abs(RoundTrip) < UE_SMALL_NUMBER)
+		return nullptr;
+
+	// Resampled length at the device rate (linear interpolation is plenty for a reverb tail)
+	const int32  SourceFrames = Samples.Num() / InNumChannels;
+	const double Step         = SourceSampleRate / SampleRate;
+	const int32  NumFrames    = FMath::Max(1, FMath::FloorToInt32((SourceFrames - 1) / Step) + 1);
+
+	TSharedRef<FConvolutionImpulse, ESPMode::ThreadSafe> Impulse = MakeShared<FConvolutionImpulse, ESPMode::ThreadSafe>();
+	Impulse->NumChannels   = FMath::Min(InNumChannels, MaxChannels);
+	Impulse->BlockFrames   = BlockFrames;
+	Impulse->NumPartitions = FMath::DivideAndRoundUp(NumFrames, BlockFrames);
+	Impulse->BinStride     = Align(BlockFrames + 1, 4);
+	Impulse->Seconds       = NumFrames / SampleRate;
+
+	const int32 NumFloats = Impulse->NumChannels * Impulse->NumPartitions * Impulse->BinStride;
+	Impulse->Real.SetNumZeroed(NumFloats);
+	Impulse->Imag.SetNumZeroed(NumFloats);
+
+	Audio::FAlignedFloatBuffer Frame;
+	Audio::FAlignedFloatBuffer Spectrum;
+	Frame.SetNumUninitialized(FFTSize);
+	Spectrum.SetNumUninitialized(FFT->NumOutputFloats());
+
+	const float Scale = Gain / RoundTrip;
+	for (int32 Channel = 0; Channel < Impulse->NumChannels; ++Channel)
+	{
+		for (int32 Partition = 0; Partition < Impulse->NumPartitions; ++Partition)
+		{
+			// Partition in the first half, zero padded (overlap-save keeps the second half of the output)
+			FMemory::Memzero(Frame.GetData(), FFTSize * sizeof(float));
+			for (int32 i = 0; i < BlockFrames; ++i)
+			{
+				const int32 OutFrame = Partition * BlockFrames + i;
+				if (OutFrame >= NumFrames)
+					break;
+
+				const double Position = OutFrame * Step;
+				const int32  Index    = FMath::Min(static_cast<int32>(Position), SourceFrames - 1);
+				const int32  Next     = FMath::Min(Index + 1, SourceFrames - 1);
+				const float  Frac     = static_cast<float>(Position - Index);
+				const float  A        = Samples[Index * InNumChannels + Channel];
+				const float  B        = Samples[Next * InNumChannels + Channel];
+				Frame[i] = (A + (B - A) * Frac) * Scale;
+			}
+
+			FFT->ForwardRealToComplex(Frame.GetData(), Spectrum.GetData());
+			const int32 Offset = (Channel * Impulse->NumPartitions + Partition) * Impulse->BinStride;
+			Split(Spectrum.GetData(), Impulse->Real.GetData() + Offset, Impulse->Imag.GetData() + Offset, BlockFrames + 1);
+		}
+	}
+
+	return Impulse;
+}
+
+/* ---------------- Convolver ---------------- */
+
+FPartitionedConvolver::FPartitionedConvolver() = default;
+FPartitionedConvolver::~FPartitionedConvolver() = default;
+
+void FPartitionedConvolver::Init(int32 InNumChannels, int32 InBlockFrames, int32 MaxPartitions)
+{
+	using namespace PartitionedConvolution;
+
+	NumChannels = FMath::Clamp(InNumChannels, 1, MaxChannels);
+	BlockFrames = ClampBlockFrames(InBlockFrames);
+	FFTSize     = 2 * BlockFrames;
+	NumBins     = BlockFrames + 1;
+	BinStride   = Align(NumBins, 4);
+	Capacity    = FMath::Max(1, MaxPartitions);
+
+	FFT = MakeFFT(FFTSize);
+
+	Window.SetNumZeroed(NumChannels * FFTSize);
+	Output.SetNumZeroed(NumChannels * BlockFrames);
+	DelayReal.SetNumZeroed(NumChannels * Capacity * BinStride);
+	DelayImag.SetNumZeroed(NumChannels * Capacity * BinStride);
+	AccReal.SetNumZeroed(BinStride);
+	AccImag.SetNumZeroed(BinStride);
+	Spectrum.SetNumZeroed(FFT.IsValid() ? FFT->NumOutputFloats() : FFTSize + 2);
+	Time.SetNumZeroed(FFTSize);
+
+	Impulse.Reset();
+	NumPartitions = 0;
+	Reset();
+}
+
+void FPartitionedConvolver::SetImpulse(FConvolutionImpulsePtr InImpulse)
+{
+	Impulse = MoveTemp(InImpulse);
+	if (Impulse.IsValid() && (Impulse->GetBlockFrames() != BlockFrames || Impulse->GetNumPartitions() > Capacity))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("PartitionedConvolver: resizing for a %d x %d impulse on the audio thread; prepare for the longest impulse up front."),
+			Impulse->GetNumPartitions(), Impulse->GetBlockFrames());
+		const FConvolutionImpulsePtr Keep = Impulse;
+		Init(NumChannels, Keep->GetBlockFrames(), FMath::Max(Capacity, Keep->GetNumPartitions()));
+		Impulse = Keep;
+	}
+
+	NumPartitions = Impulse.IsValid() ? Impulse->GetNumPartitions() : 0;
+	Reset();
+}
+
+void FPartitionedConvolver::Reset()
+{
+	FMemory::Memzero(Window.GetData(), Window.Num() * sizeof(float));
+	FMemory::Memzero(Output.GetData(), Output.Num() * sizeof(float));
+	// Only the slots the current impulse walks over
+	for (int32 Channel = 0; Channel < NumChannels && NumPartitions > 0; ++Channel)
+	{
+		FMemory::Memzero(DelayReal.GetData() + Channel * Capacity * BinStride, NumPartitions * BinStride * sizeof(float));
+		FMemory::Memzero(DelayImag.GetData() + Channel * Capacity * BinStride, NumPartitions * BinStride * sizeof(float));
+	}
+	Fill = 0;
+	Head = 0;
+}
+
+void FPartitionedConvolver::ProcessAdd(const float* In, float* Out, int32 NumFrames, float GainStart, float GainEnd)
+{
+	if (!Impulse.IsValid() || !FFT.IsValid() || NumFrames <= 0)
+		return;
+
+	const float GainStep = (GainEnd - GainStart) / NumFrames;
+
+	int32 Done = 0;
+	while (Done < NumFrames)
+	{
+		// Up to the end of the block being filled; the output read alongside is the previous block's
+		const int32 Num = FMath::Min(BlockFrames - Fill, NumFrames - Done);
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			float*       WindowIn = Window.GetData() + Channel * FFTSize + BlockFrames + Fill;
+			const float* Wet      = Output.GetData() + Channel * BlockFrames + Fill;
+			const float* InFrame  = In  + Done * NumChannels + Channel;
+			float*       OutFrame = Out + Done * NumChannels + Channel;
+
+			float Gain = GainStart + GainStep * Done;
+			for (int32 i = 0; i < Num; ++i)
+			{
+				WindowIn[i] = InFrame[i * NumChannels];
+				OutFrame[i * NumChannels] += Wet[i] * Gain;
+				Gain += GainStep;
+			}
+		}
+
+		Fill += Num;
+		Done += Num;
+		if (Fill == BlockFrames)
+		{
+			ProcessBlock();
+			Fill = 0;
+		}
+	}
+}
+
+void FPartitionedConvolver::ProcessBlock()
+{
+	using namespace PartitionedConvolution;
+
+	Head = (Head + 1) % NumPartitions;
+
+	for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		float* ChannelWindow = Window.GetData() + Channel * FFTSize;
+		float* DelayRe       = DelayReal.GetData() + Channel * Capacity * BinStride;
+		float* DelayIm       = DelayImag.GetData() + Channel * Capacity * BinStride;
+
+		// Newest input spectrum into the delay line; the block just filled becomes the last block
+		FFT->ForwardRealToComplex(ChannelWindow, Spectrum.GetData());
+		Split(Spectrum.GetData(), DelayRe + Head * BinStride, DelayIm + Head * BinStride, NumBins);
+		FMemory::Memcpy(ChannelWindow, ChannelWindow + BlockFrames, BlockFrames * sizeof(float));
+
+		// Partition p meets the input from p blocks ago: walk back from the head, wrapping once
+		const int32 IRChannel = FMath::Min(Channel, Impulse->GetNumChannels() - 1);
+		FMemory::Memzero(AccReal.GetData(), BinStride * sizeof(float));
+		FMemory::Memzero(AccImag.GetData(), BinStride * sizeof(float));
+		for (int32 Partition = 0; Partition < NumPartitions; ++Partition)
+		{
+			const int32 Slot = Head >= Partition ? Head - Partition : Head - Partition + NumPartitions;
+			MultiplyAccumulate(DelayRe + Slot * BinStride, DelayIm + Slot * BinStride,
+				Impulse->GetReal(IRChannel, Partition), Impulse->GetImag(IRChannel, Partition),
+				AccReal.GetData(), AccImag.GetData(), BinStride);
+		}
+
+		// Overlap-save: the second half is the linear convolution of the newest block
+		Interleave(AccReal.GetData(), AccImag.GetData(), Spectrum.GetData(), NumBins);
+		FFT->InverseComplexToReal(Spectrum.GetData(), Time.GetData());
+		FMemory::Memcpy(Output.GetData() + Channel * BlockFrames, Time.GetData() + BlockFrames, BlockFrames * sizeof(float));
+	}
+}
+
+void FPartitionedConvolver::MultiplyAccumulate(const float* XReal, const float* XImag, const float* HReal, const float* HImag,
+	float* AccReal, float* AccImag, int32 NumBins)
+{
+	for (int32 k = 0; k < NumBins; k += 4)
+	{
+		const VectorRegister4Float Xr = VectorLoadAligned(XReal + k);
+		const VectorRegister4Float Xi = VectorLoadAligned(XImag + k);
+		const VectorRegister4Float Hr = VectorLoadAligned(HReal + k);
+		const VectorRegister4Float Hi = VectorLoadAligned(HImag + k);
+
+		// (Xr + iXi)(Hr + iHi) = (Xr*Hr - Xi*Hi) + i(Xr*Hi + Xi*Hr)
+		VectorRegister4Float Re = VectorLoadAligned(AccReal + k);
+		VectorRegister4Float Im = VectorLoadAligned(AccImag + k);
+		Re = VectorNegateMultiplyAdd(Xi, Hi, VectorMultiplyAdd(Xr, Hr, Re));
+		Im = VectorMultiplyAdd(Xi, Hr, VectorMultiplyAdd(Xr, Hi, Im));
+		VectorStoreAligned(Re, AccReal + k);
+		VectorStoreAligned(Im, AccImag + k);
+	}
+}
+
+/* ---------------- Room ---------------- */
+
+void FConvolutionRoom::Init(float InSampleRate, int32 InNumChannels)
+{
+	SampleRate  = FMath::Max(1.f, InSampleRate);
+	NumChannels = FMath::Clamp(InNumChannels, 1, FPartitionedConvolver::MaxChannels);
+}
+
+void FConvolutionRoom::Prepare(int32 BlockFrames, int32 MaxPartitions)
+{
+	for (FPartitionedConvolver& Slot : Slots)
+	{
+		Slot.Init(NumChannels, BlockFrames, MaxPartitions);
+	}
+}
+
+void FConvolutionRoom::CrossfadeTo(FConvolutionImpulsePtr InImpulse, float Seconds)
+{
+	if (!InImpulse.IsValid() || (InImpulse == Slots[Incoming].GetImpulse() && Progress >= 1.f))
+		return;
+
+	// The quieter slot takes the new room (the idle one, unless a fade is still under way)
+	const float Angle       = 0.5f * UE_PI * Progress;
+	const float InGain      = Slots[Incoming].HasImpulse() ? FMath::Sin(Angle) : 0.f;
+	const float OutGain     = Slots[1 - Incoming].HasImpulse() ? FadeOutFrom * FMath::Cos(Angle) : 0.f;
+	const int32 Target      = InGain < OutGain ? Incoming : 1 - Incoming;
+
+	FadeOutFrom = Target == Incoming ? OutGain : InGain;
+	Incoming    = Target;
+	Slots[Incoming].SetImpulse(MoveTemp(InImpulse));
+
+	const float FadeFrames = Seconds * SampleRate;
+	Progress     = FadeFrames >= 1.f ? 0.f : 1.f;
+	ProgressStep = FadeFrames >= 1.f ? 1.f / FadeFrames : 0.f;
+}
+
+void FConvolutionRoom::ProcessAdd(const float* In, float* Out, int32 NumFrames)
+{
+	const float From = Progress;
+	Progress = FMath::Min(1.f, Progress + ProgressStep * NumFrames);
+
+	// Equal-power gains at both ends of the call; the convolver ramps linearly in between
+	const float AngleFrom = 0.5f * UE_PI * From;
+	const float AngleTo   = 0.5f * UE_PI * Progress;
+	Slots[Incoming].ProcessAdd(In, Out, NumFrames, FMath::Sin(AngleFrom), FMath::Sin(AngleTo));
+
+	if (From < 1.f)
+	{
+		Slots[1 - Incoming].ProcessAdd(In, Out, NumFrames, FadeOutFrom * FMath::Cos(AngleFrom), FadeOutFrom * FMath::Cos(AngleTo));
+	}
+}
@@ -0,0 +1,241 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Audio/PartitionedConvolver.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace PartitionedConvolverTest
+{
+	constexpr float SampleRate  = 48000.f;
+	constexpr int32 NumChannels = 2;
+	constexpr int32 NumFrames   = 6000;
+
+	// Uneven callbacks, so blocks are filled across several of them and several blocks fall in one
+	const int32 Callbacks[] = { 1, 17, 256, 999, 64, 513, 2048 };
+
+	TArray<float> MakeNoise(int32 NumSamples, int32 Seed, bool bDecaying = false, int32 NumChannelsIn = 1)
+	{
+		FRandomStream Rng(Seed);
+		TArray<float> Samples;
+		Samples.SetNumUninitialized(NumSamples);
+		const int32 Frames = NumSamples / NumChannelsIn;
+		for (int32 i = 0; i < NumSamples; ++i)
+		{
+			const float Decay = bDecaying ? FMath::Exp(-4.f * (i / NumChannelsIn) / Frames) : 1.f;
+			Samples[i] = Rng.FRandRange(-0.5f, 0.5f) * Decay;
+		}
+		return Samples;
+	}
+
+	// The impulse Build makes of Samples: each channel resampled linearly to SampleRate and scaled
+	TArray<double> ReferenceImpulse(const TArray<float>& Samples, int32 NumIRChannels, int32 Channel, float SourceSampleRate, float Gain)
+	{
+		const int32  SourceFrames = Samples.Num() / NumIRChannels;
+		const double Step         = SourceSampleRate / SampleRate;
+		const int32  Frames       = FMath::FloorToInt32((SourceFrames - 1) / Step) + 1;
+
+		TArray<double> Impulse;
+		Impulse.SetNumUninitialized(Frames);
+		for (int32 i = 0; i < Frames; ++i)
+		{
+			const double Position = i * Step;
+			const int32  Index    = FMath::Min(static_cast<int32>(Position), SourceFrames - 1);
+			const int32  Next     = FMath::Min(Index + 1, SourceFrames - 1);
+			const double A        = Samples[Index * NumIRChannels + Channel];
+			const double B        = Samples[Next * NumIRChannels + Channel];
+			Impulse[i] = (A + (B - A) * (Position - Index)) * Gain;
+		}
+		return Impulse;
+	}
+
+	// Direct convolution of one channel of the interleaved input from FirstFrame on, delayed by the
+	// convolver's latency
+	TArray<double> Convolve(const TArray<float>& In, int32 Channel, const TArray<double>& Impulse, int32 LatencyFrames, int32 FirstFrame = 0)
+	{
+		TArray<double> Out;
+		Out.SetNumZeroed(NumFrames);
+		for (int32 n = LatencyFrames; n < NumFrames; ++n)
+		{
+			const int32 Frame = n - LatencyFrames;
+			double Sum = 0.0;
+			for (int32 k = 0; k < Impulse.Num() && Frame - k >= FirstFrame; ++k)
+			{
+				Sum += Impulse[k] * In[(Frame - k) * NumChannels + Channel];
+			}
+			Out[n] = Sum;
+		}
+		return Out;
+	}
+
+	// Worst difference from the reference over [FromFrame, NumFrames), relative to its peak
+	double RelativeError(const TArray<float>& Out, int32 Channel, const TArray<double>& Reference, int32 FromFrame = 0)
+	{
+		double Peak = 0.0;
+		double Worst = 0.0;
+		for (int32 n = FromFrame; n < NumFrames; ++n)
+		{
+			Peak  = FMath::Max(Peak, FMath::Abs(Reference[n]));
+			Worst = FMath::Max(Worst, FMath::Abs(Out[n * NumChannels + Channel] - Reference[n]));
+		}
+		return Peak > 0.0 ? Worst / Peak : Worst;
+	}
+
+	template<typename ProcessFn>
+	TArray<float> Render(const TArray<float>& In, ProcessFn&& Process)
+	{
+		TArray<float> Out;
+		Out.SetNumZeroed(NumFrames * NumChannels);
+		for (int32 Frame = 0, Call = 0; Frame < NumFrames; ++Call)
+		{
+			const int32 Count = FMath::Min(Callbacks[Call % UE_ARRAY_COUNT(Callbacks)], NumFrames - Frame);
+			Process(In.GetData() + Frame * NumChannels, Out.GetData() + Frame * NumChannels, Count, Frame);
+			Frame += Count;
+		}
+		return Out;
+	}
+
+	// One impulse through a convolver against direct convolution, per output channel
+	void CheckConvolver(FAutomationTestBase& Test, int32 BlockFrames, int32 NumIRChannels, int32 IRFrames, float SourceSampleRate)
+	{
+		const FString What = FString::Printf(TEXT("%d-frame blocks, %d-channel %d-frame IR at %.0f Hz"), BlockFrames, NumIRChannels, IRFrames, SourceSampleRate);
+		constexpr float Gain = 0.7f;
+
+		const TArray<float> IR = MakeNoise(IRFrames * NumIRChannels, IRFrames, true, NumIRChannels);
+		const FConvolutionImpulsePtr Impulse = FConvolutionImpulse::Build(IR, NumIRChannels, SourceSampleRate, SampleRate, BlockFrames, Gain);
+		if (!Test.TestTrue(FString::Printf(TEXT("%s: impulse built (FFT available)"), *What), Impulse.IsValid()))
+			return;
+
+		FPartitionedConvolver Convolver;
+		Convolver.Init(NumChannels, BlockFrames, Impulse->GetNumPartitions());
+		Convolver.SetImpulse(Impulse);
+		Test.TestEqual(FString::Printf(TEXT("%s: latency"), *What), Convolver.GetLatencyFrames(), BlockFrames);
+
+		const TArray<float> In = MakeNoise(NumFrames * NumChannels, 77);
+		const TArray<float> Out = Render(In, [&Convolver](const float* Block, float* OutBlock, int32 Count, int32)
+		{
+			Convolver.ProcessAdd(Block, OutBlock, Count);
+		});
+
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			// A mono impulse plays on every channel
+			const TArray<double> Reference = Convolve(In, Channel, ReferenceImpulse(IR, NumIRChannels, FMath::Min(Channel, NumIRChannels - 1), SourceSampleRate, Gain), BlockFrames);
+			const double Error = RelativeError(Out, Channel, Reference);
+			Test.TestTrue(FString::Printf(TEXT("%s, channel %d: matches direct convolution (worst %.2e of peak)"), *What, Channel, Error), Error < 1e-4);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPartitionedConvolverTest, "GameTemplate.Audio.PartitionedConvolver",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPartitionedConvolverTest::RunTest(const FString& Parameters)
+{
+	using namespace PartitionedConvolverTest;
+
+	// Partitions that end mid-block, a single partition, a mono IR and a resampled one
+	CheckConvolver(*this, 64,  2, 1000, SampleRate);
+	CheckConvolver(*this, 256, 2, 1000, SampleRate);
+	CheckConvolver(*this, 256, 2, 200,  SampleRate);
+	CheckConvolver(*this, 128, 1, 700,  SampleRate);
+	CheckConvolver(*this, 128, 2, 500,  24000.f);
+
+	// The multiply-accumulate against plain complex arithmetic, bin by bin
+	{
+		constexpr int32 NumBins = 68;
+		const TArray<float> Values = MakeNoise(6 * NumBins, 5);
+		Audio::FAlignedFloatBuffer Buffer(Values.GetData(), Values.Num());
+		float* Xr = Buffer.GetData();
+		float* Xi = Xr + NumBins;
+		float* Hr = Xi + NumBins;
+		float* Hi = Hr + NumBins;
+		float* Ar = Hi + NumBins;
+		float* Ai = Ar + NumBins;
+
+		TArray<float> ExpectedReal, ExpectedImag;
+		for (int32 k = 0; k < NumBins; ++k)
+		{
+			ExpectedReal.Add(Ar[k] + Xr[k] * Hr[k] - Xi[k] * Hi[k]);
+			ExpectedImag.Add(Ai[k] + Xr[k] * Hi[k] + Xi[k] * Hr[k]);
+		}
+		FPartitionedConvolver::MultiplyAccumulate(Xr, Xi, Hr, Hi, Ar, Ai, NumBins);
+
+		float Worst = 0.f;
+		for (int32 k = 0; k < NumBins; ++k)
+		{
+			Worst = FMath::Max(Worst, FMath::Max(FMath::Abs(Ar[k] - ExpectedReal[k]), FMath::Abs(Ai[k] - ExpectedImag[k])));
+		}
+		TestTrue(FString::Printf(TEXT("Multiply-accumulate matches complex arithmetic (worst %.2e)"), Worst), Worst < 1e-5f);
+	}
+
+	// A room settled on one impulse is that convolution; once a cross-fade to another is over only
+	// the new one sounds, convolving what came in since the swap (its history starts there)
+	{
+		constexpr int32 BlockFrames = 128;
+		constexpr int32 SwapFrame   = 2000;
+		constexpr float FadeSeconds = 0.01f;
+
+		const TArray<float> FirstIR  = MakeNoise(600 * NumChannels, 1, true, NumChannels);
+		const TArray<float> SecondIR = MakeNoise(900 * NumChannels, 2, true, NumChannels);
+		const FConvolutionImpulsePtr First  = FConvolutionImpulse::Build(FirstIR, NumChannels, SampleRate, SampleRate, BlockFrames);
+		const FConvolutionImpulsePtr Second = FConvolutionImpulse::Build(SecondIR, NumChannels, SampleRate, SampleRate, BlockFrames);
+		if (!TestTrue(TEXT("Room impulses built"), First.IsValid() && Second.IsValid()))
+			return true;
+
+		FConvolutionRoom Room;
+		Room.Init(SampleRate, NumChannels);
+		Room.Prepare(BlockFrames, Second->GetNumPartitions());
+		Room.CrossfadeTo(First, 0.f);
+		TestTrue(TEXT("Room is active once an impulse is set"), Room.IsActive());
+
+		const TArray<float> In = MakeNoise(NumFrames * NumChannels, 78);
+		bool bSwapped = false;
+		const TArray<float> Out = Render(In, [&](const float* Block, float* OutBlock, int32 Count, int32 Frame)
+		{
+			// The swap lands on a callback boundary, as a snapshot change does
+			if (!bSwapped && Frame + Count > SwapFrame)
+			{
+				Room.CrossfadeTo(Second, FadeSeconds);
+				bSwapped = true;
+			}
+			Room.ProcessAdd(Block, OutBlock, Count);
+		});
+
+		// The callback the swap landed on
+		int32 SwappedAt = 0;
+		for (int32 Call = 0; SwappedAt + Callbacks[Call % UE_ARRAY_COUNT(Callbacks)] <= SwapFrame; ++Call)
+		{
+			SwappedAt += Callbacks[Call % UE_ARRAY_COUNT(Callbacks)];
+		}
+		// The outgoing room is still summed over the callback the fade ends in
+		int32 FadedBy = 0;
+		for (int32 Call = 0; FadedBy < SwappedAt + FMath::CeilToInt32(FadeSeconds * SampleRate); ++Call)
+		{
+			FadedBy += Callbacks[Call % UE_ARRAY_COUNT(Callbacks)];
+		}
+
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			const TArray<double> Settled = Convolve(In, Channel, ReferenceImpulse(FirstIR, NumChannels, Channel, SampleRate, 1.f), BlockFrames);
+			double Error = 0.0;
+			double Peak  = 0.0;
+			for (int32 n = 0; n < SwappedAt; ++n)
+			{
+				Peak  = FMath::Max(Peak, FMath::Abs(Settled[n]));
+				Error = FMath::Max(Error, FMath::Abs(Out[n * NumChannels + Channel] - Settled[n]));
+			}
+			Error = Peak > 0.0 ? Error / Peak : Error;
+			TestTrue(FString::Printf(TEXT("Settled room, channel %d: matches direct convolution (worst %.2e of peak)"), Channel, Error), Error < 1e-4);
+
+			const TArray<double> Faded = Convolve(In, Channel, ReferenceImpulse(SecondIR, NumChannels, Channel, SampleRate, 1.f), BlockFrames, SwappedAt);
+			Error = RelativeError(Out, Channel, Faded, FadedBy);
+			TestTrue(FString::Printf(TEXT("Faded-to room, channel %d: only the new impulse from frame %d (worst %.2e of peak)"), Channel, FadedBy, Error), Error < 1e-4);
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,274 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/SubmixEffectSnapshot.h"
+#include "AudioDeviceManager.h"
+#include "AudioMixerDevice.h"
+#include "DSP/FloatArrayMath.h"
+
+namespace SubmixEffectSnapshot
+{
+	// Largest callback we size scratch buffers for up front (frames * channels)
+	constexpr int32 MaxPreallocatedSamples = 4096 * 8;
+}
+
+FSubmixEffectSnapshot::FSubmixEffectSnapshot() = default;
+
+FSubmixEffectSnapshot::~FSubmixEffectSnapshot()
+{
+	KeyPatch.Reset();
+}
+
+void FSubmixEffectSnapshot::Init(const FSoundEffectSubmixInitData& InData)
+{
+	SampleRate  = InData.SampleRate;
+	NumChannels = 2;
+
+	MusicBus.Init(SampleRate, NumChannels);
+
+	Reverb = MakeUnique<Audio::FPlateReverbFast>(SampleRate);
+	Room.Init(SampleRate, NumChannels);
+
+	// Rooms were preloaded before this instance existed: size it now, not in the first SetRoom
+	if (const USubmixEffectSnapshotPreset* SnapshotPreset = Cast<USubmixEffectSnapshotPreset>(Preset.Get()))
+	{
+		int32 BlockFrames   = 0;
+		int32 MaxPartitions = 0;
+		SnapshotPreset->GetRoomSize(BlockFrames, MaxPartitions);
+		if (MaxPartitions > 0)
+		{
+			Room.Prepare(BlockFrames, MaxPartitions);
+		}
+	}
+
+	CutoffEase.Init(SampleRate);
+	ShelfEase.Init(SampleRate);
+	AttackEase.Init(SampleRate);
+	ReleaseEase.Init(SampleRate);
+	ThresholdEase.Init(SampleRate);
+	WetEase.Init(SampleRate);
+
+	if (FAudioDeviceManager* DeviceManager = FAudioDeviceManager::Get())
+	{
+		MixerDevice = static_cast<Audio::FMixerDevice*>(DeviceManager->GetAudioDeviceRaw(InData.DeviceID));
+	}
+
+	// Nothing below may allocate on the render thread for normal callback sizes
+	KeyBuffer.Reserve(SubmixEffectSnapshot::MaxPreallocatedSamples);
+	WetBuffer.Reserve(SubmixEffectSnapshot::MaxPreallocatedSamples);
+	PlateBuffer.Reserve(SubmixEffectSnapshot::MaxPreallocatedSamples);
+}
+
+void FSubmixEffectSnapshot::OnPresetChanged()
+{
+	GET_EFFECT_SETTINGS(SubmixEffectSnapshot);
+
+	ControlBlockFrames = FMath::Max(8, Settings.ControlBlockFrames);
+	ShelfFrequencyHz   = Settings.ShelfFrequencyHz;
+	ShelfBandwidth     = Settings.ShelfBandwidth;
+	CompRatio          = Settings.CompRatio;
+	ApplyControlValues();
+
+	SetKeySubmix(Settings.KeySubmix ? Settings.KeySubmix->GetUniqueID() : INDEX_NONE);
+
+	// The initial look is only taken once; later preset edits must not cancel a running blend
+	if (!bInitialLookApplied)
+	{
+		bInitialLookApplied = true;
+		BlendTo(Settings.Initial, 0.f);
+	}
+}
+
+void FSubmixEffectSnapshot::BlendTo(const FSnapshotTargets& Targets, float BlendSeconds)
+{
+	const float Seconds = FMath::Max(0.f, BlendSeconds);
+
+	FSnapshotTargets Clamped = Targets;
+	Clamped.FilterCutoffHz = FMath::Clamp(Targets.FilterCutoffHz, 20.f, 20000.f);
+	Clamped.CompAttackMs   = FMath::Max(0.1f, Targets.CompAttackMs);
+	Clamped.CompReleaseMs  = FMath::Max(1.f, Targets.CompReleaseMs);
+	Clamped.ReverbWet      = FMath::Clamp(Targets.ReverbWet, 0.f, 1.f);
+
+	if (Seconds <= 0.f)
+	{
+		// Jump: every ease reports the new value from now on
+		CutoffEase.SetValueInterrupt(Clamped.FilterCutoffHz);
+		ShelfEase.SetValueInterrupt(Clamped.EQHighShelfGainDb);
+		AttackEase.SetValueInterrupt(Clamped.CompAttackMs);
+		ReleaseEase.SetValueInterrupt(Clamped.CompReleaseMs);
+		ThresholdEase.SetValueInterrupt(Clamped.CompThresholdDb);
+		WetEase.SetValueInterrupt(Clamped.ReverbWet);
+
+		CutoffHz    = Clamped.FilterCutoffHz;
+		ShelfDb     = Clamped.EQHighShelfGainDb;
+		AttackMs    = Clamped.CompAttackMs;
+		ReleaseMs   = Clamped.CompReleaseMs;
+		ThresholdDb = Clamped.CompThresholdDb;
+		CurrentWet  = Clamped.ReverbWet;
+		ApplyControlValues();
+		return;
+	}
+
+	// Ramp from wherever the previous blend got to, so an interrupted blend never snaps back
+	CutoffEase.SetValueRange(CutoffHz, Clamped.FilterCutoffHz, Seconds);
+	ShelfEase.SetValueRange(ShelfDb, Clamped.EQHighShelfGainDb, Seconds);
+	AttackEase.SetValueRange(AttackMs, Clamped.CompAttackMs, Seconds);
+	ReleaseEase.SetValueRange(ReleaseMs, Clamped.CompReleaseMs, Seconds);
+	ThresholdEase.SetValueRange(ThresholdDb, Clamped.CompThresholdDb, Seconds);
+	WetEase.SetValueRange(CurrentWet, Clamped.ReverbWet, Seconds);
+}
+
+void FSubmixEffectSnapshot::OnProcessAudio(const FSoundEffectSubmixInputData& InData, FSoundEffectSubmixOutputData& OutData)
+{
+	const float* InBuffer  = InData.AudioBuffer->GetData();
+	float*       OutBuffer = OutData.AudioBuffer->GetData();
+	const int32  NumFrames  = InData.NumFrames;
+	const int32  NumSamples = NumFrames * NumChannels;
+
+	// Sidechain key for the whole callback
+	const float* KeyData = nullptr;
+	if (KeyPatch.IsValid() && KeyNumChannels > 0)
+	{
+		KeyBuffer.SetNumUninitialized(NumFrames * KeyNumChannels);
+		const int32 NumPopped = KeyPatch->PopAudio(KeyBuffer.GetData(), KeyBuffer.Num(), false);
+		if (NumPopped < KeyBuffer.Num())
+		{
+			FMemory::Memzero(KeyBuffer.GetData() + NumPopped, (KeyBuffer.Num() - NumPopped) * sizeof(float));
+		}
+		KeyData = KeyBuffer.GetData();
+	}
+
+	// Dry chain, with control values re-evaluated every ControlBlockFrames
+	for (int32 Frame = 0; Frame < NumFrames; Frame += ControlBlockFrames)
+	{
+		const int32 SliceFrames  = FMath::Min(ControlBlockFrames, NumFrames - Frame);
+		const int32 Offset       = Frame * NumChannels;
+
+		CutoffHz    = CutoffEase.GetNextValue(SliceFrames);
+		ShelfDb     = ShelfEase.GetNextValue(SliceFrames);
+		AttackMs    = AttackEase.GetNextValue(SliceFrames);
+		ReleaseMs   = ReleaseEase.GetNextValue(SliceFrames);
+		ThresholdDb = ThresholdEase.GetNextValue(SliceFrames);
+		ApplyControlValues();
+
+		MusicBus.Process(InBuffer + Offset, OutBuffer + Offset, SliceFrames,
+			KeyData ? KeyData + Frame * KeyNumChannels : nullptr, KeyNumChannels);
+	}
+
+	// Reverb send (the room once one is set, else the plate), wet level ramped sample by sample across the callback
+	if (Room.IsActive() || Reverb.IsValid())
+	{
+		WetBuffer.SetNumUninitialized(NumSamples);
+		if (Room.IsActive())
+		{
+			const float FadeFrom = Room.GetProgress();
+			FMemory::Memzero(WetBuffer.GetData(), NumSamples * sizeof(float));
+			Room.ProcessAdd(OutBuffer, WetBuffer.GetData(), NumFrames);
+
+			// The plate hands over to the first room on the room's own equal-power curve
+			if (PlateFadeFrom > 0.f && Reverb.IsValid())
+			{
+				const float FadeTo = Room.GetProgress();
+				Reverb->ProcessAudio(*OutData.AudioBuffer, NumChannels, PlateBuffer, NumChannels);
+				Audio::ArrayMixIn(PlateBuffer, WetBuffer,
+					PlateFadeFrom * FMath::Cos(0.5f * UE_PI * FadeFrom), PlateFadeFrom * FMath::Cos(0.5f * UE_PI * FadeTo));
+				if (FadeTo >= 1.f)
+				{
+					PlateFadeFrom = 0.f;
+				}
+			}
+		}
+		else
+		{
+			Reverb->ProcessAudio(*OutData.AudioBuffer, NumChannels, WetBuffer, NumChannels);
+		}
+
+		const float StartWet = CurrentWet;
+		CurrentWet = WetEase.GetNextValue(NumFrames);
+		Audio::ArrayMixIn(WetBuffer, *OutData.AudioBuffer, StartWet, CurrentWet);
+	}
+}
+
+void FSubmixEffectSnapshot::PrepareRoom(int32 BlockFrames, int32 MaxPartitions)
+{
+	Room.Prepare(BlockFrames, MaxPartitions);
+}
+
+void FSubmixEffectSnapshot::SetRoom(FConvolutionImpulsePtr Impulse, float CrossfadeSeconds)
+{
+	// Plate gain right now: all of it before the first room, part of it if that fade is still running
+	PlateFadeFrom = Room.IsActive() ? PlateFadeFrom * FMath::Cos(0.5f * UE_PI * Room.GetProgress()) : 1.f;
+	Room.CrossfadeTo(MoveTemp(Impulse), CrossfadeSeconds);
+}
+
+/* ---------------- Internals ---------------- */
+
+void FSubmixEffectSnapshot::ApplyControlValues()
+{
+	FMusicBusKernelParams Params;
+	Params.CutoffHz         = CutoffHz;
+	Params.ShelfFrequencyHz = ShelfFrequencyHz;
+	Params.ShelfBandwidth   = ShelfBandwidth;
+	Params.ShelfGainDb      = ShelfDb;
+	Params.AttackMs         = AttackMs;
+	Params.ReleaseMs        = ReleaseMs;
+	Params.ThresholdDb      = ThresholdDb;
+	Params.Ratio            = CompRatio;
+	MusicBus.SetParams(Params);
+}
+
+void FSubmixEffectSnapshot::SetKeySubmix(uint32 SubmixId)
+{
+	if (SubmixId == KeySubmixId) return;
+
+	KeyPatch.Reset();
+	KeySubmixId    = SubmixId;
+	KeyNumChannels = 0;
+
+	if (SubmixId == static_cast<uint32>(INDEX_NONE) || !MixerDevice) return;
+
+	KeyPatch = MixerDevice->AddPatchForSubmix(SubmixId, 1.f);
+	if (KeyPatch.IsValid())
+	{
+		KeyNumChannels = MixerDevice->GetNumDeviceChannels();
+	}
+}
+
+/* ---------------- Preset ---------------- */
+
+void USubmixEffectSnapshotPreset::BlendTo(const FSnapshotTargets& Targets, float BlendSeconds)
+{
+	EffectCommand<FSubmixEffectSnapshot>([Targets, BlendSeconds](FSubmixEffectSnapshot& Effect)
+	{
+		Effect.BlendTo(Targets, BlendSeconds);
+	});
+}
+
+void USubmixEffectSnapshotPreset::SetSettings(const FSubmixEffectSnapshotSettings& InSettings)
+{
+	UpdateSettings(InSettings);
+}
+
+void USubmixEffectSnapshotPreset::PrepareRoom(int32 BlockFrames, int32 MaxPartitions)
+{
+	RoomBlockFrames.store(BlockFrames, std::memory_order_relaxed);
+	RoomMaxPartitions.store(MaxPartitions, std::memory_order_release);
+
+	EffectCommand<FSubmixEffectSnapshot>([BlockFrames, MaxPartitions](FSubmixEffectSnapshot& Effect)
+	{
+		Effect.PrepareRoom(BlockFrames, MaxPartitions);
+	});
+}
+
+void USubmixEffectSnapshotPreset::GetRoomSize(int32& OutBlockFrames, int32& OutMaxPartitions) const
+{
+	OutMaxPartitions = RoomMaxPartitions.load(std::memory_order_acquire);
+	OutBlockFrames   = RoomBlockFrames.load(std::memory_order_relaxed);
+}
+
+void USubmixEffectSnapshotPreset::SetRoom(FConvolutionImpulsePtr Impulse, float CrossfadeSeconds)
+{
+	EffectCommand<FSubmixEffectSnapshot>([Impulse, CrossfadeSeconds](FSubmixEffectSnapshot& Effect)
+	{
+		Effect.SetRoom(Impulse, CrossfadeSeconds);
+	});
+}
@@ -0,0 +1,159 @@
+﻿// © Anastasis Marinos //
+
+#include "Audio/TempoMap.h"
+#include "Algo/BinarySearch.h"
+
+UTempoMap* UTempoMap::MakeConstant(UObject* Outer, float BPM, int32 BeatsPerBar)
+{
+	UTempoMap* Map = NewObject<UTempoMap>(Outer, NAME_None, RF_Transient);
+
+	FTempoChange Change;
+	Change.BPM         = BPM;
+	Change.BeatsPerBar = BeatsPerBar;
+	Map->Changes.Add(Change);
+	Map->Compile();
+	return Map;
+}
+
+void UTempoMap::Compile()
+{
+	TArray<FTempoChange> Sorted = Changes;
+	Sorted.StableSort([](const FTempoChange& A, const FTempoChange& B) { return A.StartBar < B.StartBar; });
+
+	if (Sorted.Num() == 0)
+	{
+		Sorted.Add(FTempoChange());
+	}
+	Sorted[0].StartBar = 0;
+
+	Segments.Reset(Sorted.Num());
+	for (const FTempoChange& Change : Sorted)
+	{
+		FSegment Segment;
+		Segment.StartBar       = Change.StartBar;
+		Segment.BPM            = FMath::Max(10.f, Change.BPM); // clamp to avoid div by zero
+		Segment.SecondsPerBeat = 60.0 / Segment.BPM;
+		Segment.BeatsPerBar    = FMath::Max(1, Change.BeatsPerBar);
+
+		if (Segments.Num() > 0)
+		{
+			const FSegment& Prev = Segments.Last();
+
+			// Two changes on one bar: the later entry wins
+			if (Prev.StartBar == Segment.StartBar)
+			{
+				Segment.StartBeat    = Prev.StartBeat;
+				Segment.StartSeconds = Prev.StartSeconds;
+				Segments.Last() = Segment;
+				continue;
+			}
+
+			const int32 BeatsInPrev = (Segment.StartBar - Prev.StartBar) * Prev.BeatsPerBar;
+			Segment.StartBeat    = Prev.StartBeat + BeatsInPrev;
+			Segment.StartSeconds = Prev.StartSeconds + BeatsInPrev * Prev.SecondsPerBeat;
+		}
+
+		Segments.Add(Segment);
+	}
+}
+
+FTempoMapPosition UTempoMap::TimeToPosition(double Seconds) const
+{
+	const FSegment& Segment = SegmentAtTime(Seconds);
+
+	const double BeatsIn = FMath::Max(0.0, (Seconds - Segment.StartSeconds) / Segment.SecondsPerBeat);
+	const int32  Whole   = FMath::FloorToInt32(BeatsIn);
+
+	FTempoMapPosition Position;
+	Position.Beat      = Segment.StartBeat + Whole;
+	Position.Bar       = Segment.StartBar + Whole / Segment.BeatsPerBar;
+	Position.BeatInBar = Whole % Segment.BeatsPerBar;
+	Position.Phase     = static_cast<float>(BeatsIn - Whole);
+	return Position;
+}
+
+double UTempoMap::GetNextBeatTime(double Seconds) const
+{
+	if (Seconds < 0.0)
+	{
+		return 0.0;
+	}
+	return BeatToTime(TimeToPosition(Seconds).Beat + 1);
+}
+
+double UTempoMap::BeatToTime(int32 Beat) const
+{
+	const FSegment& Segment = SegmentAtBeat(Beat);
+	return Segment.StartSeconds + (Beat - Segment.StartBeat) * Segment.SecondsPerBeat;
+}
+
+double UTempoMap::BarToTime(int32 Bar) const
+{
+	const FSegment& Segment = SegmentAtBar(Bar);
+	return Segment.StartSeconds + (Bar - Segment.StartBar) * Segment.BeatsPerBar * Segment.SecondsPerBeat;
+}
+
+float UTempoMap::GetBPMAtBeat(int32 Beat) const
+{
+	return SegmentAtBeat(Beat).BPM;
+}
+
+int32 UTempoMap::GetBeatsPerBarAtBeat(int32 Beat) const
+{
+	return SegmentAtBeat(Beat).BeatsPerBar;
+}
+
+FTempoMapPosition UTempoMap::BeatToPosition(int32 Beat) const
+{
+	const FSegment& Segment = SegmentAtBeat(Beat);
+	const int32 Offset = FMath::Max(0, Beat - Segment.StartBeat);
+
+	FTempoMapPosition Position;
+	Position.Beat      = Beat;
+	Position.Bar       = Segment.StartBar + Offset / Segment.BeatsPerBar;
+	Position.BeatInBar = Offset % Segment.BeatsPerBar;
+	return Position;
+}
+
+void UTempoMap::PostLoad()
+{
+	Super::PostLoad();
+	Compile();
+}
+
+#if WITH_EDITOR
+void UTempoMap::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	Compile();
+}
+#endif
+
+/* ---------------- Internals ---------------- */
+
+const UTempoMap::FSegment& UTempoMap::SegmentAtTime(double Seconds) const
+{
+	static const FSegment Default;
+	if (Segments.Num() == 0) return Default;
+
+	const int32 Index = Algo::UpperBoundBy(Segments, Seconds, &FSegment::StartSeconds) - 1;
+	return Segments[FMath::Max(0, Index)];
+}
+
+const UTempoMap::FSegment& UTempoMap::SegmentAtBeat(int32 Beat) const
+{
+	static const FSegment Default;
+	if (Segments.Num() == 0) return Default;
+
+	const int32 Index = Algo::UpperBoundBy(Segments, Beat, &FSegment::StartBeat) - 1;
+	return Segments[FMath::Max(0, Index)];
+}
+
+const UTempoMap::FSegment& UTempoMap::SegmentAtBar(int32 Bar) const
+{
+	static const FSegment Default;
+	if (Segments.Num() == 0) return Default;
+
+	const int32 Index = Algo::UpperBoundBy(Segments, Bar, &FSegment::StartBar) - 1;
+	return Segments[FMath::Max(0, Index)];
+}
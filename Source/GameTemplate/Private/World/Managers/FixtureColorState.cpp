@@ -0,0 +1,224 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Managers/FixtureColorState.h"
+
+namespace FixtureColorState
+{
+	// Pushed value for a fixture that has never been pushed: always reads as dirty
+	constexpr float NeverPushed = -1.e6f;
+
+	float WrapHue(float Hue)
+	{
+		Hue = FMath::Fmod(Hue, 360.f);
+		return Hue < 0.f ? Hue + 360.f : Hue;
+	}
+}
+
+int32 FFixtureColorState::Add(const FLinearColor& Color)
+{
+	const int32 Index = NumFixtures++;
+	SetNumLanes(Align(NumFixtures, 4));
+
+	SetColor(Index, Color);
+	PushedR[Index] = PushedG[Index] = PushedB[Index] = PushedA[Index] = FixtureColorState::NeverPushed;
+	return Index;
+}
+
+void FFixtureColorState::RemoveAtSwap(int32 Index)
+{
+	check(Index >= 0 && Index < NumFixtures);
+
+	const int32 Last = --NumFixtures;
+	ForEachLanes([Index, Last](FLanes& Lanes)
+	{
+		Lanes[Index] = Lanes[Last];
+		Lanes[Last]  = 0.f;
+	});
+}
+
+void FFixtureColorState::Reset()
+{
+	NumFixtures = 0;
+	BlendEnd    = 0.f;
+	SetNumLanes(0);
+}
+
+void FFixtureColorState::SetColor(int32 Index, const FLinearColor& Color)
+{
+	const FLinearColor HSV = Color.LinearRGBToHSV();
+
+	StartH[Index] = HSV.R;
+	StartS[Index] = HSV.G;
+	StartV[Index] = HSV.B;
+	StartA[Index] = HSV.A;
+	DeltaH[Index] = DeltaS[Index] = DeltaV[Index] = DeltaA[Index] = 0.f;
+	Delay[Index]  = InvDuration[Index] = 0.f;
+
+	R[Index] = Color.R;
+	G[Index] = Color.G;
+	B[Index] = Color.B;
+	A[Index] = Color.A;
+}
+
+void FFixtureColorState::BlendTo(int32 Index, const FLinearColor& Target, float InDelay, float Duration)
+{
+	if (InDelay <= 0.f && Duration <= 0.f)
+	{
+		SetColor(Index, Target);
+		return;
+	}
+
+	const FLinearColor From = FLinearColor(R[Index], G[Index], B[Index], A[Index]).LinearRGBToHSV();
+	const FLinearColor To   = Target.LinearRGBToHSV();
+
+	// Shortest way round the hue circle
+	float HueDelta = To.R - From.R;
+	if (HueDelta > 180.f)  HueDelta -= 360.f;
+	if (HueDelta < -180.f) HueDelta += 360.f;
+
+	StartH[Index] = From.R;
+	StartS[Index] = From.G;
+	StartV[Index] = From.B;
+	StartA[Index] = From.A;
+	DeltaH[Index] = HueDelta;
+	DeltaS[Index] = To.G - From.G;
+	DeltaV[Index] = To.B - From.B;
+	DeltaA[Index] = To.A - From.A;
+
+	const float SafeDuration = FMath::Max(KINDA_SMALL_NUMBER, Duration);
+	Delay[Index]       = FMath::Max(0.f, InDelay);
+	InvDuration[Index] = 1.f / SafeDuration;
+
+	BlendEnd = FMath::Max(BlendEnd, Delay[Index] + SafeDuration);
+}
+
+void FFixtureColorState::Rebase(float Time)
+{
+	BlendEnd = 0.f;
+
+	for (int32 i = 0; i < NumFixtures; ++i)
+	{
+		if (InvDuration[i] <= 0.f) continue;
+
+		const float Alpha = FMath::Clamp((Time - Delay[i]) * InvDuration[i], 0.f, 1.f);
+		if (Alpha >= 1.f)
+		{
+			// Finished: fold the blend into its start so the lane is idle again
+			StartH[i] = FixtureColorState::WrapHue(StartH[i] + DeltaH[i]);
+			StartS[i] += DeltaS[i];
+			StartV[i] += DeltaV[i];
+			StartA[i] += DeltaA[i];
+			DeltaH[i] = DeltaS[i] = DeltaV[i] = DeltaA[i] = 0.f;
+			Delay[i]  = InvDuration[i] = 0.f;
+			continue;
+		}
+
+		Delay[i] -= Time;
+		BlendEnd = FMath::Max(BlendEnd, Delay[i] + 1.f / InvDuration[i]);
+	}
+}
+
+void FFixtureColorState::Advance(float Time)
+{
+	const VectorRegister4Float Zero     = VectorZeroFloat();
+	const VectorRegister4Float One      = VectorOneFloat();
+	const VectorRegister4Float Four     = VectorSetFloat1(4.f);
+	const VectorRegister4Float Six      = VectorSetFloat1(6.f);
+	const VectorRegister4Float InvSix   = VectorSetFloat1(1.f / 6.f);
+	const VectorRegister4Float Full     = VectorSetFloat1(360.f);
+	const VectorRegister4Float InvFull  = VectorSetFloat1(1.f / 360.f);
+	const VectorRegister4Float InvSixty = VectorSetFloat1(1.f / 60.f);
+	const VectorRegister4Float OffsetR  = VectorSetFloat1(5.f);
+	const VectorRegister4Float OffsetG  = VectorSetFloat1(3.f);
+	const VectorRegister4Float Clock    = VectorSetFloat1(Time);
+
+	// HSV -> RGB: c = V - V*S*saturate(min(k, 4 - k)), k = (n + H/60) mod 6, n = 5, 3, 1 for R, G, B
+	auto Channel = [&](const VectorRegister4Float& Sextant, const VectorRegister4Float& Offset, const VectorRegister4Float& V, const VectorRegister4Float& Chroma)
+	{
+		VectorRegister4Float K = VectorAdd(Sextant, Offset);
+		K = VectorSubtract(K, VectorMultiply(Six, VectorFloor(VectorMultiply(K, InvSix))));
+		const VectorRegister4Float W = VectorMin(VectorMax(VectorMin(K, VectorSubtract(Four, K)), Zero), One);
+		return VectorSubtract(V, VectorMultiply(Chroma, W));
+	};
+
+	const int32 NumLanes = StartH.Num();
+	for (int32 i = 0; i < NumLanes; i += 4)
+	{
+		const VectorRegister4Float T = VectorMin(VectorMax(
+			VectorMultiply(VectorSubtract(Clock, VectorLoadAligned(&Delay[i])), VectorLoadAligned(&InvDuration[i])), Zero), One);
+
+		VectorRegister4Float H = VectorMultiplyAdd(T, VectorLoadAligned(&DeltaH[i]), VectorLoadAligned(&StartH[i]));
+		H = VectorSubtract(H, VectorMultiply(Full, VectorFloor(VectorMultiply(H, InvFull))));
+
+		const VectorRegister4Float S     = VectorMultiplyAdd(T, VectorLoadAligned(&DeltaS[i]), VectorLoadAligned(&StartS[i]));
+		const VectorRegister4Float V     = VectorMultiplyAdd(T, VectorLoadAligned(&DeltaV[i]), VectorLoadAligned(&StartV[i]));
+		const VectorRegister4Float Alpha = VectorMultiplyAdd(T, VectorLoadAligned(&DeltaA[i]), VectorLoadAligned(&StartA[i]));
+
+		const VectorRegister4Float Sextant = VectorMultiply(H, InvSixty);
+		const VectorRegister4Float Chroma  = VectorMultiply(V, S);
+
+		VectorStoreAligned(Channel(Sextant, OffsetR, V, Chroma), &R[i]);
+		VectorStoreAligned(Channel(Sextant, OffsetG, V, Chroma), &G[i]);
+		VectorStoreAligned(Channel(Sextant, One,     V, Chroma), &B[i]);
+		VectorStoreAligned(Alpha, &A[i]);
+	}
+}
+
+FLinearColor FFixtureColorState::GetColor(int32 Index) const
+{
+	return FLinearColor(R[Index], G[Index], B[Index], A[Index]);
+}
+
+void FFixtureColorState::GatherDirty(float DeadBand, bool bExact, TArray<int32>& OutDirty) const
+{
+	OutDirty.Reset();
+
+	const VectorRegister4Float Threshold = VectorSetFloat1(bExact ? 0.f : DeadBand);
+
+	const int32 NumLanes = R.Num();
+	for (int32 i = 0; i < NumLanes; i += 4)
+	{
+		VectorRegister4Float Moved = VectorAbs(VectorSubtract(VectorLoadAligned(&R[i]), VectorLoadAligned(&PushedR[i])));
+		Moved = VectorMax(Moved, VectorAbs(VectorSubtract(VectorLoadAligned(&G[i]), VectorLoadAligned(&PushedG[i]))));
+		Moved = VectorMax(Moved, VectorAbs(VectorSubtract(VectorLoadAligned(&B[i]), VectorLoadAligned(&PushedB[i]))));
+		Moved = VectorMax(Moved, VectorAbs(VectorSubtract(VectorLoadAligned(&A[i]), VectorLoadAligned(&PushedA[i]))));
+
+		uint32 Mask = VectorMaskBits(VectorCompareGT(Moved, Threshold));
+		while (Mask)
+		{
+			const int32 Index = i + FMath::CountTrailingZeros(Mask);
+			if (Index < NumFixtures)
+			{
+				OutDirty.Add(Index);
+			}
+			Mask &= Mask - 1;
+		}
+	}
+}
+
+void FFixtureColorState::MarkPushed(int32 Index)
+{
+	PushedR[Index] = R[Index];
+	PushedG[Index] = G[Index];
+	PushedB[Index] = B[Index];
+	PushedA[Index] = A[Index];
+}
+
+/* ---------------- Internals ---------------- */
+
+void FFixtureColorState::SetNumLanes(int32 NumLanes)
+{
+	ForEachLanes([NumLanes](FLanes& Lanes)
+	{
+		Lanes.SetNumZeroed(NumLanes);
+	});
+}
+
+void FFixtureColorState::ForEachLanes(TFunctionRef<void(FLanes&)> Fn)
+{
+	for (FLanes* Lanes : { &StartH, &StartS, &StartV, &StartA, &DeltaH, &DeltaS, &DeltaV, &DeltaA,
+		&Delay, &InvDuration, &R, &G, &B, &A, &PushedR, &PushedG, &PushedB, &PushedA })
+	{
+		Fn(*Lanes);
+	}
+}
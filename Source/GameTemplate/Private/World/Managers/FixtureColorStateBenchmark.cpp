@@ -0,0 +1,77 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "World/Managers/FixtureColorState.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace FixtureColorStateBenchmark
+{
+	constexpr int32 NumSteps = 600;
+
+	FLinearColor RandomColor(FRandomStream& Rng)
+	{
+		return FLinearColor(Rng.FRand(), Rng.FRand(), Rng.FRand(), 1.f);
+	}
+
+	void RunRig(int32 NumFixtures)
+	{
+		FRandomStream Rng(NumFixtures);
+
+		TArray<FLinearColor> From;
+		TArray<FLinearColor> To;
+		TArray<FLinearColor> Scalar;
+		From.Reserve(NumFixtures);
+		To.Reserve(NumFixtures);
+		Scalar.SetNumUninitialized(NumFixtures);
+
+		FFixtureColorState State;
+		for (int32 i = 0; i < NumFixtures; ++i)
+		{
+			From.Add(RandomColor(Rng));
+			To.Add(RandomColor(Rng));
+			State.Add(From[i]);
+			State.BlendTo(i, To[i], 0.f, 1.f);
+		}
+
+		// Per-fixture LerpUsingHSV, what a rig of independent fixtures costs on the old path
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Step = 1; Step <= NumSteps; ++Step)
+		{
+			const float Alpha = static_cast<float>(Step) / NumSteps;
+			for (int32 i = 0; i < NumFixtures; ++i)
+			{
+				Scalar[i] = FLinearColor::LerpUsingHSV(From[i], To[i], Alpha);
+			}
+		}
+		const double ScalarMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 Step = 1; Step <= NumSteps; ++Step)
+		{
+			State.Advance(static_cast<float>(Step) / NumSteps);
+		}
+		const double KernelMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		// Correctness is covered by the GameTemplate.Light.FixtureColorState automation test
+		UE_LOG(LogTemp, Display, TEXT("Fixture blend %5d fixtures: LerpUsingHSV %.4f ms/frame, SoA kernel %.4f ms/frame (x%.2f)"),
+			NumFixtures, ScalarMs / NumSteps, KernelMs / NumSteps, KernelMs > 0.0 ? ScalarMs / KernelMs : 0.0);
+	}
+
+	void Run()
+	{
+		for (const int32 NumFixtures : { 64, 512, 4096 })
+		{
+			RunRig(NumFixtures);
+		}
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("light.FixtureBlend.Benchmark"),
+		TEXT("Times the structure-of-arrays HSV fixture kernel against per-fixture FLinearColor::LerpUsingHSV (64, 512 and 4096 fixtures)."),
+		FConsoleCommandDelegate::CreateStatic(&Run));
+}
+
+#endif
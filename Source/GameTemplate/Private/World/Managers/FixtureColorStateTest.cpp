@@ -0,0 +1,101 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "World/Managers/FixtureColorState.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FixtureColorStateTest
+{
+	float MaxChannelError(const FLinearColor& Expected, const FLinearColor& Actual)
+	{
+		return FMath::Max(FMath::Max3(FMath::Abs(Expected.R - Actual.R), FMath::Abs(Expected.G - Actual.G), FMath::Abs(Expected.B - Actual.B)),
+			FMath::Abs(Expected.A - Actual.A));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFixtureColorStateTest, "GameTemplate.Light.FixtureColorState",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFixtureColorStateTest::RunTest(const FString& Parameters)
+{
+	using namespace FixtureColorStateTest;
+
+	// An odd count, so the last SIMD pass runs on a partly filled lane group
+	constexpr int32 NumFixtures = 37;
+	FRandomStream Rng(37);
+
+	TArray<FLinearColor> From;
+	TArray<FLinearColor> To;
+	FFixtureColorState State;
+	for (int32 i = 0; i < NumFixtures; ++i)
+	{
+		From.Add(FLinearColor(Rng.FRand(), Rng.FRand(), Rng.FRand(), 1.f));
+		To.Add(FLinearColor(Rng.FRand(), Rng.FRand(), Rng.FRand(), Rng.FRand()));
+		State.Add(From[i]);
+		State.BlendTo(i, To[i], 0.f, 1.f);
+	}
+	TestEqual(TEXT("Blend end"), State.GetBlendEnd(), 1.f);
+
+	// The SIMD kernel against per-fixture LerpUsingHSV, hue wrap included
+	for (const float Alpha : { 0.f, 0.37f, 0.5f, 1.f })
+	{
+		State.Advance(Alpha);
+		float MaxError = 0.f;
+		for (int32 i = 0; i < NumFixtures; ++i)
+		{
+			MaxError = FMath::Max(MaxError, MaxChannelError(FLinearColor::LerpUsingHSV(From[i], To[i], Alpha), State.GetColor(i)));
+		}
+		TestTrue(FString::Printf(TEXT("Matches LerpUsingHSV at %.2f (max error %.5f)"), Alpha, MaxError), MaxError < 1.e-3f);
+	}
+
+	// Delay: untouched before it, on the way after it
+	FFixtureColorState Staggered;
+	Staggered.Add(FLinearColor::Red);
+	Staggered.BlendTo(0, FLinearColor::Blue, 0.5f, 1.f);
+	TestEqual(TEXT("Staggered blend end"), Staggered.GetBlendEnd(), 1.5f);
+	Staggered.Advance(0.25f);
+	TestTrue(TEXT("Still at the start color before its delay"), MaxChannelError(FLinearColor::Red, Staggered.GetColor(0)) < 1.e-4f);
+	Staggered.Advance(1.f);
+	TestTrue(TEXT("Half way after its delay"),
+		MaxChannelError(FLinearColor::LerpUsingHSV(FLinearColor::Red, FLinearColor::Blue, 0.5f), Staggered.GetColor(0)) < 1.e-3f);
+
+	// Rebase keeps a blend in flight where it was, on the new clock origin
+	Staggered.Rebase(1.f);
+	TestEqual(TEXT("Blend end after rebase"), Staggered.GetBlendEnd(), 0.5f);
+	Staggered.Advance(0.f);
+	TestTrue(TEXT("Rebase leaves the color in place"),
+		MaxChannelError(FLinearColor::LerpUsingHSV(FLinearColor::Red, FLinearColor::Blue, 0.5f), Staggered.GetColor(0)) < 1.e-3f);
+	Staggered.Advance(0.5f);
+	TestTrue(TEXT("Lands on the target after rebase"), MaxChannelError(FLinearColor::Blue, Staggered.GetColor(0)) < 1.e-4f);
+
+	// Dead-band: never-pushed fixtures are dirty, small moves are not, bExact sees any move
+	FFixtureColorState Pushed;
+	Pushed.Add(FLinearColor::White);
+	Pushed.Add(FLinearColor::White);
+	TArray<int32> Dirty;
+	Pushed.GatherDirty(0.01f, false, Dirty);
+	TestEqual(TEXT("New fixtures are dirty"), Dirty.Num(), 2);
+
+	Pushed.MarkPushed(0);
+	Pushed.MarkPushed(1);
+	Pushed.SetColor(0, FLinearColor(0.995f, 1.f, 1.f, 1.f));
+	Pushed.SetColor(1, FLinearColor(0.5f, 1.f, 1.f, 1.f));
+	Pushed.GatherDirty(0.01f, false, Dirty);
+	TestTrue(TEXT("Only the fixture past the dead-band is dirty"), Dirty.Num() == 1 && Dirty[0] == 1);
+	Pushed.GatherDirty(0.01f, true, Dirty);
+	TestEqual(TEXT("Exact gathers every moved fixture"), Dirty.Num(), 2);
+
+	// Removing swaps the last fixture in, color and push state together
+	Pushed.MarkPushed(0);
+	Pushed.RemoveAtSwap(0);
+	TestEqual(TEXT("Count after remove"), Pushed.Num(), 1);
+	TestTrue(TEXT("Last fixture moved into the hole"), MaxChannelError(FLinearColor(0.5f, 1.f, 1.f, 1.f), Pushed.GetColor(0)) < 1.e-6f);
+	Pushed.GatherDirty(0.01f, false, Dirty);
+	TestTrue(TEXT("Its pushed state moved with it"), Dirty.Num() == 1 && Dirty[0] == 0);
+
+	return true;
+}
+
+#endif
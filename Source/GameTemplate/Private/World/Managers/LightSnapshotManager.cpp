@@ -1,11 +1,40 @@
 ﻿// © Anastasis Marinos //
 
 #include "World/Managers/LightSnapshotManager.h"
-#include "Kismet/GameplayStatics.h"
+#include "World/Subsystems/MoodLookSubsystem.h"
+#include "World/Subsystems/StageRegistrySubsystem.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+#include "AudioDevice.h"
+#include "DSP/Dsp.h"
 
 ALightSnapshotManager::ALightSnapshotManager()
 {
+	// Blends are stepped by the USnapshotBlendSubsystem; the tick only runs while audio reactive
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void ALightSnapshotManager::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	Overrides.Build(SnapshotColorTable);
+
+	UStageRegistrySubsystem::RegisterActor(this, ALightSnapshotManager::StaticClass());
+}
+
+void ALightSnapshotManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopAudioReactive();
+
+	if (UStageRegistrySubsystem* Registry = UStageRegistrySubsystem::Get(this))
+	{
+		Registry->OnRegistered.Remove(RegisteredHandle);
+		Registry->OnUnregistered.Remove(UnregisteredHandle);
+	}
+	UStageRegistrySubsystem::UnregisterActor(this, ALightSnapshotManager::StaticClass());
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ALightSnapshotManager::BeginPlay()
@@ -17,15 +46,21 @@ void ALightSnapshotManager::BeginPlay()
 		AutoFindAllLights();
 	}
 
-	if (SnapshotColorTable.Num() == 0)
+	if (!MoodLooks)
+	{
+		MoodLooks = UMoodLookSubsystem::GetDefaultLooks(this);
+	}
+
+	if (FixtureCollection)
 	{
-		BuildDefaultSnapshotColors();
+		FixtureCollectionInstance = GetWorld()->GetParameterCollectionInstance(FixtureCollection);
 	}
 
 	// Initialize current color from first light (if any), else white
-	if (Lights.Num() > 0 && Lights[0].IsValid())
+	const AStageLight* FirstLight = Owners.Num() > 0 ? Cast<AStageLight>(Owners[0].Get()) : nullptr;
+	if (FirstLight)
 	{
-		CurrentColor = Lights[0]->GetLightColor();
+		CurrentColor = FirstLight->GetLightColor();
 	}
 	else
 	{
@@ -34,37 +69,85 @@ void ALightSnapshotManager::BeginPlay()
 	StartColor = TargetColor = CurrentColor;
 
 	// Ensure all lights are pushed to current color on start
-	PushColorAll(CurrentColor);
+	for (int32 i = 0; i < Fixtures.Num(); ++i)
+	{
+		Fixtures.SetColor(i, CurrentColor);
+	}
+	PushDirty(true);
+
+	StartAudioReactive();
 }
 
 void ALightSnapshotManager::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
-	if (!bBlending) return;
+	const float OldGain       = ReactiveGain;
+	const float OldSaturation = ReactiveSaturation;
+	UpdateAudioReactive(DeltaSeconds);
 
-	BlendElapsed += DeltaSeconds;
-	const float Alpha = FMath::Clamp(BlendElapsed / FMath::Max(BlendDuration, KINDA_SMALL_NUMBER), 0.f, 1.f);
+	// Blends push on their own step; between them only a moved modulation needs pushing
+	if (ReactiveGain != OldGain || ReactiveSaturation != OldSaturation)
+	{
+		PushDirty(false);
+	}
+}
 
-	CurrentColor = FLinearColor::LerpUsingHSV(StartColor, TargetColor, Alpha);
-	PushColorAll(CurrentColor);
+void ALightSnapshotManager::StepSnapshotBlend(float Alpha)
+{
+	Evaluate(Alpha * BlendDuration);
+	PushDirty(Alpha >= 1.f);
 
 	if (Alpha >= 1.f)
 	{
-		bBlending = false;
+		UE_LOG(LogTemp, Verbose, TEXT("LightSnapshotManager: blend done, %llu pushes, %llu suppressed"), NumPushed, NumSuppressed);
 	}
 }
 
 void ALightSnapshotManager::RegisterLight(AStageLight* Light)
 {
-	if (!Light) return;
-	Lights.AddUnique(Light);
+	if (!Light || Owners.Contains(Light)) return;
+
+	AddFixture(Light, INDEX_NONE, Light->FixtureGroup, Light->SpotLight, Light->SM_LightHead);
 	Light->SetLightColor(CurrentColor);
 }
 
 void ALightSnapshotManager::UnregisterLight(AStageLight* Light)
 {
-	Lights.Remove(Light);
+	const int32 Index = Owners.IndexOfByKey(Light);
+	if (Index != INDEX_NONE)
+	{
+		RemoveFixtureAt(Index);
+	}
+}
+
+void ALightSnapshotManager::RegisterRig(AStageLightRig* Rig)
+{
+	if (!Rig || Owners.Contains(Rig)) return;
+
+	for (int32 Slot = 0; Slot < Rig->GetNumFixtures(); ++Slot)
+	{
+		USpotLightComponent* Beam = Rig->GetBeam(Slot);
+		AddFixture(Rig, Slot, Rig->GetFixtureGroup(Slot), Beam, nullptr);
+
+		if (Beam)
+		{
+			Beam->SetLightColor(CurrentColor, true);
+		}
+		Rig->SetHeadColor(Slot, CurrentColor);
+	}
+	Rig->FlushHeadColors();
+}
+
+void ALightSnapshotManager::UnregisterRig(AStageLightRig* Rig)
+{
+	for (int32 i = Owners.Num() - 1; i >= 0; --i)
+	{
+		if (Owners[i].Get() == Rig)
+		{
+			RemoveFixtureAt(i);
+		}
+	}
 }
 
 void ALightSnapshotManager::ApplyLightColor(const FLinearColor& InTargetColor, float BlendSeconds)
@@ -73,105 +156,478 @@ void ALightSnapshotManager::ApplyLightColor(const FLinearColor& InTargetColor, f
 	{
 		BlendSeconds = DefaultBlendSeconds;
 	}
-	BeginBlendTo(InTargetColor, BlendSeconds);
+
+	BeginBlendSetup();
+
+	StartColor       = CurrentColor;
+	TargetColor      = InTargetColor;
+	RigBlendStart    = 0.f;
+	RigBlendDuration = BlendSeconds;
+
+	for (int32 i = 0; i < Fixtures.Num(); ++i)
+	{
+		Fixtures.BlendTo(i, InTargetColor, 0.f, BlendSeconds);
+		GroupOffsets[i] = FVector3f::ZeroVector;
+	}
+	bHasGroupOffsets = false;
+
+	FinishBlendSetup();
 }
 
 void ALightSnapshotManager::ApplyLightSnapshot(EAudioSnapshot Snapshot, float BlendSeconds)
 {
-	if (!SnapshotColorTable.Contains(Snapshot))
+	const FLinearColor* Color = FindColor(Snapshot);
+	if (!Color)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("LightSnapshotManager: No color for snapshot."));
 		return;
 	}
-	ApplyLightColor(SnapshotColorTable[Snapshot], BlendSeconds);
+	ApplyLightColor(*Color, BlendSeconds);
+}
+
+const FLinearColor* ALightSnapshotManager::FindColor(EAudioSnapshot Snapshot) const
+{
+	if (const FLinearColor* Override = Overrides.Find(Snapshot))
+	{
+		return Override;
+	}
+	const FMoodLook* Look = MoodLooks ? MoodLooks->Find(Snapshot) : nullptr;
+	return Look ? &Look->Light : nullptr;
+}
+
+void ALightSnapshotManager::ApplyGroupColor(FName Group, const FLinearColor& InTargetColor, float BlendSeconds, float HueSpread, float StaggerSeconds)
+{
+	if (BlendSeconds <= 0.f)
+	{
+		BlendSeconds = DefaultBlendSeconds;
+	}
+
+	PruneLights();
+
+	TArray<int32> Members;
+	for (int32 i = 0; i < Groups.Num(); ++i)
+	{
+		if (Group.IsNone() || Groups[i] == Group)
+		{
+			Members.Add(i);
+		}
+	}
+	if (Members.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("LightSnapshotManager: No fixtures in group %s."), *Group.ToString());
+		return;
+	}
+
+	BeginBlendSetup();
+
+	const FLinearColor TargetHSV = InTargetColor.LinearRGBToHSV();
+	const FLinearColor RigHSV    = TargetColor.LinearRGBToHSV();
+	for (int32 k = 0; k < Members.Num(); ++k)
+	{
+		// -0.5..0.5 across the group, so the spread is centred on the requested hue
+		const float Position = Members.Num() > 1 ? static_cast<float>(k) / (Members.Num() - 1) - 0.5f : 0.f;
+
+		FLinearColor HSV = TargetHSV;
+		HSV.R = FMath::Fmod(HSV.R + HueSpread * Position + 360.f, 360.f);
+
+		Fixtures.BlendTo(Members[k], HSV.HSVToLinearRGB(), StaggerSeconds * k, BlendSeconds);
+
+		// Where the fixture sits against the rig color, for mixed colors to keep
+		GroupOffsets[Members[k]] = FVector3f(
+			FMath::UnwindDegrees(HSV.R - RigHSV.R),
+			HSV.G - RigHSV.G,
+			HSV.B - RigHSV.B);
+	}
+	bHasGroupOffsets = true;
+
+	FinishBlendSetup();
 }
 
-void ALightSnapshotManager::BeginBlendTo(const FLinearColor& InTarget, float InBlend)
+void ALightSnapshotManager::ApplyMixedColor(const FLinearColor& Color, bool bExact)
 {
-	StartColor   = CurrentColor;
-	TargetColor  = InTarget;
-	BlendDuration= FMath::Max(0.01f, InBlend);
-	BlendElapsed = 0.f;
-	bBlending    = true;
+	USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this);
+	if (Blends && Blends->IsBlending(this))
+	{
+		Blends->CancelBlend(this);
+	}
+
+	StartColor = TargetColor = CurrentColor = Color;
+	RigBlendStart    = 0.f;
+	RigBlendDuration = 0.f;
+	ClockTime        = 0.f;
 
-	if (BlendDuration <= 0.015f)
+	if (!bHasGroupOffsets)
 	{
-		CurrentColor = TargetColor;
-		PushColorAll(CurrentColor);
-		bBlending = false;
+		for (int32 i = 0; i < Fixtures.Num(); ++i)
+		{
+			Fixtures.SetColor(i, Color);
+		}
 	}
+	else
+	{
+		// The groups keep their place around the mixed color, offset in HSV as they were blended
+		const FLinearColor MixedHSV = Color.LinearRGBToHSV();
+		for (int32 i = 0; i < Fixtures.Num(); ++i)
+		{
+			const FVector3f& Offset = GroupOffsets[i];
+			FLinearColor HSV = MixedHSV;
+			HSV.R = FMath::Fmod(HSV.R + Offset.X + 360.f, 360.f);
+			HSV.G = FMath::Clamp(HSV.G + Offset.Y, 0.f, 1.f);
+			HSV.B = FMath::Max(0.f, HSV.B + Offset.Z);
+			Fixtures.SetColor(i, HSV.HSVToLinearRGB());
+		}
+	}
+	PushDirty(bExact);
+}
+
+/* ---------------- Internals ---------------- */
+
+void ALightSnapshotManager::BeginBlendSetup()
+{
+	// Settle everything at the current clock time, then restart the clock at 0 for the new blend
+	Evaluate(ClockTime);
+	Fixtures.Rebase(ClockTime);
+	RigBlendStart -= ClockTime;
+	ClockTime = 0.f;
 }
 
-void ALightSnapshotManager::PushColorAll(const FLinearColor& Color)
+void ALightSnapshotManager::FinishBlendSetup()
 {
-	for (int32 i = Lights.Num() - 1; i >= 0; --i)
+	BlendDuration = FMath::Max(Fixtures.GetBlendEnd(), RigBlendStart + RigBlendDuration);
+
+	USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this);
+	if (BlendDuration <= 0.015f || !Blends)
 	{
-		AStageLight* L = Lights[i].Get();
-		if (!L)
+		if (Blends)
 		{
-			Lights.RemoveAtSwap(i);
+			Blends->CancelBlend(this);
+		}
+		Evaluate(BlendDuration);
+		PushDirty(true);
+		return;
+	}
+
+	Blends->BeginBlend(this, this, BlendDuration);
+}
+
+void ALightSnapshotManager::Evaluate(float Time)
+{
+	ClockTime = Time;
+	Fixtures.Advance(Time);
+
+	const float RigAlpha = RigBlendDuration > 0.f ? FMath::Clamp((Time - RigBlendStart) / RigBlendDuration, 0.f, 1.f) : 1.f;
+	CurrentColor = FLinearColor::LerpUsingHSV(StartColor, TargetColor, RigAlpha);
+}
+
+void ALightSnapshotManager::PushDirty(bool bExact)
+{
+	// Emissive heads: the rig color and the audio modulation are single collection writes,
+	// whatever the fixture count; heads carry their own colors unmodulated
+	if (FixtureCollectionInstance && !PushedRigColor.Equals(CurrentColor, bExact ? 0.f : ColorDeadBand))
+	{
+		FixtureCollectionInstance->SetVectorParameterValue(FixtureColorParameter, CurrentColor);
+		PushedRigColor = CurrentColor;
+	}
+
+	const bool bModulationMoved = FMath::Abs(ReactiveGain - PushedGain) > ColorDeadBand
+		|| FMath::Abs(ReactiveSaturation - PushedSaturation) > ColorDeadBand
+		|| (bExact && (ReactiveGain != PushedGain || ReactiveSaturation != PushedSaturation));
+	if (bModulationMoved)
+	{
+		if (FixtureCollectionInstance)
+		{
+			FixtureCollectionInstance->SetScalarParameterValue(FixtureGainParameter, ReactiveGain);
+			FixtureCollectionInstance->SetScalarParameterValue(FixtureSaturationParameter, ReactiveSaturation);
+		}
+		PushedGain       = ReactiveGain;
+		PushedSaturation = ReactiveSaturation;
+	}
+
+	if (bNeedsPrune)
+	{
+		PruneLights();
+	}
+
+	// Fixtures whose own blend moved past the dead-band: beam and head
+	Fixtures.GatherDirty(ColorDeadBand, bExact, DirtyFixtures);
+	NumSuppressed += Fixtures.Num() - DirtyFixtures.Num();
+
+	// A moved modulation only re-lights reactive beams whose own color moved past the dead-band (the heads have it already)
+	if (bModulationMoved)
+	{
+		PushReactiveBeams();
+	}
+
+	const int32 NumDirty = DirtyFixtures.Num();
+	if (NumDirty == 0) return;
+
+	// Every dirty fixture goes out in the same frame, so a fade never drifts apart across the rig;
+	// the heads reach the renderer once per rig below
+	for (const int32 Index : DirtyFixtures)
+	{
+		const FLinearColor Color = Fixtures.GetColor(Index);
+
+		USpotLightComponent* Beam = Beams[Index].Get();
+		if (IsValid(Beam))
+		{
+			PushedBeamColors[Index] = Modulate(Color);
+			Beam->SetLightColor(PushedBeamColors[Index], true);
+		}
+		else if (Beam)
+		{
+			// Destroyed under us (owner gone, or a rig rebuilt its beams)
+			bNeedsPrune = true;
+		}
+
+		if (RigSlots[Index] != INDEX_NONE)
+		{
+			// Instanced heads: written now, sent to the renderer once per rig below
+			if (AStageLightRig* Rig = Cast<AStageLightRig>(Owners[Index].Get()))
+			{
+				Rig->SetHeadColor(RigSlots[Index], Color);
+				TouchedRigs.AddUnique(Rig);
+			}
+		}
+		else if (bDriveHeadCustomData)
+		{
+			UStaticMeshComponent* Head = Heads[Index].Get();
+			if (IsValid(Head))
+			{
+				Head->SetCustomPrimitiveDataVector4(0, FVector4(Color.R, Color.G, Color.B, Color.A));
+			}
+		}
+
+		Fixtures.MarkPushed(Index);
+	}
+	NumPushed += NumDirty;
+
+	for (AStageLightRig* Rig : TouchedRigs)
+	{
+		Rig->FlushHeadColors();
+	}
+	TouchedRigs.Reset();
+}
+
+void ALightSnapshotManager::PushReactiveBeams()
+{
+	// DirtyFixtures is ascending: walk it alongside so a dirty fixture isn't lit twice
+	int32 NextDirty = 0;
+	for (int32 i = 0; i < Fixtures.Num(); ++i)
+	{
+		if (DirtyFixtures.IsValidIndex(NextDirty) && DirtyFixtures[NextDirty] == i)
+		{
+			++NextDirty;
 			continue;
 		}
-		L->SetLightColor(Color);
+		if (ReactiveGroups.Num() > 0 && !ReactiveGroups.Contains(Groups[i]))
+		{
+			continue;
+		}
+
+		USpotLightComponent* Beam = Beams[i].Get();
+		if (IsValid(Beam))
+		{
+			// A small gain step on a dim fixture barely moves it
+			const FLinearColor Modulated = Modulate(Fixtures.GetColor(i));
+			if (PushedBeamColors[i].Equals(Modulated, ColorDeadBand))
+			{
+				++NumSuppressed;
+				continue;
+			}
+			PushedBeamColors[i] = Modulated;
+			Beam->SetLightColor(Modulated, true);
+			++NumPushed;
+		}
+		else if (Beam)
+		{
+			bNeedsPrune = true;
+		}
 	}
 }
 
-void ALightSnapshotManager::AutoFindAllLights()
+void ALightSnapshotManager::StartAudioReactive()
 {
-	TArray<AActor*> Found;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AStageLight::StaticClass(), Found);
-	for (AActor* A : Found)
+	if (!ReactiveSubmix || ReactiveTap.IsValid()) return;
+
+	UWorld* World = GetWorld();
+	FAudioDeviceHandle AudioDevice = World ? World->GetAudioDevice() : FAudioDeviceHandle();
+	if (!AudioDevice.IsValid())
 	{
-		RegisterLight(Cast<AStageLight>(A));
+		UE_LOG(LogTemp, Warning, TEXT("LightSnapshotManager: no audio device, lights won't follow %s."), *ReactiveSubmix->GetName());
+		return;
 	}
+
+	ReactiveTap = MakeShared<FMusicAnalysisTap, ESPMode::ThreadSafe>();
+	AudioDevice->RegisterSubmixBufferListener(ReactiveTap.ToSharedRef(), *ReactiveSubmix);
+	bReactive = true;
+	SetActorTickEnabled(true);
 }
 
-void ALightSnapshotManager::BuildDefaultSnapshotColors()
+void ALightSnapshotManager::StopAudioReactive()
 {
-	// sRGB (0–255) → Linear + 20% desat toward luminance gray.
-	auto C = [](uint8 R, uint8 G, uint8 B)
+	if (!ReactiveTap.IsValid()) return;
+
+	// The device holds its own reference until the render thread is done with the tap
+	if (UWorld* World = GetWorld())
 	{
-		FLinearColor Lin = FLinearColor::FromSRGBColor(FColor(R, G, B));
-		const float L = Lin.GetLuminance();
-		const FLinearColor Gray(L, L, L);
-		// 0.20 = ~20% less saturation
-		return FMath::Lerp(Lin, Gray, 0.20f);
-	};
+		FAudioDeviceHandle AudioDevice = World->GetAudioDevice();
+		if (AudioDevice.IsValid() && ReactiveSubmix)
+		{
+			AudioDevice->UnregisterSubmixBufferListener(ReactiveTap.ToSharedRef(), *ReactiveSubmix);
+		}
+	}
 
-	SnapshotColorTable.Empty();
+	UE_LOG(LogTemp, Verbose, TEXT("LightSnapshotManager: audio reactive stopped, %u frames, %u dropped"),
+		ReactiveTap->GetNumProduced(), ReactiveTap->GetNumDropped());
 
-	// --- Palette (base hex in comments) ---
+	ReactiveTap.Reset();
+	bReactive          = false;
+	ReactiveGain       = 1.f;
+	ReactiveSaturation = 1.f;
+	SetActorTickEnabled(false);
+}
 
-	// TEAL (airy / celestial) 1
-	SnapshotColorTable.Add(EAudioSnapshot::CELESTIAL,     C(34, 211, 238));  // #22D3EE  (teal-cyan)
+void ALightSnapshotManager::UpdateAudioReactive(float DeltaSeconds)
+{
+	if (!ReactiveTap.IsValid()) return;
 
-	// ORANGE (earth) 1
-	SnapshotColorTable.Add(EAudioSnapshot::TERRESTRIAL,   C(245, 158, 11));  // #F59E0B  (amber)
+	FMusicAnalysisFrame Latest;
+	FMusicAnalysisFrame Peak;
+	if (ReactiveTap->Drain(Latest, Peak) > 0)
+	{
+		// The loudest hop since the last tick, so hits between ticks still register
+		IntensityTarget  = LevelOf(Peak, IntensityBand);
+		SaturationTarget = LevelOf(Peak, SaturationBand);
+		TimeSinceFrame   = 0.f;
+	}
+	else if ((TimeSinceFrame += DeltaSeconds) > 0.25f)
+	{
+		// Nothing rendered (paused or silent device): settle back to the plain snapshot look
+		IntensityTarget  = 0.f;
+		SaturationTarget = 1.f;
+	}
+
+	auto Follow = [this, DeltaSeconds](float Level, float Target)
+	{
+		const float Tau = Target > Level ? ReactiveAttack : ReactiveRelease;
+		return Tau > 0.f ? Level + (Target - Level) * (1.f - FMath::Exp(-DeltaSeconds / Tau)) : Target;
+	};
+	IntensityLevel  = Follow(IntensityLevel, IntensityTarget);
+	SaturationLevel = Follow(SaturationLevel, SaturationTarget);
 
-	// RED (conflict) 2 (deeper)
-	SnapshotColorTable.Add(EAudioSnapshot::CONFLICT,      C(193, 18, 31));   // #C1121F  (deep red)
+	ReactiveGain       = 1.f + IntensityDepth * IntensityLevel;
+	ReactiveSaturation = 1.f - SaturationDepth * (1.f - SaturationLevel);
+}
 
-	// PURPLE (mourning) 2 (deeper violet)
-	SnapshotColorTable.Add(EAudioSnapshot::MOURNING,      C(109, 40, 217));  // #6D28D9
+float ALightSnapshotManager::LevelOf(const FMusicAnalysisFrame& Frame, EMusicAnalysisBand Band) const
+{
+	const float Db = Audio::ConvertToDecibels(Frame.GetLevel(Band));
+	return FMath::GetMappedRangeValueClamped(FVector2f(ReactiveFloorDb, ReactiveCeilingDb), FVector2f(0.f, 1.f), Db);
+}
+
+FLinearColor ALightSnapshotManager::Modulate(const FLinearColor& Color) const
+{
+	if (!bReactive) return Color;
+
+	// Saturation toward the color's own luminance, then intensity
+	const float Luma = Color.GetLuminance();
+	return FLinearColor(
+		(Luma + (Color.R - Luma) * ReactiveSaturation) * ReactiveGain,
+		(Luma + (Color.G - Luma) * ReactiveSaturation) * ReactiveGain,
+		(Luma + (Color.B - Luma) * ReactiveSaturation) * ReactiveGain,
+		Color.A);
+}
+
+void ALightSnapshotManager::PruneLights()
+{
+	for (int32 i = Owners.Num() - 1; i >= 0; --i)
+	{
+		if (!Owners[i].IsValid())
+		{
+			RemoveFixtureAt(i);
+		}
+		else if (Beams[i] && !IsValid(Beams[i]))
+		{
+			// A live rig with rebuilt beams: take the new one for the same slot
+			AStageLightRig* Rig = Cast<AStageLightRig>(Owners[i].Get());
+			Beams[i] = Rig ? Rig->GetBeam(RigSlots[i]) : nullptr;
+			if (Beams[i])
+			{
+				PushedBeamColors[i] = Modulate(Fixtures.GetColor(i));
+				Beams[i]->SetLightColor(PushedBeamColors[i], true);
+			}
+		}
+	}
+	bNeedsPrune = false;
+}
 
-	// ORANGE (family) 2 (burnt)
-	SnapshotColorTable.Add(EAudioSnapshot::FAMILY,        C(217, 119, 6));   // #D97706
+int32 ALightSnapshotManager::AddFixture(AActor* Owner, int32 RigSlot, FName Group, USpotLightComponent* Beam, UStaticMeshComponent* Head)
+{
+	Owners.Add(Owner);
+	RigSlots.Add(RigSlot);
+	Groups.Add(Group);
+	GroupOffsets.Add(FVector3f::ZeroVector);
+	Beams.Add(Beam);
+	PushedBeamColors.Add(FLinearColor::Transparent);
+	Heads.Add(Head);
+
+	// Callers set the fixture to CurrentColor themselves
+	const int32 Index = Fixtures.Add(CurrentColor);
+	Fixtures.MarkPushed(Index);
+	return Index;
+}
 
-	// TEAL (science/crime) 2 (greener teal)
-	SnapshotColorTable.Add(EAudioSnapshot::SCIENCE_CRIME, C(45, 212, 191));  // #2DD4BF
+void ALightSnapshotManager::RemoveFixtureAt(int32 Index)
+{
+	Owners.RemoveAtSwap(Index);
+	RigSlots.RemoveAtSwap(Index);
+	Groups.RemoveAtSwap(Index);
+	GroupOffsets.RemoveAtSwap(Index);
+	Beams.RemoveAtSwap(Index);
+	PushedBeamColors.RemoveAtSwap(Index);
+	Heads.RemoveAtSwap(Index);
+	Fixtures.RemoveAtSwap(Index);
+}
 
-	// PURPLE (art) 1 (lavender)
-	SnapshotColorTable.Add(EAudioSnapshot::ART,           C(167, 139, 250)); // #A78BFA
+void ALightSnapshotManager::AutoFindAllLights()
+{
+	UStageRegistrySubsystem* Registry = UStageRegistrySubsystem::Get(this);
+	if (!Registry) return;
 
-	// RED (vice) 1 (hot/coral red)
-	SnapshotColorTable.Add(EAudioSnapshot::VICE,          C(242, 82, 92));   // #F2525C
+	for (const TWeakObjectPtr<AActor>& Actor : Registry->GetAll(AStageLight::StaticClass()))
+	{
+		RegisterLight(Cast<AStageLight>(Actor.Get()));
+	}
+	for (const TWeakObjectPtr<AActor>& Actor : Registry->GetAll(AStageLightRig::StaticClass()))
+	{
+		RegisterRig(Cast<AStageLightRig>(Actor.Get()));
+	}
 
-	// BLUE (betrayal) 1 (icy/soft blue)
-	SnapshotColorTable.Add(EAudioSnapshot::BETRAYAL,      C(96, 165, 250));  // #60A5FA
+	// Fixtures that arrive (or leave) after this
+	RegisteredHandle   = Registry->OnRegistered.AddUObject(this, &ALightSnapshotManager::HandleStageActorRegistered);
+	UnregisteredHandle = Registry->OnUnregistered.AddUObject(this, &ALightSnapshotManager::HandleStageActorUnregistered);
+}
 
-	// BLUE (politics) 2 (royal/civic blue)
-	SnapshotColorTable.Add(EAudioSnapshot::POLITICS,      C(37, 99, 235));   // #2563EB
+void ALightSnapshotManager::HandleStageActorRegistered(AActor* Actor, UClass* Category)
+{
+	if (Category == AStageLight::StaticClass())
+	{
+		RegisterLight(Cast<AStageLight>(Actor));
+	}
+	else if (Category == AStageLightRig::StaticClass())
+	{
+		RegisterRig(Cast<AStageLightRig>(Actor));
+	}
+}
 
-	// GREENISH-BLUE (reflection) (calm aqua/sea-green)
-	SnapshotColorTable.Add(EAudioSnapshot::REFLECTION,    C(52, 211, 153));  // #34D399
-}
\ No newline at end of file
+void ALightSnapshotManager::HandleStageActorUnregistered(AActor* Actor, UClass* Category)
+{
+	if (Category == AStageLight::StaticClass())
+	{
+		UnregisterLight(Cast<AStageLight>(Actor));
+	}
+	else if (Category == AStageLightRig::StaticClass())
+	{
+		UnregisterRig(Cast<AStageLightRig>(Actor));
+	}
+}
@@ -0,0 +1,210 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "World/StageLight.h"
+#include "World/Managers/LightSnapshotManager.h"
+#include "World/Subsystems/SnapshotBlendSubsystem.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace LightSnapshotScalingTest
+{
+	constexpr int32 NumSteps = 120;
+
+	struct FRigResult
+	{
+		int32 NumLights = 0;
+		uint64 Pushes = 0;
+		uint64 MaxFramePushes = 0;
+		double Ms = 0.0;
+	};
+
+	using FResults = TSharedRef<TArray<FRigResult>>;
+
+	UWorld* FindGameWorld()
+	{
+		if (!GEngine) return nullptr;
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			if ((Context.WorldType == EWorldType::Game || Context.WorldType == EWorldType::PIE) && Context.World())
+			{
+				return Context.World();
+			}
+		}
+		return nullptr;
+	}
+
+	// Spawns a rig of NumLights fixtures, then runs one blend frame per engine frame
+	class FRunRigCommand : public IAutomationLatentCommand
+	{
+	public:
+		FRunRigCommand(FAutomationTestBase& InTest, FResults InResults, int32 InNumLights)
+			: Test(InTest), Results(InResults), NumLights(InNumLights)
+		{
+		}
+
+		virtual bool Update() override
+		{
+			if (!bSpawned)
+			{
+				bSpawned = Spawn();
+				return !bSpawned;
+			}
+			if (!Manager.IsValid())
+			{
+				Test.AddError(FString::Printf(TEXT("%d fixtures: the manager went away mid-blend."), NumLights));
+				TearDown();
+				return true;
+			}
+
+			const uint64 PushedBefore = Manager->GetNumPushed();
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Manager->StepSnapshotBlend(static_cast<float>(++Step) / NumSteps);
+			Result.Ms += FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+			const uint64 FramePushes = Manager->GetNumPushed() - PushedBefore;
+			Result.Pushes += FramePushes;
+			Result.MaxFramePushes = FMath::Max(Result.MaxFramePushes, FramePushes);
+
+			if (Step < NumSteps)
+			{
+				return false;
+			}
+
+			UE_LOG(LogTemp, Display, TEXT("StageLight rig %4d fixtures: %.4f ms/frame, %.3f pushes/fixture/frame (%llu suppressed)"),
+				NumLights, Result.Ms / NumSteps, double(Result.Pushes) / (double(NumLights) * NumSteps), Manager->GetNumSuppressed());
+
+			Result.NumLights = NumLights;
+			Results->Add(Result);
+			TearDown();
+			return true;
+		}
+
+	private:
+		FAutomationTestBase& Test;
+		FResults Results;
+		int32 NumLights;
+
+		TArray<TWeakObjectPtr<AStageLight>> Rig;
+		TWeakObjectPtr<ALightSnapshotManager> Manager;
+		FRigResult Result;
+		int32 Step = 0;
+		bool bSpawned = false;
+
+		bool Spawn()
+		{
+			UWorld* World = FindGameWorld();
+			if (!World)
+			{
+				Test.AddError(TEXT("No game world to spawn the rig in (run with a map loaded, -nullrhi is fine)."));
+				return false;
+			}
+
+			FActorSpawnParameters Params;
+			Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			Params.ObjectFlags |= RF_Transient;
+
+			Rig.Reserve(NumLights);
+			for (int32 i = 0; i < NumLights; ++i)
+			{
+				const FVector Location(100.0 * (i % 32), 100.0 * (i / 32), 1000.0);
+				Rig.Add(World->SpawnActor<AStageLight>(AStageLight::StaticClass(), Location, FRotator::ZeroRotator, Params));
+			}
+
+			// Only the spawned rig, not whatever the level already has
+			ALightSnapshotManager* NewManager = World->SpawnActorDeferred<ALightSnapshotManager>(
+				ALightSnapshotManager::StaticClass(), FTransform::Identity, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+			NewManager->bAutoFindLights = false;
+			NewManager->FinishSpawning(FTransform::Identity);
+
+			// Stepped here, one frame per update; the audio modulation and the scheduler stay out of it
+			NewManager->SetActorTickEnabled(false);
+			for (const TWeakObjectPtr<AStageLight>& Light : Rig)
+			{
+				NewManager->RegisterLight(Light.Get());
+			}
+			NewManager->ApplyLightColor(FLinearColor(0.1f, 0.2f, 1.f), 10.f);
+			if (USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(NewManager))
+			{
+				Blends->CancelBlend(NewManager);
+			}
+
+			Manager = NewManager;
+			return true;
+		}
+
+		void TearDown()
+		{
+			if (Manager.IsValid())
+			{
+				Manager->Destroy();
+			}
+			for (const TWeakObjectPtr<AStageLight>& Light : Rig)
+			{
+				if (Light.IsValid())
+				{
+					Light->Destroy();
+				}
+			}
+			Rig.Reset();
+		}
+	};
+
+	// Every rig size must push each fixture at most once a frame, and at the same rate per fixture
+	class FCheckFlatCommand : public IAutomationLatentCommand
+	{
+	public:
+		FCheckFlatCommand(FAutomationTestBase& InTest, FResults InResults)
+			: Test(InTest), Results(InResults)
+		{
+		}
+
+		virtual bool Update() override
+		{
+			if (Results->Num() == 0)
+			{
+				return true;
+			}
+
+			const FRigResult& Smallest = (*Results)[0];
+			const double BaseRate = double(Smallest.Pushes) / (double(Smallest.NumLights) * NumSteps);
+			Test.TestTrue(TEXT("The blend pushes the rig at all"), Smallest.Pushes > 0);
+
+			for (const FRigResult& Rig : *Results)
+			{
+				const double Rate = double(Rig.Pushes) / (double(Rig.NumLights) * NumSteps);
+				Test.TestTrue(FString::Printf(TEXT("%d fixtures: at most one push per fixture per frame (max %llu)"), Rig.NumLights, Rig.MaxFramePushes),
+					Rig.MaxFramePushes <= uint64(Rig.NumLights));
+				Test.TestNearlyEqual(FString::Printf(TEXT("%d fixtures: pushes per fixture per frame match the %d-fixture rig"), Rig.NumLights, Smallest.NumLights),
+					Rate, BaseRate, 1e-6);
+			}
+			return true;
+		}
+
+	private:
+		FAutomationTestBase& Test;
+		FResults Results;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLightSnapshotScalingTest, "GameTemplate.Light.SnapshotScaling",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FLightSnapshotScalingTest::RunTest(const FString& Parameters)
+{
+	using namespace LightSnapshotScalingTest;
+
+	FResults Results = MakeShared<TArray<FRigResult>>();
+	for (const int32 NumLights : { 10, 100, 1000 })
+	{
+		ADD_LATENT_AUTOMATION_COMMAND(FRunRigCommand(*this, Results, NumLights));
+	}
+	ADD_LATENT_AUTOMATION_COMMAND(FCheckFlatCommand(*this, Results));
+	return true;
+}
+
+#endif
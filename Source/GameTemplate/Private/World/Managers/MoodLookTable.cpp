@@ -0,0 +1,393 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Managers/MoodLookTable.h"
+#include "Dom/JsonObject.h"
+#include "HAL/IConsoleManager.h"
+#include "JsonObjectConverter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/Csv/CsvParser.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/ObjectSaveContext.h"
+#include "UObject/UObjectIterator.h"
+
+const FPrimaryAssetType UMoodLookTable::PrimaryAssetType(TEXT("MoodLookTable"));
+
+void UMoodLookTable::Flatten()
+{
+	const int32 NumMoods = StaticEnum<EAudioSnapshot>()->GetMaxEnumValue();
+
+	Dense.Reset();
+	Dense.SetNum(NumMoods);
+	Defined.Init(false, NumMoods);
+
+	for (const FMoodLook& Look : Moods)
+	{
+		const int32 Index = static_cast<int32>(Look.Mood);
+		if (Dense.IsValidIndex(Index))
+		{
+			Dense[Index]   = Look;
+			Defined[Index] = true;
+		}
+	}
+
+	BuildMoodSpace();
+}
+
+void UMoodLookTable::BuildMoodSpace()
+{
+	SpaceLooks.Reset();
+	for (int32 i = 0; i < Dense.Num(); ++i)
+	{
+		if (Defined[i] && Dense[i].bInMoodSpace)
+		{
+			FMoodSpacePoint& Point = SpaceLooks.AddDefaulted_GetRef();
+			Point.Name     = FName(StaticEnum<EAudioSnapshot>()->GetNameStringByIndex(i));
+			Point.Position = Dense[i].MoodSpacePosition;
+			Point.Audio    = Dense[i].Audio;
+			Point.Post     = Dense[i].Post;
+			Point.Light    = Dense[i].Light;
+		}
+	}
+	SpaceLooks.Append(SpacePoints);
+
+	TArray<FVector2f> Positions;
+	for (const FMoodSpacePoint& Point : SpaceLooks)
+	{
+		Positions.Add(FVector2f(Point.Position));
+	}
+	MoodSpace.Build(Positions);
+}
+
+FPrimaryAssetId UMoodLookTable::GetPrimaryAssetId() const
+{
+	if (HasAnyFlags(RF_ClassDefaultObject))
+	{
+		return FPrimaryAssetId();
+	}
+	return FPrimaryAssetId(PrimaryAssetType, GetFName());
+}
+
+void UMoodLookTable::PostLoad()
+{
+	Super::PostLoad();
+
+	// Cooked tables arrive flattened; in the editor Moods may be newer than the saved slots
+	if (GIsEditor || Dense.Num() == 0)
+	{
+		Flatten();
+	}
+	else
+	{
+		BuildMoodSpace();
+	}
+}
+
+void UMoodLookTable::PreSave(FObjectPreSaveContext SaveContext)
+{
+	Super::PreSave(SaveContext);
+	Flatten();
+}
+
+#if WITH_EDITOR
+void UMoodLookTable::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	Flatten();
+	OnLooksChanged.Broadcast(this);
+}
+#endif
+
+bool UMoodLookTable::ReloadFromFile(const FString& Path)
+{
+	const FString FullPath = FPaths::IsRelative(Path) ? FPaths::Combine(FPaths::ProjectDir(), Path) : Path;
+
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *FullPath))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("MoodLookTable: can't read %s"), *FullPath);
+		return false;
+	}
+
+	TArray<FMoodLook> Looks;
+	const bool bCsv = FPaths::GetExtension(FullPath).Equals(TEXT("csv"), ESearchCase::IgnoreCase);
+	if (!(bCsv ? ParseCsv(Text, Looks) : ParseJson(Text, Looks)))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("MoodLookTable: %s is not a valid look file, nothing changed"), *FullPath);
+		return false;
+	}
+
+	for (const FMoodLook& Look : Looks)
+	{
+		Merge(Look);
+	}
+	Flatten();
+
+	UE_LOG(LogTemp, Display, TEXT("MoodLookTable: %s retuned %d moods from %s"), *GetName(), Looks.Num(), *FullPath);
+	OnLooksChanged.Broadcast(this);
+	return true;
+}
+
+void UMoodLookTable::Merge(const FMoodLook& Look)
+{
+	for (int32 i = Moods.Num() - 1; i >= 0; --i)
+	{
+		if (Moods[i].Mood == Look.Mood)
+		{
+			Moods[i] = Look;
+			return;
+		}
+	}
+	Moods.Add(Look);
+}
+
+bool UMoodLookTable::ParseJson(const FString& Text, TArray<FMoodLook>& OutLooks) const
+{
+	// Either a bare array of looks or { "Moods": [...] }
+	TArray<TSharedPtr<FJsonValue>> Entries;
+	TSharedPtr<FJsonObject> Root;
+	if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Text), Entries))
+	{
+		const TArray<TSharedPtr<FJsonValue>>* MoodEntries = nullptr;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Text), Root) || !Root.IsValid()
+			|| !Root->TryGetArrayField(TEXT("Moods"), MoodEntries))
+		{
+			return false;
+		}
+		Entries = *MoodEntries;
+	}
+
+	const UEnum* MoodEnum = StaticEnum<EAudioSnapshot>();
+	for (const TSharedPtr<FJsonValue>& Entry : Entries)
+	{
+		const TSharedPtr<FJsonObject>* Object = nullptr;
+		FString MoodName;
+		if (!Entry.IsValid() || !Entry->TryGetObject(Object) || !(*Object)->TryGetStringField(TEXT("Mood"), MoodName))
+		{
+			return false;
+		}
+
+		const int64 Mood = MoodEnum->GetValueByNameString(MoodName);
+		if (Mood == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("MoodLookTable: unknown mood '%s'"), *MoodName);
+			return false;
+		}
+
+		// Start from the current look so a file only has to list what it changes
+		const FMoodLook* Existing = Find(static_cast<EAudioSnapshot>(Mood));
+		FMoodLook Look = Existing ? *Existing : FMoodLook();
+		if (!FJsonObjectConverter::JsonObjectToUStruct((*Object).ToSharedRef(), &Look))
+		{
+			return false;
+		}
+		Look.Mood = static_cast<EAudioSnapshot>(Mood);
+		OutLooks.Add(Look);
+	}
+	return true;
+}
+
+bool UMoodLookTable::ParseCsv(const FString& Text, TArray<FMoodLook>& OutLooks) const
+{
+	const FCsvParser Parser(Text);
+	const FCsvParser::FRows& Rows = Parser.GetRows();
+	if (Rows.Num() < 2)
+	{
+		return false;
+	}
+
+	// Header: Mood, then <Audio|Post|Light>.<Field> columns, resolved to float fields by reflection
+	struct FColumn
+	{
+		const FStructProperty* Group = nullptr;
+		const FFloatProperty*  Field = nullptr;
+	};
+
+	const TArray<const TCHAR*>& Header = Rows[0];
+	TArray<FColumn> Columns;
+	Columns.SetNum(Header.Num());
+	int32 MoodColumn = INDEX_NONE;
+
+	for (int32 c = 0; c < Header.Num(); ++c)
+	{
+		const FString Name = FString(Header[c]).TrimStartAndEnd();
+		FString GroupName, FieldName;
+		if (Name.Equals(TEXT("Mood"), ESearchCase::IgnoreCase))
+		{
+			MoodColumn = c;
+		}
+		else if (Name.Split(TEXT("."), &GroupName, &FieldName))
+		{
+			Columns[c].Group = FindFProperty<FStructProperty>(FMoodLook::StaticStruct(), *GroupName);
+			Columns[c].Field = Columns[c].Group ? FindFProperty<FFloatProperty>(Columns[c].Group->Struct, *FieldName) : nullptr;
+		}
+
+		if (c != MoodColumn && !Columns[c].Field)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("MoodLookTable: ignoring unknown column '%s'"), *Name);
+		}
+	}
+
+	if (MoodColumn == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const UEnum* MoodEnum = StaticEnum<EAudioSnapshot>();
+	for (int32 r = 1; r < Rows.Num(); ++r)
+	{
+		const TArray<const TCHAR*>& Row = Rows[r];
+		if (!Row.IsValidIndex(MoodColumn) || FCString::Strlen(Row[MoodColumn]) == 0)
+		{
+			continue;
+		}
+
+		const int64 Mood = MoodEnum->GetValueByNameString(FString(Row[MoodColumn]).TrimStartAndEnd());
+		if (Mood == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("MoodLookTable: unknown mood '%s' on row %d"), Row[MoodColumn], r + 1);
+			return false;
+		}
+
+		const FMoodLook* Existing = Find(static_cast<EAudioSnapshot>(Mood));
+		FMoodLook Look = Existing ? *Existing : FMoodLook();
+		Look.Mood = static_cast<EAudioSnapshot>(Mood);
+
+		for (int32 c = 0; c < Row.Num() && c < Columns.Num(); ++c)
+		{
+			const FColumn& Column = Columns[c];
+			if (Column.Field && FCString::Strlen(Row[c]) > 0)
+			{
+				void* Group = Column.Group->ContainerPtrToValuePtr<void>(&Look);
+				*Column.Field->ContainerPtrToValuePtr<float>(Group) = FCString::Atof(Row[c]);
+			}
+		}
+		OutLooks.Add(Look);
+	}
+	return true;
+}
+
+UMoodLookTable* UMoodLookTable::MakeDefault(UObject* Outer)
+{
+	UMoodLookTable* Table = NewObject<UMoodLookTable>(Outer, NAME_None, RF_Transient);
+
+	// sRGB (0–255) → Linear + 20% desat toward luminance gray.
+	auto C = [](uint8 R, uint8 G, uint8 B)
+	{
+		FLinearColor Lin = FLinearColor::FromSRGBColor(FColor(R, G, B));
+		const float L = Lin.GetLuminance();
+		const FLinearColor Gray(L, L, L);
+		// 0.20 = ~20% less saturation
+		return FMath::Lerp(Lin, Gray, 0.20f);
+	};
+
+	// Every stock mood is also placed in the mood space at (valence, energy)
+	auto Look = [](EAudioSnapshot Mood, const FLinearColor& Light, const FVector2D& Position)
+	{
+		FMoodLook Out;
+		Out.Mood              = Mood;
+		Out.Light             = Light;
+		Out.bInMoodSpace      = true;
+		Out.MoodSpacePosition = Position;
+		return Out;
+	};
+
+	// --- Palette (base hex in comments) ---
+
+	// TEAL (airy / celestial) 1
+	FMoodLook Cel = Look(EAudioSnapshot::CELESTIAL, C(34, 211, 238), { 0.60, 0.25 }); // #22D3EE (teal-cyan)
+	Cel.Audio.FilterCutoffHz=20000; Cel.Audio.EQHighShelfGainDb=+3; Cel.Audio.CompAttackMs=15; Cel.Audio.CompReleaseMs=150; Cel.Audio.CompThresholdDb=-12; Cel.Audio.ReverbWet=0.60f;
+	Cel.Post.Saturation=1.05f; Cel.Post.Contrast=0.95f; Cel.Post.Vignette=0.10f; Cel.Post.BloomIntensity=0.60f; Cel.Post.BloomThreshold=0.80f; Cel.Post.SceneFringe=0.00f; Cel.Post.Grain=0.00f;
+	Table->Moods.Add(Cel);
+
+	// ORANGE (earth) 1
+	FMoodLook Ter = Look(EAudioSnapshot::TERRESTRIAL, C(245, 158, 11), { 0.30, 0.45 }); // #F59E0B (amber)
+	Ter.Audio.FilterCutoffHz=16000; Ter.Audio.EQHighShelfGainDb=+0.5f; Ter.Audio.CompAttackMs=10; Ter.Audio.CompReleaseMs=120; Ter.Audio.CompThresholdDb=-12; Ter.Audio.ReverbWet=0.20f;
+	Ter.Post.Saturation=0.95f; Ter.Post.Contrast=1.00f; Ter.Post.Vignette=0.20f; Ter.Post.BloomIntensity=0.20f; Ter.Post.BloomThreshold=1.00f; Ter.Post.SceneFringe=0.00f; Ter.Post.Grain=0.05f;
+	Table->Moods.Add(Ter);
+
+	// RED (conflict) 2 (deeper)
+	FMoodLook Con = Look(EAudioSnapshot::CONFLICT, C(193, 18, 31), { -0.70, 0.95 }); // #C1121F (deep red)
+	Con.Audio.FilterCutoffHz=18000; Con.Audio.EQHighShelfGainDb=+1; Con.Audio.CompAttackMs=5; Con.Audio.CompReleaseMs=90; Con.Audio.CompThresholdDb=-12; Con.Audio.ReverbWet=0.10f;
+	Con.Post.Saturation=1.00f; Con.Post.Contrast=1.10f; Con.Post.Vignette=0.30f; Con.Post.BloomIntensity=0.10f; Con.Post.BloomThreshold=1.20f; Con.Post.SceneFringe=0.20f; Con.Post.Grain=0.15f;
+	Table->Moods.Add(Con);
+
+	// PURPLE (mourning) 2 (deeper violet)
+	FMoodLook Mou = Look(EAudioSnapshot::MOURNING, C(109, 40, 217), { -0.85, 0.15 }); // #6D28D9
+	Mou.Audio.FilterCutoffHz=14000; Mou.Audio.EQHighShelfGainDb=-1; Mou.Audio.CompAttackMs=15; Mou.Audio.CompReleaseMs=180; Mou.Audio.CompThresholdDb=-12; Mou.Audio.ReverbWet=0.50f;
+	Mou.Post.Saturation=0.80f; Mou.Post.Contrast=0.90f; Mou.Post.Vignette=0.35f; Mou.Post.BloomIntensity=0.40f; Mou.Post.BloomThreshold=1.00f; Mou.Post.SceneFringe=0.10f; Mou.Post.Grain=0.20f;
+	Table->Moods.Add(Mou);
+
+	// ORANGE (family) 2 (burnt)
+	FMoodLook Fam = Look(EAudioSnapshot::FAMILY, C(217, 119, 6), { 0.75, 0.50 }); // #D97706
+	Fam.Audio.FilterCutoffHz=18000; Fam.Audio.EQHighShelfGainDb=+1.5f; Fam.Audio.CompAttackMs=10; Fam.Audio.CompReleaseMs=120; Fam.Audio.CompThresholdDb=-12; Fam.Audio.ReverbWet=0.30f;
+	Fam.Post.Saturation=1.05f; Fam.Post.Contrast=1.00f; Fam.Post.Vignette=0.15f; Fam.Post.BloomIntensity=0.30f; Fam.Post.BloomThreshold=0.95f; Fam.Post.SceneFringe=0.00f; Fam.Post.Grain=0.05f;
+	Table->Moods.Add(Fam);
+
+	// TEAL (science/crime) 2 (greener teal)
+	FMoodLook Sci = Look(EAudioSnapshot::SCIENCE_CRIME, C(45, 212, 191), { -0.25, 0.60 }); // #2DD4BF
+	Sci.Audio.FilterCutoffHz=17000; Sci.Audio.EQHighShelfGainDb=+1; Sci.Audio.CompAttackMs=8; Sci.Audio.CompReleaseMs=110; Sci.Audio.CompThresholdDb=-12; Sci.Audio.ReverbWet=0.20f;
+	Sci.Post.Saturation=1.00f; Sci.Post.Contrast=1.05f; Sci.Post.Vignette=0.20f; Sci.Post.BloomIntensity=0.20f; Sci.Post.BloomThreshold=1.10f; Sci.Post.SceneFringe=0.05f; Sci.Post.Grain=0.05f;
+	Table->Moods.Add(Sci);
+
+	// PURPLE (art) 1 (lavender)
+	FMoodLook Art = Look(EAudioSnapshot::ART, C(167, 139, 250), { 0.85, 0.80 }); // #A78BFA
+	Art.Audio.FilterCutoffHz=20000; Art.Audio.EQHighShelfGainDb=+2; Art.Audio.CompAttackMs=12; Art.Audio.CompReleaseMs=140; Art.Audio.CompThresholdDb=-12; Art.Audio.ReverbWet=0.70f;
+	Art.Post.Saturation=1.10f; Art.Post.Contrast=1.05f; Art.Post.Vignette=0.12f; Art.Post.BloomIntensity=0.70f; Art.Post.BloomThreshold=0.85f; Art.Post.SceneFringe=0.00f; Art.Post.Grain=0.00f;
+	Table->Moods.Add(Art);
+
+	// RED (vice) 1 (hot/coral red)
+	FMoodLook Vic = Look(EAudioSnapshot::VICE, C(242, 82, 92), { -0.45, 0.85 }); // #F2525C
+	Vic.Audio.FilterCutoffHz=14000; Vic.Audio.EQHighShelfGainDb=-0.5f; Vic.Audio.CompAttackMs=8; Vic.Audio.CompReleaseMs=120; Vic.Audio.CompThresholdDb=-12; Vic.Audio.ReverbWet=0.30f;
+	Vic.Post.Saturation=0.90f; Vic.Post.Contrast=1.10f; Vic.Post.Vignette=0.25f; Vic.Post.BloomIntensity=0.15f; Vic.Post.BloomThreshold=1.20f; Vic.Post.SceneFringe=0.20f; Vic.Post.Grain=0.25f;
+	Table->Moods.Add(Vic);
+
+	// BLUE (betrayal) 1 (icy/soft blue)
+	FMoodLook Bet = Look(EAudioSnapshot::BETRAYAL, C(96, 165, 250), { -0.65, 0.50 }); // #60A5FA
+	Bet.Audio.FilterCutoffHz=20000; Bet.Audio.EQHighShelfGainDb=0; Bet.Audio.CompAttackMs=10; Bet.Audio.CompReleaseMs=120; Bet.Audio.CompThresholdDb=-12; Bet.Audio.ReverbWet=0.10f;
+	Bet.Post.Saturation=0.95f; Bet.Post.Contrast=1.00f; Bet.Post.Vignette=0.30f; Bet.Post.BloomIntensity=0.10f; Bet.Post.BloomThreshold=1.10f; Bet.Post.SceneFringe=0.10f; Bet.Post.Grain=0.10f;
+	Table->Moods.Add(Bet);
+
+	// BLUE (politics) 2 (royal/civic blue)
+	FMoodLook Pol = Look(EAudioSnapshot::POLITICS, C(37, 99, 235), { 0.05, 0.70 }); // #2563EB
+	Pol.Audio.FilterCutoffHz=20000; Pol.Audio.EQHighShelfGainDb=0; Pol.Audio.CompAttackMs=10; Pol.Audio.CompReleaseMs=120; Pol.Audio.CompThresholdDb=-12; Pol.Audio.ReverbWet=0.30f;
+	Pol.Post.Saturation=1.00f; Pol.Post.Contrast=1.00f; Pol.Post.Vignette=0.20f; Pol.Post.BloomIntensity=0.20f; Pol.Post.BloomThreshold=1.00f; Pol.Post.SceneFringe=0.00f; Pol.Post.Grain=0.05f;
+	Table->Moods.Add(Pol);
+
+	// GREENISH-BLUE (reflection) (calm aqua/sea-green)
+	FMoodLook Ref = Look(EAudioSnapshot::REFLECTION, C(52, 211, 153), { 0.10, 0.10 }); // #34D399
+	Ref.Audio.FilterCutoffHz=12000; Ref.Audio.EQHighShelfGainDb=-1.5f; Ref.Audio.CompAttackMs=15; Ref.Audio.CompReleaseMs=150; Ref.Audio.CompThresholdDb=-14; Ref.Audio.ReverbWet=0.40f;
+	Ref.Post.Saturation=0.85f; Ref.Post.Contrast=0.95f; Ref.Post.Vignette=0.33f; Ref.Post.BloomIntensity=0.35f; Ref.Post.BloomThreshold=1.05f; Ref.Post.SceneFringe=0.05f; Ref.Post.Grain=0.15f;
+	Table->Moods.Add(Ref);
+
+	Table->Flatten();
+	return Table;
+}
+
+#if !UE_BUILD_SHIPPING
+
+namespace MoodLookReload
+{
+	static void Run(const TArray<FString>& Args)
+	{
+		int32 NumReloaded = 0;
+		for (TObjectIterator<UMoodLookTable> It; It; ++It)
+		{
+			UMoodLookTable* Table = *It;
+			const FString Path = Args.Num() > 0 ? Args[0] : Table->HotReloadFile;
+			if (!Table->HasAnyFlags(RF_ClassDefaultObject) && !Path.IsEmpty() && Table->ReloadFromFile(Path))
+			{
+				++NumReloaded;
+			}
+		}
+		UE_LOG(LogTemp, Display, TEXT("mood.ReloadLooks: %d tables retuned"), NumReloaded);
+	}
+
+	FAutoConsoleCommand ReloadCommand(
+		TEXT("mood.ReloadLooks"),
+		TEXT("mood.ReloadLooks [Path]: retunes every loaded mood look table from Path (JSON or CSV), or from each table's HotReloadFile."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
+
+#endif
@@ -0,0 +1,340 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Managers/MoodSpace.h"
+#include "Algo/BinarySearch.h"
+
+namespace MoodSpace
+{
+	// Closer than this (in mood-space units) counts as the same point
+	constexpr float MergeDistance = 1.e-4f;
+
+	struct FTriangle
+	{
+		int32     V[3];
+		FVector2d Center;
+		double    RadiusSq;
+	};
+
+	static double Cross(const FVector2d& A, const FVector2d& B, const FVector2d& C)
+	{
+		return (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
+	}
+
+	static FTriangle MakeTriangle(const TArray<FVector2d>& V, int32 A, int32 B, int32 C)
+	{
+		// Counter-clockwise
+		if (Cross(V[A], V[B], V[C]) < 0.0)
+		{
+			Swap(B, C);
+		}
+
+		const FVector2d& P0 = V[A];
+		const FVector2d& P1 = V[B];
+		const FVector2d& P2 = V[C];
+		const double D  = 2.0 * (P0.X * (P1.Y - P2.Y) + P1.X * (P2.Y - P0.Y) + P2.X * (P0.Y - P1.Y));
+		const double S0 = P0.SquaredLength();
+		const double S1 = P1.SquaredLength();
+		const double S2 = P2.SquaredLength();
+
+		FTriangle T;
+		T.V[0] = A;
+		T.V[1] = B;
+		T.V[2] = C;
+
+		// Flat: any later point replaces it
+		if (FMath::Abs(D) < UE_DOUBLE_SMALL_NUMBER)
+		{
+			T.Center   = (P0 + P1 + P2) / 3.0;
+			T.RadiusSq = MAX_dbl;
+			return T;
+		}
+
+		T.Center = FVector2d(
+			(S0 * (P1.Y - P2.Y) + S1 * (P2.Y - P0.Y) + S2 * (P0.Y - P1.Y)) / D,
+			(S0 * (P2.X - P1.X) + S1 * (P0.X - P2.X) + S2 * (P1.X - P0.X)) / D);
+		T.RadiusSq = FVector2d::DistSquared(T.Center, P0);
+		return T;
+	}
+}
+
+void FMoodSpace::Reset()
+{
+	Points.Reset();
+	Triangles.Reset();
+	SlabX.Reset();
+	SlabFirst.Reset();
+	SlabEdges.Reset();
+	HullEdges.Reset();
+}
+
+void FMoodSpace::Build(TArrayView<const FVector2f> InPoints)
+{
+	Reset();
+	Points.Append(InPoints.GetData(), InPoints.Num());
+
+	Triangulate();
+	BuildSlabs();
+
+	UE_LOG(LogTemp, Verbose, TEXT("MoodSpace: %d looks, %d triangles, %d slabs, %d slab edges"),
+		Points.Num(), Triangles.Num(), FMath::Max(0, SlabX.Num() - 1), SlabEdges.Num());
+}
+
+void FMoodSpace::Triangulate()
+{
+	using namespace MoodSpace;
+
+	TArray<int32> Used;
+	for (int32 i = 0; i < Points.Num(); ++i)
+	{
+		const bool bDuplicate = Used.ContainsByPredicate([this, i](int32 j)
+		{
+			return FVector2f::DistSquared(Points[i], Points[j]) < FMath::Square(MergeDistance);
+		});
+		if (bDuplicate)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("MoodSpace: look %d sits on another look and is left out"), i);
+			continue;
+		}
+		Used.Add(i);
+	}
+
+	// Bowyer-Watson, inside a triangle far larger than the points' bounds
+	TArray<FVector2d> V;
+	V.Reserve(Points.Num() + 3);
+	FBox2d Bounds(ForceInit);
+	for (const FVector2f& P : Points)
+	{
+		V.Add(FVector2d(P));
+	}
+	for (int32 i : Used)
+	{
+		Bounds += V[i];
+	}
+
+	if (Used.Num() >= 3)
+	{
+		const FVector2d Center = Bounds.GetCenter();
+		const double    Extent = FMath::Max3(Bounds.GetSize().X, Bounds.GetSize().Y, 1.e-3) * 100.0;
+		const int32     Super  = V.Num();
+		V.Add(Center + FVector2d(-Extent, -Extent));
+		V.Add(Center + FVector2d( Extent, -Extent));
+		V.Add(Center + FVector2d(    0.0,  Extent * 2.0));
+
+		TArray<FTriangle> Mesh;
+		Mesh.Add(MakeTriangle(V, Super, Super + 1, Super + 2));
+
+		TArray<FIntPoint> Cavity;
+		for (int32 i : Used)
+		{
+			const FVector2d& P = V[i];
+
+			// Triangles whose circumcircle holds the point; the cavity is bounded by their unshared edges
+			Cavity.Reset();
+			for (int32 t = Mesh.Num() - 1; t >= 0; --t)
+			{
+				if (FVector2d::DistSquared(P, Mesh[t].Center) < Mesh[t].RadiusSq)
+				{
+					for (int32 k = 0; k < 3; ++k)
+					{
+						Cavity.Add(FIntPoint(Mesh[t].V[k], Mesh[t].V[(k + 1) % 3]));
+					}
+					Mesh.RemoveAtSwap(t);
+				}
+			}
+
+			for (const FIntPoint& Edge : Cavity)
+			{
+				if (!Cavity.Contains(FIntPoint(Edge.Y, Edge.X)))
+				{
+					Mesh.Add(MakeTriangle(V, Edge.X, Edge.Y, i));
+				}
+			}
+		}
+
+		for (const FTriangle& T : Mesh)
+		{
+			if (T.V[0] < Super && T.V[1] < Super && T.V[2] < Super && FMath::Abs(Cross(V[T.V[0]], V[T.V[1]], V[T.V[2]])) > UE_DOUBLE_SMALL_NUMBER)
+			{
+				Triangles.Add(FIntVector3(T.V[0], T.V[1], T.V[2]));
+			}
+		}
+	}
+
+	if (Triangles.Num() > 0)
+	{
+		// Hull: edges without a twin, counter-clockwise
+		for (const FIntVector3& T : Triangles)
+		{
+			for (int32 k = 0; k < 3; ++k)
+			{
+				HullEdges.Add(FIntPoint(T[k], T[(k + 1) % 3]));
+			}
+		}
+		const TArray<FIntPoint> Directed = HullEdges;
+		HullEdges.RemoveAll([&Directed](const FIntPoint& Edge) { return Directed.Contains(FIntPoint(Edge.Y, Edge.X)); });
+	}
+	else if (Used.Num() > 0)
+	{
+		// Fewer than three points, or all on one line: blend along the chain of points
+		const FVector2d Axis = Used.Num() > 1 ? (V[Used.Last()] - V[Used[0]]) : FVector2d(1.0, 0.0);
+		Used.Sort([&V, &Axis](int32 A, int32 B) { return FVector2d::DotProduct(V[A], Axis) < FVector2d::DotProduct(V[B], Axis); });
+
+		HullEdges.Add(FIntPoint(Used[0], Used[0]));
+		for (int32 k = 1; k < Used.Num(); ++k)
+		{
+			HullEdges.Add(FIntPoint(Used[k - 1], Used[k]));
+		}
+	}
+}
+
+void FMoodSpace::BuildSlabs()
+{
+	if (Triangles.Num() == 0) return;
+
+	for (const FIntVector3& T : Triangles)
+	{
+		for (int32 k = 0; k < 3; ++k)
+		{
+			SlabX.AddUnique(Points[T[k]].X);
+		}
+	}
+	SlabX.Sort();
+
+	// Each non-vertical edge left to right, with the triangle above it (a counter-clockwise
+	// triangle lies above the edges it runs along left to right)
+	TMap<FIntPoint, int32> EdgeAbove;
+	for (int32 t = 0; t < Triangles.Num(); ++t)
+	{
+		for (int32 k = 0; k < 3; ++k)
+		{
+			const int32 A = Triangles[t][k];
+			const int32 B = Triangles[t][(k + 1) % 3];
+			if (Points[A].X < Points[B].X)
+			{
+				EdgeAbove.Add(FIntPoint(A, B), t);
+			}
+			else if (Points[A].X > Points[B].X && !EdgeAbove.Contains(FIntPoint(B, A)))
+			{
+				EdgeAbove.Add(FIntPoint(B, A), INDEX_NONE);
+			}
+		}
+	}
+
+	TArray<FSlabEdge> Crossing;
+	for (int32 s = 0; s + 1 < SlabX.Num(); ++s)
+	{
+		const float Left  = SlabX[s];
+		const float Right = SlabX[s + 1];
+		const float Mid   = 0.5f * (Left + Right);
+
+		Crossing.Reset();
+		for (const TPair<FIntPoint, int32>& Edge : EdgeAbove)
+		{
+			if (Points[Edge.Key.X].X <= Left && Points[Edge.Key.Y].X >= Right)
+			{
+				Crossing.Add({ Edge.Key.X, Edge.Key.Y, Edge.Value });
+			}
+		}
+
+		// Edges never cross inside a slab, so their order at the middle holds across all of it
+		Crossing.Sort([this, Mid](const FSlabEdge& A, const FSlabEdge& B) { return EdgeHeightAt(A, Mid) < EdgeHeightAt(B, Mid); });
+
+		SlabFirst.Add(SlabEdges.Num());
+		SlabEdges.Append(Crossing);
+	}
+	SlabFirst.Add(SlabEdges.Num());
+}
+
+float FMoodSpace::EdgeHeightAt(const FSlabEdge& Edge, float X) const
+{
+	const FVector2f& A = Points[Edge.A];
+	const FVector2f& B = Points[Edge.B];
+	return A.Y + (B.Y - A.Y) * (X - A.X) / (B.X - A.X);
+}
+
+int32 FMoodSpace::FindTriangle(const FVector2f& Position) const
+{
+	if (SlabX.Num() < 2 || Position.X < SlabX[0] || Position.X > SlabX.Last())
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 Slab = FMath::Clamp(Algo::UpperBound(SlabX, Position.X) - 1, 0, SlabX.Num() - 2);
+
+	// Highest edge at or below the position; the triangle above it holds the position
+	int32 Low  = SlabFirst[Slab];
+	int32 High = SlabFirst[Slab + 1];
+	while (Low < High)
+	{
+		const int32 Mid = (Low + High) / 2;
+		if (EdgeHeightAt(SlabEdges[Mid], Position.X) <= Position.Y)
+		{
+			Low = Mid + 1;
+		}
+		else
+		{
+			High = Mid;
+		}
+	}
+	return Low > SlabFirst[Slab] ? SlabEdges[Low - 1].Above : INDEX_NONE;
+}
+
+FMoodSpaceWeights FMoodSpace::Locate(const FVector2f& Position) const
+{
+	const int32 Triangle = FindTriangle(Position);
+	return Triangle != INDEX_NONE ? Barycentric(Triangle, Position) : ClampToHull(Position);
+}
+
+FMoodSpaceWeights FMoodSpace::Barycentric(int32 Triangle, const FVector2f& Position) const
+{
+	const FIntVector3& T = Triangles[Triangle];
+	const FVector2d A(Points[T.X]);
+	const FVector2d B(Points[T.Y]);
+	const FVector2d C(Points[T.Z]);
+	const FVector2d P(Position);
+
+	const double Det = (B.Y - C.Y) * (A.X - C.X) + (C.X - B.X) * (A.Y - C.Y);
+	double W0 = ((B.Y - C.Y) * (P.X - C.X) + (C.X - B.X) * (P.Y - C.Y)) / Det;
+	double W1 = ((C.Y - A.Y) * (P.X - C.X) + (A.X - C.X) * (P.Y - C.Y)) / Det;
+	double W2 = 1.0 - W0 - W1;
+
+	// Positions on an edge can land a hair outside; keep the weights convex
+	W0 = FMath::Max(W0, 0.0);
+	W1 = FMath::Max(W1, 0.0);
+	W2 = FMath::Max(W2, 0.0);
+	const double Sum = W0 + W1 + W2;
+
+	FMoodSpaceWeights Out;
+	Out.Points[0]  = T.X;
+	Out.Points[1]  = T.Y;
+	Out.Points[2]  = T.Z;
+	Out.Weights[0] = static_cast<float>(W0 / Sum);
+	Out.Weights[1] = static_cast<float>(W1 / Sum);
+	Out.Weights[2] = static_cast<float>(W2 / Sum);
+	return Out;
+}
+
+FMoodSpaceWeights FMoodSpace::ClampToHull(const FVector2f& Position) const
+{
+	FMoodSpaceWeights Out;
+
+	float BestDistSq = MAX_flt;
+	for (const FIntPoint& Edge : HullEdges)
+	{
+		const FVector2f& A = Points[Edge.X];
+		const FVector2f  AB = Points[Edge.Y] - A;
+		const float LengthSq = AB.SquaredLength();
+		const float Alpha    = LengthSq > 0.f ? FMath::Clamp(FVector2f::DotProduct(Position - A, AB) / LengthSq, 0.f, 1.f) : 0.f;
+
+		const float DistSq = FVector2f::DistSquared(Position, A + AB * Alpha);
+		if (DistSq < BestDistSq)
+		{
+			BestDistSq     = DistSq;
+			Out.Points[0]  = Edge.X;
+			Out.Points[1]  = Edge.X != Edge.Y ? Edge.Y : INDEX_NONE;
+			Out.Weights[0] = 1.f - Alpha;
+			Out.Weights[1] = Edge.X != Edge.Y ? Alpha : 0.f;
+		}
+	}
+	return Out;
+}
@@ -0,0 +1,73 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "World/Managers/MoodSpace.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace MoodSpaceBenchmark
+{
+	constexpr int32 NumQueries = 20000;
+
+	void RunSpace(int32 NumPoints)
+	{
+		FRandomStream Random(NumPoints);
+		TArray<FVector2f> Points;
+		Points.Reserve(NumPoints);
+		for (int32 i = 0; i < NumPoints; ++i)
+		{
+			Points.Emplace(Random.FRandRange(-1.f, 1.f), Random.FRandRange(0.f, 1.f));
+		}
+
+		const uint64 BuildCycles = FPlatformTime::Cycles64();
+		FMoodSpace Space;
+		Space.Build(Points);
+		const double BuildMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - BuildCycles);
+
+		TArray<FVector2f> Queries;
+		Queries.Reserve(NumQueries);
+		for (int32 i = 0; i < NumQueries; ++i)
+		{
+			Queries.Emplace(Random.FRandRange(-1.1f, 1.1f), Random.FRandRange(-0.1f, 1.1f));
+		}
+
+		float Sink = 0.f;
+		const uint64 LocateCycles = FPlatformTime::Cycles64();
+		for (const FVector2f& Q : Queries)
+		{
+			Sink += Space.Locate(Q).Weights[0];
+		}
+		const double LocateNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - LocateCycles) * 1e6 / NumQueries;
+
+		UE_LOG(LogTemp, Display, TEXT("MoodSpace %5d looks: %d triangles, build %.3f ms, %.1f ns/locate (%.1f)"),
+			NumPoints, Space.NumTriangles(), BuildMs, LocateNs, Sink);
+	}
+
+	void Run(const TArray<FString>& Args)
+	{
+		TArray<int32> Sizes = { 11, 64, 512, 4096 };
+		if (Args.Num() > 0)
+		{
+			Sizes.Reset();
+			for (const FString& Arg : Args)
+			{
+				Sizes.Add(FMath::Max(1, FCString::Atoi(*Arg)));
+			}
+		}
+
+		for (const int32 NumPoints : Sizes)
+		{
+			RunSpace(NumPoints);
+		}
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("mood.Space.Benchmark"),
+		TEXT("Triangulates random mood spaces (default 11, 64, 512 and 4096 looks) and logs the build time and the cost per lookup (correctness is the GameTemplate.Mood.Space automation test)."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
+
+#endif
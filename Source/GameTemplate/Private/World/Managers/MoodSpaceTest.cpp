@@ -0,0 +1,105 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "World/Managers/MoodSpace.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MoodSpaceTest
+{
+	constexpr int32 NumQueries = 4000;
+
+	// Brute-force enclosing triangle, to check the slab search against
+	int32 FindTriangleLinear(const FMoodSpace& Space, const FVector2f& P)
+	{
+		for (int32 t = 0; t < Space.NumTriangles(); ++t)
+		{
+			const FIntVector3& Tri = Space.GetTriangle(t);
+			const FVector2f& A = Space.GetPoint(Tri.X);
+			const FVector2f& B = Space.GetPoint(Tri.Y);
+			const FVector2f& C = Space.GetPoint(Tri.Z);
+			if (FVector2f::CrossProduct(B - A, P - A) >= -1e-6f
+				&& FVector2f::CrossProduct(C - B, P - B) >= -1e-6f
+				&& FVector2f::CrossProduct(A - C, P - C) >= -1e-6f)
+			{
+				return t;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	void CheckSpace(FAutomationTestBase& Test, int32 NumPoints)
+	{
+		FRandomStream Random(NumPoints);
+		TArray<FVector2f> Points;
+		for (int32 i = 0; i < NumPoints; ++i)
+		{
+			Points.Emplace(Random.FRandRange(-1.f, 1.f), Random.FRandRange(0.f, 1.f));
+		}
+
+		FMoodSpace Space;
+		Space.Build(Points);
+		Test.TestEqual(FString::Printf(TEXT("%d looks: every look is a point"), NumPoints), Space.NumPoints(), NumPoints);
+		Test.TestTrue(FString::Printf(TEXT("%d looks: triangulated"), NumPoints), Space.NumTriangles() > 0);
+
+		// A look's own position is that look alone
+		for (int32 i = 0; i < NumPoints; ++i)
+		{
+			const FMoodSpaceWeights W = Space.Locate(Points[i]);
+			float Own = 0.f;
+			for (int32 k = 0; k < 3; ++k)
+			{
+				Own += W.Points[k] == i ? W.Weights[k] : 0.f;
+			}
+			Test.TestEqual(FString::Printf(TEXT("%d looks: weight of look %d at its own position"), NumPoints, i), Own, 1.f, 1e-3f);
+		}
+
+		// Inside the hull the weights must rebuild the position; outside they land on the hull
+		int32 Mismatches = 0;
+		int32 BadWeights = 0;
+		for (int32 i = 0; i < NumQueries; ++i)
+		{
+			const FVector2f Q(Random.FRandRange(-1.1f, 1.1f), Random.FRandRange(-0.1f, 1.1f));
+
+			const int32 Found = Space.FindTriangle(Q);
+			if ((Found == INDEX_NONE) != (FindTriangleLinear(Space, Q) == INDEX_NONE))
+			{
+				++Mismatches;
+			}
+
+			const FMoodSpaceWeights W = Space.Locate(Q);
+			FVector2f Rebuilt = FVector2f::ZeroVector;
+			float Sum = 0.f;
+			for (int32 k = 0; k < 3; ++k)
+			{
+				if (W.Points[k] != INDEX_NONE)
+				{
+					Rebuilt += Space.GetPoint(W.Points[k]) * W.Weights[k];
+					Sum     += W.Weights[k];
+				}
+			}
+			if (!FMath::IsNearlyEqual(Sum, 1.f, 1e-3f) || (Found != INDEX_NONE && !Rebuilt.Equals(Q, 1e-3f)))
+			{
+				++BadWeights;
+			}
+		}
+		Test.TestEqual(FString::Printf(TEXT("%d looks: hull mismatches against brute force"), NumPoints), Mismatches, 0);
+		Test.TestEqual(FString::Printf(TEXT("%d looks: positions the weights don't rebuild"), NumPoints), BadWeights, 0);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMoodSpaceTest, "GameTemplate.Mood.Space",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FMoodSpaceTest::RunTest(const FString& Parameters)
+{
+	for (const int32 NumPoints : { 3, 11, 64, 512 })
+	{
+		MoodSpaceTest::CheckSpace(*this, NumPoints);
+	}
+	return true;
+}
+
+#endif
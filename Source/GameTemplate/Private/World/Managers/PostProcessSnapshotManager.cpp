@@ -1,11 +1,44 @@
 ﻿// © Anastasis Marinos //
 
 #include "World/Managers/PostProcessSnapshotManager.h"
-#include "Kismet/GameplayStatics.h"
+#include "World/Subsystems/MoodLookSubsystem.h"
+#include "World/Subsystems/StageRegistrySubsystem.h"
 
 APostProcessSnapshotManager::APostProcessSnapshotManager()
 {
-	PrimaryActorTick.bCanEverTick = true;
+	// Blends are stepped by the USnapshotBlendSubsystem
+	PrimaryActorTick.bCanEverTick = false;
+
+	SceneRoot = CreateDefaultSubobject<USceneComponent>(TEXT("SceneRoot"));
+	SetRootComponent(SceneRoot);
+
+	LayerA = CreateDefaultSubobject<UPostProcessComponent>(TEXT("LayerA"));
+	LayerA->SetupAttachment(SceneRoot);
+
+	LayerB = CreateDefaultSubobject<UPostProcessComponent>(TEXT("LayerB"));
+	LayerB->SetupAttachment(SceneRoot);
+
+	for (UPostProcessComponent* Layer : { LayerA.Get(), LayerB.Get() })
+	{
+		Layer->bUnbound    = true;
+		Layer->BlendWeight = 0.f;
+	}
+}
+
+void APostProcessSnapshotManager::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	Overrides.Build(SnapshotTable);
+
+	UStageRegistrySubsystem::RegisterActor(this, APostProcessSnapshotManager::StaticClass());
+}
+
+void APostProcessSnapshotManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UStageRegistrySubsystem::UnregisterActor(this, APostProcessSnapshotManager::StaticClass());
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void APostProcessSnapshotManager::BeginPlay()
@@ -21,75 +54,216 @@ void APostProcessSnapshotManager::BeginPlay()
 		TargetVolume->bUnbound = true;
 	}
 
-	if (SnapshotTable.Num() == 0)
+	if (!MoodLooks)
 	{
-		BuildDefaultSnapshotTable();
+		MoodLooks = UMoodLookSubsystem::GetDefaultLooks(this);
 	}
 
+	// Build every look once; blends only copy one of these into a layer
+	RebuildLookPool();
+
+	PushChannels.Init(1);
+
 	SnapshotFromVolume(Current);
 	Start  = Current;
 	Target = Current;
+
+	SetupLayers();
 }
 
-void APostProcessSnapshotManager::Tick(float DeltaSeconds)
+void APostProcessSnapshotManager::StepSnapshotBlend(float Alpha)
 {
-	Super::Tick(DeltaSeconds);
-
-	if (!bBlending || !TargetVolume) return;
-
-	BlendElapsed += DeltaSeconds;
-	const float Alpha = FMath::Clamp(BlendElapsed / FMath::Max(BlendDuration, KINDA_SMALL_NUMBER), 0.f, 1.f);
-
-	FPostSnapshotTargets Blended;
-	Blended.Saturation     = FMath::Lerp(Start.Saturation,     Target.Saturation,     Alpha);
-	Blended.Contrast       = FMath::Lerp(Start.Contrast,       Target.Contrast,       Alpha);
-	Blended.Vignette       = FMath::Lerp(Start.Vignette,       Target.Vignette,       Alpha);
-	Blended.BloomIntensity = FMath::Lerp(Start.BloomIntensity, Target.BloomIntensity, Alpha);
-	Blended.BloomThreshold = FMath::Lerp(Start.BloomThreshold, Target.BloomThreshold, Alpha);
-	Blended.SceneFringe    = FMath::Lerp(Start.SceneFringe,    Target.SceneFringe,    Alpha);
-	Blended.Grain          = FMath::Lerp(Start.Grain,          Target.Grain,          Alpha);
-
-	PushToVolume(Blended);
+	BlendAlpha = Alpha;
+	PushWeight(Alpha, Alpha >= 1.f);
 
 	if (Alpha >= 1.f)
 	{
-		bBlending = false;
-		Current   = Target;
+		SettleIncomingLayer();
+		UE_LOG(LogTemp, Verbose, TEXT("PostProcessSnapshotManager: blend done, %llu pushes, %llu suppressed"),
+			PushChannels.GetNumPushed(), PushChannels.GetNumSuppressed());
 	}
 }
 
 void APostProcessSnapshotManager::ApplyPostSnapshot(EAudioSnapshot Snapshot, float BlendTimeSeconds)
 {
-	if (!SnapshotTable.Contains(Snapshot))
+	const FPostSnapshotTargets* Look     = FindLook(Snapshot);
+	const FPostProcessSettings* Settings = FindLookSettings(Snapshot);
+	if (!Look || !Settings)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Post snapshot not found."));
 		return;
 	}
-	BeginBlendTo(SnapshotTable[Snapshot], BlendTimeSeconds);
+	TargetLook = static_cast<int32>(Snapshot);
+	BeginBlendTo(*Look, *Settings, BlendTimeSeconds);
+}
+
+const FPostSnapshotTargets* APostProcessSnapshotManager::FindLook(EAudioSnapshot Snapshot) const
+{
+	if (const FPostSnapshotTargets* Override = Overrides.Find(Snapshot))
+	{
+		return Override;
+	}
+	const FMoodLook* Look = MoodLooks ? MoodLooks->Find(Snapshot) : nullptr;
+	return Look ? &Look->Post : nullptr;
+}
+
+void APostProcessSnapshotManager::RebuildLookPool()
+{
+	const int32 NumSnapshots = StaticEnum<EAudioSnapshot>()->GetMaxEnumValue();
+	LookPool.SetNum(NumSnapshots);
+	LookBuilt.Init(false, NumSnapshots);
+
+	for (int32 i = 0; i < NumSnapshots; ++i)
+	{
+		if (const FPostSnapshotTargets* Look = FindLook(static_cast<EAudioSnapshot>(i)))
+		{
+			LookPool[i]  = BuildLookSettings(*Look);
+			LookBuilt[i] = true;
+		}
+	}
+
+	// Mixer layers copy their look again on the next mix step
+	InvalidateMixedLooks();
+
+	if (BaseLayer && BlendAlpha >= 1.f && LookBuilt.IsValidIndex(TargetLook) && LookBuilt[TargetLook])
+	{
+		Current = Target = *FindLook(static_cast<EAudioSnapshot>(TargetLook));
+		BaseLayer->Settings = LookPool[TargetLook];
+	}
+}
+
+void APostProcessSnapshotManager::ApplyMixedLayers(TArrayView<const FSnapshotLayerWeight> MixLayers)
+{
+	static const FPostProcessSettings NoLook;
+
+	TArray<const FPostProcessSettings*, TInlineAllocator<8>> Looks;
+	TArray<float, TInlineAllocator<8>> LayerWeights;
+	for (const FSnapshotLayerWeight& MixLayer : MixLayers)
+	{
+		const FPostProcessSettings* Settings = FindLookSettings(MixLayer.Snapshot);
+		Looks.Add(Settings ? Settings : &NoLook);
+		LayerWeights.Add(MixLayer.Weight);
+	}
+	SetMixerLayers(Looks, LayerWeights);
+}
+
+void APostProcessSnapshotManager::ApplyWeightedLooks(TArrayView<const FPostProcessSettings* const> Looks, TArrayView<const float> Weights)
+{
+	check(Looks.Num() == Weights.Num());
+
+	// Each engine layer lerps toward its look by its weight over the ones below, so layer k takes
+	// w_k / (rest + w_0 + .. + w_k) to leave every look at its own share of the blend. Weights
+	// summing below 1 leave the rest to the snapshot layers underneath.
+	float Below = 1.f;
+	for (const float Weight : Weights)
+	{
+		Below -= Weight;
+	}
+	Below = FMath::Max(0.f, Below);
+
+	TArray<float, TInlineAllocator<8>> LayerWeights;
+	for (const float Weight : Weights)
+	{
+		Below += Weight;
+		LayerWeights.Add(Below > 0.f ? Weight / Below : 0.f);
+	}
+	SetMixerLayers(Looks, LayerWeights);
+}
+
+void APostProcessSnapshotManager::InvalidateMixedLooks()
+{
+	for (const FPostProcessSettings*& Look : MixerLayerLooks)
+	{
+		Look = nullptr;
+	}
+}
+
+FPostProcessSettings APostProcessSnapshotManager::BuildLookSettings(const FPostSnapshotTargets& Look)
+{
+	FPostProcessSettings S;
+
+	// Uniform RGB with alpha = 1
+	S.bOverride_ColorSaturation = true;
+	S.ColorSaturation = FVector4(Look.Saturation, Look.Saturation, Look.Saturation, 1.0);
+
+	S.bOverride_ColorContrast = true;
+	S.ColorContrast = FVector4(Look.Contrast, Look.Contrast, Look.Contrast, 1.0);
+
+	S.bOverride_VignetteIntensity = true;
+	S.VignetteIntensity = Look.Vignette;
+
+	S.bOverride_BloomIntensity = true;
+	S.BloomIntensity = Look.BloomIntensity;
+
+	S.bOverride_BloomThreshold = true;
+	S.BloomThreshold = Look.BloomThreshold;
+
+	S.bOverride_SceneFringeIntensity = true;
+	S.SceneFringeIntensity = Look.SceneFringe;
+
+	S.bOverride_FilmGrainIntensity = true;
+	S.FilmGrainIntensity = Look.Grain;
+
+	return S;
 }
 
 /* ---------------- Internals ---------------- */
 
-void APostProcessSnapshotManager::AutoFindTargetVolume()
+void APostProcessSnapshotManager::SetMixerLayers(TArrayView<const FPostProcessSettings* const> Looks, TArrayView<const float> LayerWeights)
 {
-	TArray<AActor*> Found;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), APostProcessVolume::StaticClass(), Found);
-	for (AActor* A : Found)
+	USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this);
+	if (Blends && Blends->IsBlending(this))
+	{
+		Blends->CancelBlend(this);
+	}
+
+	// Above the two snapshot layers, each mixer layer over the one before. The priority is set
+	// before registering: the world sorts its post volumes only as they are inserted
+	const float BasePriority = (TargetVolume ? TargetVolume->Priority : 0.f) + 3.f;
+	while (MixerLayers.Num() < Looks.Num())
+	{
+		UPostProcessComponent* Layer = NewObject<UPostProcessComponent>(this, NAME_None, RF_Transient);
+		Layer->bUnbound    = true;
+		Layer->BlendWeight = 0.f;
+		Layer->Priority    = BasePriority + MixerLayers.Num();
+		Layer->SetupAttachment(SceneRoot);
+		Layer->RegisterComponent();
+		MixerLayers.Add(Layer);
+		MixerLayerLooks.Add(nullptr);
+	}
+
+	// Settings are only copied when a layer's look changes
+	for (int32 i = 0; i < MixerLayers.Num(); ++i)
 	{
-		if (auto* PPV = Cast<APostProcessVolume>(A))
+		UPostProcessComponent* Layer = MixerLayers[i];
+		if (!Looks.IsValidIndex(i))
 		{
-			// Prefer an unbound volume if present
-			if (PPV->bUnbound)
-			{
-				TargetVolume = PPV;
-				return;
-			}
+			Layer->BlendWeight = 0.f;
+			continue;
 		}
+
+		if (MixerLayerLooks[i] != Looks[i])
+		{
+			Layer->Settings    = *Looks[i];
+			MixerLayerLooks[i] = Looks[i];
+		}
+		SetLayerPriority(Layer, BasePriority + i);
+		Layer->BlendWeight = LayerWeights[i];
 	}
-	// Fallback: grab the first one
-	if (Found.Num() > 0)
+}
+
+const FPostProcessSettings* APostProcessSnapshotManager::FindLookSettings(EAudioSnapshot Snapshot) const
+{
+	const int32 Index = static_cast<int32>(Snapshot);
+	return LookBuilt.IsValidIndex(Index) && LookBuilt[Index] ? &LookPool[Index] : nullptr;
+}
+
+void APostProcessSnapshotManager::AutoFindTargetVolume()
+{
+	// Prefer an unbound volume if present, else the first one
+	if (const UStageRegistrySubsystem* Registry = UStageRegistrySubsystem::Get(this))
 	{
-		TargetVolume = Cast<APostProcessVolume>(Found[0]);
+		TargetVolume = Registry->FindPostVolume(true);
 	}
 }
 
@@ -108,87 +282,89 @@ void APostProcessSnapshotManager::SnapshotFromVolume(FPostSnapshotTargets& Out)
 	Out.BloomIntensity = S.BloomIntensity;
 	Out.BloomThreshold = S.BloomThreshold;
 	Out.SceneFringe    = S.SceneFringeIntensity;
+	Out.Grain          = S.FilmGrainIntensity;
 }
 
-void APostProcessSnapshotManager::PushToVolume(const FPostSnapshotTargets& Vals) const
+void APostProcessSnapshotManager::SetupLayers()
 {
-	if (!TargetVolume) return;
-
-	FPostProcessSettings& S = TargetVolume->Settings;
-
-	// Enable the overrides we touch
-	S.bOverride_ColorSaturation      = true;
-	S.bOverride_ColorContrast        = true;
-	S.bOverride_VignetteIntensity    = true;
-	S.bOverride_BloomIntensity       = true;
-	S.bOverride_BloomThreshold       = true;
-	S.bOverride_SceneFringeIntensity = true;
-
-	// Set uniform RGB with alpha = 1
-	S.ColorSaturation.X = Vals.Saturation;
-	S.ColorSaturation.Y = Vals.Saturation;
-	S.ColorSaturation.Z = Vals.Saturation;
-	S.ColorSaturation.W = 1.0;
-
-	S.ColorContrast.X = Vals.Contrast;
-	S.ColorContrast.Y = Vals.Contrast;
-	S.ColorContrast.Z = Vals.Contrast;
-	S.ColorContrast.W = 1.0;
-
-	S.VignetteIntensity    = Vals.Vignette;
-	S.BloomIntensity       = Vals.BloomIntensity;
-	S.BloomThreshold       = Vals.BloomThreshold;
-	S.SceneFringeIntensity = Vals.SceneFringe;
+	BaseLayer     = LayerA;
+	IncomingLayer = LayerB;
+
+	// Both layers sit above the level's base volume; the incoming one above the settled one
+	const float BasePriority = TargetVolume ? TargetVolume->Priority : 0.f;
+	SetLayerPriority(BaseLayer, BasePriority + 1.f);
+	SetLayerPriority(IncomingLayer, BasePriority + 2.f);
+
+	// Start on the volume's own look so nothing changes until the first snapshot
+	BaseLayer->Settings    = BuildLookSettings(Current);
+	BaseLayer->BlendWeight = 1.f;
+	IncomingLayer->BlendWeight = 0.f;
+	PushChannels.Test(0, 0.f, DeadBand, true);
 }
 
-void APostProcessSnapshotManager::BeginBlendTo(const FPostSnapshotTargets& NewTarget, float InBlend)
+void APostProcessSnapshotManager::PushWeight(float Alpha, bool bExact)
 {
-	Start         = Current;
-	Target        = NewTarget;
-	BlendDuration = FMath::Max(0.01f, InBlend);
-	BlendElapsed  = 0.f;
-	bBlending     = true;
-
-	if (BlendDuration <= 0.015f)
+	if (IncomingLayer && PushChannels.Test(0, Alpha, DeadBand, bExact))
 	{
-		PushToVolume(Target);
-		Current = Target;
-		bBlending = false;
+		IncomingLayer->BlendWeight = Alpha;
 	}
 }
 
-void APostProcessSnapshotManager::BuildDefaultSnapshotTable()
+void APostProcessSnapshotManager::SettleIncomingLayer()
 {
-	FPostSnapshotTargets Cel; Cel.Saturation=1.05f; Cel.Contrast=0.95f; Cel.Vignette=0.10f; Cel.BloomIntensity=0.60f; Cel.BloomThreshold=0.80f; Cel.SceneFringe=0.00f; Cel.Grain=0.00f;
-	SnapshotTable.Add(EAudioSnapshot::CELESTIAL, Cel);
-
-	FPostSnapshotTargets Ter; Ter.Saturation=0.95f; Ter.Contrast=1.00f; Ter.Vignette=0.20f; Ter.BloomIntensity=0.20f; Ter.BloomThreshold=1.00f; Ter.SceneFringe=0.00f; Ter.Grain=0.05f;
-	SnapshotTable.Add(EAudioSnapshot::TERRESTRIAL, Ter);
-
-	FPostSnapshotTargets Con; Con.Saturation=1.00f; Con.Contrast=1.10f; Con.Vignette=0.30f; Con.BloomIntensity=0.10f; Con.BloomThreshold=1.20f; Con.SceneFringe=0.20f; Con.Grain=0.15f;
-	SnapshotTable.Add(EAudioSnapshot::CONFLICT, Con);
+	// The incoming look becomes the settled one (one copy per blend); the incoming layer is free
+	// for the next look
+	BaseLayer->Settings        = IncomingLayer->Settings;
+	BaseLayer->BlendWeight     = 1.f;
+	IncomingLayer->BlendWeight = 0.f;
+	PushChannels.Test(0, 0.f, DeadBand, true);
+
+	Current    = Target;
+	BlendAlpha = 1.f;
+}
 
-	FPostSnapshotTargets Mou; Mou.Saturation=0.80f; Mou.Contrast=0.90f; Mou.Vignette=0.35f; Mou.BloomIntensity=0.40f; Mou.BloomThreshold=1.00f; Mou.SceneFringe=0.10f; Mou.Grain=0.20f;
-	SnapshotTable.Add(EAudioSnapshot::MOURNING, Mou);
+void APostProcessSnapshotManager::SetLayerPriority(UPostProcessComponent* Layer, float Priority)
+{
+	if (Layer->Priority == Priority) return;
 
-	FPostSnapshotTargets Fam; Fam.Saturation=1.05f; Fam.Contrast=1.00f; Fam.Vignette=0.15f; Fam.BloomIntensity=0.30f; Fam.BloomThreshold=0.95f; Fam.SceneFringe=0.00f; Fam.Grain=0.05f;
-	SnapshotTable.Add(EAudioSnapshot::FAMILY, Fam);
+	// UWorld::PostProcessVolumes is sorted on insertion only: re-register to take the new place
+	Layer->Priority = Priority;
+	if (Layer->IsRegistered())
+	{
+		Layer->ReregisterComponent();
+	}
+}
 
-	FPostSnapshotTargets Sci; Sci.Saturation=1.00f; Sci.Contrast=1.05f; Sci.Vignette=0.20f; Sci.BloomIntensity=0.20f; Sci.BloomThreshold=1.10f; Sci.SceneFringe=0.05f; Sci.Grain=0.05f;
-	SnapshotTable.Add(EAudioSnapshot::SCIENCE_CRIME, Sci);
+void APostProcessSnapshotManager::BeginBlendTo(const FPostSnapshotTargets& NewTarget, const FPostProcessSettings& NewSettings, float InBlend)
+{
+	if (!BaseLayer || !IncomingLayer) return;
 
-	FPostSnapshotTargets Art; Art.Saturation=1.10f; Art.Contrast=1.05f; Art.Vignette=0.12f; Art.BloomIntensity=0.70f; Art.BloomThreshold=0.85f; Art.SceneFringe=0.00f; Art.Grain=0.00f;
-	SnapshotTable.Add(EAudioSnapshot::ART, Art);
+	// Interrupted mid-blend: bake where the look is now into the settled layer (once, not per frame)
+	if (BlendAlpha < 1.f)
+	{
+		Current = Blender.Evaluate(BlendAlpha);
+		BaseLayer->Settings = BuildLookSettings(Current);
+	}
 
-	FPostSnapshotTargets Vic; Vic.Saturation=0.90f; Vic.Contrast=1.10f; Vic.Vignette=0.25f; Vic.BloomIntensity=0.15f; Vic.BloomThreshold=1.20f; Vic.SceneFringe=0.20f; Vic.Grain=0.25f;
-	SnapshotTable.Add(EAudioSnapshot::VICE, Vic);
+	Start         = Current;
+	Target        = NewTarget;
+	Blender.Begin(Start, Target);
+	BlendDuration = FMath::Max(0.01f, InBlend);
+	BlendAlpha    = 0.f;
 
-	FPostSnapshotTargets Bet; Bet.Saturation=0.95f; Bet.Contrast=1.00f; Bet.Vignette=0.30f; Bet.BloomIntensity=0.10f; Bet.BloomThreshold=1.10f; Bet.SceneFringe=0.10f; Bet.Grain=0.10f;
-	SnapshotTable.Add(EAudioSnapshot::BETRAYAL, Bet);
+	IncomingLayer->Settings = NewSettings;
+	PushWeight(0.f, true);
 
-	FPostSnapshotTargets Pol; Pol.Saturation=1.00f; Pol.Contrast=1.00f; Pol.Vignette=0.20f; Pol.BloomIntensity=0.20f; Pol.BloomThreshold=1.00f; Pol.SceneFringe=0.00f; Pol.Grain=0.05f;
-	SnapshotTable.Add(EAudioSnapshot::POLITICS, Pol);
+	USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this);
+	if (BlendDuration <= 0.015f || !Blends)
+	{
+		if (Blends)
+		{
+			Blends->CancelBlend(this);
+		}
+		StepSnapshotBlend(1.f);
+		return;
+	}
 
-	FPostSnapshotTargets Ref; Ref.Saturation=0.85f; Ref.Contrast=0.95f; Ref.Vignette=0.33f; Ref.BloomIntensity=0.35f; Ref.BloomThreshold=1.05f; Ref.SceneFringe=0.05f; Ref.Grain=0.15f;
-	SnapshotTable.Add(EAudioSnapshot::REFLECTION, Ref);
-}
\ No newline at end of file
+	Blends->BeginBlend(this, this, BlendDuration);
+}
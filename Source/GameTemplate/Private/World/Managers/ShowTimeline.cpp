@@ -0,0 +1,151 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Managers/ShowTimeline.h"
+#include "World/Managers/AudioManager.h"
+#include "Audio/NarrationCueData.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/StableSort.h"
+#include "Sound/SoundBase.h"
+
+namespace ShowTimeline
+{
+	// Matches the readability buffer the subtitles always had (used without a cooked cue)
+	constexpr double SubtitleHoldSeconds = 3.0;
+	constexpr double MinSubtitleDelay    = 0.01;
+
+	// With a cue, the last subtitle still stays up at least this long
+	constexpr double MinSubtitleReadSeconds = 1.5;
+}
+
+void FShowTimeline::Compile(const TArray<FNarrationLine>& Lines, const UNarrationCueData* Cues)
+{
+	Reset();
+	LineStarts.Reserve(Lines.Num());
+	LineEnds.Reserve(Lines.Num());
+	LineFirstEvent.Reserve(Lines.Num());
+
+	double LineStart = 0.0;
+	for (int32 LineIndex = 0; LineIndex < Lines.Num(); ++LineIndex)
+	{
+		const FNarrationLine& Line = Lines[LineIndex];
+		const FNarrationCue*  Cue  = Cues && !Line.VoiceLine.IsNull() ? Cues->FindCue(Line.VoiceLine.ToSoftObjectPath()) : nullptr;
+
+		auto AddEvent = [this, LineIndex](double Time, EShowEventType Type, int32 Item = INDEX_NONE)
+		{
+			FShowEvent& Event = Events.AddDefaulted_GetRef();
+			Event.Time = Time;
+			Event.Type = Type;
+			Event.Line = LineIndex;
+			Event.Item = Item;
+		};
+
+		AddEvent(LineStart, EShowEventType::LineStart);
+		AddEvent(LineStart, EShowEventType::Snapshot);
+		if (Line.bSetStage)
+		{
+			AddEvent(LineStart, EShowEventType::Stage);
+		}
+		if (!Line.VoiceLine.IsNull())
+		{
+			AddEvent(LineStart, EShowEventType::VoiceStart);
+		}
+
+		double LastSubtitleEnd = 0.0;
+		for (int32 Segment = 0; Segment < Line.SubtitleSegments.Num(); ++Segment)
+		{
+			const double Delay = FMath::Max<double>(ShowTimeline::MinSubtitleDelay, Line.SubtitleSegments[Segment].StartTime);
+			AddEvent(LineStart + Delay, EShowEventType::SubtitleShow, Segment);
+		}
+		if (Line.SubtitleSegments.Num() > 0)
+		{
+			const double LastStart = Line.SubtitleSegments.Last().StartTime;
+			LastSubtitleEnd = Cue
+				? FMath::Max<double>(Cue->SuggestedClearTime, LastStart + ShowTimeline::MinSubtitleReadSeconds)
+				: LastStart + ShowTimeline::SubtitleHoldSeconds;
+			AddEvent(LineStart + LastSubtitleEnd, EShowEventType::SubtitleClear);
+		}
+
+		const double VoiceDuration = Cue ? Cue->Duration : Line.GetVoiceDuration();
+		const double LineEnd       = LineStart + FMath::Max(VoiceDuration, LastSubtitleEnd);
+		AddEvent(LineEnd, EShowEventType::LineEnd);
+
+		LineStarts.Add(LineStart);
+		LineEnds.Add(LineEnd);
+		LineStart = LineEnd;
+	}
+
+	// Stable, so same-time events keep their authored order (a line ends before the next one starts)
+	Algo::StableSortBy(Events, &FShowEvent::Time);
+
+	int32 LastSnapshot = INDEX_NONE;
+	int32 LastSubtitle = INDEX_NONE;
+	int32 LastStage    = INDEX_NONE;
+	LineFirstEvent.Init(INDEX_NONE, LineStarts.Num());
+
+	for (int32 Index = 0; Index < Events.Num(); ++Index)
+	{
+		FShowEvent& Event = Events[Index];
+		switch (Event.Type)
+		{
+		case EShowEventType::LineStart:     LineFirstEvent[Event.Line] = Index; break;
+		case EShowEventType::Snapshot:      LastSnapshot = Index; break;
+		case EShowEventType::Stage:         LastStage    = Index; break;
+		case EShowEventType::SubtitleShow:
+		case EShowEventType::SubtitleClear: LastSubtitle = Index; break;
+		default: break;
+		}
+
+		Event.LastSnapshot = LastSnapshot;
+		Event.LastSubtitle = LastSubtitle;
+		Event.LastStage    = LastStage;
+	}
+}
+
+void FShowTimeline::Reset()
+{
+	Events.Reset();
+	LineStarts.Reset();
+	LineEnds.Reset();
+	LineFirstEvent.Reset();
+}
+
+bool FShowTimeline::ExtendLine(int32 Line, double Seconds)
+{
+	if (!LineEnds.IsValidIndex(Line)) return false;
+
+	const double Delta = LineStarts[Line] + Seconds - LineEnds[Line];
+	if (Delta <= 0.0) return false;
+
+	// A line's end is its last event and later lines start at or after it, so shifting that
+	// event and everything behind it by the same amount keeps the stream sorted
+	int32 EndEvent = LineFirstEvent[Line];
+	while (Events.IsValidIndex(EndEvent) && (Events[EndEvent].Type != EShowEventType::LineEnd || Events[EndEvent].Line != Line))
+	{
+		++EndEvent;
+	}
+	if (!Events.IsValidIndex(EndEvent)) return false;
+
+	for (int32 Index = EndEvent; Index < Events.Num(); ++Index)
+	{
+		Events[Index].Time += Delta;
+	}
+
+	LineEnds[Line] += Delta;
+	for (int32 Later = Line + 1; Later < LineStarts.Num(); ++Later)
+	{
+		LineStarts[Later] += Delta;
+		LineEnds[Later]   += Delta;
+	}
+	return true;
+}
+
+int32 FShowTimeline::FindNextEvent(double Time) const
+{
+	return Algo::UpperBoundBy(Events, Time, &FShowEvent::Time);
+}
+
+int32 FShowTimeline::GetLineAtTime(double Time) const
+{
+	if (LineStarts.Num() == 0) return INDEX_NONE;
+	return FMath::Clamp(Algo::UpperBound(LineStarts, Time) - 1, 0, LineStarts.Num() - 1);
+}
@@ -0,0 +1,122 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "World/Managers/AudioManager.h"
+#include "World/Managers/ShowTimeline.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ShowTimelineTest
+{
+	// Voice lengths of the test show; 0 = a line without voice
+	const float VoiceSeconds[] = { 4.f, 0.f, 7.5f, 1.f, 6.f };
+
+	// Voiced lines point at assets that are never loaded, so only a cached duration reaches the layout
+	TArray<FNarrationLine> MakeLines(bool bCached)
+	{
+		TArray<FNarrationLine> Lines;
+		for (int32 i = 0; i < UE_ARRAY_COUNT(VoiceSeconds); ++i)
+		{
+			FNarrationLine& Line = Lines.AddDefaulted_GetRef();
+			if (VoiceSeconds[i] > 0.f)
+			{
+				Line.VoiceLine     = TSoftObjectPtr<USoundBase>(FSoftObjectPath(FString::Printf(TEXT("/Game/Tests/Voice%d.Voice%d"), i, i)));
+				Line.VoiceDuration = bCached ? VoiceSeconds[i] : 0.f;
+			}
+
+			// Subtitles shorter than some voices and longer than others
+			for (int32 Segment = 0; Segment < 2; ++Segment)
+			{
+				FSubtitleSegment& Subtitle = Line.SubtitleSegments.AddDefaulted_GetRef();
+				Subtitle.StartTime = 0.5f * Segment;
+				Subtitle.Text      = FString::Printf(TEXT("Line %d, segment %d"), i, Segment);
+			}
+		}
+		return Lines;
+	}
+
+	// Sorted, laid end to end, every LineEnd where its line ends, and no voiced line shorter than its voice
+	void CheckTimeline(FAutomationTestBase& Test, const FString& What, const FShowTimeline& Timeline)
+	{
+		for (int32 Index = 1; Index < Timeline.Num(); ++Index)
+		{
+			if (Timeline.GetEvent(Index).Time < Timeline.GetEvent(Index - 1).Time)
+			{
+				Test.AddError(FString::Printf(TEXT("%s: event %d runs before event %d"), *What, Index, Index - 1));
+				return;
+			}
+		}
+
+		for (int32 Index = 0; Index < Timeline.Num(); ++Index)
+		{
+			const FShowEvent& Event = Timeline.GetEvent(Index);
+			if (Event.Type == EShowEventType::LineEnd)
+			{
+				Test.TestEqual(FString::Printf(TEXT("%s: LineEnd of line %d"), *What, Event.Line), Event.Time, Timeline.GetLineEnd(Event.Line));
+			}
+		}
+
+		for (int32 Line = 0; Line < Timeline.NumLines(); ++Line)
+		{
+			if (Line > 0)
+			{
+				Test.TestEqual(FString::Printf(TEXT("%s: line %d starts where line %d ends"), *What, Line, Line - 1),
+					Timeline.GetLineStart(Line), Timeline.GetLineEnd(Line - 1));
+			}
+			const double Length = Timeline.GetLineEnd(Line) - Timeline.GetLineStart(Line);
+			Test.TestTrue(FString::Printf(TEXT("%s: line %d lasts %.2f s, its voice %.2f s"), *What, Line, Length, VoiceSeconds[Line]),
+				Length >= VoiceSeconds[Line] - 1e-6);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShowTimelineTest, "GameTemplate.Narration.ShowTimeline",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShowTimelineTest::RunTest(const FString& Parameters)
+{
+	using namespace ShowTimelineTest;
+
+	// Durations cached in the editor: laid out right at compile time
+	{
+		FShowTimeline Timeline;
+		Timeline.Compile(MakeLines(true));
+		CheckTimeline(*this, TEXT("Cached"), Timeline);
+	}
+
+	// Never cached: the lines are laid out to their subtitles, then pushed out as each voice loads
+	// (out of order, as the streaming window may finish them), the way AAudioManager::FitLineToVoice does
+	{
+		FShowTimeline Timeline;
+		Timeline.Compile(MakeLines(false));
+
+		const int32 NumEvents = Timeline.Num();
+		TArray<int32> FirstEvents;
+		for (int32 Line = 0; Line < Timeline.NumLines(); ++Line)
+		{
+			FirstEvents.Add(Timeline.GetLineFirstEvent(Line));
+		}
+
+		for (const int32 Line : { 2, 0, 4, 3, 1 })
+		{
+			Timeline.ExtendLine(Line, VoiceSeconds[Line]);
+		}
+		CheckTimeline(*this, TEXT("Loaded"), Timeline);
+
+		// Indices a running cursor holds must still point at the same events
+		TestEqual(TEXT("Loaded: event count"), Timeline.Num(), NumEvents);
+		for (int32 Line = 0; Line < Timeline.NumLines(); ++Line)
+		{
+			TestEqual(FString::Printf(TEXT("Loaded: first event of line %d"), Line), Timeline.GetLineFirstEvent(Line), FirstEvents[Line]);
+		}
+
+		const double Duration = Timeline.GetDuration();
+		TestFalse(TEXT("A line already long enough is left alone"), Timeline.ExtendLine(0, 0.5));
+		TestEqual(TEXT("Show length after a no-op extend"), Timeline.GetDuration(), Duration);
+	}
+
+	return true;
+}
+
+#endif
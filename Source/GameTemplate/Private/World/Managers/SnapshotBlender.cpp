@@ -0,0 +1,51 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Managers/SnapshotBlender.h"
+#include "UObject/UnrealType.h"
+
+FSnapshotFieldLayout::FSnapshotFieldLayout(const UScriptStruct* Struct)
+{
+	check(Struct);
+	StructName = Struct->GetName();
+
+	for (TFieldIterator<FFloatProperty> It(Struct); It; ++It)
+	{
+		const FFloatProperty* Property = *It;
+		for (int32 Element = 0; Element < Property->ArrayDim; ++Element)
+		{
+			Offsets.Add(Property->GetOffset_ForInternal() + Element * Property->ElementSize);
+			Names.Add(Property->GetFName());
+		}
+	}
+
+	UE_LOG(LogTemp, Verbose, TEXT("SnapshotBlender: %s blends %d float fields in %d lanes"), *StructName, Num(), NumLanes());
+}
+
+void FSnapshotFieldLayout::Pack(const void* Value, float* OutLanes) const
+{
+	const uint8* Bytes = static_cast<const uint8*>(Value);
+	for (int32 i = 0; i < Offsets.Num(); ++i)
+	{
+		OutLanes[i] = *reinterpret_cast<const float*>(Bytes + Offsets[i]);
+	}
+}
+
+void FSnapshotFieldLayout::Unpack(const float* Lanes, void* OutValue) const
+{
+	uint8* Bytes = static_cast<uint8*>(OutValue);
+	for (int32 i = 0; i < Offsets.Num(); ++i)
+	{
+		*reinterpret_cast<float*>(Bytes + Offsets[i]) = Lanes[i];
+	}
+}
+
+void SnapshotLerpLanes(const float* Start, const float* Delta, float Alpha, float* Out, int32 NumLanes)
+{
+	checkSlow(NumLanes % 4 == 0);
+
+	const VectorRegister4Float Weight = VectorSetFloat1(Alpha);
+	for (int32 i = 0; i < NumLanes; i += 4)
+	{
+		VectorStoreAligned(VectorMultiplyAdd(Weight, VectorLoadAligned(Delta + i), VectorLoadAligned(Start + i)), Out + i);
+	}
+}
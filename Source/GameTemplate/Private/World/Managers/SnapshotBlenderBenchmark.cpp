@@ -0,0 +1,59 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "World/Managers/SnapshotBlender.h"
+#include "World/Managers/SnapshotTypes.h"
+#include "World/Managers/PostProcessSnapshotManager.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace SnapshotBlenderBenchmark
+{
+	constexpr int32 NumSteps = 100000;
+
+	template<typename T>
+	void TimeStruct(const T& From, const T& To)
+	{
+		const FSnapshotFieldLayout& Layout = TSnapshotBlender<T>::GetLayout();
+
+		TArray<float, TAlignedHeapAllocator<16>> Out;
+		Out.SetNumZeroed(Layout.NumLanes());
+
+		TSnapshotBlender<T> Blender;
+		Blender.Begin(From, To);
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		float Sink = 0.f;
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			Layout.Pack(&Blender.Evaluate(static_cast<float>(Step) / NumSteps), Out.GetData());
+			Sink += Out[0];
+		}
+		const double TotalNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1.e6;
+
+		UE_LOG(LogTemp, Display, TEXT("SnapshotBlender: %-20s %2d fields, %2d lanes, %.1f ns/blend (%g)"),
+			*Layout.GetStructName(), Layout.Num(), Layout.NumLanes(), TotalNs / NumSteps, Sink);
+	}
+
+	void Run()
+	{
+		FSnapshotTargets AudioTo;
+		AudioTo.FilterCutoffHz = 800.f; AudioTo.ReverbWet = 0.8f;
+
+		FPostSnapshotTargets PostTo;
+		PostTo.Saturation = 0.6f; PostTo.Contrast = 1.3f;
+
+		TimeStruct(FSnapshotTargets(), AudioTo);
+		TimeStruct(FPostSnapshotTargets(), PostTo);
+		TimeStruct(FLinearColor(1.f, 0.5f, 0.f, 1.f), FLinearColor(0.1f, 0.2f, 1.f, 0.5f));
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("snapshot.Blender.Benchmark"),
+		TEXT("Times the reflected snapshot blend kernel for every look struct (correctness is the GameTemplate.Snapshot.Blender automation test)."),
+		FConsoleCommandDelegate::CreateStatic(&Run));
+}
+
+#endif
@@ -0,0 +1,78 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "World/Managers/SnapshotBlender.h"
+#include "World/Managers/SnapshotTypes.h"
+#include "World/Managers/PostProcessSnapshotManager.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SnapshotBlenderTest
+{
+	// Every reflected lane against a scalar lerp of the same field
+	template<typename T>
+	void CheckStruct(FAutomationTestBase& Test, const T& From, const T& To)
+	{
+		const FSnapshotFieldLayout& Layout = TSnapshotBlender<T>::GetLayout();
+		Test.TestTrue(FString::Printf(TEXT("%s has fields"), *Layout.GetStructName()), Layout.Num() > 0);
+		Test.TestTrue(FString::Printf(TEXT("%s lanes cover its fields"), *Layout.GetStructName()), Layout.NumLanes() >= Layout.Num());
+
+		TArray<float, TAlignedHeapAllocator<16>> A, B, Out;
+		A.SetNumZeroed(Layout.NumLanes());
+		B.SetNumZeroed(Layout.NumLanes());
+		Out.SetNumZeroed(Layout.NumLanes());
+		Layout.Pack(&From, A.GetData());
+		Layout.Pack(&To,   B.GetData());
+
+		TSnapshotBlender<T> Blender;
+		Blender.Begin(From, To);
+
+		for (const float Alpha : { 0.f, 0.25f, 0.5f, 0.9f, 1.f })
+		{
+			const T Blended = Blender.Evaluate(Alpha);
+			Layout.Pack(&Blended, Out.GetData());
+
+			for (int32 i = 0; i < Layout.Num(); ++i)
+			{
+				const float Expected = FMath::Lerp(A[i], B[i], Alpha);
+				Test.TestEqual(FString::Printf(TEXT("%s.%s at %.2f"), *Layout.GetStructName(), *Layout.GetFieldName(i).ToString(), Alpha),
+					Out[i], Expected, FMath::Max(1.e-4f, FMath::Abs(Expected) * 1.e-5f));
+			}
+		}
+
+		// Packing and unpacking is lossless
+		T RoundTrip = From;
+		Layout.Unpack(B.GetData(), &RoundTrip);
+		Layout.Pack(&RoundTrip, Out.GetData());
+		for (int32 i = 0; i < Layout.Num(); ++i)
+		{
+			Test.TestEqual(FString::Printf(TEXT("%s.%s round trip"), *Layout.GetStructName(), *Layout.GetFieldName(i).ToString()), Out[i], B[i]);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotBlenderTest, "GameTemplate.Snapshot.Blender",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSnapshotBlenderTest::RunTest(const FString& Parameters)
+{
+	using namespace SnapshotBlenderTest;
+
+	FSnapshotTargets AudioFrom;
+	FSnapshotTargets AudioTo;
+	AudioTo.FilterCutoffHz = 800.f; AudioTo.EQHighShelfGainDb = -6.f; AudioTo.CompAttackMs = 3.f;
+	AudioTo.CompReleaseMs = 400.f; AudioTo.CompThresholdDb = -24.f; AudioTo.ReverbWet = 0.8f;
+
+	FPostSnapshotTargets PostFrom;
+	FPostSnapshotTargets PostTo;
+	PostTo.Saturation = 0.6f; PostTo.Contrast = 1.3f; PostTo.Vignette = 0.5f; PostTo.BloomIntensity = 1.2f;
+	PostTo.BloomThreshold = 0.4f; PostTo.SceneFringe = 0.3f; PostTo.Grain = 0.25f;
+
+	CheckStruct(*this, AudioFrom, AudioTo);
+	CheckStruct(*this, PostFrom, PostTo);
+	CheckStruct(*this, FLinearColor(1.f, 0.5f, 0.f, 1.f), FLinearColor(0.1f, 0.2f, 1.f, 0.5f));
+	return true;
+}
+
+#endif
@@ -0,0 +1,44 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Managers/SnapshotChannels.h"
+
+void FSnapshotChannels::Init(int32 NumChannels)
+{
+	LastPushed.Init(0.f, FMath::Max(0, NumChannels));
+	bHasPushed.Init(false, FMath::Max(0, NumChannels));
+	ResetCounters();
+}
+
+bool FSnapshotChannels::Test(int32 Channel, float Value, float DeadBand, bool bExact)
+{
+	if (Channel < 0) return true;
+
+	// Pushed before Init (e.g. from Blueprint ahead of BeginPlay): a new channel always pushes
+	if (Channel >= LastPushed.Num())
+	{
+		LastPushed.SetNumZeroed(Channel + 1);
+		bHasPushed.SetNumZeroed(Channel + 1);
+	}
+
+	const float Delta = FMath::Abs(Value - LastPushed[Channel]);
+	const bool bDirty = !bHasPushed[Channel] || (bExact ? Delta > 0.f : Delta > FMath::Max(0.f, DeadBand));
+
+	if (!bDirty)
+	{
+		++NumSuppressed;
+		return false;
+	}
+
+	LastPushed[Channel] = Value;
+	bHasPushed[Channel] = true;
+	++NumPushed;
+	return true;
+}
+
+void FSnapshotChannels::Invalidate()
+{
+	for (bool& bPushed : bHasPushed)
+	{
+		bPushed = false;
+	}
+}
@@ -0,0 +1,131 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Managers/VoiceStreamingWindow.h"
+#include "World/Managers/AudioManager.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundBase.h"
+
+void FVoiceStreamingWindow::Init(int32 NumLines, int32 InLookahead)
+{
+	Reset();
+	Handles.SetNum(NumLines);
+	Lookahead = FMath::Max(0, InLookahead);
+}
+
+void FVoiceStreamingWindow::Reset()
+{
+	if (WaitHandle.IsValid())
+	{
+		WaitHandle->CancelHandle();
+		WaitHandle.Reset();
+	}
+
+	for (TSharedPtr<FStreamableHandle>& Handle : Handles)
+	{
+		if (Handle.IsValid())
+		{
+			Handle->CancelHandle();
+		}
+	}
+	Handles.Reset();
+}
+
+void FVoiceStreamingWindow::Update(const TArray<FNarrationLine>& Lines, int32 CurrentLine)
+{
+	if (!UAssetManager::IsInitialized()) return;
+
+	FStreamableManager& Streamable = UAssetManager::GetStreamableManager();
+	const int32 First = FMath::Max(0, CurrentLine);
+	const int32 Last  = CurrentLine + Lookahead;
+
+	for (int32 Line = 0; Line < Handles.Num() && Line < Lines.Num(); ++Line)
+	{
+		TSharedPtr<FStreamableHandle>& Handle = Handles[Line];
+		const bool bInWindow = Line >= First && Line <= Last;
+
+		if (!bInWindow)
+		{
+			if (Handle.IsValid())
+			{
+				Handle->ReleaseHandle();
+				Handle.Reset();
+			}
+			continue;
+		}
+
+		const TSoftObjectPtr<USoundBase>& Voice = Lines[Line].VoiceLine;
+		if (Handle.IsValid() || Voice.IsNull()) continue;
+
+		// Priming queues the first chunk of a streaming wave, so the quantized start doesn't wait on disk
+		Handle = Streamable.RequestAsyncLoad(Voice.ToSoftObjectPath(), FStreamableDelegate::CreateLambda([Voice, Line, OnResident = OnVoiceResident]()
+		{
+			if (USoundBase* Sound = Voice.Get())
+			{
+				UGameplayStatics::PrimeSound(Sound);
+				OnResident.ExecuteIfBound(Line, Sound);
+			}
+		}),
+		FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+
+void FVoiceStreamingWindow::WhenResident(const TArray<FNarrationLine>& Lines, int32 Line, FStreamableDelegate OnResident)
+{
+	if (WaitHandle.IsValid())
+	{
+		WaitHandle->CancelHandle();
+		WaitHandle.Reset();
+	}
+
+	const bool bNoVoice = !Lines.IsValidIndex(Line) || Lines[Line].VoiceLine.IsNull();
+	if (bNoVoice || IsResident(Line) || !UAssetManager::IsInitialized())
+	{
+		OnResident.ExecuteIfBound();
+		return;
+	}
+
+	// Shares the window's own request for the line, so this only adds a completion callback;
+	// the wait is released once it has fired, the window's handle keeps the voice resident
+	WaitHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Lines[Line].VoiceLine.ToSoftObjectPath(),
+		FStreamableDelegate::CreateLambda([this, OnResident = MoveTemp(OnResident)]()
+		{
+			if (WaitHandle.IsValid())
+			{
+				WaitHandle->ReleaseHandle();
+				WaitHandle.Reset();
+			}
+			OnResident.ExecuteIfBound();
+		}),
+		FStreamableManager::AsyncLoadHighPriority);
+}
+
+USoundBase* FVoiceStreamingWindow::GetSound(int32 Line) const
+{
+	if (!Handles.IsValidIndex(Line) || !Handles[Line].IsValid() || !Handles[Line]->HasLoadCompleted()) return nullptr;
+	return Cast<USoundBase>(Handles[Line]->GetLoadedAsset());
+}
+
+int32 FVoiceStreamingWindow::GetNumResident() const
+{
+	int32 Count = 0;
+	for (int32 Line = 0; Line < Handles.Num(); ++Line)
+	{
+		Count += IsResident(Line) ? 1 : 0;
+	}
+	return Count;
+}
+
+SIZE_T FVoiceStreamingWindow::GetResidentBytes() const
+{
+	SIZE_T Bytes = 0;
+	for (int32 Line = 0; Line < Handles.Num(); ++Line)
+	{
+		if (USoundBase* Sound = GetSound(Line))
+		{
+			Bytes += Sound->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+		}
+	}
+	return Bytes;
+}
@@ -1,6 +1,7 @@
 ﻿// © Anastasis Marinos //
 
 #include "World/StageLight.h"
+#include "World/Subsystems/StageRegistrySubsystem.h"
 
 AStageLight::AStageLight()
 {
@@ -28,6 +29,20 @@ void AStageLight::BeginPlay()
 	Super::BeginPlay();
 }
 
+void AStageLight::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	UStageRegistrySubsystem::RegisterActor(this, AStageLight::StaticClass());
+}
+
+void AStageLight::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UStageRegistrySubsystem::UnregisterActor(this, AStageLight::StaticClass());
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AStageLight::SetLightColor(const FLinearColor& InColor)
 {
 	if (SpotLight)
@@ -0,0 +1,172 @@
+﻿// © Anastasis Marinos //
+
+#include "World/StageLightRig.h"
+#include "World/Subsystems/StageRegistrySubsystem.h"
+
+AStageLightRig::AStageLightRig()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	SceneRoot = CreateDefaultSubobject<USceneComponent>(TEXT("SceneRoot"));
+	SetRootComponent(SceneRoot);
+
+	BaseInstances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("BaseInstances"));
+	BaseInstances->SetupAttachment(SceneRoot);
+
+	YokeInstances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("YokeInstances"));
+	YokeInstances->SetupAttachment(SceneRoot);
+
+	HeadInstances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("HeadInstances"));
+	HeadInstances->SetupAttachment(SceneRoot);
+	HeadInstances->NumCustomDataFloats = 4;
+
+	for (UInstancedStaticMeshComponent* Instances : { BaseInstances.Get(), YokeInstances.Get(), HeadInstances.Get() })
+	{
+		Instances->SetMobility(EComponentMobility::Movable);
+		Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+}
+
+void AStageLightRig::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+	BuildInstances();
+}
+
+void AStageLightRig::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// A manager that registered the rig first has already built (and holds) the beams
+	if (!bBeamsBuilt)
+	{
+		BuildBeams();
+	}
+}
+
+void AStageLightRig::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	UStageRegistrySubsystem::RegisterActor(this, AStageLightRig::StaticClass());
+}
+
+void AStageLightRig::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UStageRegistrySubsystem::UnregisterActor(this, AStageLightRig::StaticClass());
+
+	Super::EndPlay(EndPlayReason);
+}
+
+USpotLightComponent* AStageLightRig::GetBeam(int32 Fixture)
+{
+	if (!bBeamsBuilt)
+	{
+		BuildBeams();
+	}
+	return Beams.IsValidIndex(Fixture) ? Beams[Fixture].Get() : nullptr;
+}
+
+void AStageLightRig::SetHeadColor(int32 Fixture, const FLinearColor& Color)
+{
+	if (!HeadInstances || Fixture < 0 || Fixture >= HeadInstances->GetInstanceCount()) return;
+
+	// Only the instance's custom data changes; the proxy stays as it is
+	HeadInstances->SetCustomDataValue(Fixture, 0, Color.R, false);
+	HeadInstances->SetCustomDataValue(Fixture, 1, Color.G, false);
+	HeadInstances->SetCustomDataValue(Fixture, 2, Color.B, false);
+	HeadInstances->SetCustomDataValue(Fixture, 3, Color.A, false);
+	bHeadColorsDirty = true;
+}
+
+void AStageLightRig::FlushHeadColors()
+{
+	if (bHeadColorsDirty && HeadInstances)
+	{
+		// One instance-data update for the frame's writes, not a proxy rebuild
+		HeadInstances->MarkRenderInstancesDirty();
+	}
+	bHeadColorsDirty = false;
+}
+
+void AStageLightRig::RebuildRig()
+{
+	BuildInstances();
+	if (bBeamsBuilt)
+	{
+		BuildBeams();
+	}
+
+	// Managers hold the old fixtures and beams: leave and re-join so they fetch the new ones
+	UStageRegistrySubsystem* Registry = UStageRegistrySubsystem::Get(this);
+	if (Registry && Registry->IsRegistered(this, AStageLightRig::StaticClass()))
+	{
+		Registry->Unregister(this, AStageLightRig::StaticClass());
+		Registry->Register(this, AStageLightRig::StaticClass());
+	}
+}
+
+/* ---------------- Internals ---------------- */
+
+void AStageLightRig::BuildInstances()
+{
+	TArray<FTransform> Bases;
+	TArray<FTransform> Yokes;
+	TArray<FTransform> HeadTransforms;
+	Bases.Reserve(Fixtures.Num());
+	Yokes.Reserve(Fixtures.Num());
+	HeadTransforms.Reserve(Fixtures.Num());
+
+	for (const FStageFixture& Fixture : Fixtures)
+	{
+		const FTransform Yoke = FTransform(FRotator(0.f, Fixture.Pan, 0.f), YokeOffset) * Fixture.Transform;
+		const FTransform Head = FTransform(FRotator(Fixture.Tilt, 0.f, 0.f), HeadOffset) * Yoke;
+
+		Bases.Add(Fixture.Transform);
+		Yokes.Add(Yoke);
+		HeadTransforms.Add(Head);
+	}
+
+	BaseInstances->ClearInstances();
+	YokeInstances->ClearInstances();
+	HeadInstances->ClearInstances();
+
+	BaseInstances->AddInstances(Bases, false);
+	YokeInstances->AddInstances(Yokes, false);
+	HeadInstances->AddInstances(HeadTransforms, false);
+}
+
+void AStageLightRig::BuildBeams()
+{
+	for (USpotLightComponent* Beam : Beams)
+	{
+		if (Beam)
+		{
+			Beam->DestroyComponent();
+		}
+	}
+	Beams.Reset();
+	Beams.SetNum(Fixtures.Num());
+
+	for (int32 i = 0; i < Fixtures.Num(); ++i)
+	{
+		if (!Fixtures[i].bHasBeam) continue;
+
+		FTransform Head;
+		HeadInstances->GetInstanceTransform(i, Head, false);
+
+		USpotLightComponent* Beam = NewObject<USpotLightComponent>(this, NAME_None, RF_Transient);
+		Beam->SetMobility(EComponentMobility::Movable);
+		Beam->SetupAttachment(SceneRoot);
+		Beam->SetRelativeTransform(Head);
+		Beam->SetIntensity(BeamIntensity);
+		Beam->SetOuterConeAngle(BeamOuterConeAngle);
+		Beam->SetAttenuationRadius(BeamAttenuationRadius);
+		Beam->SetCastShadows(bBeamsCastShadows);
+		Beam->RegisterComponent();
+
+		Beams[i] = Beam;
+	}
+
+	bBeamsBuilt = true;
+}
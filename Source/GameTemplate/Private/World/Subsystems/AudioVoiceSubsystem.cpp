@@ -0,0 +1,451 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Subsystems/AudioVoiceSubsystem.h"
+#include "AudioDevice.h"
+#include "Components/AudioComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Sound/SoundBase.h"
+#include "TimerManager.h"
+
+static_assert(static_cast<int32>(EAudioVoiceCategory::Count) == 3, "One pool per voice category");
+
+UAudioVoiceSubsystem* UAudioVoiceSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UAudioVoiceSubsystem>() : nullptr;
+}
+
+bool UAudioVoiceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UAudioVoiceSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (!InWorld.GetAudioDevice())
+		return;
+
+	// Pay for the components up front, so the show's sounds only ever reuse them
+	for (int32 c = 0; c < static_cast<int32>(EAudioVoiceCategory::Count); ++c)
+	{
+		const EAudioVoiceCategory Category = static_cast<EAudioVoiceCategory>(c);
+		FAudioVoicePool& Pool = GetPool(Category);
+		while (Pool.Components.Num() < GetSettings(Category).PoolSize)
+		{
+			const int32 Index = CreateComponent(Category);
+			if (Index == INDEX_NONE)
+				break;
+			Pool.Free.Add(Index);
+		}
+	}
+}
+
+void UAudioVoiceSubsystem::Deinitialize()
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(VirtualTimer);
+	}
+
+	for (FAudioVoicePool& Pool : Pools)
+	{
+		for (UAudioComponent* Component : Pool.Components)
+		{
+			if (Component)
+			{
+				Component->OnAudioFinishedNative.RemoveAll(this);
+				Component->Stop();
+				Component->DestroyComponent();
+			}
+		}
+		Pool = FAudioVoicePool();
+	}
+	Voices.Reset();
+	FreeVoices.Reset();
+	NumVirtual = 0;
+	NumSpatial = 0;
+
+	Super::Deinitialize();
+}
+
+const FAudioVoiceCategorySettings& UAudioVoiceSubsystem::GetSettings(EAudioVoiceCategory Category) const
+{
+	switch (Category)
+	{
+	case EAudioVoiceCategory::Narration:   return Narration;
+	case EAudioVoiceCategory::Interaction: return Interaction;
+	default:                               return SFX;
+	}
+}
+
+FAudioVoiceHandle UAudioVoiceSubsystem::PlaySound2D(EAudioVoiceCategory Category, USoundBase* Sound, float Priority, float Volume, float StartTime)
+{
+	return StartVoice(Category, Sound, false, FVector::ZeroVector, Priority, Volume, StartTime, false);
+}
+
+FAudioVoiceHandle UAudioVoiceSubsystem::PlaySoundAtLocation(EAudioVoiceCategory Category, USoundBase* Sound, FVector Location, float Priority, float Volume)
+{
+	return StartVoice(Category, Sound, true, Location, Priority, Volume, 0.f, false);
+}
+
+UAudioComponent* UAudioVoiceSubsystem::AcquireVoice(EAudioVoiceCategory Category, USoundBase* Sound, FAudioVoiceHandle& OutHandle, float Priority)
+{
+	OutHandle = StartVoice(Category, Sound, false, FVector::ZeroVector, Priority, 1.f, 0.f, true);
+	if (!OutHandle.IsValid())
+		return nullptr;
+
+	const FAudioVoice& Voice = Voices[OutHandle.Index];
+	return GetPool(Category).Components[Voice.ComponentIndex];
+}
+
+void UAudioVoiceSubsystem::StopVoice(const FAudioVoiceHandle& Handle)
+{
+	if (IsVoiceActive(Handle))
+	{
+		Release(Handle.Index);
+		UpdateTimer();
+	}
+}
+
+bool UAudioVoiceSubsystem::IsVoiceActive(const FAudioVoiceHandle& Handle) const
+{
+	return Handle.IsValid() && Voices.IsValidIndex(Handle.Index) && Voices[Handle.Index].Serial == Handle.Serial;
+}
+
+FAudioVoicePoolStats UAudioVoiceSubsystem::GetStats(EAudioVoiceCategory Category) const
+{
+	const FAudioVoicePool& Pool = GetPool(Category);
+	FAudioVoicePoolStats Stats = Pool.Stats;
+	Stats.NumComponents = Pool.Components.Num();
+	Stats.NumPlaying    = Pool.NumPlaying;
+	Stats.NumVirtual    = 0;
+	for (const FAudioVoice& Voice : Voices)
+	{
+		Stats.NumVirtual += (Voice.Category == Category && Voice.IsVirtual()) ? 1 : 0;
+	}
+	return Stats;
+}
+
+/* ---------------- Voices ---------------- */
+
+FAudioVoiceHandle UAudioVoiceSubsystem::StartVoice(EAudioVoiceCategory Category, USoundBase* Sound, bool bSpatial, const FVector& Location, float Priority, float Volume, float StartTime, bool bStartedByCaller)
+{
+	if (!Sound || !GetWorld() || Category == EAudioVoiceCategory::Count)
+		return FAudioVoiceHandle();
+
+	const FAudioVoiceCategorySettings& Settings = GetSettings(Category);
+	FAudioVoicePool& Pool = GetPool(Category);
+
+	const int32 Index = AllocVoice();
+	FAudioVoice& Voice = Voices[Index];
+	Voice.Sound            = Sound;
+	Voice.Location         = Location;
+	Voice.StartTime        = GetAudioTime() - StartTime;
+	Voice.Duration         = Sound->GetDuration();
+	Voice.Priority         = Priority;
+	Voice.Volume           = Volume;
+	Voice.Category         = Category;
+	Voice.bSpatial         = bSpatial;
+	Voice.bStartedByCaller = bStartedByCaller;
+
+	FAudioVoiceHandle Handle;
+	Handle.Index  = Index;
+	Handle.Serial = Voice.Serial;
+
+	// A caller-started voice has to have its component now; the rest can wait as virtual voices
+	if (!(IsAudible(Voice) && MakeRoom(Category, Priority) && Realize(Index, StartTime)))
+	{
+		if (!Settings.bVirtualize || bStartedByCaller)
+		{
+			++Pool.Stats.Rejected;
+			Voices[Index] = FAudioVoice();
+			FreeVoices.Add(Index);
+			return FAudioVoiceHandle();
+		}
+		++NumVirtual;
+		++Pool.Stats.Virtualized;
+	}
+
+	UpdateTimer();
+	return Handle;
+}
+
+bool UAudioVoiceSubsystem::MakeRoom(EAudioVoiceCategory Category, float Priority)
+{
+	FAudioVoicePool& Pool = GetPool(Category);
+	if (Pool.NumPlaying < GetSettings(Category).MaxVoices)
+		return true;
+
+	// Full: take the place of the quietest voice, if this one outranks it
+	const int32 Victim = FindVictim(Category);
+	if (Victim == INDEX_NONE || Voices[Victim].Priority >= Priority)
+		return false;
+
+	++Pool.Stats.Steals;
+	if (GetSettings(Category).bVirtualize && !Voices[Victim].bStartedByCaller)
+	{
+		Virtualize(Victim);
+	}
+	else
+	{
+		Release(Victim);
+	}
+	return true;
+}
+
+int32 UAudioVoiceSubsystem::FindVictim(EAudioVoiceCategory Category) const
+{
+	// Lowest priority, then oldest
+	int32 Victim = INDEX_NONE;
+	for (const int32 VoiceIndex : GetPool(Category).Owner)
+	{
+		if (VoiceIndex == INDEX_NONE)
+			continue;
+
+		const FAudioVoice& Voice = Voices[VoiceIndex];
+		if (Victim == INDEX_NONE || Voice.Priority < Voices[Victim].Priority
+			|| (Voice.Priority == Voices[Victim].Priority && Voice.StartTime < Voices[Victim].StartTime))
+		{
+			Victim = VoiceIndex;
+		}
+	}
+	return Victim;
+}
+
+bool UAudioVoiceSubsystem::Realize(int32 VoiceIndex, float StartTime)
+{
+	FAudioVoice& Voice = Voices[VoiceIndex];
+	FAudioVoicePool& Pool = GetPool(Voice.Category);
+
+	const int32 ComponentIndex = TakeComponent(Voice.Category);
+	if (ComponentIndex == INDEX_NONE)
+		return false;
+
+	UAudioComponent* Component = Pool.Components[ComponentIndex];
+	Pool.Owner[ComponentIndex] = VoiceIndex;
+	Voice.ComponentIndex = ComponentIndex;
+	++Pool.NumPlaying;
+	NumSpatial += Voice.bSpatial ? 1 : 0;
+
+	// 2D voices keep playing through pause, as CreateSound2D's do
+	Component->bAllowSpatialization = Voice.bSpatial;
+	Component->bIsUISound           = !Voice.bSpatial;
+	Component->SetWorldLocation(Voice.Location);
+	Component->SetSound(Voice.Sound);
+	Component->SetVolumeMultiplier(Voice.Volume);
+
+	if (!Voice.bStartedByCaller)
+	{
+		Component->Play(StartTime);
+	}
+	return true;
+}
+
+void UAudioVoiceSubsystem::Virtualize(int32 VoiceIndex)
+{
+	FAudioVoice& Voice = Voices[VoiceIndex];
+	if (Voice.IsVirtual())
+		return;
+
+	DetachComponent(VoiceIndex);
+	++NumVirtual;
+	++GetPool(Voice.Category).Stats.Virtualized;
+}
+
+void UAudioVoiceSubsystem::Release(int32 VoiceIndex)
+{
+	FAudioVoice& Voice = Voices[VoiceIndex];
+	if (Voice.Serial == 0)
+		return;
+
+	if (Voice.IsVirtual())
+	{
+		--NumVirtual;
+	}
+	else
+	{
+		DetachComponent(VoiceIndex);
+	}
+
+	Voice = FAudioVoice();
+	FreeVoices.Add(VoiceIndex);
+}
+
+void UAudioVoiceSubsystem::DetachComponent(int32 VoiceIndex)
+{
+	FAudioVoice& Voice = Voices[VoiceIndex];
+	if (Voice.ComponentIndex == INDEX_NONE)
+		return;
+
+	FAudioVoicePool& Pool = GetPool(Voice.Category);
+	UAudioComponent* Component = Pool.Components[Voice.ComponentIndex];
+
+	// Back in the pool before Stop, so its finished event finds no voice
+	Pool.Owner[Voice.ComponentIndex] = INDEX_NONE;
+	Pool.Free.Add(Voice.ComponentIndex);
+	--Pool.NumPlaying;
+	NumSpatial -= Voice.bSpatial ? 1 : 0;
+	Voice.ComponentIndex = INDEX_NONE;
+
+	if (Component)
+	{
+		Component->Stop();
+	}
+}
+
+int32 UAudioVoiceSubsystem::TakeComponent(EAudioVoiceCategory Category)
+{
+	FAudioVoicePool& Pool = GetPool(Category);
+	if (Pool.Free.Num() > 0)
+	{
+		++Pool.Stats.Hits;
+		return Pool.Free.Pop(EAllowShrinking::No);
+	}
+
+	++Pool.Stats.Misses;
+	UE_LOG(LogTemp, Verbose, TEXT("AudioVoices: %s pool grew to %d components"),
+		*UEnum::GetValueAsString(Category), Pool.Components.Num() + 1);
+	return CreateComponent(Category);
+}
+
+int32 UAudioVoiceSubsystem::CreateComponent(EAudioVoiceCategory Category)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+		return INDEX_NONE;
+
+	UAudioComponent* Component = NewObject<UAudioComponent>(this, NAME_None, RF_Transient);
+	Component->bAutoActivate           = false;
+	Component->bAutoDestroy            = false;
+	Component->bStopWhenOwnerDestroyed = false;
+	Component->RegisterComponentWithWorld(World);
+
+	FAudioVoicePool& Pool = GetPool(Category);
+	const int32 Index = Pool.Components.Add(Component);
+	Pool.Owner.Add(INDEX_NONE);
+	Component->OnAudioFinishedNative.AddUObject(this, &UAudioVoiceSubsystem::HandleComponentFinished, Category, Index);
+	return Index;
+}
+
+int32 UAudioVoiceSubsystem::AllocVoice()
+{
+	const int32 Index = FreeVoices.Num() > 0 ? FreeVoices.Pop(EAllowShrinking::No) : Voices.AddDefaulted();
+	Voices[Index].Serial = NextSerial++;
+	if (NextSerial == 0)
+	{
+		NextSerial = 1;
+	}
+	return Index;
+}
+
+void UAudioVoiceSubsystem::HandleComponentFinished(UAudioComponent* Component, EAudioVoiceCategory Category, int32 ComponentIndex)
+{
+	const FAudioVoicePool& Pool = GetPool(Category);
+	if (!Pool.Owner.IsValidIndex(ComponentIndex) || Pool.Owner[ComponentIndex] == INDEX_NONE)
+		return;
+
+	Release(Pool.Owner[ComponentIndex]);
+	UpdateTimer();
+}
+
+/* ---------------- Virtual voices ---------------- */
+
+bool UAudioVoiceSubsystem::IsAudible(const FAudioVoice& Voice) const
+{
+	if (!Voice.bSpatial || !Voice.Sound)
+		return true;
+
+	const UWorld* World = GetWorld();
+	const FAudioDeviceHandle AudioDevice = World ? World->GetAudioDevice() : FAudioDeviceHandle();
+	return !AudioDevice || AudioDevice->LocationIsAudible(Voice.Location, Voice.Sound->GetMaxDistance());
+}
+
+double UAudioVoiceSubsystem::GetAudioTime() const
+{
+	const UWorld* World = GetWorld();
+	return World ? World->GetAudioTimeSeconds() : 0.0;
+}
+
+void UAudioVoiceSubsystem::UpdateVirtualVoices()
+{
+	const double Now = GetAudioTime();
+	for (int32 i = 0; i < Voices.Num(); ++i)
+	{
+		FAudioVoice& Voice = Voices[i];
+		if (Voice.Serial == 0 || Voice.bStartedByCaller)
+			continue;
+
+		if (Voice.IsVirtual())
+		{
+			// One-shots run out while virtual; loops come back from the top
+			const bool  bLooping = Voice.Sound->IsLooping();
+			const float Elapsed  = static_cast<float>(Now - Voice.StartTime);
+			if (!bLooping && Elapsed >= Voice.Duration)
+			{
+				Release(i);
+			}
+			else if (IsAudible(Voice) && MakeRoom(Voice.Category, Voice.Priority) && Realize(i, bLooping ? 0.f : Elapsed))
+			{
+				--NumVirtual;
+			}
+		}
+		else if (Voice.bSpatial && GetSettings(Voice.Category).bVirtualize && !IsAudible(Voice))
+		{
+			Virtualize(i);
+		}
+	}
+
+	UpdateTimer();
+}
+
+void UAudioVoiceSubsystem::UpdateTimer()
+{
+	UWorld* World = GetWorld();
+	if (!World)
+		return;
+
+	FTimerManager& Timers = World->GetTimerManager();
+	const bool bNeeded = NumVirtual > 0 || NumSpatial > 0;
+	if (bNeeded && !Timers.IsTimerActive(VirtualTimer))
+	{
+		Timers.SetTimer(VirtualTimer, this, &UAudioVoiceSubsystem::UpdateVirtualVoices, VirtualUpdateInterval, true);
+	}
+	else if (!bNeeded)
+	{
+		Timers.ClearTimer(VirtualTimer);
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+
+namespace AudioVoiceStats
+{
+	static void Run(UWorld* World)
+	{
+		const UAudioVoiceSubsystem* Subsystem = UAudioVoiceSubsystem::Get(World);
+		if (!Subsystem)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("au.Voices.Stats: no voice subsystem in this world."));
+			return;
+		}
+
+		for (int32 c = 0; c < static_cast<int32>(EAudioVoiceCategory::Count); ++c)
+		{
+			const EAudioVoiceCategory Category = static_cast<EAudioVoiceCategory>(c);
+			const FAudioVoicePoolStats Stats = Subsystem->GetStats(Category);
+			UE_LOG(LogTemp, Display, TEXT("au.Voices.Stats: %-12s %d components, %d playing, %d virtual | %d hits, %d misses, %d steals, %d virtualized, %d rejected"),
+				*UEnum::GetDisplayValueAsText(Category).ToString(), Stats.NumComponents, Stats.NumPlaying, Stats.NumVirtual,
+				Stats.Hits, Stats.Misses, Stats.Steals, Stats.Virtualized, Stats.Rejected);
+		}
+	}
+
+	FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("au.Voices.Stats"),
+		TEXT("Logs each voice category's pool size, playing and virtual voices, and its hit/miss counters."),
+		FConsoleCommandWithWorldDelegate::CreateStatic(&Run));
+}
+
+#endif
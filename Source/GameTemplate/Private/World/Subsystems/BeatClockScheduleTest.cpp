@@ -0,0 +1,132 @@
+﻿// © Anastasis Marinos //
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Audio/TempoMap.h"
+#include "World/Subsystems/BeatClockSubsystem.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace BeatClockScheduleTest
+{
+	constexpr double SampleRate = 48000.0;
+	constexpr int32  BlockSize  = 512;
+
+	/**
+	 * Replays the beat clock callback by callback against a stand-in for the Quartz clock: the clock
+	 * counts frames at the tempo it was last set to and a retime takes effect on the next beat
+	 * boundary; each beat is handed to the schedule before the next one fires, as HandleMetronome is.
+	 * Returns the worst distance, in ms, between the frame a beat fired on and ExpectedTime(Beat).
+	 */
+	double Replay(FBeatClockSchedule& Schedule, double Minutes, TFunctionRef<float(int32)> FollowBPM, TFunctionRef<double(int32)> ExpectedTime, double& OutGridErrorMs, int32& OutTempoMismatches)
+	{
+		float  ClockBPM      = Schedule.GetBPM();
+		float  PendingBPM    = 0.f;
+		int32  PendingBeat   = 0;
+		double NextBeatFrame = 0.0;
+		int32  Beat          = 0;
+		double MaxErrorMs    = 0.0;
+		OutGridErrorMs       = 0.0;
+		OutTempoMismatches   = 0;
+
+		if (Schedule.Schedule(1, FollowBPM(1)))
+		{
+			PendingBPM  = Schedule.GetScheduledBPM();
+			PendingBeat = 1;
+		}
+
+		const int64 TotalFrames = static_cast<int64>(Minutes * 60.0 * SampleRate);
+		for (int64 Frame = 0; Frame < TotalFrames; Frame += BlockSize)
+		{
+			while (NextBeatFrame < Frame + BlockSize)
+			{
+				// Quartz side: the beat fires on its frame, then runs at the tempo pending for it
+				const double FiredSeconds = FMath::CeilToDouble(NextBeatFrame) / SampleRate;
+				MaxErrorMs = FMath::Max(MaxErrorMs, FMath::Abs(FiredSeconds - ExpectedTime(Beat)) * 1000.0);
+				if (PendingBPM > 0.f && PendingBeat <= Beat)
+				{
+					ClockBPM   = PendingBPM;
+					PendingBPM = 0.f;
+				}
+				NextBeatFrame += SampleRate * 60.0 / ClockBPM;
+
+				// Game side, as HandleMetronome: the beat begins, the next one is scheduled
+				Schedule.BeginBeat(Beat);
+				if (Schedule.GetBPM() != ClockBPM)
+				{
+					// The playing tempo has to be the one the clock runs this beat at, not the next one's
+					++OutTempoMismatches;
+				}
+				OutGridErrorMs = FMath::Max(OutGridErrorMs, FMath::Abs(FiredSeconds - Schedule.GetBeatTime(Beat)) * 1000.0);
+				if (Schedule.Schedule(Beat + 1, FollowBPM(Beat + 1)))
+				{
+					PendingBPM  = Schedule.GetScheduledBPM();
+					PendingBeat = Beat + 1;
+				}
+				++Beat;
+			}
+		}
+		return MaxErrorMs;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBeatClockScheduleDriftTest, "GameTemplate.Audio.BeatClock.ScheduleDrift",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBeatClockScheduleDriftTest::RunTest(const FString& Parameters)
+{
+	using namespace BeatClockScheduleTest;
+
+	// An hour of the show's stages, tempo and meter changing on bar lines
+	UTempoMap* TempoMap = NewObject<UTempoMap>();
+	const FIntVector Stages[] = { { 0, 150, 4 }, { 16, 141, 7 }, { 40, 97, 6 }, { 72, 173, 5 }, { 400, 128, 4 }, { 1200, 150, 4 } };
+	for (const FIntVector& Stage : Stages)
+	{
+		FTempoChange& Change = TempoMap->Changes.AddDefaulted_GetRef();
+		Change.StartBar    = Stage.X;
+		Change.BPM         = Stage.Y + 0.3f * (Stage.X % 3); // some tempos that aren't a whole number of frames per beat
+		Change.BeatsPerBar = Stage.Z;
+	}
+	TempoMap->Compile();
+
+	FBeatClockSchedule Schedule;
+	Schedule.Start(TempoMap);
+
+	double GridErrorMs = 0.0;
+	int32  TempoMismatches = 0;
+	const double MapErrorMs = Replay(Schedule, 60.0,
+		[](int32) { return 0.f; },
+		[TempoMap](int32 Beat) { return TempoMap->BeatToTime(Beat); },
+		GridErrorMs, TempoMismatches);
+
+	TestTrue(FString::Printf(TEXT("Beats stay within 1 ms of the tempo map over 60 minutes (worst %.4f ms)"), MapErrorMs), MapErrorMs < 1.0);
+	TestTrue(FString::Printf(TEXT("Played grid matches the clock (worst %.4f ms)"), GridErrorMs), GridErrorMs < 1.0);
+	TestEqual(TEXT("Beats whose playing tempo isn't the clock's"), TempoMismatches, 0);
+	TestEqual(TEXT("Playing tempo after the last change"), Schedule.GetBPM(), TempoMap->Changes.Last().BPM);
+
+	// Scheduling the coming beat's change leaves the playing tempo alone until that beat starts
+	constexpr int32 ChangeBeat = 16 * 4; // bar 16, after the opening 4/4
+	Schedule.Start(TempoMap);
+	Schedule.BeginBeat(ChangeBeat - 1);
+	TestTrue(TEXT("Change is scheduled a beat ahead"), Schedule.Schedule(ChangeBeat));
+	TestEqual(TEXT("Playing tempo before the change"), Schedule.GetBPM(), TempoMap->GetBPMAtBeat(ChangeBeat - 1));
+	TestEqual(TEXT("Scheduled tempo before the change"), Schedule.GetScheduledBPM(), TempoMap->GetBPMAtBeat(ChangeBeat));
+	Schedule.BeginBeat(ChangeBeat);
+	TestEqual(TEXT("Playing tempo once the change's beat starts"), Schedule.GetBPM(), TempoMap->GetBPMAtBeat(ChangeBeat));
+
+	// Following the music: a wandering tempo; the grid played so far has to keep up, and predict
+	// each beat before it fires
+	Schedule.Start(TempoMap);
+	const double PredictErrorMs = Replay(Schedule, 10.0,
+		[](int32 Beat) { return 120.f + 8.f * FMath::Sin(Beat * 0.05f); },
+		[&Schedule](int32 Beat) { return Schedule.GetBeatTime(Beat); },
+		GridErrorMs, TempoMismatches);
+
+	TestTrue(FString::Printf(TEXT("Played grid follows a retimed clock (worst %.4f ms)"), GridErrorMs), GridErrorMs < 1.0);
+	TestTrue(FString::Printf(TEXT("Next beat predicted from the played grid (worst %.4f ms)"), PredictErrorMs), PredictErrorMs < 1.0);
+	TestEqual(TEXT("Followed beats whose playing tempo isn't the clock's"), TempoMismatches, 0);
+
+	return true;
+}
+
+#endif
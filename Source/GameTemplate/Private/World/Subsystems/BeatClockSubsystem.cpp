@@ -0,0 +1,437 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Subsystems/BeatClockSubsystem.h"
+#include "AudioDevice.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Quartz/QuartzSubsystem.h"
+#include "Audio/TempoMap.h"
+
+namespace BeatClock
+{
+	// Meter the Quartz clock itself runs in; only used to turn its bar/beat pair back into a beat count
+	constexpr int32 QuartzBeatsPerBar = 4;
+
+	// Following the music: each beat is shortened by PhaseGain x the phase error, at most
+	// MaxCorrection of a beat
+	constexpr float PhaseGain     = 0.5f;
+	constexpr float MaxCorrection = 0.1f;
+
+	static bool bLogDrift = false;
+	static FAutoConsoleVariableRef CVarLogDrift(
+		TEXT("au.BeatClock.LogDrift"),
+		bLogDrift,
+		TEXT("Log, every bar, how far the beat clock's audio transport time is from the ideal grid."));
+}
+
+void FBeatClockSchedule::Start(const UTempoMap* InTempoMap)
+{
+	TempoMap      = InTempoMap;
+	CurrentBPM    = TempoMap ? TempoMap->GetBPMAtBeat(0) : 120.f;
+	ScheduledBPM  = CurrentBPM;
+	ScheduledBeat = 0;
+	AnchorBeat    = 0;
+	AnchorSeconds = 0.0;
+}
+
+bool FBeatClockSchedule::Schedule(int32 NextBeat, float FollowBPM, float Correction)
+{
+	float NextBPM = TempoMap ? TempoMap->GetBPMAtBeat(NextBeat) : ScheduledBPM;
+	if (FollowBPM > 0.f)
+	{
+		// The detected tempo, with the coming beat shortened by Correction beats
+		NextBPM = FollowBPM / (1.f - Correction);
+	}
+
+	// A change too small to send keeps the tempo scheduled before, as the clock does
+	ScheduledBeat = NextBeat;
+	if (FMath::IsNearlyEqual(NextBPM, ScheduledBPM)) return false;
+
+	ScheduledBPM = NextBPM;
+	return true;
+}
+
+void FBeatClockSchedule::BeginBeat(int32 Beat)
+{
+	if (Beat <= AnchorBeat) return;
+
+	// Every beat since the anchor ran at the tempo playing then
+	AnchorSeconds += (Beat - AnchorBeat) * 60.0 / CurrentBPM;
+	AnchorBeat     = Beat;
+	if (ScheduledBeat <= Beat)
+	{
+		CurrentBPM = ScheduledBPM;
+	}
+}
+
+float FBeatClockSchedule::CorrectPhase(float MusicPhase, float ClockPhase, float Pending)
+{
+	float Error = MusicPhase - ClockPhase;
+	Error -= FMath::RoundToFloat(Error); // -0.5..0.5 beats, > 0: the music is ahead
+
+	Error -= Pending;
+	return FMath::Clamp(BeatClock::PhaseGain * Error, -BeatClock::MaxCorrection, BeatClock::MaxCorrection);
+}
+
+double FBeatClockSchedule::GetBeatTime(int32 Beat) const
+{
+	return AnchorSeconds + (Beat - AnchorBeat) * 60.0 / CurrentBPM;
+}
+
+double FBeatClockSchedule::GetBeatAtTime(double Seconds) const
+{
+	return AnchorBeat + (Seconds - AnchorSeconds) * CurrentBPM / 60.0;
+}
+
+UBeatClockSubsystem* UBeatClockSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UBeatClockSubsystem>() : nullptr;
+}
+
+bool UBeatClockSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBeatClockSubsystem::Deinitialize()
+{
+	StopFollowingMusic();
+	StopClock();
+	ClockHandle = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UBeatClockSubsystem::StartClock(float InBPM, int32 InBeatsPerBar)
+{
+	StartClockWithTempoMap(UTempoMap::MakeConstant(this, InBPM, InBeatsPerBar));
+}
+
+void UBeatClockSubsystem::StartClockWithTempoMap(UTempoMap* InTempoMap)
+{
+	if (!InTempoMap)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BeatClockSubsystem: No tempo map, beat clock not started."));
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	UQuartzSubsystem* Quartz = UQuartzSubsystem::Get(World);
+	if (!Quartz)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BeatClockSubsystem: Quartz is not available, beat clock not started."));
+		return;
+	}
+
+	TempoMap      = InTempoMap;
+	PulsesPerBeat = 4; // beat = quarter note, pulse = sixteenth
+
+	// Quartz keeps a fixed meter and only counts beats; bars come from the tempo map
+	FQuartzClockSettings Settings;
+	Settings.TimeSignature.NumBeats = BeatClock::QuartzBeatsPerBar;
+	Settings.TimeSignature.BeatType = EQuartzTimeSignatureQuantization::QuarterNote;
+
+	ClockHandle = Quartz->CreateNewClock(World, ClockName, Settings, true);
+	if (!ClockHandle)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BeatClockSubsystem: Could not create Quartz clock (no audio device?)."));
+		return;
+	}
+
+	UQuartzClockHandle* Handle = ClockHandle;
+	if (bRunning)
+	{
+		Handle->StopClock(World, true, Handle);
+	}
+
+	Schedule.Start(TempoMap);
+
+	FQuartzQuantizationBoundary Immediately;
+	Immediately.Quantization = EQuartzCommandQuantization::None;
+	Handle->SetBeatsPerMinute(World, Immediately, FOnQuartzCommandEventBP(), Handle, Schedule.GetBPM());
+
+	// The handle outlives restarts: drop the last run's subscriptions so each beat fires once
+	Handle->UnsubscribeFromAllTimeDivisions(World, Handle);
+
+	FOnQuartzMetronomeEventBP Metronome;
+	Metronome.BindUFunction(this, GET_FUNCTION_NAME_CHECKED(UBeatClockSubsystem, HandleMetronome));
+	for (const EQuartzCommandQuantization Boundary : { EQuartzCommandQuantization::Beat, EQuartzCommandQuantization::SixteenthNote })
+	{
+		Handle->SubscribeToQuantizationEvent(World, Boundary, Metronome, Handle);
+	}
+
+	Handle->ResetTransport(World, FOnQuartzCommandEventBP());
+	Handle->StartClock(World, Handle);
+
+	LastTime   = FBeatClockTime();
+	DriftMinMs = DriftMaxMs = 0.0;
+	bRunning   = true;
+
+	PendingCorrection = 0.f;
+
+	ScheduleTempoForBeat(1);
+}
+
+void UBeatClockSubsystem::StopClock()
+{
+	if (ClockHandle && bRunning)
+	{
+		UQuartzClockHandle* Handle = ClockHandle;
+		Handle->StopClock(GetWorld(), true, Handle);
+		Handle->UnsubscribeFromAllTimeDivisions(GetWorld(), Handle);
+	}
+	bRunning = false;
+}
+
+void UBeatClockSubsystem::FollowMusic(USoundSubmix* Submix)
+{
+	StopFollowingMusic();
+	if (!Submix) return;
+
+	UWorld* World = GetWorld();
+	FAudioDeviceHandle AudioDevice = World ? World->GetAudioDevice() : FAudioDeviceHandle();
+	if (!AudioDevice.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BeatClockSubsystem: no audio device, can't follow %s."), *Submix->GetName());
+		return;
+	}
+
+	FollowSubmix = Submix;
+	StartFollowTap(static_cast<int32>(AudioDevice->GetSampleRate()));
+
+	// The schedule's played grid carries on from the map's
+	FollowBPM = 0.f;
+}
+
+void UBeatClockSubsystem::StopFollowingMusic()
+{
+	if (!FollowTap.IsValid()) return;
+
+	USoundSubmix* Submix = FollowSubmix.Get();
+	UWorld* World = GetWorld();
+	FAudioDeviceHandle AudioDevice = World ? World->GetAudioDevice() : FAudioDeviceHandle();
+	if (Submix && AudioDevice.IsValid())
+	{
+		AudioDevice->UnregisterSubmixBufferListener(FollowTap.ToSharedRef(), *Submix);
+	}
+
+	FollowTap.Reset();
+	FollowSubmix.Reset();
+	PendingCorrection = 0.f;
+}
+
+FBeatClockTime UBeatClockSubsystem::GetCurrentTime() const
+{
+	FBeatClockTime Time = LastTime;
+	if (ClockHandle && bRunning)
+	{
+		Time.BeatPhase = ClockHandle->GetBeatProgressPercent(EQuartzCommandQuantization::Beat);
+	}
+	return Time;
+}
+
+int32 UBeatClockSubsystem::GetBeatsPerBar() const
+{
+	return TempoMap ? TempoMap->GetBeatsPerBarAtBeat(LastTime.BeatIndex) : 4;
+}
+
+float UBeatClockSubsystem::GetTimeUntilNextBeat() const
+{
+	return (1.f - GetCurrentTime().BeatPhase) * GetSecondsPerBeat();
+}
+
+double UBeatClockSubsystem::GetTransportSeconds() const
+{
+	return ClockHandle && bRunning ? ClockHandle->GetCurrentTimestamp(GetWorld()).Seconds : 0.0;
+}
+
+double UBeatClockSubsystem::GetBeatTime(int32 Beat) const
+{
+	if (IsFollowingMusic())
+	{
+		return Schedule.GetBeatTime(Beat);
+	}
+	return TempoMap ? TempoMap->BeatToTime(Beat) : 0.0;
+}
+
+int32 UBeatClockSubsystem::GetNextBoundaryBeat(bool bOnBar) const
+{
+	if (!TempoMap) return LastTime.BeatIndex + 1;
+
+	const FTempoMapPosition Position = GetTransportPosition();
+	if (!bOnBar)
+	{
+		return Position.Beat + 1;
+	}
+
+	// Meter changes sit on bar lines, so the current segment's bar length reaches the next one
+	return Position.Beat + TempoMap->GetBeatsPerBarAtBeat(Position.Beat) - Position.BeatInBar;
+}
+
+FQuartzQuantizationBoundary UBeatClockSubsystem::MakeBoundaryForBeat(int32 Beat) const
+{
+	const int32 CurrentBeat = TempoMap ? GetTransportPosition().Beat : LastTime.BeatIndex;
+
+	// Quartz's own bars are a fixed 4/4, so bar lines from the map are reached by counting beats
+	FQuartzQuantizationBoundary Boundary;
+	Boundary.Quantization           = EQuartzCommandQuantization::Beat;
+	Boundary.Multiplier             = static_cast<float>(FMath::Max(1, Beat - CurrentBeat));
+	Boundary.CountingReferencePoint = EQuarztQuantizationReference::CurrentTimeRelative;
+	Boundary.bCancelCommandIfClockIsNotRunning = true;
+	return Boundary;
+}
+
+/* ---------------- Internals ---------------- */
+
+void UBeatClockSubsystem::HandleMetronome(FName InClockName, EQuartzCommandQuantization QuantizationType, int32 NumBars, int32 Beat, float BeatFraction)
+{
+	if (InClockName != ClockName) return;
+
+	// Quartz counts bars and beats from 1, in its own fixed meter
+	const int32 QuartzBeat = FMath::Max(0, NumBars - 1) * BeatClock::QuartzBeatsPerBar + FMath::Clamp(Beat - 1, 0, BeatClock::QuartzBeatsPerBar - 1);
+	const FTempoMapPosition Position = TempoMap ? TempoMap->BeatToPosition(QuartzBeat) : FTempoMapPosition();
+
+	FBeatClockTime Time;
+	Time.BeatIndex  = QuartzBeat;
+	Time.Bar        = Position.Bar;
+	Time.BeatInBar  = Position.BeatInBar;
+	Time.BeatPhase  = FMath::Frac(BeatFraction);
+	Time.PulseIndex = Time.BeatIndex * PulsesPerBeat + FMath::Clamp(FMath::FloorToInt(Time.BeatPhase * PulsesPerBeat + 0.5f), 0, PulsesPerBeat - 1);
+	LastTime = Time;
+
+	switch (QuantizationType)
+	{
+	case EQuartzCommandQuantization::SixteenthNote:
+		OnPulse.Broadcast(Time);
+		break;
+
+	case EQuartzCommandQuantization::Beat:
+		Schedule.BeginBeat(Time.BeatIndex);
+		if (IsFollowingMusic())
+		{
+			UpdateFollow(Time.BeatIndex);
+		}
+		ScheduleTempoForBeat(Time.BeatIndex + 1);
+
+		if (Time.BeatInBar == 0)
+		{
+			OnBar.Broadcast(Time);
+		}
+		OnBeat.Broadcast(Time);
+		OnBeatBP.Broadcast(Time);
+
+		if (BeatClock::bLogDrift)
+		{
+			TrackDrift(Time);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UBeatClockSubsystem::ScheduleTempoForBeat(int32 NextBeat)
+{
+	if (!TempoMap || !ClockHandle) return;
+
+	const float Follow = IsFollowingMusic() ? FollowBPM : 0.f;
+	if (!Schedule.Schedule(NextBeat, Follow, PendingCorrection)) return;
+
+	// Applied by the render thread exactly on the coming beat boundary
+	FQuartzQuantizationBoundary OnNextBeat;
+	OnNextBeat.Quantization = EQuartzCommandQuantization::Beat;
+
+	UQuartzClockHandle* Handle = ClockHandle;
+	Handle->SetBeatsPerMinute(GetWorld(), OnNextBeat, FOnQuartzCommandEventBP(), Handle, Schedule.GetScheduledBPM());
+}
+
+void UBeatClockSubsystem::UpdateFollow(int32 Beat)
+{
+	if (const int32 DeviceRate = FollowTap->GetMismatchedRate())
+	{
+		// The device came back at another rate and the tap went quiet: hold the tempo, start over
+		StartFollowTap(DeviceRate);
+		return;
+	}
+
+	FTempoEstimate Latest;
+	if (FollowTap->PopLatest(Latest))
+	{
+		Detected = Latest;
+	}
+	if (!Detected.IsValid() || Detected.Confidence < FBeatClockSchedule::MinFollowConfidence || !ClockHandle)
+	{
+		// Nothing trustworthy yet: keep the tempo the clock has
+		PendingCorrection = 0.f;
+		return;
+	}
+	FollowBPM = Detected.BPM;
+
+	// Detected beat phase against the clock's, both read off the audio device clock
+	UWorld* World = GetWorld();
+	FAudioDeviceHandle AudioDevice = World ? World->GetAudioDevice() : FAudioDeviceHandle();
+	const double Now = AudioDevice.IsValid() ? AudioDevice->GetAudioClock() : Detected.StreamSeconds;
+
+	PendingCorrection = FBeatClockSchedule::CorrectPhase(Detected.GetPhaseAt(Now), ClockHandle->GetBeatProgressPercent(EQuartzCommandQuantization::Beat), PendingCorrection);
+}
+
+void UBeatClockSubsystem::StartFollowTap(int32 SampleRate)
+{
+	USoundSubmix* Submix = FollowSubmix.Get();
+	UWorld* World = GetWorld();
+	FAudioDeviceHandle AudioDevice = World ? World->GetAudioDevice() : FAudioDeviceHandle();
+	if (!Submix || !AudioDevice.IsValid()) return;
+
+	if (FollowTap.IsValid())
+	{
+		AudioDevice->UnregisterSubmixBufferListener(FollowTap.ToSharedRef(), *Submix);
+	}
+
+	// The tempo the clock runs at now (the hand-set BPM or the map) settles octave ambiguity
+	FOnsetTempoSettings Settings;
+	Settings.PriorBPM = Schedule.GetBPM();
+
+	// Game thread: the tracker allocates its buffers here, never on the render thread
+	FollowTap = MakeShared<FTempoTrackerTap, ESPMode::ThreadSafe>(Settings, SampleRate);
+	AudioDevice->RegisterSubmixBufferListener(FollowTap.ToSharedRef(), *Submix);
+
+	Detected          = FTempoEstimate();
+	PendingCorrection = 0.f;
+}
+
+FTempoMapPosition UBeatClockSubsystem::GetTransportPosition() const
+{
+	const double Seconds = GetTransportSeconds();
+	if (!IsFollowingMusic())
+	{
+		return TempoMap->TimeToPosition(Seconds);
+	}
+
+	// Following: counted on the grid the clock actually played, with the map's bars
+	const double Beats = Schedule.GetBeatAtTime(Seconds);
+	FTempoMapPosition Position = TempoMap->BeatToPosition(FMath::Max(0, FMath::FloorToInt32(Beats)));
+	Position.Phase = static_cast<float>(FMath::Frac(Beats));
+	return Position;
+}
+
+void UBeatClockSubsystem::TrackDrift(const FBeatClockTime& Time)
+{
+	if (!ClockHandle || !TempoMap) return;
+
+	// Transport seconds come from the audio render clock; the difference to the grid is delivery
+	// latency plus any drift. Latency is bounded, so a growing spread is drift.
+	const FQuartzTransportTimeStamp Stamp = ClockHandle->GetCurrentTimestamp(GetWorld());
+	const double ErrorMs = (Stamp.Seconds - GetBeatTime(Time.BeatIndex)) * 1000.0;
+
+	DriftMinMs = Time.BeatIndex == 0 ? ErrorMs : FMath::Min(DriftMinMs, ErrorMs);
+	DriftMaxMs = Time.BeatIndex == 0 ? ErrorMs : FMath::Max(DriftMaxMs, ErrorMs);
+
+	if (Time.BeatInBar == 0)
+	{
+		UE_LOG(LogTemp, Display, TEXT("BeatClock bar %d: transport - grid = %.3f ms (min %.3f, max %.3f, spread %.3f)"),
+			Time.Bar, ErrorMs, DriftMinMs, DriftMaxMs, DriftMaxMs - DriftMinMs);
+	}
+}
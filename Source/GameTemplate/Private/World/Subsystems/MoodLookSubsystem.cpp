@@ -0,0 +1,32 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Subsystems/MoodLookSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "World/Managers/MoodLookTable.h"
+
+UMoodLookSubsystem* UMoodLookSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UMoodLookSubsystem>() : nullptr;
+}
+
+bool UMoodLookSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+UMoodLookTable* UMoodLookSubsystem::GetDefaultLooks(UObject* WorldContextObject)
+{
+	UMoodLookSubsystem* Subsystem = Get(WorldContextObject);
+	if (!Subsystem)
+	{
+		return UMoodLookTable::MakeDefault(WorldContextObject);
+	}
+
+	if (!Subsystem->DefaultLooks)
+	{
+		Subsystem->DefaultLooks = UMoodLookTable::MakeDefault(Subsystem);
+	}
+	return Subsystem->DefaultLooks;
+}
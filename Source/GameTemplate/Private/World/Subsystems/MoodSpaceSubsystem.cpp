@@ -0,0 +1,237 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Subsystems/MoodSpaceSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "World/Managers/AudioSnapshotManager.h"
+#include "World/Managers/LightSnapshotManager.h"
+#include "World/Managers/MoodLookTable.h"
+#include "World/Managers/PostProcessSnapshotManager.h"
+#include "World/Managers/SnapshotBlender.h"
+#include "World/Subsystems/SnapshotMixerSubsystem.h"
+#include "World/Subsystems/StageRegistrySubsystem.h"
+
+UMoodSpaceSubsystem* UMoodSpaceSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UMoodSpaceSubsystem>() : nullptr;
+}
+
+bool UMoodSpaceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UMoodSpaceSubsystem::Deinitialize()
+{
+	Stop();
+	Super::Deinitialize();
+}
+
+void UMoodSpaceSubsystem::SetOutputs(AAudioSnapshotManager* InAudio, APostProcessSnapshotManager* InPost, ALightSnapshotManager* InLight)
+{
+	if (InAudio) AudioOutput = InAudio;
+	if (InPost)  PostOutput  = InPost;
+	if (InLight) LightOutput = InLight;
+}
+
+void UMoodSpaceSubsystem::SetMoodLooks(UMoodLookTable* InMoodLooks)
+{
+	MoodLooks   = InMoodLooks;
+	bLooksBuilt = false;
+}
+
+void UMoodSpaceSubsystem::RefreshLooks()
+{
+	bLooksBuilt = false;
+	if (!bDriving) return;
+
+	BuildLooks();
+	PushAt(LastAlpha, true);
+}
+
+bool UMoodSpaceSubsystem::HasLooks() const
+{
+	return MoodLooks && MoodLooks->GetSpaceLooks().Num() > 0;
+}
+
+void UMoodSpaceSubsystem::MoveTo(FVector2D InPosition, float Seconds)
+{
+	ResolveOutputs();
+	if (!bLooksBuilt)
+	{
+		BuildLooks();
+	}
+	if (!HasLooks())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("MoodSpace: no looks are placed in the mood space."));
+		return;
+	}
+
+	const FVector2f Target(InPosition);
+	if (bDriving)
+	{
+		// Carry on from wherever the glide and the fade are now
+		From     = Position;
+		FadeFrom = Fade;
+	}
+	else
+	{
+		// Take the outputs from the snapshot mixer and fade in over what they show now
+		if (USnapshotMixerSubsystem* Mixer = USnapshotMixerSubsystem::Get(this))
+		{
+			Mixer->ClearLayers();
+		}
+		CaptureInitial();
+		From     = Target;
+		FadeFrom = 0.f;
+		bDriving = true;
+	}
+	To           = Target;
+	MoveDuration = Seconds <= 0.015f ? 0.f : Seconds;
+	LastAlpha    = 0.f;
+
+	USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this);
+	if (MoveDuration <= 0.f || !Blends)
+	{
+		if (Blends)
+		{
+			Blends->CancelBlend(this);
+		}
+		StepSnapshotBlend(1.f);
+		return;
+	}
+
+	Blends->BeginBlend(this, this, MoveDuration);
+}
+
+void UMoodSpaceSubsystem::Stop()
+{
+	if (USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this))
+	{
+		Blends->CancelBlend(this);
+	}
+	bDriving = false;
+}
+
+void UMoodSpaceSubsystem::StepSnapshotBlend(float Alpha)
+{
+	PushAt(Alpha, Alpha >= 1.f);
+
+	if (Alpha >= 1.f)
+	{
+		UE_LOG(LogTemp, Verbose, TEXT("MoodSpace: settled at (%.2f, %.2f)"), Position.X, Position.Y);
+	}
+}
+
+/* ---------------- Internals ---------------- */
+
+void UMoodSpaceSubsystem::ResolveOutputs()
+{
+	const UStageRegistrySubsystem* Registry = UStageRegistrySubsystem::Get(this);
+	if (!Registry) return;
+
+	if (!AudioOutput.IsValid()) AudioOutput = Registry->GetFirst<AAudioSnapshotManager>();
+	if (!PostOutput.IsValid())  PostOutput  = Registry->GetFirst<APostProcessSnapshotManager>();
+	if (!LightOutput.IsValid()) LightOutput = Registry->GetFirst<ALightSnapshotManager>();
+}
+
+void UMoodSpaceSubsystem::BuildLooks()
+{
+	const FSnapshotFieldLayout& AudioLayout = TSnapshotBlender<FSnapshotTargets>::GetLayout();
+	const FSnapshotFieldLayout& ColorLayout = TSnapshotBlender<FLinearColor>::GetLayout();
+	NumAudioLanes = AudioLayout.NumLanes();
+	NumLanes      = NumAudioLanes + ColorLayout.NumLanes();
+
+	const int32 NumLooks = MoodLooks ? MoodLooks->GetSpaceLooks().Num() : 0;
+	Looks.SetNumZeroed(NumLooks * NumLanes);
+	Mixed.SetNumZeroed(NumLanes);
+	Delta.SetNumZeroed(NumLanes);
+	PostLooks.SetNum(NumLooks);
+
+	for (int32 i = 0; i < NumLooks; ++i)
+	{
+		const FMoodSpacePoint& Point = MoodLooks->GetSpaceLooks()[i];
+		AudioLayout.Pack(&Point.Audio, &Looks[i * NumLanes]);
+		ColorLayout.Pack(&Point.Light, &Looks[i * NumLanes + NumAudioLanes]);
+		PostLooks[i] = APostProcessSnapshotManager::BuildLookSettings(Point.Post);
+	}
+
+	// The post layers hold copies of the old looks
+	if (APostProcessSnapshotManager* Post = PostOutput.Get())
+	{
+		Post->InvalidateMixedLooks();
+	}
+
+	bLooksBuilt = true;
+}
+
+void UMoodSpaceSubsystem::CaptureInitial()
+{
+	const AAudioSnapshotManager* Audio = AudioOutput.Get();
+	const ALightSnapshotManager* Light = LightOutput.Get();
+	const FSnapshotTargets Targets = Audio ? Audio->GetCurrentTargets() : FSnapshotTargets();
+	const FLinearColor     Color   = Light ? Light->GetCurrentColor() : FLinearColor::White;
+
+	Initial.SetNumZeroed(NumLanes);
+	TSnapshotBlender<FSnapshotTargets>::GetLayout().Pack(&Targets, Initial.GetData());
+	TSnapshotBlender<FLinearColor>::GetLayout().Pack(&Color, Initial.GetData() + NumAudioLanes);
+}
+
+void UMoodSpaceSubsystem::PushAt(float Alpha, bool bExact)
+{
+	if (!HasLooks() || NumLanes == 0) return;
+
+	const float RampSeconds = FMath::Max(0.f, Alpha - LastAlpha) * MoveDuration;
+	LastAlpha = Alpha;
+	Position  = FMath::Lerp(From, To, Alpha);
+	Fade      = FMath::Lerp(FadeFrom, 1.f, Alpha);
+	Weights   = MoodLooks->GetMoodSpace().Locate(Position);
+
+	// Mixed = sum of the (up to) three looks by weight, with the same lane kernel as the blenders
+	Mixed.SetNumUninitialized(NumLanes);
+	FMemory::Memzero(Mixed.GetData(), NumLanes * sizeof(float));
+	for (int32 k = 0; k < 3; ++k)
+	{
+		if (Weights.Points[k] != INDEX_NONE && Weights.Weights[k] > 0.f)
+		{
+			SnapshotLerpLanes(Mixed.GetData(), &Looks[Weights.Points[k] * NumLanes], Weights.Weights[k], Mixed.GetData(), NumLanes);
+		}
+	}
+
+	// Taking over: Initial + (Mixed - Initial) * Fade
+	if (Fade < 1.f && Initial.Num() == NumLanes)
+	{
+		SnapshotLerpLanes(Mixed.GetData(), Initial.GetData(), -1.f, Delta.GetData(), NumLanes);
+		SnapshotLerpLanes(Initial.GetData(), Delta.GetData(), Fade, Mixed.GetData(), NumLanes);
+	}
+
+	if (AAudioSnapshotManager* Audio = AudioOutput.Get())
+	{
+		FSnapshotTargets Targets;
+		TSnapshotBlender<FSnapshotTargets>::GetLayout().Unpack(Mixed.GetData(), &Targets);
+		Audio->ApplyMixedTargets(Targets, bExact, RampSeconds);
+	}
+
+	if (ALightSnapshotManager* Light = LightOutput.Get())
+	{
+		FLinearColor Color;
+		TSnapshotBlender<FLinearColor>::GetLayout().Unpack(Mixed.GetData() + NumAudioLanes, &Color);
+		Light->ApplyMixedColor(Color, bExact);
+	}
+
+	if (APostProcessSnapshotManager* Post = PostOutput.Get())
+	{
+		TArray<const FPostProcessSettings*, TInlineAllocator<3>> PostMix;
+		TArray<float, TInlineAllocator<3>> PostWeights;
+		for (int32 k = 0; k < 3; ++k)
+		{
+			if (Weights.Points[k] != INDEX_NONE)
+			{
+				PostMix.Add(&PostLooks[Weights.Points[k]]);
+				PostWeights.Add(Weights.Weights[k] * Fade);
+			}
+		}
+		Post->ApplyWeightedLooks(PostMix, PostWeights);
+	}
+}
@@ -0,0 +1,188 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Subsystems/SnapshotBlendSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+void FSnapshotBlendTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target)
+	{
+		Target->StepBlends(DeltaTime);
+	}
+}
+
+FString FSnapshotBlendTickFunction::DiagnosticMessage()
+{
+	return TEXT("FSnapshotBlendTickFunction");
+}
+
+FName FSnapshotBlendTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("SnapshotBlendSubsystem"));
+}
+
+USnapshotBlendSubsystem* USnapshotBlendSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	return World ? World->GetSubsystem<USnapshotBlendSubsystem>() : nullptr;
+}
+
+bool USnapshotBlendSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void USnapshotBlendSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Runs after the timers that fire narration lines, so a line's three looks step in the frame they start
+	BlendTickFunction.Target                   = this;
+	BlendTickFunction.TickGroup                = TG_PostUpdateWork;
+	BlendTickFunction.EndTickGroup             = TG_PostUpdateWork;
+	BlendTickFunction.bCanEverTick             = true;
+	BlendTickFunction.bStartWithTickEnabled    = false;
+	BlendTickFunction.bTickEvenWhenPaused      = false;
+	BlendTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+
+	// Blends may have been requested before BeginPlay reached us
+	SetAwake(ActiveBlends.Num() > 0);
+}
+
+void USnapshotBlendSubsystem::Deinitialize()
+{
+	if (BlendTickFunction.IsTickFunctionRegistered())
+	{
+		BlendTickFunction.UnRegisterTickFunction();
+	}
+	BlendTickFunction.Target = nullptr;
+
+	ActiveBlends.Empty();
+	Groups.Empty();
+
+	Super::Deinitialize();
+}
+
+void USnapshotBlendSubsystem::BeginBlend(UObject* Owner, ISnapshotBlendChannel* Channel, float DurationSeconds)
+{
+	if (!Owner || !Channel) return;
+
+	const int32 Group = FindOrAddGroup(DurationSeconds);
+
+	FActiveBlend* Existing = ActiveBlends.FindByPredicate([Owner](const FActiveBlend& B) { return B.Owner.Get() == Owner; });
+	if (Existing)
+	{
+		Existing->Channel = Channel;
+		Existing->Group   = Group;
+	}
+	else
+	{
+		FActiveBlend& Blend = ActiveBlends.AddDefaulted_GetRef();
+		Blend.Owner   = Owner;
+		Blend.Channel = Channel;
+		Blend.Group   = Group;
+	}
+
+	SetAwake(true);
+}
+
+void USnapshotBlendSubsystem::CancelBlend(const UObject* Owner)
+{
+	ActiveBlends.RemoveAllSwap([Owner](const FActiveBlend& B) { return B.Owner.Get() == Owner; });
+	SetAwake(ActiveBlends.Num() > 0);
+}
+
+bool USnapshotBlendSubsystem::IsBlending(const UObject* Owner) const
+{
+	return ActiveBlends.ContainsByPredicate([Owner](const FActiveBlend& B) { return B.Owner.Get() == Owner; });
+}
+
+/* ---------------- Internals ---------------- */
+
+int32 USnapshotBlendSubsystem::FindOrAddGroup(float DurationSeconds)
+{
+	const uint64 Frame = GFrameCounter;
+	for (int32 i = 0; i < Groups.Num(); ++i)
+	{
+		if (Groups[i].StartFrame == Frame && FMath::IsNearlyEqual(Groups[i].Duration, DurationSeconds))
+		{
+			return i;
+		}
+	}
+
+	FBlendGroup& NewGroup = Groups.AddDefaulted_GetRef();
+	NewGroup.StartFrame = Frame;
+	NewGroup.Duration   = DurationSeconds;
+	NewGroup.Elapsed    = 0.f;
+	return Groups.Num() - 1;
+}
+
+void USnapshotBlendSubsystem::StepBlends(float DeltaSeconds)
+{
+	// One Alpha per group, computed once and handed to every channel in it
+	TArray<float, TInlineAllocator<8>> GroupAlpha;
+	GroupAlpha.SetNumUninitialized(Groups.Num());
+	for (int32 g = 0; g < Groups.Num(); ++g)
+	{
+		FBlendGroup& Group = Groups[g];
+		if (Group.StartFrame != GFrameCounter)
+		{
+			Group.Elapsed += DeltaSeconds;
+		}
+		GroupAlpha[g] = FMath::Clamp(Group.Elapsed / FMath::Max(Group.Duration, KINDA_SMALL_NUMBER), 0.f, 1.f);
+	}
+
+	// Channels may restart their own blend from inside a step; only walk what existed before
+	const int32 NumToStep = ActiveBlends.Num();
+	for (int32 i = 0; i < NumToStep; ++i)
+	{
+		const FActiveBlend Blend = ActiveBlends[i];
+		if (Blend.Owner.IsValid() && GroupAlpha.IsValidIndex(Blend.Group))
+		{
+			Blend.Channel->StepSnapshotBlend(GroupAlpha[Blend.Group]);
+		}
+	}
+
+	// Retire finished or orphaned blends
+	ActiveBlends.RemoveAllSwap([&GroupAlpha](const FActiveBlend& B)
+	{
+		return !B.Owner.IsValid() || (GroupAlpha.IsValidIndex(B.Group) && GroupAlpha[B.Group] >= 1.f);
+	});
+
+	// Compact groups that lost all members, in place (a live group only ever moves down)
+	TArray<int32, TInlineAllocator<8>> Remap;
+	Remap.Init(INDEX_NONE, Groups.Num());
+	for (const FActiveBlend& Blend : ActiveBlends)
+	{
+		Remap[Blend.Group] = 0;
+	}
+	int32 NumLive = 0;
+	for (int32 g = 0; g < Groups.Num(); ++g)
+	{
+		if (Remap[g] != INDEX_NONE)
+		{
+			Groups[NumLive] = Groups[g];
+			Remap[g] = NumLive++;
+		}
+	}
+	for (FActiveBlend& Blend : ActiveBlends)
+	{
+		Blend.Group = Remap[Blend.Group];
+	}
+	Groups.SetNum(NumLive, EAllowShrinking::No);
+
+	SetAwake(ActiveBlends.Num() > 0);
+}
+
+void USnapshotBlendSubsystem::SetAwake(bool bAwake)
+{
+	if (!bAwake)
+	{
+		Groups.Reset();
+	}
+	if (BlendTickFunction.IsTickFunctionRegistered() && BlendTickFunction.IsTickFunctionEnabled() != bAwake)
+	{
+		BlendTickFunction.SetTickFunctionEnable(bAwake);
+	}
+}
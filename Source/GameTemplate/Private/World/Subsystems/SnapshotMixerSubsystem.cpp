@@ -0,0 +1,396 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Subsystems/SnapshotMixerSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Algo/BinarySearch.h"
+#include "World/Managers/AudioSnapshotManager.h"
+#include "World/Managers/LightSnapshotManager.h"
+#include "World/Managers/PostProcessSnapshotManager.h"
+#include "World/Subsystems/StageRegistrySubsystem.h"
+
+USnapshotMixerSubsystem* USnapshotMixerSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	return World ? World->GetSubsystem<USnapshotMixerSubsystem>() : nullptr;
+}
+
+bool USnapshotMixerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void USnapshotMixerSubsystem::Deinitialize()
+{
+	if (USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this))
+	{
+		Blends->CancelBlend(this);
+	}
+	Layers.Empty();
+
+	Super::Deinitialize();
+}
+
+void USnapshotMixerSubsystem::SetOutputs(AAudioSnapshotManager* InAudio, APostProcessSnapshotManager* InPost, ALightSnapshotManager* InLight)
+{
+	if (InAudio) AudioOutput = InAudio;
+	if (InPost)  PostOutput  = InPost;
+	if (InLight) LightOutput = InLight;
+	bLooksBuilt = false;
+}
+
+void USnapshotMixerSubsystem::SetBaseSnapshot(EAudioSnapshot Snapshot, float BlendSeconds)
+{
+	AddLayer(Snapshot, BasePriority, ESnapshotLayerMode::Override, BlendSeconds, -1.f, 0.f);
+
+	// The room follows the base look only; overlays are too brief to move the walls
+	if (AAudioSnapshotManager* Audio = AudioOutput.Get())
+	{
+		Audio->CrossfadeRoom(Snapshot, BlendSeconds);
+	}
+}
+
+int32 USnapshotMixerSubsystem::PushOverlay(EAudioSnapshot Snapshot, int32 Priority, ESnapshotLayerMode Mode, float FadeInSeconds, float HoldSeconds, float FadeOutSeconds)
+{
+	return AddLayer(Snapshot, FMath::Max(Priority, BasePriority + 1), Mode, FadeInSeconds, HoldSeconds, FadeOutSeconds);
+}
+
+void USnapshotMixerSubsystem::ReleaseOverlay(int32 Handle, float FadeOutSeconds)
+{
+	FLayer* Layer = Layers.FindByPredicate([Handle](const FLayer& L) { return L.Handle == Handle; });
+	if (!Layer || Layer->Priority == BasePriority) return;
+
+	BeginChange();
+	if (Layer->ReleaseAt > 0.f)
+	{
+		Layer->ReleaseAt = 0.f;
+		if (FadeOutSeconds >= 0.f)
+		{
+			Layer->FadeOut = FadeOutSeconds;
+		}
+	}
+	FinishChange();
+}
+
+void USnapshotMixerSubsystem::ReleaseAllOverlays(float FadeOutSeconds)
+{
+	if (Layers.Num() == 0) return;
+
+	BeginChange();
+	for (FLayer& Layer : Layers)
+	{
+		if (Layer.Priority != BasePriority && Layer.ReleaseAt > 0.f)
+		{
+			Layer.ReleaseAt = 0.f;
+			Layer.FadeOut   = FMath::Max(0.f, FadeOutSeconds);
+		}
+	}
+	FinishChange();
+}
+
+void USnapshotMixerSubsystem::ClearLayers()
+{
+	if (USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this))
+	{
+		Blends->CancelBlend(this);
+	}
+	Layers.Reset();
+	ClockTime     = 0.f;
+	BlendDuration = 0.f;
+}
+
+void USnapshotMixerSubsystem::StepSnapshotBlend(float Alpha)
+{
+	StepAt(Alpha * BlendDuration, Alpha >= 1.f);
+
+	if (Alpha >= 1.f)
+	{
+		UE_LOG(LogTemp, Verbose, TEXT("SnapshotMixer: settled with %d layers"), Layers.Num());
+	}
+}
+
+/* ---------------- Internals ---------------- */
+
+void USnapshotMixerSubsystem::MakeLook(const FSnapshotTargets& Audio, const FLinearColor& Color, float* OutLanes) const
+{
+	FMemory::Memzero(OutLanes, NumLanes * sizeof(float));
+	TSnapshotBlender<FSnapshotTargets>::GetLayout().Pack(&Audio, OutLanes);
+	TSnapshotBlender<FLinearColor>::GetLayout().Pack(&Color, OutLanes + NumAudioLanes);
+}
+
+float USnapshotMixerSubsystem::WeightAt(const FLayer& Layer, float Time)
+{
+	auto Ramp = [&Layer](float T)
+	{
+		const float Alpha = Layer.RampDuration > 0.f ? FMath::Clamp((T - Layer.RampStart) / Layer.RampDuration, 0.f, 1.f) : (T >= Layer.RampStart ? 1.f : 0.f);
+		return FMath::Lerp(Layer.WeightFrom, Layer.WeightTo, Alpha);
+	};
+
+	if (Time < Layer.ReleaseAt)
+	{
+		return Ramp(Time);
+	}
+
+	// Fade out from whatever weight the layer had reached when it was released
+	const float Alpha = Layer.FadeOut > 0.f ? FMath::Clamp((Time - Layer.ReleaseAt) / Layer.FadeOut, 0.f, 1.f) : 1.f;
+	return FMath::Lerp(Ramp(Layer.ReleaseAt), 0.f, Alpha);
+}
+
+float USnapshotMixerSubsystem::SettleTime(const FLayer& Layer)
+{
+	return Layer.ReleaseAt < Held ? Layer.ReleaseAt + Layer.FadeOut : Layer.RampStart + Layer.RampDuration;
+}
+
+int32 USnapshotMixerSubsystem::AddLayer(EAudioSnapshot Snapshot, int32 Priority, ESnapshotLayerMode Mode, float FadeIn, float Hold, float FadeOut)
+{
+	ResolveOutputs();
+	if (!bLooksBuilt)
+	{
+		BuildLooks();
+	}
+	if (Layers.Num() == 0)
+	{
+		CaptureInitial();
+	}
+
+	BeginChange();
+
+	FadeIn  = FadeIn <= 0.015f ? 0.f : FadeIn;
+	FadeOut = FMath::Max(0.f, FadeOut);
+
+	// Preempt the layers at this priority from their current weight
+	for (FLayer& Old : Layers)
+	{
+		// Already on its way out
+		if (Old.Priority != Priority || Old.ReleaseAt <= 0.f) continue;
+
+		if (Mode == ESnapshotLayerMode::Override)
+		{
+			// Frozen under the new look, gone once it fully covers them
+			Old.WeightFrom = Old.WeightTo = Old.Weight;
+			Old.RampStart    = 0.f;
+			Old.RampDuration = 0.f;
+			Old.ReleaseAt    = FadeIn;
+			Old.FadeOut      = 0.f;
+		}
+		else
+		{
+			// An additive layer hides nothing: cross-fade the old ones out
+			Old.ReleaseAt = 0.f;
+			Old.FadeOut   = FadeIn;
+		}
+	}
+
+	FLayer Layer;
+	Layer.Handle       = NextHandle++;
+	Layer.Priority     = Priority;
+	Layer.Snapshot     = Snapshot;
+	Layer.Mode         = Mode;
+	Layer.WeightFrom   = 0.f;
+	Layer.WeightTo     = 1.f;
+	Layer.RampStart    = 0.f;
+	Layer.RampDuration = FadeIn;
+	Layer.ReleaseAt    = Hold >= 0.f ? FadeIn + Hold : Held;
+	Layer.FadeOut      = FadeOut;
+
+	// Above every layer of the same priority
+	const int32 Index = Algo::UpperBoundBy(Layers, Priority, &FLayer::Priority);
+	Layers.Insert(Layer, Index);
+
+	FinishChange();
+	return Layer.Handle;
+}
+
+void USnapshotMixerSubsystem::ResolveOutputs()
+{
+	const UStageRegistrySubsystem* Registry = UStageRegistrySubsystem::Get(this);
+	if (!Registry) return;
+
+	if (!AudioOutput.IsValid())
+	{
+		AudioOutput = Registry->GetFirst<AAudioSnapshotManager>();
+		bLooksBuilt &= !AudioOutput.IsValid();
+	}
+	if (!PostOutput.IsValid())
+	{
+		PostOutput = Registry->GetFirst<APostProcessSnapshotManager>();
+	}
+	if (!LightOutput.IsValid())
+	{
+		LightOutput = Registry->GetFirst<ALightSnapshotManager>();
+		bLooksBuilt &= !LightOutput.IsValid();
+	}
+}
+
+void USnapshotMixerSubsystem::BuildLooks()
+{
+	NumAudioLanes = TSnapshotBlender<FSnapshotTargets>::GetLayout().NumLanes();
+	NumLanes      = NumAudioLanes + TSnapshotBlender<FLinearColor>::GetLayout().NumLanes();
+
+	const int32 NumSnapshots = static_cast<int32>(StaticEnum<EAudioSnapshot>()->GetMaxEnumValue());
+	Looks.SetNumZeroed(NumSnapshots * NumLanes);
+	Offsets.SetNumZeroed(NumSnapshots * NumLanes);
+
+	FLanes Neutral;
+	Neutral.SetNumZeroed(NumLanes);
+	MakeLook(FSnapshotTargets(), FLinearColor::Black, Neutral.GetData());
+
+	const AAudioSnapshotManager* Audio = AudioOutput.Get();
+	const ALightSnapshotManager* Light = LightOutput.Get();
+
+	for (int32 i = 0; i < NumSnapshots; ++i)
+	{
+		const EAudioSnapshot Snapshot = static_cast<EAudioSnapshot>(i);
+		const FSnapshotTargets* AudioLook = Audio ? Audio->FindTargets(Snapshot) : nullptr;
+		const FLinearColor*     Color     = Light ? Light->FindColor(Snapshot) : nullptr;
+
+		float* Look = &Looks[i * NumLanes];
+		MakeLook(AudioLook ? *AudioLook : FSnapshotTargets(), Color ? *Color : FLinearColor::White, Look);
+
+		// Offset = Look - Neutral
+		SnapshotLerpLanes(Look, Neutral.GetData(), -1.f, &Offsets[i * NumLanes], NumLanes);
+	}
+
+	bLooksBuilt = true;
+}
+
+void USnapshotMixerSubsystem::CaptureInitial()
+{
+	const AAudioSnapshotManager* Audio = AudioOutput.Get();
+	const ALightSnapshotManager* Light = LightOutput.Get();
+
+	Initial.SetNumZeroed(NumLanes);
+	MakeLook(Audio ? Audio->GetCurrentTargets() : FSnapshotTargets(), Light ? Light->GetCurrentColor() : FLinearColor::White, Initial.GetData());
+	Mixed = Initial;
+}
+
+void USnapshotMixerSubsystem::BeginChange()
+{
+	// Settle the mix at the current clock time, then restart the clock at 0 for the change
+	Evaluate(ClockTime);
+	for (FLayer& Layer : Layers)
+	{
+		Layer.RampStart -= ClockTime;
+		if (Layer.ReleaseAt < Held)
+		{
+			Layer.ReleaseAt -= ClockTime;
+		}
+	}
+	ClockTime = 0.f;
+}
+
+void USnapshotMixerSubsystem::FinishChange()
+{
+	BlendDuration = 0.f;
+	for (const FLayer& Layer : Layers)
+	{
+		BlendDuration = FMath::Max(BlendDuration, SettleTime(Layer));
+	}
+
+	USnapshotBlendSubsystem* Blends = USnapshotBlendSubsystem::Get(this);
+	if (BlendDuration <= 0.015f || !Blends)
+	{
+		if (Blends)
+		{
+			Blends->CancelBlend(this);
+		}
+		StepAt(BlendDuration, true);
+		return;
+	}
+
+	Blends->BeginBlend(this, this, BlendDuration);
+}
+
+void USnapshotMixerSubsystem::RefreshLooks()
+{
+	bLooksBuilt = false;
+	if (Layers.Num() == 0) return;
+
+	BuildLooks();
+	StepAt(ClockTime, true);
+}
+
+void USnapshotMixerSubsystem::StepAt(float Time, bool bExact)
+{
+	const float RampSeconds = FMath::Max(0.f, Time - ClockTime);
+
+	Evaluate(Time);
+	RetireFinished(Time);
+	PushOutputs(bExact, RampSeconds);
+}
+
+void USnapshotMixerSubsystem::Evaluate(float Time)
+{
+	ClockTime = Time;
+
+	if (NumLanes == 0 || Initial.Num() != NumLanes) return;
+
+	Mixed = Initial;
+	float* Out = Mixed.GetData();
+
+	// One pass, bottom to top: override = lerp toward the look, additive = add the weighted offset
+	const int32 NumLooks = NumLanes > 0 ? Looks.Num() / NumLanes : 0;
+	for (FLayer& Layer : Layers)
+	{
+		Layer.Weight = WeightAt(Layer, Time);
+
+		const int32 Index = static_cast<int32>(Layer.Snapshot);
+		if (Layer.Weight <= 0.f || Index >= NumLooks) continue;
+
+		const VectorRegister4Float Weight = VectorSetFloat1(Layer.Weight);
+		if (Layer.Mode == ESnapshotLayerMode::Override)
+		{
+			const float* Look = &Looks[Index * NumLanes];
+			for (int32 i = 0; i < NumLanes; i += 4)
+			{
+				const VectorRegister4Float Value = VectorLoadAligned(Out + i);
+				VectorStoreAligned(VectorMultiplyAdd(Weight, VectorSubtract(VectorLoadAligned(Look + i), Value), Value), Out + i);
+			}
+		}
+		else
+		{
+			const float* Offset = &Offsets[Index * NumLanes];
+			for (int32 i = 0; i < NumLanes; i += 4)
+			{
+				VectorStoreAligned(VectorMultiplyAdd(Weight, VectorLoadAligned(Offset + i), VectorLoadAligned(Out + i)), Out + i);
+			}
+		}
+	}
+}
+
+void USnapshotMixerSubsystem::RetireFinished(float Time)
+{
+	Layers.RemoveAll([Time](const FLayer& Layer)
+	{
+		return Layer.ReleaseAt < Held && Time >= Layer.ReleaseAt + Layer.FadeOut;
+	});
+}
+
+void USnapshotMixerSubsystem::PushOutputs(bool bExact, float RampSeconds)
+{
+	if (NumLanes == 0 || Mixed.Num() != NumLanes) return;
+
+	if (AAudioSnapshotManager* Audio = AudioOutput.Get())
+	{
+		FSnapshotTargets Targets;
+		TSnapshotBlender<FSnapshotTargets>::GetLayout().Unpack(Mixed.GetData(), &Targets);
+		Audio->ApplyMixedTargets(Targets, bExact, RampSeconds);
+	}
+
+	if (ALightSnapshotManager* Light = LightOutput.Get())
+	{
+		FLinearColor Color;
+		TSnapshotBlender<FLinearColor>::GetLayout().Unpack(Mixed.GetData() + NumAudioLanes, &Color);
+		Light->ApplyMixedColor(Color, bExact);
+	}
+
+	if (APostProcessSnapshotManager* Post = PostOutput.Get())
+	{
+		TArray<FSnapshotLayerWeight, TInlineAllocator<8>> Weights;
+		for (const FLayer& Layer : Layers)
+		{
+			Weights.Add({ Layer.Snapshot, Layer.Weight });
+		}
+		Post->ApplyMixedLayers(Weights);
+	}
+}
@@ -0,0 +1,237 @@
+﻿// © Anastasis Marinos //
+
+#include "World/Subsystems/StageRegistrySubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/PostProcessVolume.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+
+UStageRegistrySubsystem* UStageRegistrySubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UStageRegistrySubsystem>() : nullptr;
+}
+
+bool UStageRegistrySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStageRegistrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelAddedHandle   = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UStageRegistrySubsystem::HandleLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UStageRegistrySubsystem::HandleLevelRemoved);
+
+	if (UWorld* World = GetWorld())
+	{
+		ActorSpawnedHandle   = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UStageRegistrySubsystem::HandleActorSpawned));
+		ActorDestroyedHandle = World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &UStageRegistrySubsystem::HandleActorDestroyed));
+	}
+}
+
+void UStageRegistrySubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	if (UWorld* World = GetWorld())
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		World->RemoveOnActorDestroyedHandler(ActorDestroyedHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+void UStageRegistrySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	for (const ULevel* Level : InWorld.GetLevels())
+	{
+		RegisterPostVolumes(Level);
+	}
+}
+
+void UStageRegistrySubsystem::RegisterActor(AActor* Actor, UClass* Category)
+{
+	if (UStageRegistrySubsystem* Registry = Get(Actor))
+	{
+		Registry->Register(Actor, Category);
+	}
+}
+
+void UStageRegistrySubsystem::UnregisterActor(AActor* Actor, UClass* Category)
+{
+	if (UStageRegistrySubsystem* Registry = Get(Actor))
+	{
+		Registry->Unregister(Actor, Category);
+	}
+}
+
+bool UStageRegistrySubsystem::IsRegistered(const AActor* Actor, UClass* Category) const
+{
+	const TArray<TWeakObjectPtr<AActor>>* Actors = ByClass.Find(Category);
+	return Actors && Actors->Contains(Actor);
+}
+
+void UStageRegistrySubsystem::Register(AActor* Actor, UClass* Category)
+{
+	if (!Actor || !Category) return;
+
+	TArray<TWeakObjectPtr<AActor>>& Actors = ByClass.FindOrAdd(Category);
+	if (Actors.Contains(Actor)) return;
+
+	Actors.Add(Actor);
+
+	FRegisteredTags& Registered = TagsOf.FindOrAdd(Actor);
+	if (Registered.NumCategories++ == 0)
+	{
+		Registered.Tags = Actor->Tags;
+		for (const FName& Tag : Registered.Tags)
+		{
+			ByTag.FindOrAdd(Tag).AddUnique(Actor);
+		}
+	}
+
+	OnRegistered.Broadcast(Actor, Category);
+}
+
+void UStageRegistrySubsystem::Unregister(AActor* Actor, UClass* Category)
+{
+	if (!Actor || !Category) return;
+
+	TArray<TWeakObjectPtr<AActor>>* Actors = ByClass.Find(Category);
+	if (!Actors || Actors->RemoveSingleSwap(Actor) == 0) return;
+
+	// The tags it joined under, not whatever it carries now
+	FRegisteredTags* Registered = TagsOf.Find(Actor);
+	if (Registered && --Registered->NumCategories <= 0)
+	{
+		for (const FName& Tag : Registered->Tags)
+		{
+			if (TArray<TWeakObjectPtr<AActor>>* Tagged = ByTag.Find(Tag))
+			{
+				Tagged->RemoveSingleSwap(Actor);
+			}
+		}
+		TagsOf.Remove(Actor);
+	}
+
+	OnUnregistered.Broadcast(Actor, Category);
+}
+
+AActor* UStageRegistrySubsystem::GetFirst(UClass* Category) const
+{
+	for (const TWeakObjectPtr<AActor>& Actor : GetAll(Category))
+	{
+		if (AActor* Live = Actor.Get())
+		{
+			return Live;
+		}
+	}
+	return nullptr;
+}
+
+const TArray<TWeakObjectPtr<AActor>>& UStageRegistrySubsystem::GetAll(UClass* Category) const
+{
+	static const TArray<TWeakObjectPtr<AActor>> Empty;
+	const TArray<TWeakObjectPtr<AActor>>* Actors = ByClass.Find(Category);
+	return Actors ? *Actors : Empty;
+}
+
+AActor* UStageRegistrySubsystem::FindByTag(UClass* Category, FName Tag) const
+{
+	const TArray<TWeakObjectPtr<AActor>>* Tagged = ByTag.Find(Tag);
+	if (!Tagged) return nullptr;
+
+	for (const TWeakObjectPtr<AActor>& Actor : *Tagged)
+	{
+		AActor* Live = Actor.Get();
+		if (Live && Live->IsA(Category))
+		{
+			return Live;
+		}
+	}
+	return nullptr;
+}
+
+APostProcessVolume* UStageRegistrySubsystem::FindPostVolume(bool bPreferUnbound) const
+{
+	APostProcessVolume* First = nullptr;
+	for (const TWeakObjectPtr<AActor>& Volume : GetAll(APostProcessVolume::StaticClass()))
+	{
+		APostProcessVolume* Actor = Cast<APostProcessVolume>(Volume.Get());
+		if (!Actor) continue;
+
+		if (!bPreferUnbound || Actor->bUnbound)
+		{
+			return Actor;
+		}
+		First = First ? First : Actor;
+	}
+	return First;
+}
+
+/* ---------------- Post volumes ---------------- */
+
+void UStageRegistrySubsystem::RegisterPostVolumes(const ULevel* Level)
+{
+	if (!Level) return;
+
+	for (AActor* Actor : Level->Actors)
+	{
+		if (APostProcessVolume* Volume = Cast<APostProcessVolume>(Actor))
+		{
+			Register(Volume, APostProcessVolume::StaticClass());
+		}
+	}
+}
+
+void UStageRegistrySubsystem::UnregisterPostVolumes(const ULevel* Level)
+{
+	if (!Level) return;
+
+	for (AActor* Actor : Level->Actors)
+	{
+		if (APostProcessVolume* Volume = Cast<APostProcessVolume>(Actor))
+		{
+			Unregister(Volume, APostProcessVolume::StaticClass());
+		}
+	}
+}
+
+void UStageRegistrySubsystem::HandleLevelAdded(ULevel* Level, UWorld* InWorld)
+{
+	// Levels streamed in before BeginPlay are picked up there
+	if (InWorld == GetWorld() && InWorld->HasBegunPlay())
+	{
+		RegisterPostVolumes(Level);
+	}
+}
+
+void UStageRegistrySubsystem::HandleLevelRemoved(ULevel* Level, UWorld* InWorld)
+{
+	if (InWorld == GetWorld())
+	{
+		UnregisterPostVolumes(Level);
+	}
+}
+
+void UStageRegistrySubsystem::HandleActorSpawned(AActor* Actor)
+{
+	if (APostProcessVolume* Volume = Cast<APostProcessVolume>(Actor))
+	{
+		Register(Volume, APostProcessVolume::StaticClass());
+	}
+}
+
+void UStageRegistrySubsystem::HandleActorDestroyed(AActor* Actor)
+{
+	if (APostProcessVolume* Volume = Cast<APostProcessVolume>(Actor))
+	{
+		Unregister(Volume, APostProcessVolume::StaticClass());
+	}
+}
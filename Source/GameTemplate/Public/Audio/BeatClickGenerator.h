@@ -0,0 +1,112 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** How one click sounds: a sine swept from Frequency to EndFrequency under an exponential decay */
+struct FBeatClickShape
+{
+	float Frequency    = 1600.f;
+	float EndFrequency = 1600.f;
+	float Decay        = 0.012f;  // seconds to fall by 1/e; a hit lasts until -60 dB
+	float Attack       = 0.0005f; // linear ramp in, seconds
+};
+
+/** Gains of the accent levels, and how many ticks each beat is split into */
+struct FBeatClickAccents
+{
+	float Downbeat    = 1.f;
+	float Group       = 0.7f;  // first beat of each group inside the bar (the 3 in 4/4, the 4 in 6/4)
+	float Beat        = 0.5f;
+	float Subdivision = 0.25f;
+	int32 Subdivisions = 1;
+};
+
+/** Tempo and place in the bar of one beat, as the beat clock scheduled it */
+struct FBeatClickBeat
+{
+	int32  Beat        = 0;
+	float  BPM         = 120.f;
+	int32  BeatsPerBar = 4;
+	int32  BeatInBar   = 0;
+	uint32 GroupMask   = 1; // bit per beat in the bar that starts a group (bit 0 always set)
+
+	/** Beats grouped in threes when the bar divides into them (6, 9, 12), otherwise in twos with
+	 *  a trailing three for odd bars (5 = 2+3, 7 = 2+2+3) */
+	static uint32 MakeGroupMask(int32 BeatsPerBar);
+};
+
+/**
+ * Mono click track counted in samples from the first beat it was armed with, so every click lands
+ * on the frame the beat clock's Quartz grid puts the beat on (a beat is a whole number of frames,
+ * as Quartz counts it). Tempo and meter come one beat at a time through Schedule; beats with no
+ * entry keep the last tempo and carry on counting through the bar. Nothing allocates once
+ * constructed: the schedule and the sounding hits live in fixed arrays.
+ */
+class GAMETEMPLATE_API FBeatClickGenerator
+{
+public:
+	static constexpr int32 MaxHits     = 8;
+	static constexpr int32 MaxSchedule = 16;
+
+	void Init(float InSampleRate);
+
+	void SetShape(const FBeatClickShape& InShape) { Shape = InShape; }
+	void SetAccents(const FBeatClickAccents& InAccents);
+
+	/** Restart the count: the next sample rendered is the start of First.Beat */
+	void Arm(const FBeatClickBeat& First);
+	void Disarm();
+
+	/** Tempo and bar position of a coming beat; beats must be scheduled in order */
+	void Schedule(const FBeatClickBeat& Beat);
+
+	/** Overwrites Out with NumFrames of the click track (silence while disarmed) */
+	void Render(float* Out, int32 NumFrames);
+
+	bool IsArmed() const { return bArmed; }
+	int32 GetCurrentBeat() const { return CurrentBeat; }
+	int64 GetFramesRendered() const { return FramesRendered; }
+
+private:
+	struct FHit
+	{
+		float Phase     = 0.f;
+		float PhaseStep = 0.f;
+		float StepScale = 1.f;  // per frame, sweeps the pitch towards EndFrequency
+		float Level     = 0.f;
+		float LevelScale = 1.f; // per frame, the decay
+		float Gain      = 0.f;
+		int32 Age       = 0;
+		int32 AttackFrames = 1;
+		int32 FramesLeft   = 0;
+	};
+
+	void BeginBeat();
+	void Apply(const FBeatClickBeat& Beat);
+	void Trigger(float Gain, float PitchScale);
+	void RenderHits(float* Out, int32 NumFrames);
+
+	float SampleRate = 48000.f;
+	FBeatClickShape   Shape;
+	FBeatClickAccents Accents;
+
+	FHit  Hits[MaxHits];
+	int32 NextHit = 0;
+
+	FBeatClickBeat Pending[MaxSchedule];
+	int32 PendingHead = 0;
+	int32 PendingNum  = 0;
+
+	bool   bArmed         = false;
+	int64  FramesRendered = 0;  // since Arm
+	int64  BeatStart      = 0;  // frame the current beat starts on
+	int64  NextTick       = 0;
+	int32  FramesPerBeat  = 24000;
+	int32  TickInBeat     = 0;
+	int32  CurrentBeat    = 0;
+	int32  BeatsPerBar    = 4;
+	int32  BeatInBar      = 0;
+	uint32 GroupMask      = 1;
+};
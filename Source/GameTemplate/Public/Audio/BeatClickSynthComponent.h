@@ -0,0 +1,103 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SynthComponent.h"
+#include "Audio/BeatClickGenerator.h"
+#include "BeatClickSynthComponent.generated.h"
+
+class UBeatClockSubsystem;
+struct FBeatClockTime;
+
+UENUM(BlueprintType)
+enum class EBeatClickVoice : uint8
+{
+	Click,  // short bright tick, a metronome
+	Pulse,  // soft low thump
+	SubDrop // sine falling two octaves, felt more than heard
+};
+
+/**
+ * Rehearsal click synthesized on the audio render thread, locked to the world's beat clock. It starts
+ * on a bar line through a Quartz quantized play and from there counts frames, so every click lands
+ * on the frame the clock's beat does; each beat the clock schedules (tempo map changes, or the
+ * retimed beats while following the music) is passed on a beat ahead. The downbeat, the first beat
+ * of each group in the bar and plain beats get their own gains, so the pattern follows the meter.
+ * No sample assets; nothing allocates while rendering.
+ */
+UCLASS(ClassGroup=Synth, meta=(BlueprintSpawnableComponent))
+class GAMETEMPLATE_API UBeatClickSynthComponent : public USynthComponent
+{
+	GENERATED_BODY()
+
+public:
+	UBeatClickSynthComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Start clicking from the beat clock's next bar line (the clock must be running) */
+	UFUNCTION(BlueprintCallable, Category="Beat Click")
+	void StartOnBeatClock();
+
+	UFUNCTION(BlueprintCallable, Category="Beat Click")
+	void StopClick();
+
+	UFUNCTION(BlueprintPure, Category="Beat Click")
+	bool IsClicking() const { return bClicking; }
+
+	UFUNCTION(BlueprintCallable, Category="Beat Click")
+	void SetVoice(EBeatClickVoice InVoice);
+
+	UFUNCTION(BlueprintCallable, Category="Beat Click")
+	void SetSubdivisions(int32 InSubdivisions);
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Beat Click")
+	EBeatClickVoice Voice = EBeatClickVoice::Click;
+
+	// Scales the voice's frequencies
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Beat Click", meta=(ClampMin="0.25", ClampMax="4.0"))
+	float Pitch = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Beat Click|Accents", meta=(ClampMin="0.0", ClampMax="1.0"))
+	float DownbeatGain = 1.f;
+
+	// First beat of each group inside the bar: the 3 of 4/4, the 4 of 6/4, the 3 of 5/4 (2+3)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Beat Click|Accents", meta=(ClampMin="0.0", ClampMax="1.0"))
+	float GroupGain = 0.7f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Beat Click|Accents", meta=(ClampMin="0.0", ClampMax="1.0"))
+	float BeatGain = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Beat Click|Accents", meta=(ClampMin="0.0", ClampMax="1.0"))
+	float SubdivisionGain = 0.25f;
+
+	// Clicks per beat (2 = eighths, 4 = sixteenths)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Beat Click|Accents", meta=(ClampMin="1", ClampMax="8"))
+	int32 Subdivisions = 1;
+
+	// Start on the first bar line once play begins (if the beat clock is running by then)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Beat Click")
+	bool bStartWithBeatClock = false;
+
+protected:
+	virtual bool Init(int32& SampleRate) override;
+	virtual int32 OnGenerateAudio(float* OutAudio, int32 NumSamples) override;
+
+private:
+	void HandleBeat(const FBeatClockTime& Time);
+	void PushSettings();
+
+	FBeatClickBeat MakeBeat(const UBeatClockSubsystem& Clock, int32 Beat, float BPM) const;
+	FBeatClickShape MakeShape() const;
+	FBeatClickAccents MakeAccents() const;
+
+	// Render thread only, reached through SynthCommand
+	FBeatClickGenerator Generator;
+
+	FDelegateHandle BeatHandle;
+	int32 LastScheduledBeat = INDEX_NONE;
+	int32 LastClockBeat     = INDEX_NONE;
+	bool  bClicking = false;
+};
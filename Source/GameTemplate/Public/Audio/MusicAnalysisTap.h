@@ -0,0 +1,87 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "ISubmixBufferListener.h"
+#include "MusicAnalysisTap.generated.h"
+
+UENUM(BlueprintType)
+enum class EMusicAnalysisBand : uint8
+{
+	Full     UMETA(DisplayName="Full (RMS)"),
+	Low      UMETA(DisplayName="Low (< 150 Hz)"),
+	LowMid   UMETA(DisplayName="Low Mid (150-800 Hz)"),
+	HighMid  UMETA(DisplayName="High Mid (800-4000 Hz)"),
+	High     UMETA(DisplayName="High (> 4000 Hz)"),
+};
+
+// One analysis hop of the music: RMS of the mix and of each band (linear)
+struct FMusicAnalysisFrame
+{
+	static constexpr int32 NumBands = 4;
+
+	uint32 Sequence   = 0;   // hop counter, gaps mean frames were dropped
+	double AudioClock = 0.0; // audio clock at the end of the buffer that completed the hop
+	float  Rms        = 0.f;
+	float  Peak       = 0.f;
+	float  Bands[NumBands] = {};
+
+	float GetLevel(EMusicAnalysisBand Band) const
+	{
+		return Band == EMusicAnalysisBand::Full ? Rms : Bands[static_cast<int32>(Band) - 1];
+	}
+};
+
+/**
+ * Listens to a submix on the audio render thread and reduces it to an RMS envelope and four band
+ * energies per hop (HopSeconds, independent of the device buffer size). The bands come from a
+ * one-pole crossover (150 / 800 / 4000 Hz) on the channel mix, so a hop costs a few multiply-adds
+ * per sample. Finished frames go to the game thread through a single-producer/single-consumer
+ * TCircularQueue; the audio thread never locks or allocates, and a full queue drops the frame
+ * (counted) rather than waiting for the game thread.
+ */
+class GAMETEMPLATE_API FMusicAnalysisTap : public ISubmixBufferListener
+{
+public:
+	explicit FMusicAnalysisTap(float InHopSeconds = 0.01f, uint32 QueueCapacity = 256);
+
+	// ISubmixBufferListener (audio render thread)
+	virtual void OnNewSubmixBuffer(const USoundSubmix* OwningSubmix, float* AudioData, int32 NumSamples, int32 NumChannels, const int32 SampleRate, double AudioClock) override;
+	virtual const FString& GetListenerName() const override;
+
+	// Game thread: pops every frame produced since the last call into OutLatest (and the loudest
+	// of them per band into OutPeak). Returns the number of frames popped.
+	int32 Drain(FMusicAnalysisFrame& OutLatest, FMusicAnalysisFrame& OutPeak);
+
+	// Game thread: the oldest frame not yet popped
+	bool Pop(FMusicAnalysisFrame& OutFrame) { return Frames.Dequeue(OutFrame); }
+
+	int32 GetHopFrames(int32 SampleRate) const { return FMath::Max(1, FMath::RoundToInt(HopSeconds * SampleRate)); }
+
+	uint32 GetNumProduced() const { return NumProduced.load(std::memory_order_relaxed); }
+	uint32 GetNumDropped() const { return NumDropped.load(std::memory_order_relaxed); }
+
+private:
+	void UpdateCoefficients(int32 SampleRate);
+	void FinishHop(double AudioClock);
+
+	// Written by the producer, read by the consumer
+	TCircularQueue<FMusicAnalysisFrame> Frames;
+	std::atomic<uint32> NumProduced { 0 };
+	std::atomic<uint32> NumDropped { 0 };
+
+	// Audio render thread only
+	float HopSeconds   = 0.01f;
+	int32 HopFrames    = 480;
+	int32 CoefficientsRate = 0;
+	float CrossoverCoef[FMusicAnalysisFrame::NumBands - 1] = {};
+	float CrossoverZ[FMusicAnalysisFrame::NumBands - 1] = {};
+
+	int32  FramesInHop = 0;
+	double SumSquares  = 0.0;
+	double BandSquares[FMusicAnalysisFrame::NumBands] = {};
+	float  HopPeak     = 0.f;
+	uint32 Sequence    = 0;
+};
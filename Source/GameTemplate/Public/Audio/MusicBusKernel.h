@@ -0,0 +1,78 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Control values for one FMusicBusKernel slice
+struct FMusicBusKernelParams
+{
+	float CutoffHz         = 20000.f;
+	float ShelfFrequencyHz = 10000.f;
+	float ShelfBandwidth   = 0.7f;	// octaves
+	float ShelfGainDb      = 0.f;
+	float AttackMs         = 10.f;
+	float ReleaseMs        = 120.f;
+	float ThresholdDb      = -12.f;
+	float Ratio            = 4.f;
+};
+
+/**
+ * Low-pass -> high shelf -> compressor for the music bus, walking the buffer once in 32-frame
+ * control blocks that stay in cache. All channels of a frame (up to four) sit in one SIMD register,
+ * so both biquads run as vector ops (stereo frames are loaded and stored two at a time). The
+ * compressor detects the block's peak with the SignalProcessing array ops, computes its gain once
+ * per block in dB and ramps it across the block with ArrayFade. The detector keys from an
+ * external buffer (the VO sidechain) when one is given.
+ */
+class GAMETEMPLATE_API FMusicBusKernel
+{
+public:
+	static constexpr int32 MaxChannels = 4;
+
+	void Init(float InSampleRate, int32 InNumChannels);
+	void Reset();
+
+	// Recomputes only the coefficients whose inputs changed
+	void SetParams(const FMusicBusKernelParams& InParams);
+
+	// In and Out are interleaved NumFrames * NumChannels and may alias.
+	// Key is interleaved NumFrames * KeyNumChannels; the kernel keys from its own output when null.
+	void Process(const float* In, float* Out, int32 NumFrames, const float* Key = nullptr, int32 KeyNumChannels = 0);
+
+	int32 GetNumChannels() const { return NumChannels; }
+
+private:
+	struct FBiquadCoefficients
+	{
+		float B0 = 1.f, B1 = 0.f, B2 = 0.f, A1 = 0.f, A2 = 0.f;
+	};
+
+	// Both biquads over NumFrames, In to Out (may alias)
+	void Filter(const float* In, float* Out, int32 NumFrames);
+
+	void UpdateLowPass();
+	void UpdateHighShelf();
+	void UpdateDynamics();
+
+	float SampleRate  = 48000.f;
+	int32 NumChannels = 2;
+
+	FMusicBusKernelParams Params;
+
+	FBiquadCoefficients LowPass;
+	FBiquadCoefficients HighShelf;
+
+	// Transposed direct form II state, one lane per channel
+	alignas(16) float LowPassZ1[MaxChannels]   = {};
+	alignas(16) float LowPassZ2[MaxChannels]   = {};
+	alignas(16) float HighShelfZ1[MaxChannels] = {};
+	alignas(16) float HighShelfZ2[MaxChannels] = {};
+
+	// Compressor, stepped per control block
+	float AttackCoef    = 0.f;
+	float ReleaseCoef   = 0.f;
+	float GainSlope     = 0.f;	// -(1 - 1/Ratio), dB of gain per dB over threshold
+	float Envelope      = 0.f;
+	float Gain          = 1.f;	// applied at the end of the last block
+};
@@ -0,0 +1,27 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "NarrationCookCommandlet.generated.h"
+
+/**
+ * Decodes every voice line under a content path and writes a UNarrationCueData sidecar with exact
+ * durations, loudness envelopes, speech/silence regions and subtitle clear times. Analysis runs in
+ * parallel; it needs editor-only source audio but no rendering, so it runs headless:
+ *
+ *   UnrealEditor-Cmd GameTemplate.uproject -run=NarrationCook -Path=/Game/Audio/Narration
+ *       -Output=/Game/Audio/NarrationCues [-EnvelopeRate=50] [-SilenceDb=-40] [-MinSilence=0.25]
+ *       [-ClearHold=0.75] [-Batch=32] -unattended -nullrhi
+ */
+UCLASS()
+class GAMETEMPLATE_API UNarrationCookCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UNarrationCookCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
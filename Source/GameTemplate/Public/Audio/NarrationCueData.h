@@ -0,0 +1,62 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "NarrationCueData.generated.h"
+
+/** Precomputed timing and loudness of one voice line (written by the NarrationCook commandlet) */
+USTRUCT(BlueprintType)
+struct FNarrationCue
+{
+	GENERATED_BODY()
+
+	// Envelope bytes map linearly onto [EnvelopeFloorDb, 0] dBFS
+	static constexpr float EnvelopeFloorDb = -60.f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Narration")
+	FSoftObjectPath Voice;
+
+	// Exact length from the decoded PCM (sec)
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Narration")
+	float Duration = 0.f;
+
+	// Envelope bins per second
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Narration")
+	float EnvelopeRate = 50.f;
+
+	// RMS loudness per bin, quantized to a byte
+	UPROPERTY(VisibleAnywhere, Category="Narration")
+	TArray<uint8> Envelope;
+
+	// Speech regions as (start, end) in seconds; gaps between them are silence
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Narration")
+	TArray<FVector2f> SpeechRegions;
+
+	// When the last subtitle can go: end of the last speech region plus a readability hold
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Narration")
+	float SuggestedClearTime = 0.f;
+
+	/** Envelope loudness at a time into the line, in dBFS */
+	float GetLoudnessDb(float Seconds) const;
+};
+
+/** Sidecar of precomputed narration cues, looked up by voice asset path */
+UCLASS(BlueprintType)
+class GAMETEMPLATE_API UNarrationCueData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(VisibleAnywhere, Category="Narration")
+	TArray<FNarrationCue> Cues;
+
+	const FNarrationCue* FindCue(const FSoftObjectPath& Voice) const;
+	void RebuildLookup();
+
+	virtual void PostLoad() override;
+
+private:
+	TMap<FSoftObjectPath, int32> Lookup;
+};
@@ -0,0 +1,178 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DSP/Dsp.h"
+#include "ISubmixBufferListener.h"
+
+namespace Audio
+{
+	class IFFTAlgorithm;
+}
+
+struct FOnsetTempoSettings
+{
+	// Tempo search range and the prior the search is weighted by (log-Gaussian around PriorBPM,
+	// PriorWidth octaves wide), which is what picks 150 over 75 or 300
+	float MinBPM     = 60.f;
+	float MaxBPM     = 200.f;
+	float PriorBPM   = 120.f;
+	float PriorWidth = 0.5f;
+
+	// Onset envelope kept for the tempo search, and how often the search runs
+	float HistorySeconds = 8.f;
+	float UpdateSeconds  = 0.5f;
+};
+
+// Tempo and beat phase as of StreamSeconds (stream time is the audio clock handed to Process)
+struct FTempoEstimate
+{
+	double StreamSeconds   = 0.0;
+	double LastBeatSeconds = 0.0;
+	float  BPM        = 0.f;
+	float  Confidence = 0.f; // 0..1, periodicity strength of the onset envelope at the chosen tempo
+	uint32 Sequence   = 0;
+
+	bool IsValid() const { return BPM > 0.f; }
+	float GetSecondsPerBeat() const { return 60.f / BPM; }
+
+	// 0..1 through the beat at Seconds (extrapolated at BPM)
+	float GetPhaseAt(double Seconds) const
+	{
+		return IsValid() ? static_cast<float>(FMath::Frac((Seconds - LastBeatSeconds) / GetSecondsPerBeat())) : 0.f;
+	}
+};
+
+struct FDetectedOnset
+{
+	double Seconds  = 0.0;
+	float  Strength = 0.f;
+};
+
+/**
+ * Incremental onset detector and tempo tracker for a music stream.
+ * Every hop (512 frames) a Hann-windowed 1024-point FFT of the channel mix gives the spectral flux
+ * of the log-compressed magnitudes, the onset envelope; onsets are its peaks over an adaptive
+ * threshold. Every UpdateSeconds the envelope history is autocorrelated over the tempo range
+ * (weighted by the tempo prior, with the double lag reinforcing), and the beat phase is the
+ * offset that lines a comb at that period up with the most onset energy. The autocorrelation is
+ * spread over the hops that follow, a slice of lags each, so no one buffer pays for all of it.
+ * All buffers are sized in Init; Process never allocates, so it runs on the audio render thread.
+ */
+class GAMETEMPLATE_API FOnsetTempoTracker
+{
+public:
+	static constexpr int32 FFTSize = 1024;
+	static constexpr int32 HopSize = 512;
+	static constexpr int32 MaxOnsetsPerBlock = 64;
+
+	FOnsetTempoTracker();
+	~FOnsetTempoTracker();
+
+	void Init(float InSampleRate, const FOnsetTempoSettings& InSettings = FOnsetTempoSettings());
+	void Reset();
+
+	// Interleaved audio starting at BlockSeconds on the stream clock. Returns true if a new
+	// estimate was made during the block.
+	bool Process(const float* Interleaved, int32 NumFrames, int32 NumChannels, double BlockSeconds);
+
+	const FTempoEstimate& GetEstimate() const { return Estimate; }
+
+	// Onsets found by the last Process call (at most MaxOnsetsPerBlock)
+	TArrayView<const FDetectedOnset> GetNewOnsets() const { return MakeArrayView(NewOnsets.GetData(), NumNewOnsets); }
+
+	float GetSampleRate() const { return SampleRate; }
+	float GetEnvelopeRate() const { return SampleRate / HopSize; }
+
+private:
+	void AnalyzeHop(double HopEndSeconds);
+	void PickOnset(double FrameSeconds);
+	void BeginSearch(double NewestSeconds, double HopEndSeconds);
+	void ContinueSearch();
+	void FinishSearch();
+	float SmoothedAt(float FramesBack) const;
+
+	FOnsetTempoSettings Settings;
+	float SampleRate = 48000.f;
+
+	TUniquePtr<Audio::IFFTAlgorithm> FFT;
+	Audio::FAlignedFloatBuffer Window;
+	Audio::FAlignedFloatBuffer Input;    // last FFTSize mono samples, circular
+	Audio::FAlignedFloatBuffer Frame;    // windowed, in time order
+	Audio::FAlignedFloatBuffer Spectrum; // interleaved complex
+	Audio::FAlignedFloatBuffer LogMagnitude;
+	Audio::FAlignedFloatBuffer PrevLogMagnitude;
+	int32 InputWrite  = 0;
+	int32 HopFill     = 0;
+	int64 NumHops     = 0;
+
+	// Onset envelope history, circular (newest at EnvelopeWrite - 1); the search works on a
+	// smoothed copy in time order
+	TArray<float> Envelope;
+	TArray<float> Smoothed;
+	TArray<float> Autocorr;
+	float MagnitudeScale = 1.f;
+	int32 EnvelopeWrite = 0;
+	int32 EnvelopeCount = 0;
+	int32 HopsPerUpdate = 47;
+	int32 HopsSinceUpdate = 0;
+
+	// Search in progress over the first SearchCount frames of Smoothed: lags below SearchLag are
+	// done (INDEX_NONE when none is running), LagsPerHop more each hop up to SearchTopLag
+	int32  SearchLag    = INDEX_NONE;
+	int32  SearchTopLag = 0;
+	int32  SearchCount  = 0;
+	int32  LagsPerHop   = 1;
+	double SearchNewestSeconds = 0.0;
+	double SearchEndSeconds    = 0.0;
+
+	// Peak picking: the last three envelope values and a running mean for the threshold
+	float Odf[3] = {};
+	float OdfMean = 0.f;
+	float OdfMax  = 0.f;
+	double LastOnsetSeconds = -1.0;
+
+	TArray<FDetectedOnset> NewOnsets;
+	int32 NumNewOnsets = 0;
+
+	// Tempo hysteresis: a jump needs two searches in a row to agree
+	float CandidateBPM = 0.f;
+	FTempoEstimate Estimate;
+};
+
+/**
+ * Runs an FOnsetTempoTracker on a submix, on the audio render thread. Each new estimate goes to the
+ * game thread through a lock-free triple buffer, so a newer one always replaces what the game thread
+ * hasn't read yet. The tracker is sized for
+ * the device rate the tap is made with; if the device comes back at another rate the tap goes
+ * quiet and reports it, and the owner makes a new one.
+ */
+class GAMETEMPLATE_API FTempoTrackerTap : public ISubmixBufferListener
+{
+public:
+	FTempoTrackerTap(const FOnsetTempoSettings& InSettings, int32 DeviceSampleRate);
+
+	virtual void OnNewSubmixBuffer(const USoundSubmix* OwningSubmix, float* AudioData, int32 NumSamples, int32 NumChannels, const int32 SampleRate, double AudioClock) override;
+	virtual const FString& GetListenerName() const override;
+
+	// Game thread: the newest estimate since the last call, if any
+	bool PopLatest(FTempoEstimate& OutEstimate);
+
+	// Game thread: the rate the device renders at if it isn't the one the tap was made for, else 0
+	int32 GetMismatchedRate() const { return MismatchedRate.load(std::memory_order_relaxed); }
+
+private:
+	FOnsetTempoSettings Settings;
+	FOnsetTempoTracker Tracker;
+	int32 TrackerRate = 0;
+	std::atomic<int32> MismatchedRate { 0 };
+
+	// Triple buffer: the render thread owns Slots[WriteSlot], the game thread Slots[ReadSlot]; the
+	// third is handed over through SharedSlot, whose FreshBit says it holds an unread estimate
+	static constexpr uint32 FreshBit = 4;
+	FTempoEstimate Slots[3];
+	int32 WriteSlot = 0;
+	int32 ReadSlot = 1;
+	std::atomic<uint32> SharedSlot { 2 };
+};
@@ -0,0 +1,148 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DSP/Dsp.h"
+
+namespace Audio
+{
+	class IFFTAlgorithm;
+}
+
+class FConvolutionImpulse;
+using FConvolutionImpulsePtr = TSharedPtr<const FConvolutionImpulse, ESPMode::ThreadSafe>;
+
+/**
+ * An impulse response cut into BlockFrames partitions and transformed once, up front, at the
+ * device rate. Spectra are stored split (real and imaginary planes, padded to a multiple of four
+ * bins) so the convolver's multiply-accumulate runs four bins per SIMD op. Immutable once built,
+ * so any number of convolvers can share one.
+ */
+class GAMETEMPLATE_API FConvolutionImpulse
+{
+public:
+	static constexpr int32 MaxChannels = 2;
+
+	/**
+	 * Interleaved Samples at SourceSampleRate, resampled to SampleRate and scaled by Gain.
+	 * Channels past MaxChannels are ignored. BlockFrames is rounded up to a power of two.
+	 */
+	static FConvolutionImpulsePtr Build(TArrayView<const float> Samples, int32 NumChannels, float SourceSampleRate,
+		float SampleRate, int32 BlockFrames, float Gain = 1.f);
+
+	int32 GetNumChannels() const { return NumChannels; }
+	int32 GetBlockFrames() const { return BlockFrames; }
+	int32 GetNumPartitions() const { return NumPartitions; }
+	int32 GetBinStride() const { return BinStride; }
+	float GetSeconds() const { return Seconds; }
+	SIZE_T GetAllocatedSize() const { return Real.GetAllocatedSize() + Imag.GetAllocatedSize(); }
+
+	const float* GetReal(int32 Channel, int32 Partition) const { return Real.GetData() + (Channel * NumPartitions + Partition) * BinStride; }
+	const float* GetImag(int32 Channel, int32 Partition) const { return Imag.GetData() + (Channel * NumPartitions + Partition) * BinStride; }
+
+private:
+	int32 NumChannels   = 0;
+	int32 BlockFrames   = 0;
+	int32 NumPartitions = 0;
+	int32 BinStride     = 0;
+	float Seconds       = 0.f;
+
+	// [Channel][Partition][BinStride]
+	Audio::FAlignedFloatBuffer Real;
+	Audio::FAlignedFloatBuffer Imag;
+};
+
+/**
+ * Uniformly partitioned overlap-save convolution. Each BlockFrames of input is transformed once
+ * into a frequency-domain delay line; the output block is the sum over partitions of delay-line
+ * spectrum times impulse spectrum, then one inverse transform. Cost per block is two FFTs of
+ * 2 * BlockFrames plus one complex multiply-accumulate per partition, whatever the IR length.
+ * Adds a latency of BlockFrames. Nothing allocates on Process once Init has sized the state.
+ */
+class GAMETEMPLATE_API FPartitionedConvolver
+{
+public:
+	static constexpr int32 MaxChannels = 2;
+
+	FPartitionedConvolver();
+	~FPartitionedConvolver();
+
+	// Sizes the state for impulses of up to MaxPartitions blocks (allocates)
+	void Init(int32 InNumChannels, int32 InBlockFrames, int32 MaxPartitions);
+
+	// Swaps the impulse and clears the history; only allocates if it outgrows what Init sized
+	void SetImpulse(FConvolutionImpulsePtr InImpulse);
+	void Reset();
+
+	// Adds the convolved In to Out (both interleaved NumFrames * NumChannels), with the gain
+	// ramped from GainStart to GainEnd across the call
+	void ProcessAdd(const float* In, float* Out, int32 NumFrames, float GainStart = 1.f, float GainEnd = 1.f);
+
+	bool HasImpulse() const { return Impulse.IsValid(); }
+	const FConvolutionImpulsePtr& GetImpulse() const { return Impulse; }
+	int32 GetLatencyFrames() const { return BlockFrames; }
+
+	// Four bins per op: Acc += X * H, on split complex planes (NumBins a multiple of four, aligned)
+	static void MultiplyAccumulate(const float* XReal, const float* XImag, const float* HReal, const float* HImag,
+		float* AccReal, float* AccImag, int32 NumBins);
+
+private:
+	void ProcessBlock();
+
+	TUniquePtr<Audio::IFFTAlgorithm> FFT;
+	FConvolutionImpulsePtr Impulse;
+
+	int32 NumChannels   = 2;
+	int32 BlockFrames   = 0;
+	int32 FFTSize       = 0;
+	int32 NumBins       = 0;
+	int32 BinStride     = 0;
+	int32 Capacity      = 0; // partitions the delay line is sized for
+	int32 NumPartitions = 0;
+	int32 Fill          = 0; // frames into the current block
+	int32 Head          = 0; // delay-line slot of the newest input spectrum
+
+	Audio::FAlignedFloatBuffer Window;    // [Channel][FFTSize]: last block, then the one filling
+	Audio::FAlignedFloatBuffer Output;    // [Channel][BlockFrames]: what the last block produced
+	Audio::FAlignedFloatBuffer DelayReal; // [Channel][Capacity][BinStride]
+	Audio::FAlignedFloatBuffer DelayImag;
+	Audio::FAlignedFloatBuffer AccReal;   // [BinStride]
+	Audio::FAlignedFloatBuffer AccImag;
+	Audio::FAlignedFloatBuffer Spectrum;  // the FFT's interleaved layout
+	Audio::FAlignedFloatBuffer Time;      // [FFTSize]
+};
+
+/**
+ * Two convolvers and an equal-power cross-fade between them. A room change loads the new impulse
+ * into the quieter convolver and fades across; once a fade is done only one convolver runs.
+ */
+class GAMETEMPLATE_API FConvolutionRoom
+{
+public:
+	void Init(float InSampleRate, int32 InNumChannels);
+
+	// Sizes both convolvers for impulses of up to MaxPartitions blocks of BlockFrames (allocates)
+	void Prepare(int32 BlockFrames, int32 MaxPartitions);
+
+	void CrossfadeTo(FConvolutionImpulsePtr InImpulse, float Seconds);
+
+	// Adds the room's response to In into Out
+	void ProcessAdd(const float* In, float* Out, int32 NumFrames);
+
+	// True once a room has been set
+	bool IsActive() const { return Slots[0].HasImpulse() || Slots[1].HasImpulse(); }
+
+	// How far the incoming room has faded in, 0..1 (1 when no fade is under way)
+	float GetProgress() const { return Progress; }
+
+private:
+	FPartitionedConvolver Slots[2];
+	float SampleRate  = 48000.f;
+	int32 NumChannels = 2;
+
+	int32 Incoming     = 0;   // slot faded in (or fully in)
+	float FadeOutFrom  = 0.f; // outgoing slot's gain when the fade began
+	float Progress     = 1.f;
+	float ProgressStep = 0.f; // per frame
+};
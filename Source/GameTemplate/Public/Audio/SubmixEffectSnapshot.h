@@ -0,0 +1,156 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Audio/MusicBusKernel.h"
+#include "Audio/PartitionedConvolver.h"
+#include "DSP/Dsp.h"
+#include "DSP/MultithreadedPatching.h"
+#include "DSP/ReverbFast.h"
+#include "Sound/SoundEffectSubmix.h"
+#include "Sound/SoundSubmix.h"
+#include "World/Managers/SnapshotTypes.h"
+#include "SubmixEffectSnapshot.generated.h"
+
+namespace Audio
+{
+	class FMixerDevice;
+}
+
+// Everything the snapshot effect needs that is not part of a look
+USTRUCT(BlueprintType)
+struct GAMETEMPLATE_API FSubmixEffectSnapshotSettings
+{
+	GENERATED_BODY()
+
+	// Look the effect starts in before the first BlendTo
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot")
+	FSnapshotTargets Initial;
+
+	// Centre of the high shelf driven by EQHighShelfGainDb
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot|EQ", meta=(ClampMin="1000.0", ClampMax="20000.0"))
+	float ShelfFrequencyHz = 10000.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot|EQ", meta=(ClampMin="0.1", ClampMax="2.0"))
+	float ShelfBandwidth = 0.7f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot|Compressor", meta=(ClampMin="1.0", ClampMax="20.0"))
+	float CompRatio = 4.f;
+
+	// Submix that keys the compressor (the VO submix); the music keys itself when null
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot|Compressor")
+	TObjectPtr<USoundSubmix> KeySubmix = nullptr;
+
+	// Parameter ramps are re-evaluated every this many frames inside an audio block
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot|Advanced", meta=(ClampMin="8", ClampMax="1024"))
+	int32 ControlBlockFrames = 32;
+};
+
+/**
+ * Filter -> high shelf -> compressor -> reverb send for the music bus, in one effect.
+ * The dry chain runs through FMusicBusKernel, so each slice is a single SIMD pass. The send goes
+ * to a plate until a measured room is set, then through FConvolutionRoom; the plate fades out
+ * across the first room's cross-fade.
+ * The game thread sends one BlendTo per snapshot change; every parameter then ramps on the
+ * audio render thread, re-evaluated each ControlBlockFrames so blends never step per game frame.
+ */
+class GAMETEMPLATE_API FSubmixEffectSnapshot : public FSoundEffectSubmix
+{
+public:
+	FSubmixEffectSnapshot();
+	virtual ~FSubmixEffectSnapshot() override;
+
+	virtual void Init(const FSoundEffectSubmixInitData& InData) override;
+	virtual void OnPresetChanged() override;
+	virtual uint32 GetDesiredInputChannelCountOverride() const override { return 2; }
+	virtual void OnProcessAudio(const FSoundEffectSubmixInputData& InData, FSoundEffectSubmixOutputData& OutData) override;
+
+	// Audio render thread: ramp every look parameter toward Targets over BlendSeconds
+	void BlendTo(const FSnapshotTargets& Targets, float BlendSeconds);
+
+	// Audio render thread: size the room convolvers (allocates; instances made later size themselves in Init
+	// from the preset), then cross-fade between rooms
+	void PrepareRoom(int32 BlockFrames, int32 MaxPartitions);
+	void SetRoom(FConvolutionImpulsePtr Impulse, float CrossfadeSeconds);
+
+private:
+	void SetKeySubmix(uint32 SubmixId);
+	void ApplyControlValues();
+
+	float SampleRate = 48000.f;
+	int32 NumChannels = 2;
+	int32 ControlBlockFrames = 32;
+	float ShelfFrequencyHz = 10000.f;
+	float ShelfBandwidth = 0.7f;
+	float CompRatio = 4.f;
+
+	// Filter, shelf and compressor fused into one pass per slice
+	FMusicBusKernel MusicBus;
+	TUniquePtr<Audio::FPlateReverbFast> Reverb;
+	FConvolutionRoom Room;
+
+	// Per-parameter ramps, advanced by the number of frames rendered
+	Audio::FLinearEase CutoffEase;
+	Audio::FLinearEase ShelfEase;
+	Audio::FLinearEase AttackEase;
+	Audio::FLinearEase ReleaseEase;
+	Audio::FLinearEase ThresholdEase;
+	Audio::FLinearEase WetEase;
+
+	// Control values as of the last evaluated slice
+	float CutoffHz    = 20000.f;
+	float ShelfDb     = 0.f;
+	float AttackMs    = 10.f;
+	float ReleaseMs   = 120.f;
+	float ThresholdDb = -12.f;
+	float CurrentWet  = 0.f;
+	bool  bInitialLookApplied = false;
+
+	// Plate gain when the current room fade began: 1 before any room, 0 once a room is fully in
+	float PlateFadeFrom = 1.f;
+
+	// Sidechain key pulled from another submix
+	Audio::FMixerDevice*          MixerDevice = nullptr;
+	Audio::FPatchOutputStrongPtr  KeyPatch;
+	uint32                        KeySubmixId = INDEX_NONE;
+	int32                         KeyNumChannels = 0;
+
+	Audio::FAlignedFloatBuffer KeyBuffer;
+	Audio::FAlignedFloatBuffer WetBuffer;
+	Audio::FAlignedFloatBuffer PlateBuffer;
+};
+
+UCLASS(ClassGroup = AudioSourceEffect, meta = (BlueprintSpawnableComponent))
+class GAMETEMPLATE_API USubmixEffectSnapshotPreset : public USoundEffectSubmixPreset
+{
+	GENERATED_BODY()
+
+public:
+	EFFECT_PRESET_METHODS(SubmixEffectSnapshot)
+
+	// Send one ramp command to every running instance of this effect
+	UFUNCTION(BlueprintCallable, Category="Audio|Effects")
+	void BlendTo(const FSnapshotTargets& Targets, float BlendSeconds);
+
+	UFUNCTION(BlueprintCallable, Category="Audio|Effects")
+	void SetSettings(const FSubmixEffectSnapshotSettings& InSettings);
+
+	// Size every instance's room convolvers for the longest preloaded impulse, once, before SetRoom.
+	// Kept on the preset, so instances created afterwards are sized in Init instead of on first SetRoom.
+	void PrepareRoom(int32 BlockFrames, int32 MaxPartitions);
+
+	// Room size of the last PrepareRoom; MaxPartitions is 0 before any
+	void GetRoomSize(int32& OutBlockFrames, int32& OutMaxPartitions) const;
+
+	// Cross-fade every instance's reverb send to a pre-transformed room
+	void SetRoom(FConvolutionImpulsePtr Impulse, float CrossfadeSeconds);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SubmixEffectPreset, meta = (ShowOnlyInnerProperties))
+	FSubmixEffectSnapshotSettings Settings;
+
+private:
+	// Set on the game thread, read by instances initialising on the audio threads
+	std::atomic<int32> RoomBlockFrames { 0 };
+	std::atomic<int32> RoomMaxPartitions { 0 };
+};
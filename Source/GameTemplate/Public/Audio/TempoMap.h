@@ -0,0 +1,106 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "TempoMap.generated.h"
+
+/** A tempo and/or meter change, taking effect on a bar line */
+USTRUCT(BlueprintType)
+struct FTempoChange
+{
+	GENERATED_BODY()
+
+	/** Bar (0-based) the change starts on */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Tempo", meta=(ClampMin="0"))
+	int32 StartBar = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Tempo", meta=(ClampMin="10.0", ClampMax="400.0"))
+	float BPM = 150.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Tempo", meta=(ClampMin="1", ClampMax="32"))
+	int32 BeatsPerBar = 4;
+};
+
+/** Position on the tempo map */
+USTRUCT(BlueprintType)
+struct FTempoMapPosition
+{
+	GENERATED_BODY()
+
+	/** Beats since the start of the map (0-based) */
+	UPROPERTY(BlueprintReadOnly, Category="Tempo")
+	int32 Beat = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category="Tempo")
+	int32 Bar = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category="Tempo")
+	int32 BeatInBar = 0;
+
+	/** 0..1 through the current beat */
+	UPROPERTY(BlueprintReadOnly, Category="Tempo")
+	float Phase = 0.f;
+};
+
+/**
+ * Tempo and meter changes for a show, compiled into segments with cumulative start times,
+ * beats and bars. Every query is a binary search over the segments, so time -> beat/bar/phase
+ * and "next beat after t" are O(log n) however many changes the show has.
+ */
+UCLASS(BlueprintType)
+class GAMETEMPLATE_API UTempoMap : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Changes in any order; the first bar always has a tempo (the earliest change is moved to bar 0) */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Tempo")
+	TArray<FTempoChange> Changes;
+
+	/** Transient map with a single tempo, for callers that only have a BPM */
+	static UTempoMap* MakeConstant(UObject* Outer, float BPM, int32 BeatsPerBar = 4);
+
+	/** Sorts Changes and rebuilds the segment table (done on load and after edits) */
+	void Compile();
+
+	UFUNCTION(BlueprintPure, Category="Tempo")
+	FTempoMapPosition TimeToPosition(double Seconds) const;
+
+	/** Time of the first beat strictly after Seconds */
+	UFUNCTION(BlueprintPure, Category="Tempo")
+	double GetNextBeatTime(double Seconds) const;
+
+	UFUNCTION(BlueprintPure, Category="Tempo")
+	double BeatToTime(int32 Beat) const;
+
+	UFUNCTION(BlueprintPure, Category="Tempo")
+	double BarToTime(int32 Bar) const;
+
+	float GetBPMAtBeat(int32 Beat) const;
+	int32 GetBeatsPerBarAtBeat(int32 Beat) const;
+	FTempoMapPosition BeatToPosition(int32 Beat) const;
+
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	struct FSegment
+	{
+		double StartSeconds   = 0.0;
+		int32  StartBeat      = 0;
+		int32  StartBar       = 0;
+		double SecondsPerBeat = 0.4;
+		int32  BeatsPerBar    = 4;
+		float  BPM            = 150.f;
+	};
+
+	const FSegment& SegmentAtTime(double Seconds) const;
+	const FSegment& SegmentAtBeat(int32 Beat) const;
+	const FSegment& SegmentAtBar(int32 Bar) const;
+
+	TArray<FSegment> Segments;
+};
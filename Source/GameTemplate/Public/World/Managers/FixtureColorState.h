@@ -0,0 +1,63 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Per-fixture color blends kept as structure-of-arrays lanes (H, S, V, A and friends, one float
+ * array each), so Advance() evaluates four fixtures per SIMD pass instead of one LerpUsingHSV each.
+ * Every fixture has its own start, target, delay and duration on one shared blend clock.
+ * Hue takes the shortest way round, matching FLinearColor::LerpUsingHSV.
+ */
+class GAMETEMPLATE_API FFixtureColorState
+{
+public:
+	int32 Num() const { return NumFixtures; }
+
+	int32 Add(const FLinearColor& Color);
+	void RemoveAtSwap(int32 Index);
+	void Reset();
+
+	// Jump straight to Color
+	void SetColor(int32 Index, const FLinearColor& Color);
+
+	// Blend from the fixture's current color; Delay and Duration are seconds on the blend clock
+	void BlendTo(int32 Index, const FLinearColor& Target, float Delay, float Duration);
+
+	// Moves the blend clock origin to Time (so a new blend can start at 0) without disturbing blends in flight
+	void Rebase(float Time);
+
+	// Clock time at which the last running fixture reaches its target
+	float GetBlendEnd() const { return BlendEnd; }
+
+	// Evaluates every fixture at Time seconds on the blend clock
+	void Advance(float Time);
+
+	FLinearColor GetColor(int32 Index) const;
+
+	// Fixtures that moved more than DeadBand (any channel) since they were last marked pushed.
+	// bExact reports any difference at all.
+	void GatherDirty(float DeadBand, bool bExact, TArray<int32>& OutDirty) const;
+	void MarkPushed(int32 Index);
+
+private:
+	using FLanes = TArray<float, TAlignedHeapAllocator<16>>;
+
+	void SetNumLanes(int32 NumLanes);
+	void ForEachLanes(TFunctionRef<void(FLanes&)> Fn);
+
+	// Blend: value = Start + Delta * saturate((Time - Delay) * InvDuration)
+	FLanes StartH, StartS, StartV, StartA;
+	FLanes DeltaH, DeltaS, DeltaV, DeltaA;
+	FLanes Delay, InvDuration;
+
+	// Linear RGBA as of the last Advance / SetColor
+	FLanes R, G, B, A;
+
+	// Linear RGBA as of the last MarkPushed
+	FLanes PushedR, PushedG, PushedB, PushedA;
+
+	int32 NumFixtures = 0;
+	float BlendEnd    = 0.f;
+};
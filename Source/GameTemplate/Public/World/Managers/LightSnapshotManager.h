@@ -4,21 +4,33 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Audio/MusicAnalysisTap.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Sound/SoundSubmix.h"
 #include "World/StageLight.h"
+#include "World/StageLightRig.h"
 #include "World/Managers/AudioSnapshotManager.h"
+#include "World/Managers/FixtureColorState.h"
+#include "World/Managers/MoodLookTable.h"
+#include "World/Subsystems/SnapshotBlendSubsystem.h"
 #include "LightSnapshotManager.generated.h"
 
 UCLASS()
-class GAMETEMPLATE_API ALightSnapshotManager : public AActor
+class GAMETEMPLATE_API ALightSnapshotManager : public AActor, public ISnapshotBlendChannel
 {
 	GENERATED_BODY()
 
 public:
 	ALightSnapshotManager();
 	virtual void BeginPlay() override;
+	virtual void PostInitializeComponents() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaSeconds) override;
 
-	/** Auto-find AStageLight actors in level on BeginPlay */
+	/** Stepped by the USnapshotBlendSubsystem while a blend is in flight */
+	virtual void StepSnapshotBlend(float Alpha) override;
+
+	/** Take every AStageLight and AStageLightRig in the world, including ones spawned or streamed in later */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light")
 	bool bAutoFindLights = true;
 
@@ -26,10 +38,16 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light")
 	float DefaultBlendSeconds = 0.35f;
 
-	/** Optional: color lookup per snapshot enum */
+	/** Optional: per-level color overrides, read as the level loads; moods not listed here come from the mood look table */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Snapshots")
 	TMap<EAudioSnapshot, FLinearColor> SnapshotColorTable;
 
+	/** Show-wide looks (handed over by AAudioManager; the stock looks until then) */
+	void SetMoodLooks(UMoodLookTable* InMoodLooks) { MoodLooks = InMoodLooks; }
+
+	/** A mood's color: the level override, else the mood look table */
+	const FLinearColor* FindColor(EAudioSnapshot Snapshot) const;
+
 	/** Register/unregister fixtures (auto-done if bAutoFindLights = true) */
 	UFUNCTION(BlueprintCallable, Category="Light")
 	void RegisterLight(AStageLight* Light);
@@ -37,28 +55,184 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Light")
 	void UnregisterLight(AStageLight* Light);
 
+	/** Register/unregister every fixture of an instanced rig */
+	UFUNCTION(BlueprintCallable, Category="Light")
+	void RegisterRig(AStageLightRig* Rig);
+
+	UFUNCTION(BlueprintCallable, Category="Light")
+	void UnregisterRig(AStageLightRig* Rig);
+
 	/** Apply raw color (lerp Using HSV) to all registered lights */
 	UFUNCTION(BlueprintCallable, Category="Light")
 	void ApplyLightColor(const FLinearColor& TargetColor, float BlendSeconds = -1.f);
 
-	/** Apply color by snapshot enum (looks up in SnapshotColorTable) */
+	/** Apply color by snapshot enum (see FindColor) */
 	UFUNCTION(BlueprintCallable, Category="Light")
 	void ApplyLightSnapshot(EAudioSnapshot Snapshot, float BlendSeconds = -1.f);
 
+	/** Blend the fixtures of one group (None = every fixture) to TargetColor.
+	 *  HueSpread fans the hue across the group (degrees, centred on TargetColor);
+	 *  StaggerSeconds delays each successive fixture, for chases. */
+	UFUNCTION(BlueprintCallable, Category="Light")
+	void ApplyGroupColor(FName Group, const FLinearColor& TargetColor, float BlendSeconds = -1.f, float HueSpread = 0.f, float StaggerSeconds = 0.f);
+
+	/** Linear color change below this (per channel) is not pushed to a fixture */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light", meta=(ClampMin="0.0"))
+	float ColorDeadBand = 0.002f;
+
+	/** Collection the fixture heads' emissive reads the rig color from: one write recolors every head */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Batching")
+	TObjectPtr<UMaterialParameterCollection> FixtureCollection = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Batching")
+	FName FixtureColorParameter = TEXT("FixtureColor");
+
+	/** Collection scalars carrying the audio modulation: head materials scale their color by the gain
+	 *  and lerp it toward its luminance by 1 - saturation, so the music reaches every head in one write */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Batching")
+	FName FixtureGainParameter = TEXT("FixtureGain");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Batching")
+	FName FixtureSaturationParameter = TEXT("FixtureSaturation");
+
+	/** Also write each fixture's own color to its head's custom primitive data (0-3), for head
+	 *  materials that follow per-fixture and group colors rather than the rig color */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Batching")
+	bool bDriveHeadCustomData = false;
+
+	/** Submix the music plays through; when set, fixture intensity and saturation follow it on top of the snapshot color */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive")
+	TObjectPtr<USoundSubmix> ReactiveSubmix = nullptr;
+
+	/** Fixture groups whose beams follow the music (empty = every group); heads follow through the collection */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive")
+	TArray<FName> ReactiveGroups;
+
+	/** Band that drives intensity: the color is scaled by 1 + IntensityDepth * level */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive")
+	EMusicAnalysisBand IntensityBand = EMusicAnalysisBand::Low;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive", meta=(ClampMin="0.0", ClampMax="4.0"))
+	float IntensityDepth = 0.5f;
+
+	/** Band that drives saturation: full snapshot saturation at full level, washed out by SaturationDepth at silence */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive")
+	EMusicAnalysisBand SaturationBand = EMusicAnalysisBand::Full;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive", meta=(ClampMin="0.0", ClampMax="1.0"))
+	float SaturationDepth = 0.3f;
+
+	/** Band level (dBFS) mapped to 0 and to 1 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive")
+	float ReactiveFloorDb = -48.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive")
+	float ReactiveCeilingDb = -9.f;
+
+	/** Envelope smoothing (sec) on the game thread */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive", meta=(ClampMin="0.0"))
+	float ReactiveAttack = 0.03f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Audio Reactive", meta=(ClampMin="0.0"))
+	float ReactiveRelease = 0.25f;
+
+	/** Output of the USnapshotMixerSubsystem: the whole rig to an already mixed color, replacing any own blend.
+	 *  Fixtures keep the hue, saturation and value offsets their last ApplyGroupColor gave them. */
+	void ApplyMixedColor(const FLinearColor& Color, bool bExact);
+
+	FLinearColor GetCurrentColor() const { return CurrentColor; }
+
+	int32 GetNumFixtures() const { return Fixtures.Num(); }
+	uint64 GetNumPushed() const { return NumPushed; }
+	uint64 GetNumSuppressed() const { return NumSuppressed; }
+
+	/** Smoothed 0..1 levels driving intensity and saturation */
+	float GetIntensityLevel() const { return IntensityLevel; }
+	float GetSaturationLevel() const { return SaturationLevel; }
+
 private:
-	TArray<TWeakObjectPtr<AStageLight>> Lights;
+	// The level's overrides as of PostInitializeComponents, indexed by mood
+	TMoodOverrides<FLinearColor> Overrides;
+
+	// Fixture i is Owners[i], RigSlots[i], Groups[i], Beams[i], PushedBeamColors[i], Heads[i] and lane i of Fixtures.
+	// Owner is an AStageLight (RigSlot INDEX_NONE) or the AStageLightRig holding instance RigSlot.
+	TArray<TWeakObjectPtr<AActor>> Owners;
+	TArray<int32> RigSlots;
+	TArray<FName> Groups;
+
+	// Per fixture HSV offset from the rig color (hue degrees, saturation, value) set by
+	// ApplyGroupColor and cleared by ApplyLightColor; mixed colors are pushed through it
+	TArray<FVector3f> GroupOffsets;
+	bool bHasGroupOffsets = false;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<USpotLightComponent>> Beams;
 
-	// Blend state
-	bool bBlending = false;
-	float BlendElapsed = 0.f;
+	// Modulated color each beam was last lit with, for the dead-band on modulation-only pushes
+	TArray<FLinearColor> PushedBeamColors;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UStaticMeshComponent>> Heads;
+
+	FFixtureColorState Fixtures;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UMaterialParameterCollectionInstance> FixtureCollectionInstance = nullptr;
+
+	// Blend clock (elapsed time is tracked by the blend scheduler; it runs 0..BlendDuration)
 	float BlendDuration = 0.35f;
+	float ClockTime = 0.f;
 
+	// Rig color: what new fixtures start with and what the collection carries
 	FLinearColor StartColor = FLinearColor::White;
 	FLinearColor TargetColor = FLinearColor::White;
 	FLinearColor CurrentColor = FLinearColor::White;
+	FLinearColor PushedRigColor = FLinearColor::Transparent;
+	float RigBlendStart = 0.f;
+	float RigBlendDuration = 0.f;
+
+	TArray<int32> DirtyFixtures;
+	TArray<AStageLightRig*> TouchedRigs;
+	bool bNeedsPrune = false;
 
-	void BeginBlendTo(const FLinearColor& InTarget, float InBlend);
-	void PushColorAll(const FLinearColor& Color);
+	uint64 NumPushed = 0;
+	uint64 NumSuppressed = 0;
+
+	void BeginBlendSetup();
+	void FinishBlendSetup();
+	void Evaluate(float Time);
+	void PushDirty(bool bExact);
+	void PushReactiveBeams();
+	void PruneLights();
+	int32 AddFixture(AActor* Owner, int32 RigSlot, FName Group, USpotLightComponent* Beam, UStaticMeshComponent* Head);
+	void RemoveFixtureAt(int32 Index);
 	void AutoFindAllLights();
-	void BuildDefaultSnapshotColors();
+	void HandleStageActorRegistered(AActor* Actor, UClass* Category);
+	void HandleStageActorUnregistered(AActor* Actor, UClass* Category);
+
+	// Audio reactive modulation: Gain * (Luma + (Color - Luma) * Saturation), applied to the beams as
+	// they are pushed; the heads apply it from the collection's gain and saturation
+	void StartAudioReactive();
+	void StopAudioReactive();
+	void UpdateAudioReactive(float DeltaSeconds);
+	float LevelOf(const FMusicAnalysisFrame& Frame, EMusicAnalysisBand Band) const;
+	FLinearColor Modulate(const FLinearColor& Color) const;
+
+	TSharedPtr<FMusicAnalysisTap, ESPMode::ThreadSafe> ReactiveTap;
+	float IntensityLevel = 0.f;
+	float SaturationLevel = 1.f;
+	float IntensityTarget = 0.f;
+	float SaturationTarget = 1.f;
+	float TimeSinceFrame = 0.f;
+	float ReactiveGain = 1.f;
+	float ReactiveSaturation = 1.f;
+	float PushedGain = 1.f;
+	float PushedSaturation = 1.f;
+	bool  bReactive = false;
+
+	FDelegateHandle RegisteredHandle;
+	FDelegateHandle UnregisteredHandle;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UMoodLookTable> MoodLooks = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,176 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "World/Managers/MoodSpace.h"
+#include "World/Managers/SnapshotTypes.h"
+#include "MoodLookTable.generated.h"
+
+class UMoodLookTable;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnMoodLooksChanged, UMoodLookTable*);
+
+/** Everything one mood sets: the music bus, the post look and the rig color */
+USTRUCT(BlueprintType)
+struct FMoodLook
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	EAudioSnapshot Mood = EAudioSnapshot::CELESTIAL;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	FSnapshotTargets Audio;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	FPostSnapshotTargets Post;
+
+	// Linear
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	FLinearColor Light = FLinearColor::White;
+
+	// Also a point of the 2D mood space
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood|Space")
+	bool bInMoodSpace = false;
+
+	// X = valence (-1 dark .. 1 bright), Y = energy (0 still .. 1 intense)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood|Space", meta=(EditCondition="bInMoodSpace"))
+	FVector2D MoodSpacePosition = FVector2D::ZeroVector;
+};
+
+/** A look placed in the 2D mood space only (an in-between mood with no EAudioSnapshot of its own) */
+USTRUCT(BlueprintType)
+struct FMoodSpacePoint
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	FName Name;
+
+	// X = valence (-1 dark .. 1 bright), Y = energy (0 still .. 1 intense)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	FVector2D Position = FVector2D::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	FSnapshotTargets Audio;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	FPostSnapshotTargets Post;
+
+	// Linear
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Mood")
+	FLinearColor Light = FLinearColor::White;
+};
+
+/** A manager's per-level overrides, authored as a map and flattened to slots indexed by
+ *  EAudioSnapshot when play begins, so a lookup is an index as in the mood look table */
+template<typename T>
+class TMoodOverrides
+{
+public:
+	void Build(const TMap<EAudioSnapshot, T>& Overrides)
+	{
+		const int32 NumMoods = StaticEnum<EAudioSnapshot>()->GetMaxEnumValue();
+		Dense.Reset();
+		Dense.SetNum(Overrides.Num() > 0 ? NumMoods : 0);
+		Defined.Init(false, Dense.Num());
+
+		for (const TPair<EAudioSnapshot, T>& Override : Overrides)
+		{
+			const int32 Index = static_cast<int32>(Override.Key);
+			if (Dense.IsValidIndex(Index))
+			{
+				Dense[Index]   = Override.Value;
+				Defined[Index] = true;
+			}
+		}
+	}
+
+	const T* Find(EAudioSnapshot Mood) const
+	{
+		const int32 Index = static_cast<int32>(Mood);
+		return Defined.IsValidIndex(Index) && Defined[Index] ? &Dense[Index] : nullptr;
+	}
+
+private:
+	TArray<T> Dense;
+	TArray<bool> Defined;
+};
+
+/**
+ * One show's mood looks (audio, post and light together), loaded through the Asset Manager.
+ * The authored list is flattened on save into a dense array indexed by EAudioSnapshot, so a
+ * cooked table is looked up by index with no hashing. Looks can be retuned at runtime from a
+ * JSON or CSV file (mood.ReloadLooks); listeners of OnLooksChanged pick the new values up.
+ */
+UCLASS(BlueprintType)
+class GAMETEMPLATE_API UMoodLookTable : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	static const FPrimaryAssetType PrimaryAssetType;
+
+	// One entry per mood (a later duplicate wins; moods left out have no look)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Mood", meta=(TitleProperty="Mood"))
+	TArray<FMoodLook> Moods;
+
+	// Looks placed in the mood space besides the moods marked bInMoodSpace
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Mood|Space", meta=(TitleProperty="Name"))
+	TArray<FMoodSpacePoint> SpacePoints;
+
+	// JSON or CSV retune file for mood.ReloadLooks (relative paths are under the project directory)
+	UPROPERTY(EditAnywhere, Category="Mood|Hot Reload", meta=(FilePathFilter="Look files (*.json;*.csv)|*.json;*.csv"))
+	FString HotReloadFile;
+
+	FOnMoodLooksChanged OnLooksChanged;
+
+	const FMoodLook* Find(EAudioSnapshot Mood) const
+	{
+		const int32 Index = static_cast<int32>(Mood);
+		return Defined.IsValidIndex(Index) && Defined[Index] ? &Dense[Index] : nullptr;
+	}
+
+	/** Rebuild the dense table from Moods, and the mood space */
+	void Flatten();
+
+	/** Every look in the mood space (placed moods first, then SpacePoints), triangulated on load */
+	const FMoodSpace& GetMoodSpace() const { return MoodSpace; }
+	const TArray<FMoodSpacePoint>& GetSpaceLooks() const { return SpaceLooks; }
+
+	/**
+	 * Merge looks from a JSON array of FMoodLook objects or a CSV with a Mood column and
+	 * Audio.<Field> / Post.<Field> / Light.<R|G|B|A> columns. Fields a file leaves out keep their
+	 * value. Returns false (and changes nothing) if the file can't be read or parsed.
+	 */
+	UFUNCTION(BlueprintCallable, Category="Mood")
+	bool ReloadFromFile(const FString& Path);
+
+	/** A new copy of the stock looks; worlds share one through UMoodLookSubsystem::GetDefaultLooks */
+	static UMoodLookTable* MakeDefault(UObject* Outer);
+
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+	virtual void PostLoad() override;
+	virtual void PreSave(FObjectPreSaveContext SaveContext) override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	bool ParseJson(const FString& Text, TArray<FMoodLook>& OutLooks) const;
+	bool ParseCsv(const FString& Text, TArray<FMoodLook>& OutLooks) const;
+	void Merge(const FMoodLook& Look);
+	void BuildMoodSpace();
+
+	// Cooked with the asset: slot i is mood i
+	UPROPERTY()
+	TArray<FMoodLook> Dense;
+
+	UPROPERTY()
+	TArray<bool> Defined;
+
+	TArray<FMoodSpacePoint> SpaceLooks;
+	FMoodSpace MoodSpace;
+};
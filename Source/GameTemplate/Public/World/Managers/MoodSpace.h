@@ -0,0 +1,64 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Up to three looks around a mood-space position and their barycentric weights (unused slots are INDEX_NONE, 0) */
+struct FMoodSpaceWeights
+{
+	int32 Points[3]  = { INDEX_NONE, INDEX_NONE, INDEX_NONE };
+	float Weights[3] = { 0.f, 0.f, 0.f };
+};
+
+/**
+ * Looks placed as points in a 2D mood space (X = valence, Y = energy). Build runs a Delaunay
+ * triangulation once and cuts the plane into vertical slabs at every vertex X; the edges crossing a
+ * slab never cross each other there, so they are kept sorted by height. Locate is a binary search
+ * for the slab and one for the edge below the position, which gives the enclosing triangle in
+ * O(log n) however many looks are authored. Outside the hull the position is clamped onto the
+ * nearest hull edge.
+ */
+class GAMETEMPLATE_API FMoodSpace
+{
+public:
+	/** Triangulate Points (coincident points after the first are left out of the mesh) */
+	void Build(TArrayView<const FVector2f> InPoints);
+	void Reset();
+
+	int32 NumPoints() const { return Points.Num(); }
+	int32 NumTriangles() const { return Triangles.Num(); }
+	const FVector2f& GetPoint(int32 Index) const { return Points[Index]; }
+
+	FMoodSpaceWeights Locate(const FVector2f& Position) const;
+
+	/** Enclosing triangle of Position, or INDEX_NONE outside the hull */
+	int32 FindTriangle(const FVector2f& Position) const;
+
+	const FIntVector3& GetTriangle(int32 Index) const { return Triangles[Index]; }
+
+private:
+	struct FSlabEdge
+	{
+		int32 A = INDEX_NONE;   // left end
+		int32 B = INDEX_NONE;   // right end
+		int32 Above = INDEX_NONE;
+	};
+
+	void Triangulate();
+	void BuildSlabs();
+	float EdgeHeightAt(const FSlabEdge& Edge, float X) const;
+	FMoodSpaceWeights Barycentric(int32 Triangle, const FVector2f& Position) const;
+	FMoodSpaceWeights ClampToHull(const FVector2f& Position) const;
+
+	TArray<FVector2f>   Points;
+	TArray<FIntVector3> Triangles; // counter-clockwise
+
+	// Slab s spans [SlabX[s], SlabX[s + 1]]; its edges are SlabEdges[SlabFirst[s] .. SlabFirst[s + 1]), bottom first
+	TArray<float>     SlabX;
+	TArray<int32>     SlabFirst;
+	TArray<FSlabEdge> SlabEdges;
+
+	// Edges with a triangle on one side only (or the point chain, if the points are collinear)
+	TArray<FIntPoint> HullEdges;
+};
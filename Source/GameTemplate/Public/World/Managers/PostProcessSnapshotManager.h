@@ -5,78 +5,138 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Engine/PostProcessVolume.h"
+#include "Components/PostProcessComponent.h"
 #include "World/Managers/AudioSnapshotManager.h"
+#include "World/Managers/MoodLookTable.h"
+#include "World/Managers/SnapshotBlender.h"
+#include "World/Managers/SnapshotChannels.h"
+#include "World/Subsystems/SnapshotBlendSubsystem.h"
+#include "World/Subsystems/SnapshotMixerSubsystem.h"
 #include "PostProcessSnapshotManager.generated.h"
 
-// Tunable targets we will interpolate toward
-USTRUCT(BlueprintType)
-struct FPostSnapshotTargets
-{
-	GENERATED_BODY()
-
-	// 1.0 = neutral for Sat/Contrast; others are absolute
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
-	float Saturation = 1.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
-	float Contrast = 1.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
-	float Vignette = 0.2f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
-	float BloomIntensity = 0.2f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
-	float BloomThreshold = 1.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
-	float SceneFringe = 0.0f; // Chromatic aberration
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
-	float Grain = 0.0f;
-};
-
+/**
+ * Drives the post look through two unbound post-process layers owned by this actor. Every
+ * snapshot's FPostProcessSettings is built once on BeginPlay; a blend copies the incoming look
+ * into the upper layer and then only moves that layer's BlendWeight, so the per-frame cost is
+ * the same however many post fields a look overrides. The engine does the per-field lerp.
+ */
 UCLASS()
-class GAMETEMPLATE_API APostProcessSnapshotManager : public AActor
+class GAMETEMPLATE_API APostProcessSnapshotManager : public AActor, public ISnapshotBlendChannel
 {
 	GENERATED_BODY()
 
 public:
 	APostProcessSnapshotManager();
 	virtual void BeginPlay() override;
-	virtual void Tick(float DeltaSeconds) override;
+	virtual void PostInitializeComponents() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	// Assign the volume you want to drive (auto-finds an unbound one if null)
+	// Stepped by the USnapshotBlendSubsystem while a blend is in flight
+	virtual void StepSnapshotBlend(float Alpha) override;
+
+	// The level's base volume: the starting look is read from it and the snapshot layers sit above
+	// its priority (auto-finds an unbound one if null)
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
 	TObjectPtr<APostProcessVolume> TargetVolume = nullptr;
 
-	// Force Unbound on the target (useful for a single global look)
+	// Force Unbound on the base volume (useful for a single global look)
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
 	bool bForceUnbound = true;
 
-	// Table of looks keyed by the same enum you use for audio
+	// Per-level look overrides keyed by the same enum you use for audio, read as the level loads;
+	// moods not listed here come from the mood look table
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post|Snapshots")
 	TMap<EAudioSnapshot, FPostSnapshotTargets> SnapshotTable;
 
+	// Show-wide looks (handed over by AAudioManager; the stock looks until then). Call
+	// RebuildLookPool after changing them.
+	void SetMoodLooks(UMoodLookTable* InMoodLooks) { MoodLooks = InMoodLooks; }
+
+	// A mood's look: the level override, else the mood look table
+	const FPostSnapshotTargets* FindLook(EAudioSnapshot Snapshot) const;
+
+	// Rebuild every prebuilt look; a settled snapshot look takes its new values at once
+	void RebuildLookPool();
+
 	// Apply a look over BlendTimeSeconds
 	UFUNCTION(BlueprintCallable, Category="Post|Snapshots")
 	void ApplyPostSnapshot(EAudioSnapshot Snapshot, float BlendTimeSeconds = 0.35f);
 
+	// A blend weight this close to the last pushed one is not written again
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post|Snapshots", meta=(ClampMin="0.0"))
+	float DeadBand = 0.002f;
+
+	const FSnapshotChannels& GetPushChannels() const { return PushChannels; }
+
+	// Output of the USnapshotMixerSubsystem: one engine post layer per mixer layer (bottom first),
+	// holding that snapshot's prebuilt look at the layer's weight. Additive layers stack as override.
+	void ApplyMixedLayers(TArrayView<const FSnapshotLayerWeight> MixLayers);
+
+	// Output of the UMoodSpaceSubsystem: prebuilt looks with barycentric weights (summing to at most
+	// 1), stacked as engine post layers whose weights reproduce that blend. Looks must stay alive
+	// until the next call or InvalidateMixedLooks.
+	void ApplyWeightedLooks(TArrayView<const FPostProcessSettings* const> Looks, TArrayView<const float> Weights);
+
+	// The looks behind the mixed layers changed in place; copy them again on the next mix
+	void InvalidateMixedLooks();
+
+	// Settings a look resolves to (every field it drives, with its override enabled)
+	static FPostProcessSettings BuildLookSettings(const FPostSnapshotTargets& Look);
+
 private:
-	// Interp state
-	bool  bBlending = false;
-	float BlendElapsed = 0.f;
+	// The level's overrides as of PostInitializeComponents, indexed by mood
+	TMoodOverrides<FPostSnapshotTargets> Overrides;
+
+	UPROPERTY(VisibleAnywhere, Category="Post")
+	TObjectPtr<USceneComponent> SceneRoot;
+
+	// Settled look at weight 1, and the incoming look whose weight the blend moves (fixed roles:
+	// the world sorts its post volumes by priority only as they register)
+	UPROPERTY(VisibleAnywhere, Category="Post")
+	TObjectPtr<UPostProcessComponent> LayerA;
+
+	UPROPERTY(VisibleAnywhere, Category="Post")
+	TObjectPtr<UPostProcessComponent> LayerB;
+
+	UPostProcessComponent* BaseLayer     = nullptr;
+	UPostProcessComponent* IncomingLayer = nullptr;
+
+	// Layers driven by the mixer or the mood space, and the look each one currently holds
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UPostProcessComponent>> MixerLayers;
+
+	TArray<const FPostProcessSettings*> MixerLayerLooks;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UMoodLookTable> MoodLooks = nullptr;
+
+	// Prebuilt settings per snapshot, indexed by EAudioSnapshot value
+	TArray<FPostProcessSettings> LookPool;
+	TArray<bool> LookBuilt;
+
+	// Snapshot the two blend layers last moved to
+	int32 TargetLook = INDEX_NONE;
+
+	// Interp state (elapsed time is tracked by the blend scheduler)
 	float BlendDuration = 0.35f;
+	float BlendAlpha    = 1.f;
 
 	FPostSnapshotTargets Current;
 	FPostSnapshotTargets Start;
 	FPostSnapshotTargets Target;
+	TSnapshotBlender<FPostSnapshotTargets> Blender;
+
+	// Last pushed blend weight, plus pushed/suppressed counters
+	FSnapshotChannels PushChannels;
 
 	// Helpers
 	void AutoFindTargetVolume();
 	void SnapshotFromVolume(FPostSnapshotTargets& Out) const;
-	void PushToVolume(const FPostSnapshotTargets& Values) const;
-	void BeginBlendTo(const FPostSnapshotTargets& NewTarget, float InBlend);
-	void BuildDefaultSnapshotTable();
+	void SetupLayers();
+	void PushWeight(float Alpha, bool bExact);
+	void SettleIncomingLayer();
+	static void SetLayerPriority(UPostProcessComponent* Layer, float Priority);
+	void BeginBlendTo(const FPostSnapshotTargets& NewTarget, const FPostProcessSettings& NewSettings, float InBlend);
+	const FPostProcessSettings* FindLookSettings(EAudioSnapshot Snapshot) const;
+	void SetMixerLayers(TArrayView<const FPostProcessSettings* const> Looks, TArrayView<const float> LayerWeights);
 };
\ No newline at end of file
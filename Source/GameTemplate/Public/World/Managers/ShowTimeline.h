@@ -0,0 +1,72 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FNarrationLine;
+class UNarrationCueData;
+
+enum class EShowEventType : uint8
+{
+	LineStart,     // hold point: playback waits here for the player to trigger the line
+	Snapshot,      // audio, post and light snapshots of the line
+	Stage,         // game stage change
+	VoiceStart,
+	SubtitleShow,  // Item = subtitle segment
+	SubtitleClear,
+	LineEnd
+};
+
+struct FShowEvent
+{
+	double         Time = 0.0;
+	EShowEventType Type = EShowEventType::LineStart;
+	int32          Line = INDEX_NONE;
+	int32          Item = INDEX_NONE;
+
+	// State in effect once this event has run: index of the last event of each kind (INDEX_NONE = none yet)
+	int32 LastSnapshot = INDEX_NONE;
+	int32 LastSubtitle = INDEX_NONE;
+	int32 LastStage    = INDEX_NONE;
+};
+
+/**
+ * Narration lines compiled into one time-sorted event stream. Lines are laid end to end on a show
+ * time axis; each event carries the index of the last snapshot, subtitle and stage event at or
+ * before it, so the state at any time is one binary search away (seek, skip, rehearsal jumps).
+ */
+class GAMETEMPLATE_API FShowTimeline
+{
+public:
+	/** Cues, when given, supply exact durations and subtitle clear times instead of runtime queries */
+	void Compile(const TArray<FNarrationLine>& Lines, const UNarrationCueData* Cues = nullptr);
+	void Reset();
+
+	/**
+	 * Pushes Line's end, and every later line, out so the line lasts at least Seconds (a voice
+	 * longer than the layout knew). False if it already does. Event indices don't change, so a
+	 * running cursor stays valid.
+	 */
+	bool ExtendLine(int32 Line, double Seconds);
+
+	int32 Num() const { return Events.Num(); }
+	bool IsValidIndex(int32 Index) const { return Events.IsValidIndex(Index); }
+	const FShowEvent& GetEvent(int32 Index) const { return Events[Index]; }
+
+	/** First event after Time; events at exactly Time count as already run */
+	int32 FindNextEvent(double Time) const;
+
+	int32 NumLines() const { return LineStarts.Num(); }
+	int32 GetLineAtTime(double Time) const;
+	int32 GetLineFirstEvent(int32 Line) const { return LineFirstEvent[Line]; }
+	double GetLineStart(int32 Line) const { return LineStarts[Line]; }
+	double GetLineEnd(int32 Line) const { return LineEnds[Line]; }
+	double GetDuration() const { return LineEnds.Num() > 0 ? LineEnds.Last() : 0.0; }
+
+private:
+	TArray<FShowEvent> Events;
+	TArray<double>     LineStarts;
+	TArray<double>     LineEnds;
+	TArray<int32>      LineFirstEvent;
+};
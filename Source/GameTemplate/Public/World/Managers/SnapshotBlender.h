@@ -0,0 +1,101 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Class.h"
+
+/**
+ * The float fields of a USTRUCT, found once by reflection and packed as contiguous lanes (padded
+ * to a multiple of four). Adding a UPROPERTY float to a look struct adds a lane; nothing else.
+ */
+class GAMETEMPLATE_API FSnapshotFieldLayout
+{
+public:
+	explicit FSnapshotFieldLayout(const UScriptStruct* Struct);
+
+	int32 Num() const { return Offsets.Num(); }
+	int32 NumLanes() const { return Align(Offsets.Num(), 4); }
+
+	// Value's float fields into Lanes[0..Num), and back (other fields of OutValue are left alone)
+	void Pack(const void* Value, float* OutLanes) const;
+	void Unpack(const float* Lanes, void* OutValue) const;
+
+	const FString& GetStructName() const { return StructName; }
+	FName GetFieldName(int32 Lane) const { return Names[Lane]; }
+
+private:
+	TArray<int32> Offsets;
+	TArray<FName> Names;
+	FString StructName;
+};
+
+/** Out = Start + Delta * Alpha over NumLanes aligned lanes (a multiple of four), one SIMD register at a time */
+GAMETEMPLATE_API void SnapshotLerpLanes(const float* Start, const float* Delta, float Alpha, float* Out, int32 NumLanes);
+
+/** Reflected struct for T (engine base structures have no T::StaticStruct) */
+template<typename T>
+struct TSnapshotStruct
+{
+	static UScriptStruct* Get() { return T::StaticStruct(); }
+};
+
+template<>
+struct TSnapshotStruct<FLinearColor>
+{
+	static UScriptStruct* Get() { return TBaseStructure<FLinearColor>::Get(); }
+};
+
+/**
+ * Blends whole look structs: Begin packs the start and the delta once, Evaluate is one SIMD lerp
+ * over every float field and an unpack. Non-float fields come from the target.
+ */
+template<typename T>
+class TSnapshotBlender
+{
+public:
+	static const FSnapshotFieldLayout& GetLayout()
+	{
+		static const FSnapshotFieldLayout Layout(TSnapshotStruct<T>::Get());
+		return Layout;
+	}
+
+	void Begin(const T& From, const T& To)
+	{
+		const FSnapshotFieldLayout& Layout = GetLayout();
+		const int32 NumLanes = Layout.NumLanes();
+
+		Start.SetNumZeroed(NumLanes);
+		Delta.SetNumZeroed(NumLanes);
+		Lanes.SetNumZeroed(NumLanes);
+		Layout.Pack(&From, Start.GetData());
+		Layout.Pack(&To,   Lanes.GetData());
+
+		// Delta = To - From, with the same kernel at Alpha = -1 against To
+		SnapshotLerpLanes(Lanes.GetData(), Start.GetData(), -1.f, Delta.GetData(), NumLanes);
+
+		Result = To;
+	}
+
+	const T& Evaluate(float Alpha)
+	{
+		SnapshotLerpLanes(Start.GetData(), Delta.GetData(), Alpha, Lanes.GetData(), Lanes.Num());
+		GetLayout().Unpack(Lanes.GetData(), &Result);
+		return Result;
+	}
+
+	static T Lerp(const T& From, const T& To, float Alpha)
+	{
+		TSnapshotBlender Blender;
+		Blender.Begin(From, To);
+		return Blender.Evaluate(Alpha);
+	}
+
+private:
+	using FLanes = TArray<float, TAlignedHeapAllocator<16>>;
+
+	FLanes Start;
+	FLanes Delta;
+	FLanes Lanes;
+	T Result;
+};
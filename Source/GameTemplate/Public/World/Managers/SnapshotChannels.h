@@ -0,0 +1,37 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Remembers the last value pushed on each snapshot channel and filters out pushes that would not
+ * be noticed. A channel is only pushed again once it moves past its dead-band (e.g. 0.1 dB, 1 Hz),
+ * so a blend that only touches two fields stops rewriting the other four every frame.
+ */
+class GAMETEMPLATE_API FSnapshotChannels
+{
+public:
+	// Forget every channel; channels are also added as they are first tested
+	void Init(int32 NumChannels);
+
+	// True when Channel has to be pushed; Value is then recorded as the last pushed value.
+	// DeadBand is in the channel's own units and read by the caller each push, so edits apply at once.
+	// bExact ignores the dead-band, so the final step of a blend always lands on the target.
+	bool Test(int32 Channel, float Value, float DeadBand, bool bExact = false);
+
+	// Next Test on every channel pushes (e.g. after the pushed-to object changed)
+	void Invalidate();
+
+	int32 Num() const { return LastPushed.Num(); }
+	uint64 GetNumPushed() const { return NumPushed; }
+	uint64 GetNumSuppressed() const { return NumSuppressed; }
+	void ResetCounters() { NumPushed = NumSuppressed = 0; }
+
+private:
+	TArray<float, TInlineAllocator<8>> LastPushed;
+	TArray<bool,  TInlineAllocator<8>> bHasPushed;
+
+	uint64 NumPushed     = 0;
+	uint64 NumSuppressed = 0;
+};
@@ -0,0 +1,75 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SnapshotTypes.generated.h"
+
+UENUM(BlueprintType)
+enum class EAudioSnapshot : uint8
+{
+	CELESTIAL,
+	TERRESTRIAL,
+	CONFLICT,
+	MOURNING,
+	FAMILY,
+	SCIENCE_CRIME,
+	ART,
+	VICE,
+	BETRAYAL,
+	POLITICS,
+	REFLECTION
+};
+
+USTRUCT(BlueprintType)
+struct FSnapshotTargets
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot")
+	float FilterCutoffHz = 20000.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot")
+	float EQHighShelfGainDb = 0.f; // high-shelf @ ~10k
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot")
+	float CompAttackMs = 10.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot")
+	float CompReleaseMs = 120.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot")
+	float CompThresholdDb = -12.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Snapshot")
+	float ReverbWet = 0.30f;
+};
+
+// Tunable targets we will interpolate toward
+USTRUCT(BlueprintType)
+struct FPostSnapshotTargets
+{
+	GENERATED_BODY()
+
+	// 1.0 = neutral for Sat/Contrast; others are absolute
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
+	float Saturation = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
+	float Contrast = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
+	float Vignette = 0.2f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
+	float BloomIntensity = 0.2f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
+	float BloomThreshold = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
+	float SceneFringe = 0.0f; // Chromatic aberration
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Post")
+	float Grain = 0.0f; // Film grain intensity
+};
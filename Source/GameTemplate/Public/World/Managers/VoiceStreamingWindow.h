@@ -0,0 +1,44 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+
+struct FNarrationLine;
+class USoundBase;
+
+DECLARE_DELEGATE_TwoParams(FOnVoiceResident, int32 /*Line*/, USoundBase* /*Sound*/);
+
+/**
+ * Keeps the voice lines of the current narration line and the next few resident: async loads
+ * through the asset manager's streamable manager, primes the first stream chunk once loaded, and
+ * releases lines that fall behind the cursor.
+ */
+class GAMETEMPLATE_API FVoiceStreamingWindow
+{
+public:
+	void Init(int32 NumLines, int32 InLookahead);
+	void Reset();
+
+	/** Requests [CurrentLine, CurrentLine + Lookahead] and releases everything else */
+	void Update(const TArray<FNarrationLine>& Lines, int32 CurrentLine);
+
+	/** Runs OnResident once Line's voice is loaded: right away if it already is (or has no voice) */
+	void WhenResident(const TArray<FNarrationLine>& Lines, int32 Line, FStreamableDelegate OnResident);
+
+	/** Loaded sound for a line, or null if it isn't resident (yet) */
+	USoundBase* GetSound(int32 Line) const;
+	bool IsResident(int32 Line) const { return GetSound(Line) != nullptr; }
+
+	int32  GetNumResident() const;
+	SIZE_T GetResidentBytes() const;
+
+	/** Runs as each line's voice loads (after priming), e.g. to lay the line out to the voice's real length */
+	FOnVoiceResident OnVoiceResident;
+
+private:
+	TArray<TSharedPtr<FStreamableHandle>> Handles;
+	TSharedPtr<FStreamableHandle> WaitHandle;
+	int32 Lookahead = 2;
+};
@@ -29,6 +29,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Components")
 	TObjectPtr<USpotLightComponent> SpotLight;
 
+	/** Group for ALightSnapshotManager::ApplyGroupColor (e.g. "Wash", "Back") */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light")
+	FName FixtureGroup = NAME_None;
+
 	/** Change the beam color (used by the LightSnapshotManager) */
 	UFUNCTION(BlueprintCallable, Category="Light")
 	void SetLightColor(const FLinearColor& InColor);
@@ -39,4 +43,6 @@ public:
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void PostInitializeComponents() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 };
\ No newline at end of file
@@ -0,0 +1,115 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SpotLightComponent.h"
+#include "StageLightRig.generated.h"
+
+/** One fixture on a rig (transform is relative to the rig) */
+USTRUCT(BlueprintType)
+struct FStageFixture
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Fixture", meta=(MakeEditWidget))
+	FTransform Transform;
+
+	/** Yoke yaw and head pitch, in degrees */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Fixture")
+	float Pan = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Fixture")
+	float Tilt = 0.f;
+
+	/** Only fixtures that actually light the set need a real spotlight; the rest are emissive heads */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Fixture")
+	bool bHasBeam = false;
+
+	/** Group for ALightSnapshotManager::ApplyGroupColor */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Fixture")
+	FName Group = NAME_None;
+};
+
+/**
+ * A truss of fixtures drawn as three instanced meshes (base, yoke, head) instead of one actor
+ * per light. Head color goes through per-instance custom data (0-3 = linear RGBA), so the head
+ * material must read PerInstanceCustomData. Spotlights are only created for bHasBeam fixtures.
+ */
+UCLASS()
+class GAMETEMPLATE_API AStageLightRig : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AStageLightRig();
+
+	virtual void OnConstruction(const FTransform& Transform) override;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Light|Components")
+	TObjectPtr<USceneComponent> SceneRoot;
+
+	// Assign meshes in BP (same meshes as AStageLight)
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Light|Components")
+	TObjectPtr<UInstancedStaticMeshComponent> BaseInstances;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Light|Components")
+	TObjectPtr<UInstancedStaticMeshComponent> YokeInstances;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Light|Components")
+	TObjectPtr<UInstancedStaticMeshComponent> HeadInstances;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Rig")
+	TArray<FStageFixture> Fixtures;
+
+	/** Yoke pivot above the base, head pivot above the yoke */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Rig")
+	FVector YokeOffset = FVector(0.f, 0.f, 20.f);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Rig")
+	FVector HeadOffset = FVector(0.f, 0.f, 30.f);
+
+	// Settings every beam is created with
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Beams")
+	float BeamIntensity = 5000.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Beams")
+	float BeamOuterConeAngle = 20.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Beams")
+	float BeamAttenuationRadius = 3000.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Light|Beams")
+	bool bBeamsCastShadows = false;
+
+	int32 GetNumFixtures() const { return Fixtures.Num(); }
+	FName GetFixtureGroup(int32 Fixture) const { return Fixtures.IsValidIndex(Fixture) ? Fixtures[Fixture].Group : NAME_None; }
+
+	/** Spotlight for a fixture, or null when it has no beam. Beams are created on first use. */
+	USpotLightComponent* GetBeam(int32 Fixture);
+
+	/** Writes a head color without a render update; FlushHeadColors sends every write in one instance-data update */
+	void SetHeadColor(int32 Fixture, const FLinearColor& Color);
+	void FlushHeadColors();
+
+	/** Rebuild instances (and beams, if already created) after editing Fixtures at runtime */
+	UFUNCTION(BlueprintCallable, Category="Light|Rig")
+	void RebuildRig();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void PostInitializeComponents() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void BuildInstances();
+	void BuildBeams();
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<USpotLightComponent>> Beams;
+
+	bool bBeamsBuilt = false;
+	bool bHeadColorsDirty = false;
+};
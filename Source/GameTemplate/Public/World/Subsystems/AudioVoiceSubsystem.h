@@ -0,0 +1,222 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AudioVoiceSubsystem.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+
+UENUM(BlueprintType)
+enum class EAudioVoiceCategory : uint8
+{
+	Narration,
+	Interaction,
+	SFX,
+	Count UMETA(Hidden)
+};
+
+/** How many components a category keeps and how many of its voices may sound at once */
+USTRUCT(BlueprintType)
+struct FAudioVoiceCategorySettings
+{
+	GENERATED_BODY()
+
+	FAudioVoiceCategorySettings() = default;
+	FAudioVoiceCategorySettings(int32 InPoolSize, int32 InMaxVoices, bool bInVirtualize)
+		: PoolSize(InPoolSize), MaxVoices(InMaxVoices), bVirtualize(bInVirtualize) {}
+
+	// Components created on world begin play
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Voices", meta=(ClampMin="0"))
+	int32 PoolSize = 4;
+
+	// Voices sounding at once; past this a new voice takes the place of a lower priority one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Voices", meta=(ClampMin="1"))
+	int32 MaxVoices = 8;
+
+	// Keep voices that can't be heard (out of range, or outranked) as virtual voices that
+	// come back at their current position when they can
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Voices")
+	bool bVirtualize = true;
+};
+
+/** Counters of one category since the world began play */
+USTRUCT(BlueprintType)
+struct FAudioVoicePoolStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Voices")
+	int32 NumComponents = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Voices")
+	int32 NumPlaying = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Voices")
+	int32 NumVirtual = 0;
+
+	// Voices that got a pooled component / that had to create one
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Voices")
+	int32 Hits = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Voices")
+	int32 Misses = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Voices")
+	int32 Steals = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Voices")
+	int32 Virtualized = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Voices")
+	int32 Rejected = 0;
+};
+
+/** A voice started through the subsystem (stays valid for the voice's lifetime only) */
+USTRUCT(BlueprintType)
+struct FAudioVoiceHandle
+{
+	GENERATED_BODY()
+
+	bool IsValid() const { return Serial != 0; }
+	void Reset() { Index = INDEX_NONE; Serial = 0; }
+
+	int32  Index  = INDEX_NONE;
+	uint32 Serial = 0;
+};
+
+/** One live voice: sounding on a pooled component, or virtual (tracked without one) */
+USTRUCT()
+struct FAudioVoice
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<USoundBase> Sound = nullptr;
+
+	int32   ComponentIndex = INDEX_NONE; // into the category's pool, INDEX_NONE while virtual
+	FVector Location     = FVector::ZeroVector;
+	double  StartTime    = 0.0; // audio time the voice started (or would have)
+	float   Duration     = 0.f;
+	float   Priority     = 1.f;
+	float   Volume       = 1.f;
+	uint32  Serial       = 0;     // 0 while the slot is free
+	EAudioVoiceCategory Category = EAudioVoiceCategory::SFX;
+	bool    bSpatial     = false;
+	bool    bStartedByCaller = false; // AcquireVoice: the caller starts it (quantized starts)
+
+	bool IsVirtual() const { return Serial != 0 && ComponentIndex == INDEX_NONE; }
+};
+
+USTRUCT()
+struct FAudioVoicePool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<UAudioComponent>> Components;
+
+	TArray<int32> Free;    // indices into Components
+	TArray<int32> Owner;   // voice on each component, or INDEX_NONE
+	int32 NumPlaying = 0;
+	FAudioVoicePoolStats Stats;
+};
+
+/**
+ * Persistent audio components for narration, interaction and one-shot sounds. Each category
+ * preallocates its components when the world begins play and hands them out again as voices finish,
+ * so a steady stream of sounds creates no UObjects (Misses counts the times a pool had to grow).
+ * A category holds at most MaxVoices sounding voices; a louder claim (higher priority) stops or
+ * virtualizes the quietest one. Spatial voices beyond their sound's attenuation range are kept as
+ * virtual voices with no component, and come back at their elapsed position once in range.
+ */
+UCLASS(Config=Game)
+class GAMETEMPLATE_API UAudioVoiceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UAudioVoiceSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Play Sound unspatialized; returns an invalid handle if the category is full of louder voices */
+	UFUNCTION(BlueprintCallable, Category="Audio|Voices")
+	FAudioVoiceHandle PlaySound2D(EAudioVoiceCategory Category, USoundBase* Sound, float Priority = 1.f, float Volume = 1.f, float StartTime = 0.f);
+
+	/** Play Sound at Location; may start virtual if the listener is out of range */
+	UFUNCTION(BlueprintCallable, Category="Audio|Voices")
+	FAudioVoiceHandle PlaySoundAtLocation(EAudioVoiceCategory Category, USoundBase* Sound, FVector Location, float Priority = 1.f, float Volume = 1.f);
+
+	/**
+	 * A pooled 2D component set up with Sound for the caller to start itself (Play or PlayQuantized).
+	 * It is never virtualized, and goes back to the pool when it finishes or on StopVoice.
+	 */
+	UAudioComponent* AcquireVoice(EAudioVoiceCategory Category, USoundBase* Sound, FAudioVoiceHandle& OutHandle, float Priority = 1.f);
+
+	UFUNCTION(BlueprintCallable, Category="Audio|Voices")
+	void StopVoice(const FAudioVoiceHandle& Handle);
+
+	/** Still sounding or virtual */
+	UFUNCTION(BlueprintPure, Category="Audio|Voices")
+	bool IsVoiceActive(const FAudioVoiceHandle& Handle) const;
+
+	UFUNCTION(BlueprintPure, Category="Audio|Voices")
+	FAudioVoicePoolStats GetStats(EAudioVoiceCategory Category) const;
+
+	const FAudioVoiceCategorySettings& GetSettings(EAudioVoiceCategory Category) const;
+
+	UPROPERTY(EditAnywhere, Config, Category="Voices")
+	FAudioVoiceCategorySettings Narration { 2, 2, false };
+
+	UPROPERTY(EditAnywhere, Config, Category="Voices")
+	FAudioVoiceCategorySettings Interaction { 4, 6, true };
+
+	UPROPERTY(EditAnywhere, Config, Category="Voices")
+	FAudioVoiceCategorySettings SFX { 8, 16, true };
+
+	// How often virtual voices are checked for range, and sounding spatial ones for leaving it
+	UPROPERTY(EditAnywhere, Config, Category="Voices", meta=(ClampMin="0.02"))
+	float VirtualUpdateInterval = 0.1f;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	FAudioVoiceHandle StartVoice(EAudioVoiceCategory Category, USoundBase* Sound, bool bSpatial, const FVector& Location, float Priority, float Volume, float StartTime, bool bStartedByCaller);
+	bool MakeRoom(EAudioVoiceCategory Category, float Priority);
+	bool Realize(int32 VoiceIndex, float StartTime);
+	void Virtualize(int32 VoiceIndex);
+	void Release(int32 VoiceIndex);
+	int32 FindVictim(EAudioVoiceCategory Category) const;
+	void DetachComponent(int32 VoiceIndex);
+	int32 TakeComponent(EAudioVoiceCategory Category);
+	int32 CreateComponent(EAudioVoiceCategory Category);
+	int32 AllocVoice();
+
+	bool IsAudible(const FAudioVoice& Voice) const;
+	double GetAudioTime() const;
+	void UpdateVirtualVoices();
+	void UpdateTimer();
+
+	void HandleComponentFinished(UAudioComponent* Component, EAudioVoiceCategory Category, int32 ComponentIndex);
+
+	FAudioVoicePool& GetPool(EAudioVoiceCategory Category) { return Pools[static_cast<int32>(Category)]; }
+	const FAudioVoicePool& GetPool(EAudioVoiceCategory Category) const { return Pools[static_cast<int32>(Category)]; }
+
+	UPROPERTY(Transient)
+	FAudioVoicePool Pools[3]; // by EAudioVoiceCategory
+
+	UPROPERTY(Transient)
+	TArray<FAudioVoice> Voices;
+
+	TArray<int32> FreeVoices;
+	int32 NumVirtual   = 0;
+	int32 NumSpatial   = 0; // sounding spatial voices (watched for leaving range)
+	uint32 NextSerial  = 1;
+
+	FTimerHandle VirtualTimer;
+};
@@ -0,0 +1,216 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Audio/OnsetTempoTracker.h"
+#include "Quartz/AudioMixerClockHandle.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BeatClockSubsystem.generated.h"
+
+class UTempoMap;
+class USoundSubmix;
+
+/** Where the show is on the musical grid */
+USTRUCT(BlueprintType)
+struct FBeatClockTime
+{
+	GENERATED_BODY()
+
+	/** Beats since the clock started (0-based) */
+	UPROPERTY(BlueprintReadOnly, Category="Beat Clock")
+	int32 BeatIndex = 0;
+
+	/** Bar (0-based) and beat inside it (0-based) */
+	UPROPERTY(BlueprintReadOnly, Category="Beat Clock")
+	int32 Bar = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category="Beat Clock")
+	int32 BeatInBar = 0;
+
+	/** 0..1 through the current beat */
+	UPROPERTY(BlueprintReadOnly, Category="Beat Clock")
+	float BeatPhase = 0.f;
+
+	/** Sixteenth-note pulses since the clock started */
+	UPROPERTY(BlueprintReadOnly, Category="Beat Clock")
+	int32 PulseIndex = 0;
+};
+
+/**
+ * Tempo side of the beat clock, apart from Quartz so it can be replayed offline: the tempo each beat
+ * is scheduled with (a beat ahead, as the Quartz clock is retimed), the tempo of the beat playing,
+ * and the grid actually played so far.
+ */
+struct GAMETEMPLATE_API FBeatClockSchedule
+{
+	/** Back to beat 0 at the map's opening tempo */
+	void Start(const UTempoMap* InTempoMap);
+
+	/** Picks NextBeat's tempo: the map's, or FollowBPM shortened by Correction beats when FollowBPM > 0.
+	 *  True when it differs from the tempo scheduled before, i.e. the clock has to be retimed. */
+	bool Schedule(int32 NextBeat, float FollowBPM = 0.f, float Correction = 0.f);
+
+	/** Beat has started: the tempo scheduled for it is now the playing one */
+	void BeginBeat(int32 Beat);
+
+	/** Following the music: estimates less confident than this hold the tempo the clock has */
+	static constexpr float MinFollowConfidence = 0.25f;
+
+	/** Following the music, as a beat starts: the Correction for the next Schedule that pulls the
+	 *  clock's phase onto the music's (both 0..1 through the beat). Pending is the correction
+	 *  scheduled a beat ago, which only takes effect over the coming beat. */
+	static float CorrectPhase(float MusicPhase, float ClockPhase, float Pending);
+
+	float GetBPM() const { return CurrentBPM; }
+	float GetScheduledBPM() const { return ScheduledBPM; }
+
+	/** Start time of Beat, and the (fractional) beat at Seconds, on the grid played so far */
+	double GetBeatTime(int32 Beat) const;
+	double GetBeatAtTime(double Seconds) const;
+
+private:
+	const UTempoMap* TempoMap = nullptr;
+
+	float CurrentBPM    = 120.f;
+	float ScheduledBPM  = 120.f;
+	int32 ScheduledBeat = 0;
+
+	// Beats from AnchorBeat on run at CurrentBPM
+	int32  AnchorBeat    = 0;
+	double AnchorSeconds = 0.0;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnBeatClockEvent, const FBeatClockTime&);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnBeatClockEventBP, const FBeatClockTime&, Time);
+
+/**
+ * One beat/bar clock per world, running on a Quartz clock so it advances with the audio render
+ * clock rather than game time. Everything that used to keep its own beat timer subscribes here:
+ * OnPulse (sixteenths), OnBeat and OnBar are native multicasts fired from the Quartz metronome.
+ * Bars, meter and tempo changes come from a UTempoMap; the Quartz clock is retimed one beat ahead.
+ * FollowMusic hands the tempo to an onset/tempo tracker on the music submix instead: each beat is
+ * retimed to the detected BPM, shortened or stretched a little to pull in the detected beat phase.
+ */
+UCLASS()
+class GAMETEMPLATE_API UBeatClockSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UBeatClockSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void Deinitialize() override;
+
+	/** Start the clock from bar 0 at a fixed tempo; restarts it if it was already running */
+	UFUNCTION(BlueprintCallable, Category="Beat Clock")
+	void StartClock(float InBPM, int32 InBeatsPerBar = 4);
+
+	/** Start the clock from bar 0 following a tempo map */
+	UFUNCTION(BlueprintCallable, Category="Beat Clock")
+	void StartClockWithTempoMap(UTempoMap* InTempoMap);
+
+	UFUNCTION(BlueprintCallable, Category="Beat Clock")
+	void StopClock();
+
+	/** Follow the tempo and beats detected in the music playing through Submix. Bars and meter still
+	 *  come from the tempo map; its tempo is only the tracker's starting guess. */
+	UFUNCTION(BlueprintCallable, Category="Beat Clock")
+	void FollowMusic(USoundSubmix* Submix);
+
+	UFUNCTION(BlueprintCallable, Category="Beat Clock")
+	void StopFollowingMusic();
+
+	UFUNCTION(BlueprintPure, Category="Beat Clock")
+	bool IsFollowingMusic() const { return FollowTap.IsValid(); }
+
+	/** Latest tempo detected in the followed music (invalid for the first few seconds) */
+	const FTempoEstimate& GetDetectedTempo() const { return Detected; }
+
+	UFUNCTION(BlueprintPure, Category="Beat Clock")
+	bool IsClockRunning() const { return bRunning; }
+
+	/** Current position, with the phase read from the audio clock */
+	UFUNCTION(BlueprintPure, Category="Beat Clock")
+	FBeatClockTime GetCurrentTime() const;
+
+	UFUNCTION(BlueprintPure, Category="Beat Clock")
+	float GetTimeUntilNextBeat() const;
+
+	/** Length of the beat playing now (a scheduled tempo change only counts once its beat starts) */
+	UFUNCTION(BlueprintPure, Category="Beat Clock")
+	float GetSecondsPerBeat() const { return 60.f / Schedule.GetBPM(); }
+
+	/** Tempo of the beat playing now */
+	float GetBPM() const { return Schedule.GetBPM(); }
+
+	/** Tempo the Quartz clock is retimed to; read from OnBeat it is the coming beat's */
+	float GetScheduledBPM() const { return Schedule.GetScheduledBPM(); }
+
+	int32 GetBeatsPerBar() const;
+	int32 GetPulsesPerBeat() const { return PulsesPerBeat; }
+
+	/** Audio transport time, and the grid time of a beat on the tempo map */
+	double GetTransportSeconds() const;
+	double GetBeatTime(int32 Beat) const;
+
+	/** First beat (or first bar line, by the tempo map's meter) after the audio transport's current position */
+	int32 GetNextBoundaryBeat(bool bOnBar) const;
+
+	/** Quartz boundary that fires exactly on Beat, counted from the clock's current position */
+	FQuartzQuantizationBoundary MakeBoundaryForBeat(int32 Beat) const;
+
+	/** Tempo map the clock follows (a constant one when started from a BPM) */
+	UTempoMap* GetTempoMap() const { return TempoMap; }
+
+	/** Quartz clock the grid runs on (for quantized playback) */
+	UQuartzClockHandle* GetClockHandle() const { return ClockHandle; }
+	FName GetClockName() const { return ClockName; }
+
+	FOnBeatClockEvent OnPulse;
+	FOnBeatClockEvent OnBeat;
+	FOnBeatClockEvent OnBar;
+
+	UPROPERTY(BlueprintAssignable, Category="Beat Clock")
+	FOnBeatClockEventBP OnBeatBP;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UFUNCTION()
+	void HandleMetronome(FName InClockName, EQuartzCommandQuantization QuantizationType, int32 NumBars, int32 Beat, float BeatFraction);
+
+	void TrackDrift(const FBeatClockTime& Time);
+	void ScheduleTempoForBeat(int32 Beat);
+	void UpdateFollow(int32 Beat);
+	void StartFollowTap(int32 SampleRate);
+	FTempoMapPosition GetTransportPosition() const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UQuartzClockHandle> ClockHandle = nullptr;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTempoMap> TempoMap = nullptr;
+
+	FName ClockName = TEXT("ShowBeatClock");
+
+	// Tempo per beat, and the grid the clock played
+	FBeatClockSchedule Schedule;
+	int32 PulsesPerBeat = 4;
+	bool  bRunning = false;
+
+	FBeatClockTime LastTime;
+
+	// Following the music: the tracker on the submix (the schedule's played grid replaces the
+	// tempo map's times, which no longer apply)
+	TSharedPtr<FTempoTrackerTap, ESPMode::ThreadSafe> FollowTap;
+	TWeakObjectPtr<USoundSubmix> FollowSubmix;
+	FTempoEstimate Detected;
+	float  FollowBPM         = 0.f;
+	float  PendingCorrection = 0.f; // beats the already scheduled next beat is shortened by
+
+	// au.BeatClock.LogDrift: audio transport seconds against the ideal grid, per beat
+	double DriftMinMs = 0.0;
+	double DriftMaxMs = 0.0;
+};
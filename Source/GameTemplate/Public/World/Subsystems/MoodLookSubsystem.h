@@ -0,0 +1,33 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MoodLookSubsystem.generated.h"
+
+class UMoodLookTable;
+
+/**
+ * Holds the world's one copy of the stock mood looks, built the first time anything asks for it.
+ * The snapshot managers and the audio manager share it until the show's own table is in, so a
+ * retune (mood.ReloadLooks) reaches all of them at once.
+ */
+UCLASS()
+class GAMETEMPLATE_API UMoodLookSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UMoodLookSubsystem* Get(const UObject* WorldContextObject);
+
+	/** The world's stock looks; a private copy outered to WorldContextObject in worlds without the subsystem */
+	static UMoodLookTable* GetDefaultLooks(UObject* WorldContextObject);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<UMoodLookTable> DefaultLooks = nullptr;
+};
@@ -0,0 +1,103 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/Scene.h"
+#include "World/Managers/MoodSpace.h"
+#include "World/Subsystems/SnapshotBlendSubsystem.h"
+#include "MoodSpaceSubsystem.generated.h"
+
+class AAudioSnapshotManager;
+class APostProcessSnapshotManager;
+class ALightSnapshotManager;
+class UMoodLookTable;
+
+/**
+ * Drives the room from a continuous (valence, energy) position instead of one discrete snapshot.
+ * The mood look table's space looks are packed once (audio fields and rig color as SIMD lanes,
+ * post looks as prebuilt settings); each step locates the position in the triangulated space and
+ * blends the three surrounding looks by their barycentric weights, in one pass for audio and light
+ * and as three weighted engine post layers. Taking the outputs clears the snapshot mixer and fades
+ * the space in over what they showed; a later snapshot base picks up from the last mixed look.
+ */
+UCLASS()
+class GAMETEMPLATE_API UMoodSpaceSubsystem : public UWorldSubsystem, public ISnapshotBlendChannel
+{
+	GENERATED_BODY()
+
+public:
+	static UMoodSpaceSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void Deinitialize() override;
+
+	/** Managers the blend is pushed to; any left null are taken from the stage registry */
+	void SetOutputs(AAudioSnapshotManager* InAudio, APostProcessSnapshotManager* InPost, ALightSnapshotManager* InLight);
+
+	/** The table whose space looks are blended (rebuild with RefreshLooks after a retune) */
+	void SetMoodLooks(UMoodLookTable* InMoodLooks);
+	void RefreshLooks();
+
+	/** Glide to a (valence, energy) position over Seconds, from wherever the position is now */
+	UFUNCTION(BlueprintCallable, Category="Snapshots|Mood Space")
+	void MoveTo(FVector2D Position, float Seconds = 1.f);
+
+	/** Stop driving the outputs (they keep the last mixed look) */
+	UFUNCTION(BlueprintCallable, Category="Snapshots|Mood Space")
+	void Stop();
+
+	UFUNCTION(BlueprintPure, Category="Snapshots|Mood Space")
+	FVector2D GetPosition() const { return FVector2D(Position); }
+
+	UFUNCTION(BlueprintPure, Category="Snapshots|Mood Space")
+	bool IsDriving() const { return bDriving; }
+
+	/** True once a table with at least one space look is set */
+	bool HasLooks() const;
+
+	const FMoodSpaceWeights& GetWeights() const { return Weights; }
+
+	virtual void StepSnapshotBlend(float Alpha) override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	using FLanes = TArray<float, TAlignedHeapAllocator<16>>;
+
+	void ResolveOutputs();
+	void BuildLooks();
+	void CaptureInitial();
+	void PushAt(float Alpha, bool bExact);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UMoodLookTable> MoodLooks = nullptr;
+
+	TWeakObjectPtr<AAudioSnapshotManager>       AudioOutput;
+	TWeakObjectPtr<APostProcessSnapshotManager> PostOutput;
+	TWeakObjectPtr<ALightSnapshotManager>       LightOutput;
+
+	// Look vector per space look: audio lanes, then color lanes
+	int32 NumAudioLanes = 0;
+	int32 NumLanes      = 0;
+	FLanes Looks;
+	FLanes Mixed;
+	FLanes Initial; // what the outputs showed when the space took them over
+	FLanes Delta;   // Mixed - Initial while fading in, sized with the looks
+	TArray<FPostProcessSettings> PostLooks;
+	bool bLooksBuilt = false;
+
+	// Glide From -> To over MoveDuration (elapsed time is tracked by the blend scheduler), while the
+	// space's share of the outputs fades FadeFrom -> 1 over Initial
+	FVector2f Position = FVector2f::ZeroVector;
+	FVector2f From     = FVector2f::ZeroVector;
+	FVector2f To       = FVector2f::ZeroVector;
+	float MoveDuration = 0.f;
+	float LastAlpha    = 0.f;
+	float Fade         = 1.f;
+	float FadeFrom     = 1.f;
+	bool  bDriving     = false;
+
+	FMoodSpaceWeights Weights;
+};
@@ -0,0 +1,94 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SnapshotBlendSubsystem.generated.h"
+
+class USnapshotBlendSubsystem;
+
+/** Implemented by the snapshot managers; receives the shared Alpha every scheduler step */
+class ISnapshotBlendChannel
+{
+public:
+	virtual ~ISnapshotBlendChannel() = default;
+
+	/** Apply the look at Alpha (0..1) along the active blend. Alpha reaches exactly 1 on the last step. */
+	virtual void StepSnapshotBlend(float Alpha) = 0;
+};
+
+/** Tick function owned by the scheduler; only enabled while at least one blend is in flight */
+USTRUCT()
+struct FSnapshotBlendTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	USnapshotBlendSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FSnapshotBlendTickFunction> : public TStructOpsTypeTraitsBase2<FSnapshotBlendTickFunction>
+{
+	enum { WithCopy = false };
+};
+
+/**
+ * World-level scheduler for snapshot blends.
+ * The audio, post and light managers register a blend here instead of ticking themselves.
+ * Blends started in the same frame with the same duration share one group and one Alpha,
+ * so the three looks fired by a narration line land on identical values every frame.
+ */
+UCLASS()
+class GAMETEMPLATE_API USnapshotBlendSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static USnapshotBlendSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Start (or restart) the blend owned by Owner. Channel is stepped until Alpha reaches 1. */
+	void BeginBlend(UObject* Owner, ISnapshotBlendChannel* Channel, float DurationSeconds);
+
+	/** Drop Owner's blend without a final step */
+	void CancelBlend(const UObject* Owner);
+
+	bool IsBlending(const UObject* Owner) const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	friend struct FSnapshotBlendTickFunction;
+
+	struct FBlendGroup
+	{
+		uint64 StartFrame = 0;
+		float  Duration   = 0.f;
+		float  Elapsed    = 0.f;
+	};
+
+	struct FActiveBlend
+	{
+		TWeakObjectPtr<UObject> Owner;
+		ISnapshotBlendChannel*  Channel = nullptr;
+		int32                   Group   = INDEX_NONE;
+	};
+
+	void StepBlends(float DeltaSeconds);
+	int32 FindOrAddGroup(float DurationSeconds);
+	void SetAwake(bool bAwake);
+
+	FSnapshotBlendTickFunction BlendTickFunction;
+
+	TArray<FBlendGroup>  Groups;
+	TArray<FActiveBlend> ActiveBlends;
+};
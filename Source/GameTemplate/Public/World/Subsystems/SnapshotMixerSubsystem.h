@@ -0,0 +1,156 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "World/Managers/SnapshotBlender.h"
+#include "World/Managers/SnapshotTypes.h"
+#include "World/Subsystems/SnapshotBlendSubsystem.h"
+#include "SnapshotMixerSubsystem.generated.h"
+
+class AAudioSnapshotManager;
+class APostProcessSnapshotManager;
+class ALightSnapshotManager;
+
+UENUM(BlueprintType)
+enum class ESnapshotLayerMode : uint8
+{
+	/** Blends the layer's look over everything below it by the layer's weight */
+	Override,
+	/** Adds the look's offset from the neutral look (the struct defaults, black light), scaled by weight */
+	Additive
+};
+
+/** One mixer layer as the post output sees it, bottom to top */
+struct FSnapshotLayerWeight
+{
+	EAudioSnapshot Snapshot = EAudioSnapshot::CELESTIAL;
+	float          Weight   = 0.f;
+};
+
+/**
+ * Layered snapshot mixer: a base look plus transient overlays (e.g. a CONFLICT hit over
+ * REFLECTION), each with a priority, a mode and a weight envelope. Every step evaluates all
+ * layers in one pass over packed look vectors (the reflected float fields of FSnapshotTargets,
+ * then the rig color, four lanes per SIMD register) and feeds the audio and light managers the mixed values; the post manager gets the
+ * layer weights and stacks its prebuilt looks as engine post layers.
+ *
+ * Preemption starts from where the mix is now: a new layer at a used priority freezes the layers
+ * there at their current weight and retires them once it is fully in, so an interrupted crossfade
+ * carries on from the blended look instead of snapping back.
+ */
+UCLASS()
+class GAMETEMPLATE_API USnapshotMixerSubsystem : public UWorldSubsystem, public ISnapshotBlendChannel
+{
+	GENERATED_BODY()
+
+public:
+	static USnapshotMixerSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void Deinitialize() override;
+
+	/** Managers the mix is pushed to; any left null are taken from the stage registry */
+	void SetOutputs(AAudioSnapshotManager* InAudio, APostProcessSnapshotManager* InPost, ALightSnapshotManager* InLight);
+
+	/** Crossfade the base look (preempts a base crossfade in flight) */
+	UFUNCTION(BlueprintCallable, Category="Snapshots|Mixer")
+	void SetBaseSnapshot(EAudioSnapshot Snapshot, float BlendSeconds = 0.35f);
+
+	/** Push an overlay above the base; higher priority sits on top, and pushing at a priority that
+	 *  is in use preempts the layers there. HoldSeconds < 0 holds until ReleaseOverlay. */
+	UFUNCTION(BlueprintCallable, Category="Snapshots|Mixer")
+	int32 PushOverlay(EAudioSnapshot Snapshot, int32 Priority = 1, ESnapshotLayerMode Mode = ESnapshotLayerMode::Override,
+		float FadeInSeconds = 0.2f, float HoldSeconds = -1.f, float FadeOutSeconds = 0.5f);
+
+	/** Fade an overlay out from its current weight (FadeOutSeconds < 0 uses the one it was pushed with) */
+	UFUNCTION(BlueprintCallable, Category="Snapshots|Mixer")
+	void ReleaseOverlay(int32 Handle, float FadeOutSeconds = -1.f);
+
+	UFUNCTION(BlueprintCallable, Category="Snapshots|Mixer")
+	void ReleaseAllOverlays(float FadeOutSeconds = 0.5f);
+
+	/** Drop every layer without pushing anything (another source, such as the mood space, takes the outputs) */
+	void ClearLayers();
+
+	/** Rebuild the look vectors from the managers' looks on the next change */
+	void InvalidateLooks() { bLooksBuilt = false; }
+
+	/** Rebuild the look vectors now and push the stack re-mixed with them (after a mood look retune) */
+	void RefreshLooks();
+
+	int32 GetNumLayers() const { return Layers.Num(); }
+
+	virtual void StepSnapshotBlend(float Alpha) override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static constexpr int32 BasePriority = MIN_int32;
+	static constexpr float Held = MAX_flt;
+
+	using FLanes = TArray<float, TAlignedHeapAllocator<16>>;
+
+	struct FLayer
+	{
+		int32 Handle   = INDEX_NONE;
+		int32 Priority = 0;
+		EAudioSnapshot     Snapshot = EAudioSnapshot::CELESTIAL;
+		ESnapshotLayerMode Mode     = ESnapshotLayerMode::Override;
+
+		// Weight ramps From -> To over [RampStart, RampStart + RampDuration] on the mixer clock
+		float WeightFrom   = 0.f;
+		float WeightTo     = 1.f;
+		float RampStart    = 0.f;
+		float RampDuration = 0.f;
+
+		// Fades to 0 over FadeOut from ReleaseAt, then leaves the stack
+		float ReleaseAt = Held;
+		float FadeOut   = 0.5f;
+
+		// As of the last Evaluate
+		float Weight = 0.f;
+	};
+
+	void MakeLook(const FSnapshotTargets& Audio, const FLinearColor& Color, float* OutLanes) const;
+	static float WeightAt(const FLayer& Layer, float Time);
+	static float SettleTime(const FLayer& Layer);
+
+	int32 AddLayer(EAudioSnapshot Snapshot, int32 Priority, ESnapshotLayerMode Mode, float FadeIn, float Hold, float FadeOut);
+	void ResolveOutputs();
+	void BuildLooks();
+	void CaptureInitial();
+
+	void BeginChange();
+	void FinishChange();
+	void StepAt(float Time, bool bExact);
+	void Evaluate(float Time);
+	void RetireFinished(float Time);
+	void PushOutputs(bool bExact, float RampSeconds);
+
+	TWeakObjectPtr<AAudioSnapshotManager>       AudioOutput;
+	TWeakObjectPtr<APostProcessSnapshotManager> PostOutput;
+	TWeakObjectPtr<ALightSnapshotManager>       LightOutput;
+
+	// Look vector: audio lanes, then color lanes
+	int32 NumAudioLanes = 0;
+	int32 NumLanes      = 0;
+
+	// NumLanes per snapshot, indexed by EAudioSnapshot value
+	FLanes Looks;
+	FLanes Offsets;
+	bool bLooksBuilt = false;
+
+	// What the stack sits on: the managers' state before the first layer
+	FLanes Initial;
+	FLanes Mixed;
+
+	// Sorted by priority, bottom first (equal priorities in push order)
+	TArray<FLayer> Layers;
+	int32 NextHandle = 1;
+
+	// Mixer clock (elapsed time is tracked by the blend scheduler; it runs 0..BlendDuration)
+	float BlendDuration = 0.f;
+	float ClockTime     = 0.f;
+};
@@ -0,0 +1,90 @@
+﻿// © Anastasis Marinos //
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StageRegistrySubsystem.generated.h"
+
+class APostProcessVolume;
+class ULevel;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnStageActorRegistration, AActor* /*Actor*/, UClass* /*Category*/);
+
+/**
+ * Per-world index of the show's actors. Snapshot managers and fixtures register themselves under
+ * their native class (from PostInitializeComponents, so everything in a level is in before any
+ * BeginPlay) and leave on EndPlay; lookups by class and by actor tag are map lookups instead of
+ * actor-iterator scans. OnRegistered lets managers pick up actors spawned or streamed in later.
+ */
+UCLASS()
+class GAMETEMPLATE_API UStageRegistrySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UStageRegistrySubsystem* Get(const UObject* WorldContextObject);
+
+	void Register(AActor* Actor, UClass* Category);
+	void Unregister(AActor* Actor, UClass* Category);
+
+	/** Actor joins (leaves) its own world's registry: the one call for PostInitializeComponents
+	 *  (EndPlay); a no-op in worlds without a registry */
+	static void RegisterActor(AActor* Actor, UClass* Category);
+	static void UnregisterActor(AActor* Actor, UClass* Category);
+
+	bool IsRegistered(const AActor* Actor, UClass* Category) const;
+
+	/** First live actor registered under Category (null if none) */
+	AActor* GetFirst(UClass* Category) const;
+
+	/** Every actor registered under Category (entries can be stale until they unregister) */
+	const TArray<TWeakObjectPtr<AActor>>& GetAll(UClass* Category) const;
+
+	/** First live actor registered under Category that carries Tag */
+	AActor* FindByTag(UClass* Category, FName Tag) const;
+
+	template<class T> T* GetFirst() const { return Cast<T>(GetFirst(T::StaticClass())); }
+	template<class T> T* FindByTag(FName Tag) const { return Cast<T>(FindByTag(T::StaticClass(), Tag)); }
+
+	/** Post volume to drive: the first unbound one if bPreferUnbound, else the first at all.
+	 *  Post volumes are engine actors, so the registry registers them itself (see OnWorldBeginPlay). */
+	APostProcessVolume* FindPostVolume(bool bPreferUnbound = true) const;
+
+	FOnStageActorRegistration OnRegistered;
+	FOnStageActorRegistration OnUnregistered;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Registers the post volumes of the levels loaded so far, before any actor's BeginPlay */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	// Post volumes join and leave with their level, or when spawned and destroyed
+	void RegisterPostVolumes(const ULevel* Level);
+	void UnregisterPostVolumes(const ULevel* Level);
+	void HandleLevelAdded(ULevel* Level, UWorld* InWorld);
+	void HandleLevelRemoved(ULevel* Level, UWorld* InWorld);
+	void HandleActorSpawned(AActor* Actor);
+	void HandleActorDestroyed(AActor* Actor);
+
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ActorDestroyedHandle;
+
+	// Tags an actor was registered under (its Tags may change while it is in), and in how many categories
+	struct FRegisteredTags
+	{
+		TArray<FName> Tags;
+		int32 NumCategories = 0;
+	};
+
+	TMap<UClass*, TArray<TWeakObjectPtr<AActor>>> ByClass;
+	TMap<FName, TArray<TWeakObjectPtr<AActor>>>   ByTag;
+	TMap<TWeakObjectPtr<AActor>, FRegisteredTags> TagsOf;
+};